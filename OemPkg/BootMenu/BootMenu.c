@@ -25,6 +25,7 @@
 #include <Protocol/DfciSettingAccess.h>
 #include <Protocol/MsFrontPageAuthTokenProtocol.h>
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
@@ -136,6 +137,31 @@ DriverCallback (
   OUT EFI_BROWSER_ACTION_REQUEST            *ActionRequest
   );
 
+//
+// FrontPage starts a new browser session every time a top menu entry is selected, and each
+// session extracts BootSettingsConfig, BootGrayoutConfig and BootSuppressConfig, which read
+// the same DFCI settings. Each setting is read once and kept until it is written, the setting
+// access provider changes or FrontPage hands out a new auth token. While FrontPage runs these
+// settings only change through SetSetting, on the apply path of this form; DFCI applies its
+// settings packets when BDS starts, before FrontPage.
+//
+typedef struct {
+  DFCI_SETTING_ID_STRING    Id;
+  BOOLEAN                   Valid;
+  EFI_STATUS                Status;
+  UINT8                     Value;
+  DFCI_SETTING_FLAGS        Flags;
+} BOOT_MENU_SETTING_CACHE_ENTRY;
+
+STATIC BOOT_MENU_SETTING_CACHE_ENTRY  mSettingCache[] = {
+  { DFCI_SETTING_ID__IPV6,            FALSE, EFI_NOT_READY, 0, 0 },
+  { DFCI_SETTING_ID__ALT_BOOT,        FALSE, EFI_NOT_READY, 0, 0 },
+  { DFCI_SETTING_ID__BOOT_ORDER_LOCK, FALSE, EFI_NOT_READY, 0, 0 },
+  { DFCI_SETTING_ID__ENABLE_USB_BOOT, FALSE, EFI_NOT_READY, 0, 0 }
+};
+
+STATIC DFCI_AUTH_TOKEN  mSettingCacheAuthToken;
+
 typedef struct {
   UINTN                             Signature;
   EFI_HANDLE                        DriverHandle;
@@ -154,6 +180,27 @@ BOOT_MENU_PRIVATE  mBootMenuPrivate = {
   }
 };
 
+/**
+  Invalidate cached setting values.
+
+  @param  Id                     The setting to invalidate, or NULL for all settings.
+
+**/
+STATIC
+VOID
+InvalidateSettingCache (
+  IN DFCI_SETTING_ID_STRING  Id OPTIONAL
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mSettingCache); Index++) {
+    if ((Id == NULL) || (AsciiStrCmp (mSettingCache[Index].Id, Id) == 0)) {
+      mSettingCache[Index].Valid = FALSE;
+    }
+  }
+}
+
 /**
   SWM registration notification callback
 
@@ -211,6 +258,8 @@ SettingAccessCallback (
     DEBUG ((DEBUG_ERROR, "Unable to locate SettingAccess. Code=%r\n", Status));
   }
 
+  InvalidateSettingCache (NULL);
+
   return;
 }
 
@@ -665,6 +714,75 @@ DriverCallback (
   return Status;
 }
 
+/**
+  Read a setting through the cache. Successful reads and EFI_NOT_FOUND (no provider for the
+  setting) are cached; other errors are retried on the next read.
+
+  @param  Id                     The setting to get.
+  @param  Value                  Where to store the setting value.
+  @param  Flags                  Where to store the setting flags.
+
+  @retval                        Status from Setting Access provider.
+
+**/
+STATIC
+EFI_STATUS
+GetCachedSetting (
+  IN  DFCI_SETTING_ID_STRING  Id,
+  OUT UINT8                   *Value,
+  OUT DFCI_SETTING_FLAGS      *Flags
+  )
+{
+  BOOT_MENU_SETTING_CACHE_ENTRY  *Entry;
+  UINTN                          ValueSize;
+  UINTN                          Index;
+
+  if (mSettingCacheAuthToken != mAuthToken) {
+    InvalidateSettingCache (NULL);
+    mSettingCacheAuthToken = mAuthToken;
+  }
+
+  Entry = NULL;
+  for (Index = 0; Index < ARRAY_SIZE (mSettingCache); Index++) {
+    if (AsciiStrCmp (mSettingCache[Index].Id, Id) == 0) {
+      Entry = &mSettingCache[Index];
+      break;
+    }
+  }
+
+  if (Entry == NULL) {
+    ValueSize = sizeof (UINT8);
+    return mSettingAccess->Get (
+                             mSettingAccess,
+                             Id,
+                             &mAuthToken,
+                             DFCI_SETTING_TYPE_ENABLE,
+                             &ValueSize,
+                             Value,
+                             Flags
+                             );
+  }
+
+  if (!Entry->Valid) {
+    ValueSize     = sizeof (Entry->Value);
+    Entry->Flags  = 0;
+    Entry->Status = mSettingAccess->Get (
+                                      mSettingAccess,
+                                      Id,
+                                      &mAuthToken,
+                                      DFCI_SETTING_TYPE_ENABLE,
+                                      &ValueSize,
+                                      &Entry->Value,
+                                      &Entry->Flags
+                                      );
+    Entry->Valid = (!EFI_ERROR (Entry->Status) || (Entry->Status == EFI_NOT_FOUND));
+  }
+
+  *Value = Entry->Value;
+  *Flags = Entry->Flags;
+  return Entry->Status;
+}
+
 /**
   GetSetting gets a setting from the settings access provider
 
@@ -682,18 +800,8 @@ GetSetting (
 {
   EFI_STATUS          Status;
   DFCI_SETTING_FLAGS  Flags;
-  UINTN               ValueSize;
-
-  ValueSize = sizeof (UINT8);
-  Status    = mSettingAccess->Get (
-                                mSettingAccess,
-                                Id,
-                                &mAuthToken,
-                                DFCI_SETTING_TYPE_ENABLE,
-                                &ValueSize,
-                                Data,
-                                &Flags
-                                );
+
+  Status = GetCachedSetting (Id, Data, &Flags);
   if (EFI_ERROR (Status)) {
     *Data = TRUE;
     DEBUG ((DEBUG_ERROR, "%a Internal error getting setting id %d - code=%r\n", __FUNCTION__, Id, Status));
@@ -720,19 +828,9 @@ GetSettingGrayoutFlag (
   EFI_STATUS          Status;
   DFCI_SETTING_FLAGS  Flags;
   UINT8               Temp;
-  UINTN               ValueSize;
-
-  *Data     = FALSE;  // If Get Setting fails, assume Grayed out
-  ValueSize = sizeof (Temp);
-  Status    = mSettingAccess->Get (
-                                mSettingAccess,
-                                Id,
-                                &mAuthToken,
-                                DFCI_SETTING_TYPE_ENABLE,
-                                &ValueSize,
-                                &Temp,
-                                &Flags
-                                );
+
+  *Data  = FALSE;  // If Get Setting fails, assume Grayed out
+  Status = GetCachedSetting (Id, &Temp, &Flags);
   if (!EFI_ERROR (Status)) {
     if ((DFCI_SETTING_FLAGS_OUT_WRITE_ACCESS & Flags) == 0) {
       mSettingsGrayoutConfiguration.RestrictedAccessString |= TRUE;
@@ -764,19 +862,9 @@ GetSettingSuppressFlag (
   EFI_STATUS          Status;
   DFCI_SETTING_FLAGS  Flags;
   UINT8               Temp;
-  UINTN               ValueSize;
-
-  *Data     = FALSE;  // If Get Setting fails, assume setting is not suppressed
-  ValueSize = sizeof (UINT8);
-  Status    = mSettingAccess->Get (
-                                mSettingAccess,
-                                Id,
-                                &mAuthToken,
-                                DFCI_SETTING_TYPE_ENABLE,
-                                &ValueSize,
-                                &Temp,
-                                &Flags
-                                );
+
+  *Data  = FALSE;  // If Get Setting fails, assume setting is not suppressed
+  Status = GetCachedSetting (Id, &Temp, &Flags);
   if (EFI_NOT_FOUND == Status) {
     // If the specific error ID_NOT_FOUND
     *Data = TRUE;                  // Suppress this setting as there is no provider
@@ -817,6 +905,11 @@ SetSetting (
                              Data,
                              &Flags
                              );
+
+  // The write may change the value or the access flags, even if it failed.
+  //
+  InvalidateSettingCache (Id);
+
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "Error setting id %d. Code = %r\n", Id, Status));
   }
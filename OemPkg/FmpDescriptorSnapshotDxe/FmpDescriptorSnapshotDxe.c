@@ -0,0 +1,581 @@
+/** @file FmpDescriptorSnapshotDxe.c
+
+  This module produces the FmpDescriptorSnapshot protocol. It captures the image descriptors of every
+  EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance the first time they are requested and keeps them for the rest
+  of the boot. An FMP instance is only queried again after it has been installed or reinstalled.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/FirmwareManagement.h>
+#include <Protocol/FmpDescriptorSnapshot.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+//
+// Captured state of a single FMP instance.
+//
+typedef struct {
+  LIST_ENTRY                          Link;
+  EFI_HANDLE                          Handle;
+  EFI_FIRMWARE_MANAGEMENT_PROTOCOL    *Fmp;
+  BOOLEAN                             Stale;
+  UINT8                               FailedCaptures;
+  UINT32                              DescriptorVersion;
+  UINT32                              PackageVersion;
+  CHAR16                              *PackageVersionName;
+  UINTN                               DescriptorCount;
+  EFI_FIRMWARE_IMAGE_DESCRIPTOR       *Descriptors;
+} FMP_SNAPSHOT_RECORD;
+
+#define FMP_SNAPSHOT_RECORD_FROM_LINK(a)  BASE_CR (a, FMP_SNAPSHOT_RECORD, Link)
+
+//
+// An FMP instance whose GetImageInfo keeps failing is queried at most this many times until it is reinstalled,
+// so that a broken device does not cost a slow bus query on every lookup.
+//
+#define FMP_SNAPSHOT_MAX_FAILED_CAPTURES  3
+
+STATIC LIST_ENTRY                     mRecordList = INITIALIZE_LIST_HEAD_VARIABLE (mRecordList);
+STATIC FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *mEntries   = NULL;
+STATIC UINTN                          mEntryCount = 0;
+STATIC BOOLEAN                        mInitialCaptureDone = FALSE;
+STATIC BOOLEAN                        mRefreshPending     = FALSE;
+STATIC VOID                           *mFmpRegistration   = NULL;
+
+/**
+  Free the captured descriptors of a record, leaving the record itself in place.
+
+  @param[in]  Record    Record to clear.
+
+**/
+STATIC
+VOID
+ClearRecord (
+  IN FMP_SNAPSHOT_RECORD  *Record
+  )
+{
+  UINTN  Index;
+
+  if (Record->Descriptors != NULL) {
+    for (Index = 0; Index < Record->DescriptorCount; Index++) {
+      if (Record->Descriptors[Index].ImageIdName != NULL) {
+        FreePool (Record->Descriptors[Index].ImageIdName);
+      }
+
+      if (Record->Descriptors[Index].VersionName != NULL) {
+        FreePool (Record->Descriptors[Index].VersionName);
+      }
+    }
+
+    FreePool (Record->Descriptors);
+    Record->Descriptors = NULL;
+  }
+
+  if (Record->PackageVersionName != NULL) {
+    FreePool (Record->PackageVersionName);
+    Record->PackageVersionName = NULL;
+  }
+
+  Record->DescriptorCount = 0;
+}
+
+/**
+  Find the record tracking an FMP handle.
+
+  @param[in]  Handle    FMP handle.
+
+  @retval  The record, or NULL if the handle is not tracked.
+
+**/
+STATIC
+FMP_SNAPSHOT_RECORD *
+FindRecord (
+  IN EFI_HANDLE  Handle
+  )
+{
+  LIST_ENTRY           *Link;
+  FMP_SNAPSHOT_RECORD  *Record;
+
+  for (Link = GetFirstNode (&mRecordList); !IsNull (&mRecordList, Link); Link = GetNextNode (&mRecordList, Link)) {
+    Record = FMP_SNAPSHOT_RECORD_FROM_LINK (Link);
+    if (Record->Handle == Handle) {
+      return Record;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Mark an FMP handle as needing a fresh capture, creating a record for it if it is new. The handle gets a
+  new budget of capture attempts.
+
+  @param[in]  Handle    FMP handle.
+
+**/
+STATIC
+VOID
+MarkHandleStale (
+  IN EFI_HANDLE  Handle
+  )
+{
+  FMP_SNAPSHOT_RECORD  *Record;
+
+  Record = FindRecord (Handle);
+  if (Record == NULL) {
+    Record = AllocateZeroPool (sizeof (FMP_SNAPSHOT_RECORD));
+    if (Record == NULL) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to allocate snapshot record.\n", __FUNCTION__));
+      return;
+    }
+
+    Record->Handle = Handle;
+    InsertTailList (&mRecordList, &Record->Link);
+  }
+
+  Record->Stale          = TRUE;
+  Record->FailedCaptures = 0;
+}
+
+/**
+  Query an FMP instance and replace the record's descriptors with deep copies of the current ones.
+
+  @param[in]  Record    Record to capture.
+
+  @retval EFI_SUCCESS   The descriptors were captured.
+  @retval Others        The FMP instance could not be queried.
+
+**/
+STATIC
+EFI_STATUS
+CaptureRecord (
+  IN FMP_SNAPSHOT_RECORD  *Record
+  )
+{
+  EFI_STATUS                     Status;
+  UINTN                          ImageInfoSize;
+  EFI_FIRMWARE_IMAGE_DESCRIPTOR  *ImageInfoBuf;
+  EFI_FIRMWARE_IMAGE_DESCRIPTOR  *Source;
+  EFI_FIRMWARE_IMAGE_DESCRIPTOR  *Copy;
+  UINT8                          DescriptorCount;
+  UINT32                         DescriptorVersion;
+  UINTN                          DescriptorSize;
+  UINT32                         PackageVersion;
+  CHAR16                         *PackageVersionName;
+  UINTN                          Index;
+
+  ClearRecord (Record);
+
+  ImageInfoBuf       = NULL;
+  PackageVersionName = NULL;
+  ImageInfoSize      = 0;
+
+  Status = Record->Fmp->GetImageInfo (
+                          Record->Fmp,
+                          &ImageInfoSize,
+                          NULL,
+                          &DescriptorVersion,
+                          &DescriptorCount,
+                          &DescriptorSize,
+                          &PackageVersion,
+                          &PackageVersionName
+                          );
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    DEBUG ((DEBUG_ERROR, "%a - Unexpected Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
+    return EFI_ERROR (Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  ImageInfoBuf = AllocateZeroPool (ImageInfoSize);
+  if (ImageInfoBuf == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PackageVersionName = NULL;
+  Status             = Record->Fmp->GetImageInfo (
+                                      Record->Fmp,
+                                      &ImageInfoSize,
+                                      ImageInfoBuf,
+                                      &DescriptorVersion,
+                                      &DescriptorCount,
+                                      &DescriptorSize,
+                                      &PackageVersion,
+                                      &PackageVersionName
+                                      );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
+    goto Exit;
+  }
+
+  if ((DescriptorCount > 0) && (((UINTN)DescriptorCount * DescriptorSize) > ImageInfoSize)) {
+    DEBUG ((DEBUG_ERROR, "%a - Descriptor count %d and size %d overflow the image info buffer.\n", __FUNCTION__, DescriptorCount, DescriptorSize));
+    Status = EFI_DEVICE_ERROR;
+    goto Exit;
+  }
+
+  if (DescriptorCount > 0) {
+    Record->Descriptors = AllocateZeroPool (DescriptorCount * sizeof (EFI_FIRMWARE_IMAGE_DESCRIPTOR));
+    if (Record->Descriptors == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+  }
+
+  //
+  // Descriptors are DescriptorSize apart, which may differ from the size of the structure this module
+  // was built with. Copy the fields both sides know about and take private copies of the strings.
+  //
+  for (Index = 0; Index < DescriptorCount; Index++) {
+    Source = (EFI_FIRMWARE_IMAGE_DESCRIPTOR *)((UINT8 *)ImageInfoBuf + (Index * DescriptorSize));
+    Copy   = &Record->Descriptors[Index];
+    CopyMem (Copy, Source, MIN (DescriptorSize, sizeof (EFI_FIRMWARE_IMAGE_DESCRIPTOR)));
+    Copy->ImageIdName  = NULL;
+    Copy->VersionName  = NULL;
+    Copy->Dependencies = NULL;
+
+    if (Source->ImageIdName != NULL) {
+      Copy->ImageIdName = AllocateCopyPool (StrSize (Source->ImageIdName), Source->ImageIdName);
+    }
+
+    if (Source->VersionName != NULL) {
+      Copy->VersionName = AllocateCopyPool (StrSize (Source->VersionName), Source->VersionName);
+    }
+
+    Record->DescriptorCount++;
+  }
+
+  Record->DescriptorVersion  = DescriptorVersion;
+  Record->PackageVersion     = PackageVersion;
+  Record->PackageVersionName = PackageVersionName;
+  PackageVersionName         = NULL;
+  Record->Stale              = FALSE;
+
+Exit:
+  if (EFI_ERROR (Status)) {
+    ClearRecord (Record);
+  }
+
+  if (PackageVersionName != NULL) {
+    FreePool (PackageVersionName);
+  }
+
+  FreePool (ImageInfoBuf);
+  return Status;
+}
+
+/**
+  Rebuild the flat entry array handed out to consumers from the record list.
+
+**/
+STATIC
+VOID
+RebuildEntries (
+  VOID
+  )
+{
+  LIST_ENTRY           *Link;
+  FMP_SNAPSHOT_RECORD  *Record;
+  UINTN                Count;
+  UINTN                Index;
+
+  if (mEntries != NULL) {
+    FreePool (mEntries);
+    mEntries = NULL;
+  }
+
+  mEntryCount = 0;
+
+  Count = 0;
+  for (Link = GetFirstNode (&mRecordList); !IsNull (&mRecordList, Link); Link = GetNextNode (&mRecordList, Link)) {
+    Count += FMP_SNAPSHOT_RECORD_FROM_LINK (Link)->DescriptorCount;
+  }
+
+  if (Count == 0) {
+    return;
+  }
+
+  mEntries = AllocateZeroPool (Count * sizeof (FMP_DESCRIPTOR_SNAPSHOT_ENTRY));
+  if (mEntries == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to allocate %d snapshot entries.\n", __FUNCTION__, Count));
+    return;
+  }
+
+  for (Link = GetFirstNode (&mRecordList); !IsNull (&mRecordList, Link); Link = GetNextNode (&mRecordList, Link)) {
+    Record = FMP_SNAPSHOT_RECORD_FROM_LINK (Link);
+    for (Index = 0; Index < Record->DescriptorCount; Index++) {
+      mEntries[mEntryCount].Handle             = Record->Handle;
+      mEntries[mEntryCount].DescriptorIndex    = Index;
+      mEntries[mEntryCount].DescriptorCount    = Record->DescriptorCount;
+      mEntries[mEntryCount].DescriptorVersion  = Record->DescriptorVersion;
+      mEntries[mEntryCount].PackageVersion     = Record->PackageVersion;
+      mEntries[mEntryCount].PackageVersionName = Record->PackageVersionName;
+      mEntries[mEntryCount].Descriptor         = &Record->Descriptors[Index];
+      mEntryCount++;
+    }
+  }
+}
+
+/**
+  Bring the snapshot up to date. Only FMP instances installed or reinstalled since the previous
+  refresh, and instances whose capture failed fewer than FMP_SNAPSHOT_MAX_FAILED_CAPTURES times, are
+  queried. Every record is checked with HandleProtocol, which does not reach the device, so records for
+  handles that no longer carry the FMP protocol are dropped even though uninstalls are not notified.
+
+**/
+STATIC
+VOID
+RefreshSnapshot (
+  VOID
+  )
+{
+  EFI_STATUS           Status;
+  EFI_HANDLE           *HandleBuffer;
+  EFI_HANDLE           Handle;
+  UINTN                HandleCount;
+  UINTN                BufferSize;
+  UINTN                Index;
+  LIST_ENTRY           *Link;
+  LIST_ENTRY           *NextLink;
+  FMP_SNAPSHOT_RECORD  *Record;
+  VOID                 *Interface;
+  BOOLEAN              Changed;
+
+  Changed = !mInitialCaptureDone;
+
+  if (!mInitialCaptureDone) {
+    Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiFirmwareManagementProtocolGuid, NULL, &HandleCount, &HandleBuffer);
+    if (!EFI_ERROR (Status)) {
+      for (Index = 0; Index < HandleCount; Index++) {
+        MarkHandleStale (HandleBuffer[Index]);
+      }
+
+      FreePool (HandleBuffer);
+    }
+
+    mInitialCaptureDone = TRUE;
+  }
+
+  //
+  // Drain the handles the notify registration has seen since the last refresh.
+  //
+  if (mRefreshPending) {
+    mRefreshPending = FALSE;
+    while (TRUE) {
+      BufferSize = sizeof (Handle);
+      Status     = gBS->LocateHandle (ByRegisterNotify, NULL, mFmpRegistration, &BufferSize, &Handle);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      MarkHandleStale (Handle);
+    }
+  }
+
+  for (Link = GetFirstNode (&mRecordList); !IsNull (&mRecordList, Link); Link = NextLink) {
+    NextLink = GetNextNode (&mRecordList, Link);
+    Record   = FMP_SNAPSHOT_RECORD_FROM_LINK (Link);
+
+    Status = gBS->HandleProtocol (Record->Handle, &gEfiFirmwareManagementProtocolGuid, &Interface);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_INFO, "%a - FMP handle %p is gone, dropping its descriptors.\n", __FUNCTION__, Record->Handle));
+      RemoveEntryList (&Record->Link);
+      ClearRecord (Record);
+      FreePool (Record);
+      Changed = TRUE;
+      continue;
+    }
+
+    if (Interface != (VOID *)Record->Fmp) {
+      Record->Fmp            = (EFI_FIRMWARE_MANAGEMENT_PROTOCOL *)Interface;
+      Record->Stale          = TRUE;
+      Record->FailedCaptures = 0;
+    }
+
+    if (Record->Stale && (Record->FailedCaptures < FMP_SNAPSHOT_MAX_FAILED_CAPTURES)) {
+      Status = CaptureRecord (Record);
+      if (EFI_ERROR (Status)) {
+        //
+        // Leave the record stale so a later refresh tries again, until it runs out of attempts.
+        //
+        Record->FailedCaptures++;
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Failed to capture FMP handle %p (attempt %d of %d). %r\n",
+          __FUNCTION__,
+          Record->Handle,
+          Record->FailedCaptures,
+          FMP_SNAPSHOT_MAX_FAILED_CAPTURES,
+          Status
+          ));
+      }
+
+      Changed = TRUE;
+    }
+  }
+
+  if (Changed) {
+    RebuildEntries ();
+  }
+}
+
+/**
+  Iterate over the captured descriptors of all FMP instances.
+
+  @param[in]      This      Protocol instance.
+  @param[in, out] Cursor    On input, 0 to start or the value returned by the previous call.
+                            On output, the value to pass to the next call.
+  @param[out]     Entry     The next captured descriptor.
+
+  @retval EFI_SUCCESS             Entry was returned.
+  @retval EFI_NOT_FOUND           There are no more entries.
+  @retval EFI_INVALID_PARAMETER   Cursor or Entry is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+SnapshotGetNext (
+  IN     FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL     *This,
+  IN OUT UINTN                                *Cursor,
+  OUT    CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  **Entry
+  )
+{
+  if ((Cursor == NULL) || (Entry == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (*Cursor == 0) {
+    RefreshSnapshot ();
+  }
+
+  if (*Cursor >= mEntryCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Entry = &mEntries[*Cursor];
+  (*Cursor)++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Look up the captured descriptor for an image type.
+
+  @param[in]  This          Protocol instance.
+  @param[in]  Handle        FMP handle to restrict the search to, or NULL to search every instance.
+  @param[in]  ImageTypeId   Image type to find.
+  @param[out] Entry         The matching descriptor.
+
+  @retval EFI_SUCCESS             Entry was returned.
+  @retval EFI_NOT_FOUND           No captured descriptor matches.
+  @retval EFI_INVALID_PARAMETER   ImageTypeId or Entry is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+SnapshotFind (
+  IN  FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL     *This,
+  IN  EFI_HANDLE                           Handle OPTIONAL,
+  IN  CONST EFI_GUID                       *ImageTypeId,
+  OUT CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  **Entry
+  )
+{
+  UINTN  Index;
+
+  if ((ImageTypeId == NULL) || (Entry == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RefreshSnapshot ();
+
+  for (Index = 0; Index < mEntryCount; Index++) {
+    if ((Handle != NULL) && (mEntries[Index].Handle != Handle)) {
+      continue;
+    }
+
+    if (CompareGuid (&mEntries[Index].Descriptor->ImageTypeId, ImageTypeId)) {
+      *Entry = &mEntries[Index];
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+STATIC FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL  mSnapshotProtocol = {
+  SnapshotGetNext,
+  SnapshotFind
+};
+
+/**
+  FMP install/reinstall notification. The handles are drained from the registration on the next
+  refresh so that GetImageInfo is never called at notification TPL.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+FmpInstallNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  mRefreshPending = TRUE;
+}
+
+/**
+  Entry point. Register for FMP install notifications and publish the snapshot protocol.
+  No FMP instance is queried until a consumer asks for descriptors.
+
+  @param[in]  ImageHandle   The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The protocol was installed.
+  @retval Others            The notification could not be registered or the protocol installed.
+
+**/
+EFI_STATUS
+EFIAPI
+FmpDescriptorSnapshotEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   Event;
+
+  Status = gBS->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, FmpInstallNotify, NULL, &Event);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to create FMP notify event. %r\n", __FUNCTION__, Status));
+    return Status;
+  }
+
+  Status = gBS->RegisterProtocolNotify (&gEfiFirmwareManagementProtocolGuid, Event, &mFmpRegistration);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to register for FMP notifications. %r\n", __FUNCTION__, Status));
+    gBS->CloseEvent (Event);
+    return Status;
+  }
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &ImageHandle,
+                  &gFmpDescriptorSnapshotProtocolGuid,
+                  &mSnapshotProtocol,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to install the snapshot protocol. %r\n", __FUNCTION__, Status));
+    gBS->CloseEvent (Event);
+  }
+
+  return Status;
+}
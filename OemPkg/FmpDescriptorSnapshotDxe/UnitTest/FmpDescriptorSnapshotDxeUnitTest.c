@@ -0,0 +1,688 @@
+/** @file FmpDescriptorSnapshotDxeUnitTest.c
+
+  Host based unit tests of FmpDescriptorSnapshotDxe.
+
+  The driver runs against a few mock FMP instances behind a minimal boot services table. Every mock
+  GetImageInfo call is charged MOCK_FMP_QUERY_US of simulated bus time, like an FMP that asks an EC over
+  I2C, and the tests check how many of those queries the snapshot makes: one capture per instance per
+  install, none for lookups, none for instances that were uninstalled and only a few for an instance
+  that keeps failing. The descriptors are returned DescriptorSize apart with DescriptorSize larger than
+  the structure, like a newer FMP would. The driver source is included so each test can drop the
+  records the driver kept.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../FmpDescriptorSnapshotDxe.c"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "FmpDescriptorSnapshotDxe Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define MOCK_FMP_COUNT             4
+#define MOCK_FMP_MAX_DESCRIPTORS   2
+#define MOCK_FMP_QUERY_US          20000
+#define MOCK_FMP_DESCRIPTOR_SIZE   (sizeof (EFI_FIRMWARE_IMAGE_DESCRIPTOR) + 16)
+#define MOCK_FMP_VERSION_NAME_LEN  16
+
+//
+// A mock FMP instance. Reinstalling it switches to its other protocol instance, so that the interface
+// pointer changes like it does when a driver reinstalls FMP.
+//
+typedef struct {
+  EFI_FIRMWARE_MANAGEMENT_PROTOCOL    Instance[2];
+  UINTN                               ActiveInstance;
+  BOOLEAN                             Installed;
+  BOOLEAN                             Notified;           // Not yet returned by LocateHandle (ByRegisterNotify).
+  EFI_STATUS                          QueryStatus;        // Returned by every GetImageInfo call when an error.
+  UINT8                               DescriptorCount;
+  UINT32                              Version;
+  CHAR16                              VersionName[MOCK_FMP_VERSION_NAME_LEN];
+  UINTN                               Queries;
+} MOCK_FMP;
+
+STATIC MOCK_FMP           mMockFmp[MOCK_FMP_COUNT];
+STATIC UINT64             mBusMicroseconds;
+STATIC EFI_BOOT_SERVICES  mTestBootServices;
+STATIC UINT8              mTestRegistration;
+
+EFI_BOOT_SERVICES  *gBS = &mTestBootServices;
+
+/**
+  Get the image type of a mock FMP descriptor.
+
+  @param[in]  Fmp         Index of the mock FMP.
+  @param[in]  Descriptor  Index of the descriptor.
+  @param[out] ImageTypeId Receives the image type.
+
+**/
+STATIC
+VOID
+MockImageTypeId (
+  IN  UINTN     Fmp,
+  IN  UINTN     Descriptor,
+  OUT EFI_GUID  *ImageTypeId
+  )
+{
+  ZeroMem (ImageTypeId, sizeof (*ImageTypeId));
+  ImageTypeId->Data1 = 0xF3D00000 | (UINT32)(Fmp << 8) | (UINT32)Descriptor;
+}
+
+/**
+  Find the mock FMP an interface belongs to.
+
+  @param[in]  This    The interface.
+
+  @retval     The mock FMP, or NULL if the interface is not one of the mocks.
+
+**/
+STATIC
+MOCK_FMP *
+MockFromInterface (
+  IN CONST EFI_FIRMWARE_MANAGEMENT_PROTOCOL  *This
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < MOCK_FMP_COUNT; Index++) {
+    if ((This == &mMockFmp[Index].Instance[0]) || (This == &mMockFmp[Index].Instance[1])) {
+      return &mMockFmp[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Slow mock GetImageInfo. Every call is a simulated bus query.
+
+  @param[in]      This                Protocol instance.
+  @param[in, out] ImageInfoSize       Size of ImageInfo on input, size of the image info on output.
+  @param[in, out] ImageInfo           Receives the descriptors.
+  @param[out]     DescriptorVersion   Receives the descriptor version.
+  @param[out]     DescriptorCount     Receives the number of descriptors.
+  @param[out]     DescriptorSize      Receives the distance between descriptors.
+  @param[out]     PackageVersion      Receives the package version.
+  @param[out]     PackageVersionName  Receives a pool copy of the package version name.
+
+  @retval EFI_SUCCESS           The image info was returned.
+  @retval EFI_BUFFER_TOO_SMALL  ImageInfo is too small.
+  @retval Others                The test made the query fail.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetImageInfo (
+  IN     EFI_FIRMWARE_MANAGEMENT_PROTOCOL  *This,
+  IN OUT UINTN                             *ImageInfoSize,
+  IN OUT EFI_FIRMWARE_IMAGE_DESCRIPTOR     *ImageInfo,
+  OUT    UINT32                            *DescriptorVersion,
+  OUT    UINT8                             *DescriptorCount,
+  OUT    UINTN                             *DescriptorSize,
+  OUT    UINT32                            *PackageVersion,
+  OUT    CHAR16                            **PackageVersionName
+  )
+{
+  MOCK_FMP                       *Mock;
+  EFI_FIRMWARE_IMAGE_DESCRIPTOR  *Descriptor;
+  UINTN                          Needed;
+  UINTN                          Index;
+
+  Mock = MockFromInterface (This);
+  if (Mock == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Mock->Queries++;
+  mBusMicroseconds += MOCK_FMP_QUERY_US;
+
+  if (EFI_ERROR (Mock->QueryStatus)) {
+    return Mock->QueryStatus;
+  }
+
+  Needed = Mock->DescriptorCount * MOCK_FMP_DESCRIPTOR_SIZE;
+  if ((*ImageInfoSize < Needed) || (ImageInfo == NULL)) {
+    *ImageInfoSize = Needed;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  for (Index = 0; Index < Mock->DescriptorCount; Index++) {
+    Descriptor = (EFI_FIRMWARE_IMAGE_DESCRIPTOR *)((UINT8 *)ImageInfo + (Index * MOCK_FMP_DESCRIPTOR_SIZE));
+    SetMem (Descriptor, MOCK_FMP_DESCRIPTOR_SIZE, 0xA5);
+    ZeroMem (Descriptor, sizeof (*Descriptor));
+    Descriptor->ImageIndex = (UINT8)(Index + 1);
+    MockImageTypeId ((UINTN)(Mock - mMockFmp), Index, &Descriptor->ImageTypeId);
+    Descriptor->Version      = Mock->Version;
+    Descriptor->VersionName  = Mock->VersionName;
+    Descriptor->ImageIdName  = L"Mock image";
+    Descriptor->Dependencies = (EFI_FIRMWARE_IMAGE_DEP *)Mock;
+  }
+
+  *ImageInfoSize      = Needed;
+  *DescriptorVersion  = EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION;
+  *DescriptorCount    = Mock->DescriptorCount;
+  *DescriptorSize     = MOCK_FMP_DESCRIPTOR_SIZE;
+  *PackageVersion     = 0xFFFFFFFF;
+  *PackageVersionName = AllocateCopyPool (StrSize (L"Mock package"), L"Mock package");
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the handles of the installed mock FMP instances.
+
+  @param[in]  SearchType  Must be ByProtocol.
+  @param[in]  Protocol    Must be the FMP protocol.
+  @param[in]  SearchKey   Not used.
+  @param[out] NoHandles   Receives the number of handles.
+  @param[out] Buffer      Receives a pool buffer of handles.
+
+  @retval EFI_SUCCESS     The handles were returned.
+  @retval EFI_NOT_FOUND   No mock FMP is installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestLocateHandleBuffer (
+  IN     EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN     EFI_GUID                *Protocol OPTIONAL,
+  IN     VOID                    *SearchKey OPTIONAL,
+  OUT    UINTN                   *NoHandles,
+  OUT    EFI_HANDLE              **Buffer
+  )
+{
+  UINTN  Index;
+
+  if ((SearchType != ByProtocol) || !CompareGuid (Protocol, &gEfiFirmwareManagementProtocolGuid)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *Buffer = AllocatePool (MOCK_FMP_COUNT * sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *NoHandles = 0;
+  for (Index = 0; Index < MOCK_FMP_COUNT; Index++) {
+    if (mMockFmp[Index].Installed) {
+      (*Buffer)[(*NoHandles)++] = (EFI_HANDLE)&mMockFmp[Index];
+    }
+  }
+
+  if (*NoHandles == 0) {
+    FreePool (*Buffer);
+    *Buffer = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the next mock FMP handle installed or reinstalled since it was last returned.
+
+  @param[in]      SearchType  Must be ByRegisterNotify.
+  @param[in]      Protocol    Not used.
+  @param[in]      SearchKey   Must be the test registration.
+  @param[in, out] BufferSize  Size of Buffer on input, size of one handle on output.
+  @param[out]     Buffer      Receives the handle.
+
+  @retval EFI_SUCCESS     A handle was returned.
+  @retval EFI_NOT_FOUND   No mock FMP was installed since.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestLocateHandle (
+  IN     EFI_LOCATE_SEARCH_TYPE  SearchType,
+  IN     EFI_GUID                *Protocol OPTIONAL,
+  IN     VOID                    *SearchKey OPTIONAL,
+  IN OUT UINTN                   *BufferSize,
+  OUT    EFI_HANDLE              *Buffer
+  )
+{
+  UINTN  Index;
+
+  if ((SearchType != ByRegisterNotify) || (SearchKey != &mTestRegistration) || (*BufferSize < sizeof (EFI_HANDLE))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  for (Index = 0; Index < MOCK_FMP_COUNT; Index++) {
+    if (mMockFmp[Index].Notified) {
+      mMockFmp[Index].Notified = FALSE;
+      *BufferSize              = sizeof (EFI_HANDLE);
+      *Buffer                  = (EFI_HANDLE)&mMockFmp[Index];
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Return the current FMP interface of a mock handle.
+
+  @param[in]  Handle      Mock FMP handle.
+  @param[in]  Protocol    Must be the FMP protocol.
+  @param[out] Interface   Receives the interface.
+
+  @retval EFI_SUCCESS       The interface was returned.
+  @retval EFI_UNSUPPORTED   The mock is not installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestHandleProtocol (
+  IN  EFI_HANDLE  Handle,
+  IN  EFI_GUID    *Protocol,
+  OUT VOID        **Interface
+  )
+{
+  MOCK_FMP  *Mock;
+
+  Mock = (MOCK_FMP *)Handle;
+  if (!CompareGuid (Protocol, &gEfiFirmwareManagementProtocolGuid) || !Mock->Installed) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *Interface = &Mock->Instance[Mock->ActiveInstance];
+  return EFI_SUCCESS;
+}
+
+/**
+  Install or reinstall a mock FMP and signal the driver's install notification.
+
+  @param[in]  Index   Index of the mock FMP.
+
+**/
+STATIC
+VOID
+InstallMockFmp (
+  IN UINTN  Index
+  )
+{
+  if (mMockFmp[Index].Installed) {
+    mMockFmp[Index].ActiveInstance ^= 1;
+  }
+
+  mMockFmp[Index].Installed = TRUE;
+  mMockFmp[Index].Notified  = TRUE;
+  FmpInstallNotify (NULL, NULL);
+}
+
+/**
+  Count the GetImageInfo calls made to every mock FMP.
+
+  @retval     The number of calls.
+
+**/
+STATIC
+UINTN
+TotalQueries (
+  VOID
+  )
+{
+  UINTN  Index;
+  UINTN  Queries;
+
+  Queries = 0;
+  for (Index = 0; Index < MOCK_FMP_COUNT; Index++) {
+    Queries += mMockFmp[Index].Queries;
+  }
+
+  return Queries;
+}
+
+/**
+  Walk the snapshot once and check every entry against the mock it came from.
+
+  @param[out] EntryCount  Receives the number of entries.
+
+  @retval     TRUE        Every entry matches its mock.
+  @retval     FALSE       Not.
+
+**/
+STATIC
+BOOLEAN
+WalkSnapshot (
+  OUT UINTN  *EntryCount
+  )
+{
+  CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *Entry;
+  MOCK_FMP                             *Mock;
+  EFI_GUID                             ImageTypeId;
+  UINTN                                Cursor;
+
+  *EntryCount = 0;
+  Cursor      = 0;
+  while (!EFI_ERROR (mSnapshotProtocol.GetNext (&mSnapshotProtocol, &Cursor, &Entry))) {
+    Mock = (MOCK_FMP *)Entry->Handle;
+    MockImageTypeId ((UINTN)(Mock - mMockFmp), Entry->DescriptorIndex, &ImageTypeId);
+    if (!Mock->Installed ||
+        (Entry->DescriptorCount != Mock->DescriptorCount) ||
+        !CompareGuid (&Entry->Descriptor->ImageTypeId, &ImageTypeId) ||
+        (Entry->Descriptor->Version != Mock->Version) ||
+        (Entry->Descriptor->VersionName == Mock->VersionName) ||
+        (StrCmp (Entry->Descriptor->VersionName, Mock->VersionName) != 0) ||
+        (Entry->Descriptor->Dependencies != NULL) ||
+        (Entry->PackageVersionName == NULL) ||
+        (StrCmp (Entry->PackageVersionName, L"Mock package") != 0))
+    {
+      return FALSE;
+    }
+
+    (*EntryCount)++;
+  }
+
+  return TRUE;
+}
+
+/**
+  Reset the mocks and the driver. Mocks 0 to 2 are installed before the driver starts, so the
+  driver finds them with LocateHandleBuffer; mock 3 is not installed.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED    The test can run.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SnapshotTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (&mTestBootServices, sizeof (mTestBootServices));
+  mTestBootServices.LocateHandleBuffer = TestLocateHandleBuffer;
+  mTestBootServices.LocateHandle       = TestLocateHandle;
+  mTestBootServices.HandleProtocol     = TestHandleProtocol;
+
+  ZeroMem (mMockFmp, sizeof (mMockFmp));
+  for (Index = 0; Index < MOCK_FMP_COUNT; Index++) {
+    mMockFmp[Index].Instance[0].GetImageInfo = MockGetImageInfo;
+    mMockFmp[Index].Instance[1].GetImageInfo = MockGetImageInfo;
+    mMockFmp[Index].Installed                = (Index < 3);
+    mMockFmp[Index].QueryStatus              = EFI_SUCCESS;
+    mMockFmp[Index].DescriptorCount          = (UINT8)(1 + Index % MOCK_FMP_MAX_DESCRIPTORS);
+    mMockFmp[Index].Version                  = 0x100 + (UINT32)Index;
+    StrCpyS (mMockFmp[Index].VersionName, MOCK_FMP_VERSION_NAME_LEN, L"1.0");
+  }
+
+  mBusMicroseconds    = 0;
+  mFmpRegistration    = &mTestRegistration;
+  mInitialCaptureDone = FALSE;
+  mRefreshPending     = FALSE;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the records and entries the driver kept.
+
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+SnapshotTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  FMP_SNAPSHOT_RECORD  *Record;
+
+  while (!IsListEmpty (&mRecordList)) {
+    Record = FMP_SNAPSHOT_RECORD_FROM_LINK (GetFirstNode (&mRecordList));
+    RemoveEntryList (&Record->Link);
+    ClearRecord (Record);
+    FreePool (Record);
+  }
+
+  if (mEntries != NULL) {
+    FreePool (mEntries);
+    mEntries = NULL;
+  }
+
+  mEntryCount = 0;
+}
+
+/**
+  Each instance is queried once, a size probe and a fetch, on the first iteration. Later iterations
+  and lookups are served from the snapshot, which holds its own copies of the strings.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CaptureOncePerBoot (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *Entry;
+  EFI_GUID                             ImageTypeId;
+  UINTN                                EntryCount;
+  UINTN                                Pass;
+
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 4);
+  UT_ASSERT_EQUAL (mMockFmp[0].Queries, 2);
+  UT_ASSERT_EQUAL (mMockFmp[1].Queries, 2);
+  UT_ASSERT_EQUAL (mMockFmp[2].Queries, 2);
+  UT_ASSERT_EQUAL (mMockFmp[3].Queries, 0);
+  DEBUG ((DEBUG_INFO, "First iteration: %d queries, %ld us of bus time\n", TotalQueries (), mBusMicroseconds));
+
+  for (Pass = 0; Pass < 100; Pass++) {
+    UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+    UT_ASSERT_EQUAL (EntryCount, 4);
+
+    MockImageTypeId (1, 1, &ImageTypeId);
+    UT_ASSERT_NOT_EFI_ERROR (mSnapshotProtocol.Find (&mSnapshotProtocol, NULL, &ImageTypeId, &Entry));
+    UT_ASSERT_EQUAL ((UINTN)Entry->Handle, (UINTN)&mMockFmp[1]);
+    UT_ASSERT_STATUS_EQUAL (mSnapshotProtocol.Find (&mSnapshotProtocol, &mMockFmp[0], &ImageTypeId, &Entry), EFI_NOT_FOUND);
+  }
+
+  UT_ASSERT_EQUAL (TotalQueries (), 6);
+  DEBUG ((DEBUG_INFO, "After 100 more iterations and 200 lookups: %d queries, %ld us of bus time\n", TotalQueries (), mBusMicroseconds));
+
+  //
+  // The snapshot keeps the strings it copied at capture.
+  //
+  StrCpyS (mMockFmp[0].VersionName, MOCK_FMP_VERSION_NAME_LEN, L"2.0");
+  MockImageTypeId (0, 0, &ImageTypeId);
+  UT_ASSERT_NOT_EFI_ERROR (mSnapshotProtocol.Find (&mSnapshotProtocol, NULL, &ImageTypeId, &Entry));
+  UT_ASSERT_MEM_EQUAL (Entry->Descriptor->VersionName, L"1.0", sizeof (L"1.0"));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Installing a new instance or reinstalling one only queries that instance.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+InstallQueriesOnlyThatInstance (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  EntryCount;
+
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (TotalQueries (), 6);
+
+  InstallMockFmp (3);
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 6);
+  UT_ASSERT_EQUAL (mMockFmp[3].Queries, 2);
+  UT_ASSERT_EQUAL (TotalQueries (), 8);
+
+  mMockFmp[1].Version = 0x200;
+  StrCpyS (mMockFmp[1].VersionName, MOCK_FMP_VERSION_NAME_LEN, L"2.0");
+  InstallMockFmp (1);
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 6);
+  UT_ASSERT_EQUAL (mMockFmp[1].Queries, 4);
+  UT_ASSERT_EQUAL (TotalQueries (), 10);
+
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (TotalQueries (), 10);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An uninstalled instance is not notified, but its descriptors are dropped on the next refresh
+  without querying any instance.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+UninstallDropsDescriptors (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *Entry;
+  EFI_GUID                             ImageTypeId;
+  UINTN                                EntryCount;
+
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 4);
+
+  mMockFmp[1].Installed = FALSE;
+  MockImageTypeId (1, 0, &ImageTypeId);
+  UT_ASSERT_STATUS_EQUAL (mSnapshotProtocol.Find (&mSnapshotProtocol, NULL, &ImageTypeId, &Entry), EFI_NOT_FOUND);
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 2);
+  UT_ASSERT_EQUAL (TotalQueries (), 6);
+
+  InstallMockFmp (1);
+  UT_ASSERT_NOT_EFI_ERROR (mSnapshotProtocol.Find (&mSnapshotProtocol, NULL, &ImageTypeId, &Entry));
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 4);
+  UT_ASSERT_EQUAL (TotalQueries (), 8);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An instance whose GetImageInfo fails is queried at most FMP_SNAPSHOT_MAX_FAILED_CAPTURES times, no
+  matter how often the snapshot is used, and gets new attempts when it is reinstalled.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+FailingInstanceIsRateLimited (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *Entry;
+  EFI_GUID                             ImageTypeId;
+  UINTN                                EntryCount;
+  UINTN                                Pass;
+
+  mMockFmp[2].QueryStatus = EFI_DEVICE_ERROR;
+  MockImageTypeId (2, 0, &ImageTypeId);
+
+  for (Pass = 0; Pass < 100; Pass++) {
+    UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+    UT_ASSERT_EQUAL (EntryCount, 3);
+    UT_ASSERT_STATUS_EQUAL (mSnapshotProtocol.Find (&mSnapshotProtocol, NULL, &ImageTypeId, &Entry), EFI_NOT_FOUND);
+  }
+
+  UT_ASSERT_EQUAL (mMockFmp[2].Queries, FMP_SNAPSHOT_MAX_FAILED_CAPTURES);
+  UT_ASSERT_EQUAL (TotalQueries (), 4 + FMP_SNAPSHOT_MAX_FAILED_CAPTURES);
+  DEBUG ((DEBUG_INFO, "100 iterations with a failing FMP: %d queries, %ld us of bus time\n", TotalQueries (), mBusMicroseconds));
+
+  mMockFmp[2].QueryStatus = EFI_SUCCESS;
+  InstallMockFmp (2);
+  UT_ASSERT_TRUE (WalkSnapshot (&EntryCount));
+  UT_ASSERT_EQUAL (EntryCount, 4);
+  UT_ASSERT_EQUAL (mMockFmp[2].Queries, FMP_SNAPSHOT_MAX_FAILED_CAPTURES + 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SnapshotTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SnapshotTests, Framework, "FMP Descriptor Snapshot Tests", "OemPkg.FmpDescriptorSnapshotDxe", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SnapshotTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SnapshotTests, "Slow FMPs are queried once per boot", "CaptureOnce", CaptureOncePerBoot, SnapshotTestSetup, SnapshotTestCleanup, NULL);
+  AddTestCase (SnapshotTests, "An install queries only that FMP", "Install", InstallQueriesOnlyThatInstance, SnapshotTestSetup, SnapshotTestCleanup, NULL);
+  AddTestCase (SnapshotTests, "An uninstalled FMP is dropped", "Uninstall", UninstallDropsDescriptors, SnapshotTestSetup, SnapshotTestCleanup, NULL);
+  AddTestCase (SnapshotTests, "A failing FMP is retried a few times", "FailingFmp", FailingInstanceIsRateLimited, SnapshotTestSetup, SnapshotTestCleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -13,6 +13,7 @@
 #include "String.h"
 #include "FrontPageUi.h"
 #include "FrontPageConfigAccess.h"
+#include "FrontPageLatency.h"
 
 #include <IndustryStandard/SmBios.h>
 
@@ -32,12 +33,14 @@
 #include <Protocol/OnScreenKeyboard.h>
 #include <Protocol/SimpleWindowManager.h>
 #include <Protocol/FirmwareManagement.h>
+#include <Protocol/FmpDescriptorSnapshot.h>
 #include <Protocol/VariablePolicy.h>
 
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/HiiLib.h>
+#include <Library/UefiHiiServicesLib.h>
 #include <Library/PrintLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -56,6 +59,7 @@
 #include <Library/MuSecureBootKeySelectorLib.h>
 #include <Library/SecureBootKeyStoreLib.h>
 #include <Library/SwmDialogsLib.h>
+#include <Library/SmbiosStringIndexLib.h>
 
 #include <MsDisplayEngine.h>
 #include <UIToolKit/SimpleUIToolKit.h>
@@ -81,6 +85,7 @@ BOOLEAN  mShowFullMenu = FALSE;     // By default we won't show the full FrontPa
 //
 UINT32                           mCurrentFormIndex;
 EFI_EVENT                        mMasterFrameNotifyEvent;
+EFI_EVENT                        mPointerFrameEvent = NULL;
 DISPLAY_ENGINE_SHARED_STATE      mDisplayEngineState;
 BOOLEAN                          mTerminateFrontPage = FALSE;
 BOOLEAN                          mResetRequired;
@@ -131,6 +136,24 @@ struct {
 //
 EFI_GUID  gMuFrontPageConfigFormSetGuid = FRONT_PAGE_CONFIG_FORMSET_GUID;
 
+// Formsets handed to the browser alongside FrontPage's own. Their HII handles are resolved once and
+// kept current by HII database form package notifications, so switching menus does not enumerate
+// the whole HII database.
+//
+typedef struct {
+  EFI_GUID          FormSetGuid;
+  EFI_HII_HANDLE    HiiHandle;          // NULL if the formset is not registered.
+  BOOLEAN           Stale;              // TRUE if HiiHandle must be resolved again.
+} FORMSET_HANDLE_CACHE_ENTRY;
+
+FORMSET_HANDLE_CACHE_ENTRY  mFormSetHandleCache[] = {
+  { MS_BOOT_MENU_FORMSET_GUID, NULL, TRUE },
+  { DFCI_MENU_FORMSET_GUID,    NULL, TRUE },
+  { HWH_MENU_FORMSET_GUID,     NULL, TRUE }
+};
+
+EFI_HANDLE  mFormPackageNotifyHandles[3] = { NULL, NULL, NULL };
+
 #pragma pack(1)
 
 ///
@@ -184,57 +207,6 @@ GetAndDisplayBitmap (
   BOOLEAN   XCoordAdj
   );
 
-/**
-
-  Acquire the string associated with the Index from smbios structure and return it.
-  The caller is responsible for free the string buffer.
-
-  @param    OptionalStrStart  The start position to search the string
-  @param    Index             The index of the string to extract
-  @param    String            The string that is extracted
-
-  @retval   EFI_SUCCESS       The function returns EFI_SUCCESS if found the string.
-  @retval   EFI_NOT_FOUND     If the target string is not found.
-
-**/
-STATIC
-EFI_STATUS
-GetOptionalStringByIndex (
-  IN  CHAR8   *OptionalStrStart,
-  UINT8       Index,
-  OUT CHAR16  **String
-  )
-{
-  UINTN  StrSize;
-
-  if (Index == 0) {
-    *String = AllocateZeroPool (sizeof (CHAR16));
-    return EFI_SUCCESS;
-  }
-
-  StrSize = 0;
-  do {
-    Index--;
-    OptionalStrStart += StrSize;
-    StrSize           = AsciiStrSize (OptionalStrStart);
-  } while (OptionalStrStart[StrSize] != 0 && Index != 0);
-
-  if ((Index != 0) || (StrSize == 1)) {
-    //
-    // Meet the end of strings set but Index is non-zero, or
-    // Find an empty string
-    //
-    FreePool (*String);
-    *String = NULL;
-    return EFI_NOT_FOUND;
-  } else {
-    *String = AllocatePool (StrSize * sizeof (CHAR16));
-    AsciiStrToUnicodeStrS (OptionalStrStart, *String, StrSize);
-  }
-
-  return EFI_SUCCESS;
-}
-
 /**
   Updates HII display strings based on associated EFI variable state.
 
@@ -249,38 +221,26 @@ UpdateDisplayStrings (
   IN EFI_HII_HANDLE  HiiHandle
   )
 {
-  EFI_STATUS  Status = EFI_SUCCESS;
-  CHAR16      *NewString;
-
-  EFI_SMBIOS_PROTOCOL      *SmbiosProtocol;
-  EFI_SMBIOS_HANDLE        SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;
-  EFI_SMBIOS_TABLE_HEADER  *Record;
-  SMBIOS_TYPE              Type;
-  SMBIOS_TABLE_TYPE1       *Type1Record;
-  SMBIOS_TABLE_TYPE3       *Type3Record;
+  EFI_STATUS    Status = EFI_SUCCESS;
+  CHAR16        *NewString;
+  CONST CHAR16  *SmbiosString;
 
-  Status = gBS->LocateProtocol (&gEfiSmbiosProtocolGuid, NULL, (VOID **)&SmbiosProtocol);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((EFI_D_ERROR, "Could not locate SMBIOS protocol.  %r\n", Status));
-    return Status;
-  }
+  CONST SMBIOS_STRUCTURE  *Record;
+  SMBIOS_TABLE_TYPE1      *Type1Record;
+  SMBIOS_TABLE_TYPE3      *Type3Record;
 
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;      // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_INFORMATION; // Smbios type1
-  Status       = SmbiosProtocol->GetNext (SmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record); // Smbios type1
   if (!EFI_ERROR (Status)) {
     Type1Record = (SMBIOS_TABLE_TYPE1 *)Record;
 
-    Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type1Record + Type1Record->Hdr.Length), Type1Record->SerialNumber, &NewString);
+    Status = SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->SerialNumber, &SmbiosString);
     if (!EFI_ERROR (Status)) {
-      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_SERIALNUM_VALUE), NewString, NULL);
-      FreePool (NewString);
+      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_SERIALNUM_VALUE), (EFI_STRING)SmbiosString, NULL);
     }
 
-    Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type1Record + Type1Record->Hdr.Length), Type1Record->ProductName, &NewString);
+    Status = SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->ProductName, &SmbiosString);
     if (!EFI_ERROR (Status)) {
-      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_MODEL_VALUE), NewString, NULL);
-      FreePool (NewString);
+      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_MODEL_VALUE), (EFI_STRING)SmbiosString, NULL);
     }
 
     NewString = AllocatePool ((GUID_STRING_LENGTH + 1) * sizeof (CHAR16));
@@ -297,15 +257,12 @@ UpdateDisplayStrings (
     }
   }
 
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;    // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_ENCLOSURE; // Smbios type3
-  Status       = SmbiosProtocol->GetNext (SmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_ENCLOSURE, 0, &Record); // Smbios type3
   if (!EFI_ERROR (Status)) {
     Type3Record = (SMBIOS_TABLE_TYPE3 *)Record;
-    Status      = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type3Record + Type3Record->Hdr.Length), Type3Record->AssetTag, &NewString);
+    Status      = SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_ENCLOSURE, 0, Type3Record->AssetTag, &SmbiosString);
     if (!EFI_ERROR (Status)) {
-      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_ASSET_TAG_VALUE), NewString, NULL);
-      FreePool (NewString);
+      HiiSetString (HiiHandle, STRING_TOKEN (STR_INF_VIEW_PC_ASSET_TAG_VALUE), (EFI_STRING)SmbiosString, NULL);
     }
   }
 
@@ -313,23 +270,145 @@ UpdateDisplayStrings (
 }
 
 /**
-Function to populate the PC INFO firmware version form with the current fw versions
-found using FMP.
+  Add the firmware version "key-value" row for one FMP image descriptor to the PC INFO form.
+
+  @param[in]  OpCodeHandle  Opcode handle to append to.
+  @param[in]  HiiHandle     FrontPage HII handle used to register the strings.
+  @param[in]  Descriptor    FMP image descriptor to display.
 
 **/
+STATIC
 VOID
-UpdateFormWithFirmwareVersions (
+AddFirmwareVersionOpCodes (
+  IN VOID                                 *OpCodeHandle,
+  IN EFI_HII_HANDLE                       HiiHandle,
+  IN CONST EFI_FIRMWARE_IMAGE_DESCRIPTOR  *Descriptor
+  )
+{
+  EFI_STRING_ID  StringId;
+  EFI_STRING_ID  StringId1;
+
+  StringId  = STRING_TOKEN (STR_NULL_STRING);
+  StringId1 = STRING_TOKEN (STR_NULL_STRING);
+
+  if (Descriptor->ImageIdName != NULL) {
+    if ((StringId = HiiSetString (HiiHandle, 0, Descriptor->ImageIdName, NULL)) == 0) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to set string for fmp ImageIdName: %s. \n", __FUNCTION__, Descriptor->ImageIdName));
+      return;
+    }
+  } else {
+    DEBUG ((DEBUG_ERROR, "%a - FMP ImageIdName is null\n", __FUNCTION__));
+  }
+
+  if (Descriptor->VersionName != NULL) {
+    if ((StringId1 = HiiSetString (HiiHandle, 0, Descriptor->VersionName, NULL)) == 0) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to set string for fmp VersionName: %s. \n", __FUNCTION__, Descriptor->VersionName));
+      return;
+    }
+  } else {
+    DEBUG ((DEBUG_ERROR, "%a - FMP VersionName is null\n", __FUNCTION__));
+  }
+
+  // Create a Subtitle OpCode to group the Firmware version "key-value" pair that follows.
+  //
+  HiiCreateSubTitleOpCode (
+    OpCodeHandle,
+    STRING_TOKEN (STR_NULL_STRING),
+    STRING_TOKEN (STR_NULL_STRING),
+    EFI_IFR_FLAGS_HORIZONTAL,
+    0
+    );
+
+  HiiCreateTextOpCode (
+    OpCodeHandle,
+    StringId,
+    STRING_TOKEN (STR_NULL_STRING),
+    STRING_TOKEN (STR_NULL_STRING)
+    );
+
+  HiiCreateTextOpCode (
+    OpCodeHandle,
+    StringId1,
+    STRING_TOKEN (STR_NULL_STRING),
+    STRING_TOKEN (STR_NULL_STRING)
+    );
+
+  // Create empty 3rd text Opcode add an additional column to the display grid, thus moving the firmware version to the left (better alignment).
+  //
+  HiiCreateTextOpCode (
+    OpCodeHandle,
+    STRING_TOKEN (STR_NULL_STRING),
+    STRING_TOKEN (STR_NULL_STRING),
+    STRING_TOKEN (STR_NULL_STRING)
+    );
+}
+
+/**
+  Add the firmware versions from the descriptors captured by the FmpDescriptorSnapshot protocol.
+  The snapshot is taken once per boot, so re-entering FrontPage does not query the FMP instances again.
+
+  @param[in]  OpCodeHandle  Opcode handle to append to.
+  @param[in]  HiiHandle     FrontPage HII handle used to register the strings.
+
+  @retval EFI_SUCCESS       The firmware versions were added.
+  @retval Others            The snapshot protocol is not available.
+
+**/
+STATIC
+EFI_STATUS
+AddFirmwareVersionsFromSnapshot (
+  IN VOID            *OpCodeHandle,
   IN EFI_HII_HANDLE  HiiHandle
   )
 {
-  EFI_STATUS          Status;
-  VOID                *StartOpCodeHandle;
-  VOID                *EndOpCodeHandle = NULL;
-  EFI_IFR_GUID_LABEL  *StartLabel;
-  EFI_IFR_GUID_LABEL  *EndLabel;
-  EFI_STRING_ID       StringId;
-  EFI_STRING_ID       StringId1;
+  EFI_STATUS                           Status;
+  FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL     *Snapshot;
+  CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  *Entry;
+  UINTN                                Cursor;
 
+  Status = gBS->LocateProtocol (&gFmpDescriptorSnapshotProtocolGuid, NULL, (VOID **)&Snapshot);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Cursor = 0;
+  while (!EFI_ERROR (Snapshot->GetNext (Snapshot, &Cursor, &Entry))) {
+    //
+    // For FrontPage we only show the 1st descriptor of each FMP instance.
+    //
+    if (Entry->DescriptorIndex != 0) {
+      continue;
+    }
+
+    if (Entry->DescriptorCount > 1) {
+      DEBUG ((DEBUG_INFO, "%a - Found %d descriptors.  For FrontPage we only show the 1st descriptor.\n", __FUNCTION__, Entry->DescriptorCount));
+    }
+
+    AddFirmwareVersionOpCodes (OpCodeHandle, HiiHandle, Entry->Descriptor);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Add the firmware versions by querying every FMP instance directly. Used when the
+  FmpDescriptorSnapshot protocol is not available.
+
+  @param[in]  OpCodeHandle  Opcode handle to append to.
+  @param[in]  HiiHandle     FrontPage HII handle used to register the strings.
+
+  @retval EFI_SUCCESS       The firmware versions were added.
+  @retval Others            No FMP instance could be located.
+
+**/
+STATIC
+EFI_STATUS
+AddFirmwareVersionsFromFmp (
+  IN VOID            *OpCodeHandle,
+  IN EFI_HII_HANDLE  HiiHandle
+  )
+{
+  EFI_STATUS                        Status;
   EFI_FIRMWARE_MANAGEMENT_PROTOCOL  **FmpList;
   UINTN                             FmpCount;
   UINTN                             Index;
@@ -347,6 +426,108 @@ UpdateFormWithFirmwareVersions (
   FmpList            = NULL;
   PackageVersionName = NULL;
 
+  //
+  // Get all FMP instances and then use the descriptor to get string name and version
+  //
+  Status = EfiLocateProtocolBuffer (&gEfiFirmwareManagementProtocolGuid, &FmpCount, (VOID *)&FmpList);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "EfiLocateProtocolBuffer(gEfiFirmwareManagementProtocolGuid) returned error.  %r \n", Status));
+    return Status;
+  }
+
+  for (Index = 0; Index < FmpCount; Index++) {
+    Fmp = (EFI_FIRMWARE_MANAGEMENT_PROTOCOL *)(FmpList[Index]);
+    // get the GetImageInfo for the FMP
+
+    ImageInfoSize = 0;
+    //
+    // get necessary descriptor size
+    // this should return TOO SMALL
+    Status = Fmp->GetImageInfo (
+                    Fmp,                        // FMP Pointer
+                    &ImageInfoSize,             // Buffer Size (in this case 0)
+                    NULL,                       // NULL so we can get size
+                    &FmpImageInfoDescriptorVer, // DescriptorVersion
+                    &FmpImageInfoCount,         // DescriptorCount
+                    &DescriptorSize,            // DescriptorSize
+                    &PackageVersion,            // PackageVersion
+                    &PackageVersionName         // PackageVersionName
+                    );
+
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+      DEBUG ((DEBUG_ERROR, "%a - Unexpected Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
+      continue;
+    }
+
+    FmpImageInfoBuf = NULL;
+    FmpImageInfoBuf = AllocateZeroPool (ImageInfoSize);
+    if (FmpImageInfoBuf == NULL) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to get memory for descriptors.\n", __FUNCTION__));
+      continue;
+    }
+
+    PackageVersionName = NULL;
+    Status             = Fmp->GetImageInfo (
+                                Fmp,
+                                &ImageInfoSize,             // ImageInfoSize
+                                FmpImageInfoBuf,            // ImageInfo
+                                &FmpImageInfoDescriptorVer, // DescriptorVersion
+                                &FmpImageInfoCount,         // DescriptorCount
+                                &DescriptorSize,            // DescriptorSize
+                                &PackageVersion,            // PackageVersion
+                                &PackageVersionName         // PackageVersionName
+                                );
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
+      goto FmpCleanUp;
+    }
+
+    if (FmpImageInfoCount == 0) {
+      DEBUG ((DEBUG_INFO, "%a - No Image Info descriptors.\n", __FUNCTION__));
+      goto FmpCleanUp;
+    }
+
+    if (FmpImageInfoCount > 1) {
+      DEBUG ((DEBUG_INFO, "%a - Found %d descriptors.  For FrontPage we only show the 1st descriptor.\n", __FUNCTION__, FmpImageInfoCount));
+    }
+
+    AddFirmwareVersionOpCodes (OpCodeHandle, HiiHandle, FmpImageInfoBuf);
+
+FmpCleanUp:
+    // clean up -
+    FreePool (FmpImageInfoBuf);
+    FmpImageInfoBuf = NULL;
+    if (PackageVersionName != NULL) {
+      FreePool (PackageVersionName);
+      PackageVersionName = NULL;
+    }
+  } // for loop for all fmp handles
+
+  // Free up the FmpList of pointers
+  if (FmpList != NULL) {
+    FreePool (FmpList);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+Function to populate the PC INFO firmware version form with the current fw versions
+found using FMP.
+
+**/
+VOID
+UpdateFormWithFirmwareVersions (
+  IN EFI_HII_HANDLE  HiiHandle
+  )
+{
+  EFI_STATUS          Status;
+  VOID                *StartOpCodeHandle;
+  VOID                *EndOpCodeHandle = NULL;
+  EFI_IFR_GUID_LABEL  *StartLabel;
+  EFI_IFR_GUID_LABEL  *EndLabel;
+
   do {
     //
     // Init OpCode Handle and Allocate space for creation of UpdateData Buffer
@@ -379,153 +560,180 @@ UpdateFormWithFirmwareVersions (
     EndLabel->Number   = LABEL_PCINFO_FW_VERSION_TAG_END;
 
     //
-    // Get all FMP instances and then use the descriptor to get string name and version
+    // Prefer the per-boot descriptor snapshot; fall back to querying each FMP instance.
     //
-    Status = EfiLocateProtocolBuffer (&gEfiFirmwareManagementProtocolGuid, &FmpCount, (VOID *)&FmpList);
+    Status = AddFirmwareVersionsFromSnapshot (StartOpCodeHandle, HiiHandle);
     if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "EfiLocateProtocolBuffer(gEfiFirmwareManagementProtocolGuid) returned error.  %r \n", Status));
-      break;
+      Status = AddFirmwareVersionsFromFmp (StartOpCodeHandle, HiiHandle);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
     }
 
-    for (Index = 0; Index < FmpCount; Index++) {
-      Fmp = (EFI_FIRMWARE_MANAGEMENT_PROTOCOL *)(FmpList[Index]);
-      // get the GetImageInfo for the FMP
+    Status = HiiUpdateForm (
+               HiiHandle,                      // HII handle
+               &gMuFrontPageConfigFormSetGuid, // Formset GUID
+               FRONT_PAGE_FORM_ID_PCINFO,      // Form ID
+               StartOpCodeHandle,              // Label for where to insert opcodes
+               EndOpCodeHandle                 // Replace data
+               );
+  } while (FALSE);
 
-      ImageInfoSize = 0;
-      //
-      // get necessary descriptor size
-      // this should return TOO SMALL
-      Status = Fmp->GetImageInfo (
-                      Fmp,                        // FMP Pointer
-                      &ImageInfoSize,             // Buffer Size (in this case 0)
-                      NULL,                       // NULL so we can get size
-                      &FmpImageInfoDescriptorVer, // DescriptorVersion
-                      &FmpImageInfoCount,         // DescriptorCount
-                      &DescriptorSize,            // DescriptorSize
-                      &PackageVersion,            // PackageVersion
-                      &PackageVersionName         // PackageVersionName
-                      );
-
-      if (Status != EFI_BUFFER_TOO_SMALL) {
-        DEBUG ((DEBUG_ERROR, "%a - Unexpected Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
-        continue;
-      }
+  if (StartOpCodeHandle != NULL) {
+    HiiFreeOpCodeHandle (StartOpCodeHandle);
+  }
 
-      FmpImageInfoBuf = NULL;
-      FmpImageInfoBuf = AllocateZeroPool (ImageInfoSize);
-      if (FmpImageInfoBuf == NULL) {
-        DEBUG ((DEBUG_ERROR, "%a - Failed to get memory for descriptors.\n", __FUNCTION__));
-        continue;
-      }
+  if (EndOpCodeHandle != NULL) {
+    HiiFreeOpCodeHandle (EndOpCodeHandle);
+  }
+}
 
-      PackageVersionName = NULL;
-      Status             = Fmp->GetImageInfo (
-                                  Fmp,
-                                  &ImageInfoSize,             // ImageInfoSize
-                                  FmpImageInfoBuf,            // ImageInfo
-                                  &FmpImageInfoDescriptorVer, // DescriptorVersion
-                                  &FmpImageInfoCount,         // DescriptorCount
-                                  &DescriptorSize,            // DescriptorSize
-                                  &PackageVersion,            // PackageVersion
-                                  &PackageVersionName         // PackageVersionName
-                                  );
+/**
+  HII database notification for form packages. Keeps mFormSetHandleCache in step with the database.
 
-      if (EFI_ERROR (Status)) {
-        DEBUG ((DEBUG_ERROR, "%a - Failure in GetImageInfo.  Status = %r\n", __FUNCTION__, Status));
-        goto FmpCleanUp;
-      }
+  A removed form package marks the cache entry holding that HII handle stale. HiiUpdateForm removes
+  and re-adds the form package on the same handle, so an added package on a stale entry's handle
+  makes it valid again. Any new or added form package may register a formset that was not found
+  before, so unresolved entries are marked stale.
 
-      if (FmpImageInfoCount == 0) {
-        DEBUG ((DEBUG_INFO, "%a - No Image Info descriptors.\n", __FUNCTION__));
-        goto FmpCleanUp;
-      }
+  @param[in]  PackageType   Package type of the notification.
+  @param[in]  PackageGuid   Not used.
+  @param[in]  Package       Not used.
+  @param[in]  Handle        HII handle of the package list the package belongs to.
+  @param[in]  NotifyType    Type of change to the package.
 
-      if (FmpImageInfoCount > 1) {
-        DEBUG ((DEBUG_INFO, "%a - Found %d descriptors.  For FrontPage we only show the 1st descriptor.\n", __FUNCTION__, FmpImageInfoCount));
-      }
+  @retval EFI_SUCCESS       Always.
 
-      if (FmpImageInfoBuf->ImageIdName != NULL) {
-        if ((StringId = HiiSetString (HiiHandle, 0, FmpImageInfoBuf->ImageIdName, NULL)) == 0) {
-          DEBUG ((DEBUG_ERROR, "%a - Failed to set string for fmp ImageIdName: %s. \n", __FUNCTION__, FmpImageInfoBuf->ImageIdName));
-          goto FmpCleanUp;
-        }
-      } else {
-        DEBUG ((DEBUG_ERROR, "%a - FMP ImageIdName is null\n", __FUNCTION__));
-      }
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FormPackageNotify (
+  IN UINT8                         PackageType,
+  IN CONST EFI_GUID                *PackageGuid,
+  IN CONST EFI_HII_PACKAGE_HEADER  *Package,
+  IN EFI_HII_HANDLE                Handle,
+  IN EFI_HII_DATABASE_NOTIFY_TYPE  NotifyType
+  )
+{
+  UINTN  Index;
 
-      if (FmpImageInfoBuf->VersionName != NULL) {
-        if ((StringId1 = HiiSetString (HiiHandle, 0, FmpImageInfoBuf->VersionName, NULL)) == 0) {
-          DEBUG ((DEBUG_ERROR, "%a - Failed to set string for fmp VersionName: %s. \n", __FUNCTION__, FmpImageInfoBuf->VersionName));
-          goto FmpCleanUp;
-        }
-      } else {
-        DEBUG ((DEBUG_ERROR, "%a - FMP VersionName is null\n", __FUNCTION__));
+  for (Index = 0; Index < ARRAY_SIZE (mFormSetHandleCache); Index++) {
+    if (NotifyType == EFI_HII_DATABASE_NOTIFY_REMOVE_PACK) {
+      if (mFormSetHandleCache[Index].HiiHandle == Handle) {
+        mFormSetHandleCache[Index].Stale = TRUE;
       }
+    } else if (mFormSetHandleCache[Index].HiiHandle == NULL) {
+      mFormSetHandleCache[Index].Stale = TRUE;
+    } else if (mFormSetHandleCache[Index].HiiHandle == Handle) {
+      mFormSetHandleCache[Index].Stale = FALSE;
+    }
+  }
 
-      // Create a Subtitle OpCode to group the Firmware version "key-value" pair that follows.
-      //
-      HiiCreateSubTitleOpCode (
-        StartOpCodeHandle,
-        STRING_TOKEN (STR_NULL_STRING),
-        STRING_TOKEN (STR_NULL_STRING),
-        EFI_IFR_FLAGS_HORIZONTAL,
-        0
-        );
+  return EFI_SUCCESS;
+}
 
-      HiiCreateTextOpCode (
-        StartOpCodeHandle,
-        StringId,
-        STRING_TOKEN (STR_NULL_STRING),
-        STRING_TOKEN (STR_NULL_STRING)
-        );
+/**
+  Register for form package changes so the formset handle cache stays current.
 
-      HiiCreateTextOpCode (
-        StartOpCodeHandle,
-        StringId1,
-        STRING_TOKEN (STR_NULL_STRING),
-        STRING_TOKEN (STR_NULL_STRING)
-        );
+**/
+STATIC
+VOID
+InitializeFormSetHandleCache (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+  UINTN                         Index;
+  EFI_HII_DATABASE_NOTIFY_TYPE  NotifyTypes[] = {
+    EFI_HII_DATABASE_NOTIFY_NEW_PACK,
+    EFI_HII_DATABASE_NOTIFY_ADD_PACK,
+    EFI_HII_DATABASE_NOTIFY_REMOVE_PACK
+  };
+
+  for (Index = 0; Index < ARRAY_SIZE (mFormSetHandleCache); Index++) {
+    mFormSetHandleCache[Index].HiiHandle = NULL;
+    mFormSetHandleCache[Index].Stale     = TRUE;
+  }
 
-      // Create empty 3rd text Opcode add an additional column to the display grid, thus moving the firmware version to the left (better alignment).
+  //
+  // The database matches NotifyType exactly, so each type needs its own registration.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (NotifyTypes); Index++) {
+    Status = gHiiDatabase->RegisterPackageNotify (
+                             gHiiDatabase,
+                             EFI_HII_PACKAGE_FORMS,
+                             NULL,
+                             FormPackageNotify,
+                             NotifyTypes[Index],
+                             &mFormPackageNotifyHandles[Index]
+                             );
+    if (EFI_ERROR (Status)) {
       //
-      HiiCreateTextOpCode (
-        StartOpCodeHandle,
-        STRING_TOKEN (STR_NULL_STRING),
-        STRING_TOKEN (STR_NULL_STRING),
-        STRING_TOKEN (STR_NULL_STRING)
-        );
+      // Without notifications the cache cannot be trusted; resolve on every call instead.
+      //
+      DEBUG ((DEBUG_ERROR, "%a - RegisterPackageNotify failed.  %r\n", __FUNCTION__, Status));
+      mFormPackageNotifyHandles[Index] = NULL;
+    }
+  }
+}
 
-FmpCleanUp:
-      // clean up -
-      FreePool (FmpImageInfoBuf);
-      FmpImageInfoBuf = NULL;
-      if (PackageVersionName != NULL) {
-        FreePool (PackageVersionName);
-        PackageVersionName = NULL;
-      }
-    } // for loop for all fmp handles
+/**
+  Unregister the form package notifications.
+
+**/
+STATIC
+VOID
+UninitializeFormSetHandleCache (
+  VOID
+  )
+{
+  UINTN  Index;
 
-    // Free up the FmpList of pointers
-    if (FmpList != NULL) {
-      FreePool (FmpList);
+  for (Index = 0; Index < ARRAY_SIZE (mFormPackageNotifyHandles); Index++) {
+    if (mFormPackageNotifyHandles[Index] != NULL) {
+      gHiiDatabase->UnregisterPackageNotify (gHiiDatabase, mFormPackageNotifyHandles[Index]);
+      mFormPackageNotifyHandles[Index] = NULL;
     }
+  }
+}
 
-    Status = HiiUpdateForm (
-               HiiHandle,                      // HII handle
-               &gMuFrontPageConfigFormSetGuid, // Formset GUID
-               FRONT_PAGE_FORM_ID_PCINFO,      // Form ID
-               StartOpCodeHandle,              // Label for where to insert opcodes
-               EndOpCodeHandle                 // Replace data
-               );
-  } while (FALSE);
+/**
+  Get the HII handle of a cached formset, resolving it only if the cache entry is stale.
 
-  if (StartOpCodeHandle != NULL) {
-    HiiFreeOpCodeHandle (StartOpCodeHandle);
+  @param[in]  Entry     Formset cache entry.
+
+  @retval  The HII handle, or NULL if the formset is not registered.
+
+**/
+STATIC
+EFI_HII_HANDLE
+GetCachedFormSetHandle (
+  IN FORMSET_HANDLE_CACHE_ENTRY  *Entry
+  )
+{
+  EFI_HII_HANDLE  *HiiHandles;
+  UINTN           Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mFormPackageNotifyHandles); Index++) {
+    if (mFormPackageNotifyHandles[Index] == NULL) {
+      Entry->Stale = TRUE;
+      break;
+    }
   }
 
-  if (EndOpCodeHandle != NULL) {
-    HiiFreeOpCodeHandle (EndOpCodeHandle);
+  if (Entry->Stale) {
+    Entry->HiiHandle = NULL;
+    HiiHandles       = HiiGetHiiHandles (&Entry->FormSetGuid);
+    if (HiiHandles != NULL) {
+      Entry->HiiHandle = HiiHandles[0];
+      FreePool (HiiHandles);
+    }
+
+    Entry->Stale = FALSE;
   }
+
+  return Entry->HiiHandle;
 }
 
 /**
@@ -594,6 +802,8 @@ InitializeFrontPage (
     if (mFrontPagePrivate.HiiHandle == NULL) {
       return EFI_OUT_OF_RESOURCES;
     }
+
+    InitializeFormSetHandleCache ();
   }
 
   HiiHandle = mFrontPagePrivate.HiiHandle;
@@ -664,6 +874,13 @@ UninitializeFrontPage (
 
   gBS->CloseEvent (mMasterFrameNotifyEvent);
 
+  if (NULL != mPointerFrameEvent) {
+    gBS->CloseEvent (mPointerFrameEvent);
+    mPointerFrameEvent = NULL;
+  }
+
+  UninitializeFormSetHandleCache ();
+
   return Status;
 }
 
@@ -685,31 +902,20 @@ CallFrontPage (
 
   #define MAX_FORMSET_HANDLES  5
   EFI_HII_HANDLE  Handles[MAX_FORMSET_HANDLES];
+  EFI_HII_HANDLE  CachedHandle;
   UINTN           HandleCount;
-
-  // Locate Boot Menu form - this should already be registered.
-  //
-  EFI_GUID        BootMenu    = MS_BOOT_MENU_FORMSET_GUID;
-  EFI_HII_HANDLE  *BootHandle = HiiGetHiiHandles (&BootMenu);
-  EFI_HII_HANDLE  *DfciHandle = HiiGetHiiHandles (&gDfciMenuFormsetGuid);
-  EFI_HII_HANDLE  *HwhHandle  =  HiiGetHiiHandles (&gHwhMenuFormsetGuid);
+  UINTN           CacheIndex;
 
   Handles[0]  = mFrontPagePrivate.HiiHandle;
   HandleCount = 1;
 
-  if (BootHandle != NULL) {
-    Handles[HandleCount++] = BootHandle[0];
-    FreePool (BootHandle);
-  }
-
-  if (DfciHandle != NULL) {
-    Handles[HandleCount++] = DfciHandle[0];
-    FreePool (DfciHandle);
-  }
-
-  if (HwhHandle != NULL) {
-    Handles[HandleCount++] = HwhHandle[0];
-    FreePool (HwhHandle);
+  // Boot Menu, DFCI and HWH forms - these should already be registered.
+  //
+  for (CacheIndex = 0; CacheIndex < ARRAY_SIZE (mFormSetHandleCache); CacheIndex++) {
+    CachedHandle = GetCachedFormSetHandle (&mFormSetHandleCache[CacheIndex]);
+    if (CachedHandle != NULL) {
+      Handles[HandleCount++] = CachedHandle;
+    }
   }
 
   DEBUG ((DEBUG_INFO, "MAX_FORMSET_HANDLES=%d, CurrentFormsetHandles=%d\n", MAX_FORMSET_HANDLES, HandleCount));
@@ -736,6 +942,7 @@ CallFrontPage (
 
   // Call the browser to display the selected form.
   //
+  FrontPageLatencyFormSwitchDone ();
   Status = mFormBrowser2->SendForm (
                             mFormBrowser2,
                             Handles,
@@ -978,8 +1185,10 @@ RenderTitlebar (
 {
   EFI_STATUS                 Status = EFI_SUCCESS;
   EFI_FONT_DISPLAY_INFO      StringInfo;
-  EFI_IMAGE_OUTPUT           *pBltBuffer;
+  EFI_IMAGE_OUTPUT           *pBltBuffer = NULL;
   EFI_LOADED_IMAGE_PROTOCOL  *ImageInfo;
+  EFI_STRING                 TitleString = NULL;
+  UINTN                      TitleX;
   CHAR8                      Parameter = '\0';
   EFI_GUID                   *IconFile = NULL;
   UINTN                      DataSize;
@@ -1052,6 +1261,26 @@ RenderTitlebar (
     GetAndDisplayBitmap (IconFile, (mTitleBarWidth * FP_TBAR_ENTRY_INDICATOR_X_PERCENT) / 100, TRUE);
   }
 
+  TitleString = HiiGetString (mFrontPagePrivate.HiiHandle, STRING_TOKEN (STR_FRONT_PAGE_TITLE), NULL);
+  if (NULL == TitleString) {
+    Status = EFI_NOT_FOUND;
+    goto Exit;
+  }
+
+  // Select a font (size & style) and font colors.
+  //
+  ZeroMem (&StringInfo, sizeof (StringInfo));
+  StringInfo.FontInfoMask       = EFI_FONT_INFO_ANY_FONT;
+  StringInfo.FontInfo.FontSize  = FP_TBAR_TEXT_FONT_HEIGHT;
+  StringInfo.FontInfo.FontStyle = EFI_HII_FONT_STYLE_NORMAL;
+
+  CopyMem (&StringInfo.ForegroundColor, &gMsColorTable.TitleBarTextColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  CopyMem (&StringInfo.BackgroundColor, &gMsColorTable.TitleBarBackgroundColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+
+  // Based on Master Frame width - so the logo bitmap aligns with the text in the menu.
+  //
+  TitleX = (mMasterFrameWidth * FP_TBAR_TEXT_X_PERCENT) / 100;
+
   // Prepare string blitting buffer.
   //
   pBltBuffer = (EFI_IMAGE_OUTPUT *)AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
@@ -1066,22 +1295,13 @@ RenderTitlebar (
   pBltBuffer->Height       = (UINT16)mBootVerticalResolution;
   pBltBuffer->Image.Screen = mGop;
 
-  // Select a font (size & style) and font colors.
-  //
-  StringInfo.FontInfoMask       = EFI_FONT_INFO_ANY_FONT;
-  StringInfo.FontInfo.FontSize  = FP_TBAR_TEXT_FONT_HEIGHT;
-  StringInfo.FontInfo.FontStyle = EFI_HII_FONT_STYLE_NORMAL;
-
-  CopyMem (&StringInfo.ForegroundColor, &gMsColorTable.TitleBarTextColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-  CopyMem (&StringInfo.BackgroundColor, &gMsColorTable.TitleBarBackgroundColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-
   // Determine the size the TitleBar text string will occupy on the screen.
   //
   UINT32    MaxDescent;
   SWM_RECT  StringRect;
 
   GetTextStringBitmapSize (
-    HiiGetString (mFrontPagePrivate.HiiHandle, STRING_TOKEN (STR_FRONT_PAGE_TITLE), NULL),
+    TitleString,
     &StringInfo.FontInfo,
     FALSE,
     EFI_HII_OUT_FLAG_CLIP |
@@ -1099,10 +1319,10 @@ RenderTitlebar (
                   EFI_HII_OUT_FLAG_CLIP |
                   EFI_HII_OUT_FLAG_CLIP_CLEAN_X | EFI_HII_OUT_FLAG_CLIP_CLEAN_Y |
                   EFI_HII_IGNORE_LINE_BREAK | EFI_HII_DIRECT_TO_SCREEN,
-                  HiiGetString (mFrontPagePrivate.HiiHandle, STRING_TOKEN (STR_FRONT_PAGE_TITLE), NULL),
+                  TitleString,
                   &StringInfo,
                   &pBltBuffer,
-                  ((mMasterFrameWidth  * FP_TBAR_TEXT_X_PERCENT) / 100),                                     // Based on Master Frame width - so the logo bitmap aligns with the text in the menu.
+                  TitleX,
                   ((mTitleBarHeight / 2) - ((StringRect.Bottom - StringRect.Top + 1) / 2)),                  // Vertically center.
                   NULL,
                   NULL,
@@ -1115,6 +1335,10 @@ Exit:
     FreePool (pBltBuffer);
   }
 
+  if (NULL != TitleString) {
+    FreePool (TitleString);
+  }
+
   return Status;
 }
 
@@ -1247,6 +1471,197 @@ NotifyUserOfAlerts (
   return Status;
 } // NotifyUserOfAlerts()
 
+//
+// Pointer moves are coalesced to one top-level menu draw per frame interval. The first move in an interval is
+// drawn right away and the last one dropped in the interval is kept, so the final position is not lost when the
+// pointer stops. Button transitions are always drawn immediately. All drawing happens while the display engine
+// dispatches MasterFrameNotifyCallback, so the interval timer only ends the interval and the kept move is drawn
+// at the first dispatch after that, unless that dispatch brings a newer pointer event.
+//
+#define FP_POINTER_FRAME_INTERVAL  EFI_TIMER_PERIOD_MILLISECONDS (16)
+
+STATIC BOOLEAN          mPointerFrameActive   = FALSE;
+STATIC UINT32           mLastPointerButtons   = 0;
+STATIC BOOLEAN          mPointerInputPending  = FALSE;
+STATIC SWM_INPUT_STATE  mPendingPointerInput;
+
+/**
+  Draw the top-level menu with an input event.
+
+  @param    InputState          Input to pass to the menu.
+  @param    DispatchTimestamp   Latency timestamp taken when the input was dispatched, or 0.
+
+  @retval   The menu state returned by the draw.
+
+**/
+STATIC
+OBJECT_STATE
+DrawTopMenuWithInput (
+  IN SWM_INPUT_STATE  *InputState,
+  IN UINT64           DispatchTimestamp
+  )
+{
+  OBJECT_STATE  MenuState;
+  VOID          *pSelectionContext = NULL;
+  UINT64        InputTimestamp;
+
+  // Draw the top-level menu in the master frame.
+  //
+  MenuState = mTopMenu->Base.Draw (
+                               mTopMenu,
+                               mDisplayEngineState.ShowTopMenuHighlight,
+                               InputState,
+                               &pSelectionContext
+                               );
+
+  // The menu Blt is complete at this point. Key input also has its console arrival time.
+  //
+  FrontPageLatencyRecord (FrontPageLatencyDispatchToPixel, DispatchTimestamp);
+  if (SWM_INPUT_TYPE_KEY == InputState->InputType) {
+    InputTimestamp = FrontPageLatencyTakeInputTimestamp ();
+    FrontPageLatencyRecord (FrontPageLatencyInputToPixel, InputTimestamp);
+  }
+
+  return MenuState;
+}
+
+/**
+  Switch to the form selected in the top-level menu, if it changed.
+
+**/
+STATIC
+VOID
+HandleTopMenuSelection (
+  VOID
+  )
+{
+  UINT32          SelectedIndex;
+  LB_RETURN_DATA  ReturnData;
+
+  // Get the currently selected top-level menu entry (may be none).
+  //
+  mTopMenu->GetSelectedCellIndex (
+              mTopMenu,
+              &ReturnData
+              );
+
+  SelectedIndex = ReturnData.SelectedCell;
+
+  if (SelectedIndex != mCurrentFormIndex) {
+    // Update the current form ID to the new one.
+    //
+    mCurrentFormIndex = SelectedIndex;
+
+    // Signal the form (browser) to close so the new form will be displayed.
+    //
+    mDisplayEngineState.CloseFormRequest = TRUE;
+    mTerminateFrontPage                  = FALSE;
+    FrontPageLatencyMarkFormSwitch ();
+  }
+}
+
+/**
+  Start a pointer frame interval.
+
+**/
+STATIC
+VOID
+StartPointerFrame (
+  VOID
+  )
+{
+  if (NULL == mPointerFrameEvent) {
+    return;
+  }
+
+  mPointerFrameActive = !EFI_ERROR (gBS->SetTimer (mPointerFrameEvent, TimerRelative, FP_POINTER_FRAME_INTERVAL));
+}
+
+/**
+  Decide whether a pointer event is drawn now or coalesced into the current frame interval.
+
+  @param    InputState    Pointer input from the display engine.
+
+  @retval   TRUE          Draw the event now.
+  @retval   FALSE         The event falls within the current frame interval. It is kept to be drawn after the
+                          interval ends.
+
+**/
+STATIC
+BOOLEAN
+ShouldDrawPointerEvent (
+  IN SWM_INPUT_STATE  *InputState
+  )
+{
+  BOOLEAN  ButtonTransition;
+
+  ButtonTransition    = (InputState->State.TouchState.ActiveButtons != mLastPointerButtons);
+  mLastPointerButtons = InputState->State.TouchState.ActiveButtons;
+
+  if (!ButtonTransition && mPointerFrameActive) {
+    CopyMem (&mPendingPointerInput, InputState, sizeof (mPendingPointerInput));
+    mPointerInputPending = TRUE;
+    FrontPageLatencyCountPointerEvent (FALSE);
+    return FALSE;
+  }
+
+  if (!mPointerFrameActive) {
+    StartPointerFrame ();
+  }
+
+  // This event is newer than any move kept from the interval.
+  //
+  mPointerInputPending = FALSE;
+  FrontPageLatencyCountPointerEvent (TRUE);
+  return TRUE;
+}
+
+/**
+  Draw the last pointer move dropped in a frame interval that has ended, and start a new interval.
+
+  @param    DispatchTimestamp   Latency timestamp taken when the current notification was dispatched.
+
+**/
+STATIC
+VOID
+DrawPendingPointerInput (
+  IN UINT64  DispatchTimestamp
+  )
+{
+  if (!mPointerInputPending || mPointerFrameActive) {
+    return;
+  }
+
+  mPointerInputPending = FALSE;
+  StartPointerFrame ();
+
+  if (SELECT == DrawTopMenuWithInput (&mPendingPointerInput, DispatchTimestamp)) {
+    HandleTopMenuSelection ();
+  }
+}
+
+/**
+  Pointer frame interval timer callback. Ends the frame interval so that the kept pointer move, or the next one,
+  is drawn.
+
+  The top menu is not drawn here: the display engine owns the screen outside its MasterFrameNotifyCallback
+  dispatch.
+
+  @param    Event     The timer event.
+  @param    Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+PointerFrameCallback (
+  IN  EFI_EVENT  Event,
+  IN  VOID       *Context
+  )
+{
+  mPointerFrameActive = FALSE;
+}
+
 /**
   Master Frame callback (signalled by Display Engine) for receiving user input data (i.e., key, touch, mouse, etc.).
 
@@ -1263,11 +1678,18 @@ MasterFrameNotifyCallback (
   IN  VOID       *Context
   )
 {
-  UINT32           SelectedIndex      = 0;
   VOID             *pSelectionContext = NULL;
   OBJECT_STATE     MenuState          = NORMAL;
   SWM_INPUT_STATE  *pInputState       = &mDisplayEngineState.InputState;
-  LB_RETURN_DATA   ReturnData;
+  UINT64           DispatchTimestamp;
+
+  DispatchTimestamp = FrontPageLatencyTimestamp ();
+
+  // Catch up on a pointer move kept from an ended frame interval, unless this notification is a newer pointer event.
+  //
+  if ((USERINPUT != mDisplayEngineState.NotificationType) || (SWM_INPUT_TYPE_TOUCH != pInputState->InputType)) {
+    DrawPendingPointerInput (DispatchTimestamp);
+  }
 
   // If we just need to redraw, do that and exit.
   //
@@ -1279,6 +1701,7 @@ MasterFrameNotifyCallback (
                      &pSelectionContext
                      );
 
+    FrontPageLatencyRecord (FrontPageLatencyDispatchToPixel, DispatchTimestamp);
     goto Exit;
   }
 
@@ -1293,14 +1716,13 @@ MasterFrameNotifyCallback (
   if ((SWM_INPUT_TYPE_TOUCH == pInputState->InputType /* && (pInputState->State.TouchState.ActiveButtons & 0x1) */) ||
       (SWM_INPUT_TYPE_KEY   == pInputState->InputType))
   {
-    // Draw the top-level menu in the master frame.
+    // Pointer moves within a frame interval are drawn once, when the interval ends.
     //
-    MenuState = mTopMenu->Base.Draw (
-                                 mTopMenu,
-                                 mDisplayEngineState.ShowTopMenuHighlight,
-                                 &mDisplayEngineState.InputState,
-                                 &pSelectionContext
-                                 );
+    if ((SWM_INPUT_TYPE_TOUCH == pInputState->InputType) && !ShouldDrawPointerEvent (pInputState)) {
+      goto Exit;
+    }
+
+    MenuState = DrawTopMenuWithInput (pInputState, DispatchTimestamp);
 
     // If nothing was selected (user may simply have moved the highlighted cell), there's no action to take.
     //
@@ -1308,25 +1730,7 @@ MasterFrameNotifyCallback (
       return;
     }
 
-    // Get the currently selected top-level menu entry (may be none).
-    //
-    mTopMenu->GetSelectedCellIndex (
-                mTopMenu,
-                &ReturnData
-                );
-
-    SelectedIndex = ReturnData.SelectedCell;
-
-    if (SelectedIndex != mCurrentFormIndex) {
-      // Update the current form ID to the new one.
-      //
-      mCurrentFormIndex = SelectedIndex;
-
-      // Signal the form (browser) to close so the new form will be displayed.
-      //
-      mDisplayEngineState.CloseFormRequest = TRUE;
-      mTerminateFrontPage                  = FALSE;
-    }
+    HandleTopMenuSelection ();
   }
 
 Exit:
@@ -1414,6 +1818,22 @@ InitializeFrontPageUI (
     goto Exit;
   }
 
+  // Create the pointer frame interval timer. Without it every pointer event is drawn.
+  //
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  PointerFrameCallback,
+                  NULL,
+                  &mPointerFrameEvent
+                  );
+
+  if (EFI_SUCCESS != Status) {
+    DEBUG ((DEBUG_WARN, "WARN [FP]: Failed to create pointer frame timer, pointer events will not be coalesced.  Status = %r\r\n", Status));
+    mPointerFrameEvent = NULL;
+    Status             = EFI_SUCCESS;
+  }
+
   // Set shared pointer to user input context structure in a PCD so it can be shared.
   //
   PcdSet64S (PcdCurrentPointerState, (UINT64)(UINTN)&mDisplayEngineState);
@@ -1655,6 +2075,10 @@ UefiMain (
   //
   InitializeFrontPage (TRUE);
 
+  // Start collecting responsiveness data.
+  //
+  FrontPageLatencyInitialize ();
+
   // Initialize the FrontPage User Interface.
   //
   Status = InitializeFrontPageUI ();
@@ -1679,6 +2103,10 @@ UefiMain (
     CallFrontPage (mCurrentFormIndex);
   } while (FALSE == mTerminateFrontPage);
 
+  // Publish the responsiveness data before a reset can discard it.
+  //
+  FrontPageLatencyUninitialize ();
+
   if (mResetRequired) {
     ResetSystemWithSubtype (EfiResetCold, &gFrontPageResetGuid);
   }
@@ -1764,6 +2192,9 @@ GetAndDisplayBitmap (
 
 /**
 Acquire an Auth Token and save it in a protocol
+
+The DFCI auth token is the session token of the visit: FrontPageUi and BootMenu pass it to every DFCI
+check, so the password is only hashed here. It is disposed of in UninitializeFrontPage.
 **/
 EFI_STATUS
 GetAuthToken (
@@ -1793,7 +2224,7 @@ GetAuthToken (
   }
 
   if (!EFI_ERROR (Status) && (mAuthToken != DFCI_AUTH_TOKEN_INVALID)) {
-    mFrontPageAuthTokenProtocol = (FRONT_PAGE_AUTH_TOKEN_PROTOCOL *)AllocateZeroPool (sizeof (mFrontPageAuthTokenProtocol));
+    mFrontPageAuthTokenProtocol = (FRONT_PAGE_AUTH_TOKEN_PROTOCOL *)AllocateZeroPool (sizeof (*mFrontPageAuthTokenProtocol));
 
     //
     // Regardless of the auth token value we install the protocol.
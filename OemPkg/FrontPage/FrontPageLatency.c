@@ -0,0 +1,337 @@
+/** @file
+  Responsiveness measurement for the FrontPage.
+
+  Input arrival, master frame dispatch, form callbacks and top menu switches are timestamped with the
+  performance counter and collected into fixed log2 microsecond histograms. The histograms are dumped to
+  the debug log and published in a volatile variable when FrontPage exits so that UI changes can be
+  compared before and after, and slow OEM callbacks stand out.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/SimpleTextInEx.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include "FrontPageLatency.h"
+
+//
+// Keys that move or activate the top menu highlight.
+//
+STATIC CONST EFI_INPUT_KEY  mLatencyKeys[] = {
+  { SCAN_UP,   CHAR_NULL            },
+  { SCAN_DOWN, CHAR_NULL            },
+  { SCAN_NULL, CHAR_TAB             },
+  { SCAN_NULL, CHAR_CARRIAGE_RETURN }
+};
+
+STATIC CHAR8  *mLatencyPathNames[FrontPageLatencyPathMax] = {
+  "InputToPixel",
+  "DispatchToPixel",
+  "FormCallback",
+  "FormSwitch"
+};
+
+STATIC FRONT_PAGE_LATENCY_VARIABLE        mLatency;
+STATIC UINT64                             mCounterStart;
+STATIC UINT64                             mCounterEnd;
+STATIC volatile UINT64                    mInputTimestamp      = 0;
+STATIC UINT64                             mFormSwitchTimestamp = 0;
+STATIC EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL  *mLatencyTextInEx    = NULL;
+STATIC VOID                               *mLatencyKeyNotifyHandles[ARRAY_SIZE (mLatencyKeys)];
+
+/**
+  Get a timestamp to later pass to FrontPageLatencyRecord.
+
+  @retval   The current performance counter value.
+
+**/
+UINT64
+FrontPageLatencyTimestamp (
+  VOID
+  )
+{
+  UINT64  Counter;
+
+  // 0 means "no timestamp" to the rest of this file.
+  //
+  Counter = GetPerformanceCounter ();
+  return (Counter == 0) ? 1 : Counter;
+}
+
+/**
+  Console key notification. Runs at notify TPL as soon as the key is read from the device, ahead of
+  the display engine, so it marks the arrival of the input.
+
+  @param[in]  KeyData   The key that was pressed.
+
+  @retval     EFI_SUCCESS   Always.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+LatencyKeyNotify (
+  IN EFI_KEY_DATA  *KeyData
+  )
+{
+  mInputTimestamp = FrontPageLatencyTimestamp ();
+  return EFI_SUCCESS;
+}
+
+/**
+  Get and clear the timestamp of the most recent console key arrival.
+
+  @retval   The timestamp, or 0 if no key has arrived since the last call.
+
+**/
+UINT64
+FrontPageLatencyTakeInputTimestamp (
+  VOID
+  )
+{
+  EFI_TPL  OldTpl;
+  UINT64   Timestamp;
+
+  OldTpl          = gBS->RaiseTPL (TPL_NOTIFY);
+  Timestamp       = mInputTimestamp;
+  mInputTimestamp = 0;
+  gBS->RestoreTPL (OldTpl);
+
+  return Timestamp;
+}
+
+/**
+  Convert the counter ticks between two timestamps to microseconds, allowing for a counter that counts
+  down and for a single wrap.
+
+  @param[in]  Start   Earlier timestamp.
+  @param[in]  End     Later timestamp.
+
+  @retval   Elapsed microseconds.
+
+**/
+STATIC
+UINT64
+ElapsedMicroseconds (
+  IN UINT64  Start,
+  IN UINT64  End
+  )
+{
+  UINT64  Ticks;
+
+  if (mCounterEnd >= mCounterStart) {
+    Ticks = (End >= Start) ? (End - Start) : ((mCounterEnd - Start) + (End - mCounterStart));
+  } else {
+    Ticks = (Start >= End) ? (Start - End) : ((mCounterStart - End) + (Start - mCounterEnd));
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+}
+
+/**
+  Add the time elapsed since StartTimestamp to the histogram of a path.
+
+  @param[in]  Path            Path being measured.
+  @param[in]  StartTimestamp  Timestamp taken when the path started. 0 is ignored.
+
+**/
+VOID
+FrontPageLatencyRecord (
+  IN FRONT_PAGE_LATENCY_PATH  Path,
+  IN UINT64                   StartTimestamp
+  )
+{
+  FRONT_PAGE_LATENCY_HISTOGRAM  *Histogram;
+  UINT64                        Microseconds;
+  UINTN                         Bucket;
+
+  if ((StartTimestamp == 0) || (Path >= FrontPageLatencyPathMax)) {
+    return;
+  }
+
+  Microseconds = ElapsedMicroseconds (StartTimestamp, FrontPageLatencyTimestamp ());
+
+  Bucket = 0;
+  if (Microseconds != 0) {
+    Bucket = MIN ((UINTN)HighBitSet64 (Microseconds), FRONT_PAGE_LATENCY_BUCKET_COUNT - 1);
+  }
+
+  Histogram = &mLatency.Histogram[Path];
+  Histogram->Count++;
+  Histogram->TotalMicroseconds += Microseconds;
+  Histogram->MaxMicroseconds    = MAX (Histogram->MaxMicroseconds, Microseconds);
+  Histogram->Buckets[Bucket]++;
+}
+
+/**
+  Note that a new top menu entry was selected. The form switch is recorded by the next call to
+  FrontPageLatencyFormSwitchDone.
+
+**/
+VOID
+FrontPageLatencyMarkFormSwitch (
+  VOID
+  )
+{
+  mFormSwitchTimestamp = FrontPageLatencyTimestamp ();
+}
+
+/**
+  Record a form switch started by FrontPageLatencyMarkFormSwitch, if there is one.
+
+**/
+VOID
+FrontPageLatencyFormSwitchDone (
+  VOID
+  )
+{
+  FrontPageLatencyRecord (FrontPageLatencyFormSwitch, mFormSwitchTimestamp);
+  mFormSwitchTimestamp = 0;
+}
+
+/**
+  Count a pointer event that reached the top menu.
+
+  @param[in]  Drawn   TRUE if the event was drawn, FALSE if it was dropped within a frame interval.
+
+**/
+VOID
+FrontPageLatencyCountPointerEvent (
+  IN BOOLEAN  Drawn
+  )
+{
+  if (Drawn) {
+    mLatency.PointerEventsDrawn++;
+  } else {
+    mLatency.PointerEventsCoalesced++;
+  }
+}
+
+/**
+  Reset the histograms and start watching for console key arrivals.
+
+**/
+VOID
+FrontPageLatencyInitialize (
+  VOID
+  )
+{
+  EFI_STATUS    Status;
+  EFI_KEY_DATA  KeyData;
+  UINTN         Index;
+
+  ZeroMem (&mLatency, sizeof (mLatency));
+  mLatency.Signature   = FRONT_PAGE_LATENCY_SIGNATURE;
+  mLatency.Version     = FRONT_PAGE_LATENCY_VERSION;
+  mLatency.PathCount   = FrontPageLatencyPathMax;
+  mLatency.BucketCount = FRONT_PAGE_LATENCY_BUCKET_COUNT;
+
+  GetPerformanceCounterProperties (&mCounterStart, &mCounterEnd);
+
+  mInputTimestamp      = 0;
+  mFormSwitchTimestamp = 0;
+  ZeroMem (mLatencyKeyNotifyHandles, sizeof (mLatencyKeyNotifyHandles));
+
+  Status = gBS->HandleProtocol (
+                  gST->ConsoleInHandle,
+                  &gEfiSimpleTextInputExProtocolGuid,
+                  (VOID **)&mLatencyTextInEx
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a - No SimpleTextInEx on the console (%r). Input latency will not be measured.\n", __FUNCTION__, Status));
+    mLatencyTextInEx = NULL;
+    return;
+  }
+
+  ZeroMem (&KeyData, sizeof (KeyData));
+  for (Index = 0; Index < ARRAY_SIZE (mLatencyKeys); Index++) {
+    KeyData.Key = mLatencyKeys[Index];
+    Status      = mLatencyTextInEx->RegisterKeyNotify (
+                                      mLatencyTextInEx,
+                                      &KeyData,
+                                      LatencyKeyNotify,
+                                      &mLatencyKeyNotifyHandles[Index]
+                                      );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_WARN, "%a - Failed to register key notify %d (%r).\n", __FUNCTION__, Index, Status));
+      mLatencyKeyNotifyHandles[Index] = NULL;
+    }
+  }
+}
+
+/**
+  Stop watching for key arrivals, then dump the histograms to the debug log and to the
+  FrontPageLatency variable.
+
+**/
+VOID
+FrontPageLatencyUninitialize (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+  FRONT_PAGE_LATENCY_HISTOGRAM  *Histogram;
+  UINTN                         Path;
+  UINTN                         Bucket;
+
+  if (mLatencyTextInEx != NULL) {
+    for (Path = 0; Path < ARRAY_SIZE (mLatencyKeyNotifyHandles); Path++) {
+      if (mLatencyKeyNotifyHandles[Path] != NULL) {
+        mLatencyTextInEx->UnregisterKeyNotify (mLatencyTextInEx, mLatencyKeyNotifyHandles[Path]);
+        mLatencyKeyNotifyHandles[Path] = NULL;
+      }
+    }
+
+    mLatencyTextInEx = NULL;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "FrontPage pointer events: Drawn=%d Coalesced=%d\n",
+    mLatency.PointerEventsDrawn,
+    mLatency.PointerEventsCoalesced
+    ));
+
+  for (Path = 0; Path < FrontPageLatencyPathMax; Path++) {
+    Histogram = &mLatency.Histogram[Path];
+    if (Histogram->Count == 0) {
+      continue;
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "FrontPage latency %a: Count=%d AvgUs=%ld MaxUs=%ld\n",
+      mLatencyPathNames[Path],
+      Histogram->Count,
+      DivU64x32 (Histogram->TotalMicroseconds, Histogram->Count),
+      Histogram->MaxMicroseconds
+      ));
+
+    for (Bucket = 0; Bucket < FRONT_PAGE_LATENCY_BUCKET_COUNT; Bucket++) {
+      if (Histogram->Buckets[Bucket] != 0) {
+        DEBUG ((DEBUG_INFO, "  >= %8ldus : %d\n", (Bucket == 0) ? 0 : LShiftU64 (1, Bucket), Histogram->Buckets[Bucket]));
+      }
+    }
+  }
+
+  Status = gRT->SetVariable (
+                  FRONT_PAGE_LATENCY_VARIABLE_NAME,
+                  &gOemFrontPageLatencyVarGuid,
+                  FRONT_PAGE_LATENCY_VARIABLE_ATTRS,
+                  sizeof (mLatency),
+                  &mLatency
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a - Failed to publish the latency histograms (%r).\n", __FUNCTION__, Status));
+  }
+}
@@ -0,0 +1,98 @@
+/** @file
+  Responsiveness measurement for the FrontPage.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _FRONT_PAGE_LATENCY_H_
+#define _FRONT_PAGE_LATENCY_H_
+
+#include <Guid/FrontPageLatencyVariable.h>
+
+/**
+  Reset the histograms and start watching for console key arrivals.
+
+**/
+VOID
+FrontPageLatencyInitialize (
+  VOID
+  );
+
+/**
+  Stop watching for key arrivals, then dump the histograms to the debug log and to the
+  FrontPageLatency variable.
+
+**/
+VOID
+FrontPageLatencyUninitialize (
+  VOID
+  );
+
+/**
+  Get a timestamp to later pass to FrontPageLatencyRecord.
+
+  @retval   The current performance counter value.
+
+**/
+UINT64
+FrontPageLatencyTimestamp (
+  VOID
+  );
+
+/**
+  Get and clear the timestamp of the most recent console key arrival.
+
+  @retval   The timestamp, or 0 if no key has arrived since the last call.
+
+**/
+UINT64
+FrontPageLatencyTakeInputTimestamp (
+  VOID
+  );
+
+/**
+  Add the time elapsed since StartTimestamp to the histogram of a path.
+
+  @param[in]  Path            Path being measured.
+  @param[in]  StartTimestamp  Timestamp taken when the path started. 0 is ignored.
+
+**/
+VOID
+FrontPageLatencyRecord (
+  IN FRONT_PAGE_LATENCY_PATH  Path,
+  IN UINT64                   StartTimestamp
+  );
+
+/**
+  Note that a new top menu entry was selected. The form switch is recorded by the next call to
+  FrontPageLatencyFormSwitchDone.
+
+**/
+VOID
+FrontPageLatencyMarkFormSwitch (
+  VOID
+  );
+
+/**
+  Record a form switch started by FrontPageLatencyMarkFormSwitch, if there is one.
+
+**/
+VOID
+FrontPageLatencyFormSwitchDone (
+  VOID
+  );
+
+/**
+  Count a pointer event that reached the top menu.
+
+  @param[in]  Drawn   TRUE if the event was drawn, FALSE if it was dropped within a frame interval.
+
+**/
+VOID
+FrontPageLatencyCountPointerEvent (
+  IN BOOLEAN  Drawn
+  );
+
+#endif // _FRONT_PAGE_LATENCY_H_
@@ -0,0 +1,288 @@
+/** @file
+  Progress indicator for password hashing in the FrontPage.
+
+  Checking or setting a password runs a deliberately slow PBKDF2 hash, which leaves the screen
+  frozen for up to a second or more. When the password hash provider publishes the password hash
+  progress protocol, FrontPage registers a callback with it for the duration of the hash. The
+  callback grows a progress bar in a panel at the center of the screen and polls the console for Esc,
+  returning FALSE to abort the hash when it is pressed. The screen under the panel is saved and put
+  back when the hash is done.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/GraphicsOutput.h>
+#include <Protocol/HiiFont.h>
+#include <Protocol/PasswordHashProgress.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HiiLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MsColorTableLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <MsDisplayEngine.h>
+
+#include "FrontPagePasswordProgress.h"
+
+#define PWD_PROGRESS_WIDTH_PERCENT  50        // The panel is half the width of the screen.
+#define PWD_PROGRESS_RENDER_FLAGS   (EFI_HII_OUT_FLAG_CLIP | EFI_HII_OUT_FLAG_CLIP_CLEAN_X | EFI_HII_OUT_FLAG_CLIP_CLEAN_Y | EFI_HII_IGNORE_LINE_BREAK | EFI_HII_DIRECT_TO_SCREEN)
+
+extern EFI_GRAPHICS_OUTPUT_PROTOCOL  *mGop;
+extern EFI_HII_FONT_PROTOCOL         *mFont;
+extern EFI_HII_HANDLE                gStringPackHandle;
+extern UINT32                        mBootHorizontalResolution;
+extern UINT32                        mBootVerticalResolution;
+
+STATIC PASSWORD_HASH_PROGRESS_PROTOCOL  *mHashProgress = NULL;
+STATIC EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *mSavedPixels  = NULL;   // Screen under the panel.
+STATIC UINTN                            mPanelX;
+STATIC UINTN                            mPanelY;
+STATIC UINTN                            mPanelWidth;
+STATIC UINTN                            mPanelHeight;
+STATIC UINTN                            mBarX;
+STATIC UINTN                            mBarY;
+STATIC UINTN                            mBarWidth;
+STATIC UINTN                            mBarHeight;
+STATIC UINTN                            mBarFill;               // Width of the filled part of the bar.
+STATIC BOOLEAN                          mCancelled = FALSE;
+
+/**
+  Fill a rectangle of the screen with a color.
+
+  @param[in]  Color   Fill color.
+  @param[in]  X       Screen X coordinate of the top left corner.
+  @param[in]  Y       Screen Y coordinate of the top left corner.
+  @param[in]  Width   Width of the rectangle. 0 draws nothing.
+  @param[in]  Height  Height of the rectangle.
+
+**/
+STATIC
+VOID
+FillRectangle (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Color,
+  IN UINTN                          X,
+  IN UINTN                          Y,
+  IN UINTN                          Width,
+  IN UINTN                          Height
+  )
+{
+  if ((Width == 0) || (Height == 0)) {
+    return;
+  }
+
+  mGop->Blt (mGop, Color, EfiBltVideoFill, 0, 0, X, Y, Width, Height, 0);
+}
+
+/**
+  Put back the screen under the panel, or clear the panel if the screen could not be saved.
+
+**/
+STATIC
+VOID
+RemovePanel (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = EFI_NOT_READY;
+  if (mSavedPixels != NULL) {
+    Status = mGop->Blt (mGop, mSavedPixels, EfiBltBufferToVideo, 0, 0, mPanelX, mPanelY, mPanelWidth, mPanelHeight, 0);
+    FreePool (mSavedPixels);
+    mSavedPixels = NULL;
+  }
+
+  if (EFI_ERROR (Status)) {
+    FillRectangle (&gMsColorTable.MasterFrameBackgroundColor, mPanelX, mPanelY, mPanelWidth, mPanelHeight);
+  }
+}
+
+/**
+  Password hash progress callback. Follows the hash with the progress bar and cancels it when Esc
+  has been pressed. Other keys pressed during the hash are discarded.
+
+  @param[in]  Context     Not used.
+  @param[in]  Completed   Iterations completed so far.
+  @param[in]  Total       Iterations in the whole hash.
+
+  @retval     TRUE    Continue hashing.
+  @retval     FALSE   The user pressed Esc.
+
+**/
+STATIC
+BOOLEAN
+EFIAPI
+PasswordProgressCallback (
+  IN VOID    *Context,
+  IN UINT64  Completed,
+  IN UINT64  Total
+  )
+{
+  EFI_INPUT_KEY  Key;
+  UINTN          Fill;
+
+  // Checking a password may run more than one hash, each reporting from 0 again. The bar follows the
+  // hash in progress.
+  //
+  Fill = 0;
+  if (Total != 0) {
+    Fill = (UINTN)DivU64x64Remainder (MultU64x64 (MIN (Completed, Total), mBarWidth), Total, NULL);
+  }
+
+  if (Fill > mBarFill) {
+    FillRectangle (&gMsColorTable.MasterFrameCellSelectColor, mBarX + mBarFill, mBarY, Fill - mBarFill, mBarHeight);
+  } else if (Fill < mBarFill) {
+    FillRectangle (&gMsColorTable.MasterFrameCellNormalColor, mBarX + Fill, mBarY, mBarFill - Fill, mBarHeight);
+  }
+
+  mBarFill = Fill;
+
+  while (!EFI_ERROR (gST->ConIn->ReadKeyStroke (gST->ConIn, &Key))) {
+    if (Key.ScanCode == SCAN_ESC) {
+      mCancelled = TRUE;
+    }
+  }
+
+  return !mCancelled;
+}
+
+/**
+  Show a progress bar with a message while a password is being hashed, and let the user cancel the
+  hash with Esc. Does nothing if the password hash provider does not report progress.
+
+  @param[in]  MessageId   String shown above the progress bar.
+
+**/
+VOID
+FrontPagePasswordProgressBegin (
+  IN EFI_STRING_ID  MessageId
+  )
+{
+  EFI_STATUS             Status;
+  CHAR16                 *Message;
+  EFI_FONT_DISPLAY_INFO  StringInfo;
+  EFI_IMAGE_OUTPUT       Screen;
+  EFI_IMAGE_OUTPUT       *ScreenPtr;
+  UINTN                  Margin;
+
+  mCancelled = FALSE;
+  mBarFill   = 0;
+  Message    = NULL;
+
+  if ((mGop == NULL) || (mHashProgress != NULL)) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol (&gPasswordHashProgressProtocolGuid, NULL, (VOID **)&mHashProgress);
+  if (EFI_ERROR (Status)) {
+    mHashProgress = NULL;
+    return;
+  }
+
+  // Select the same font and colors as the title bar.
+  //
+  ZeroMem (&StringInfo, sizeof (StringInfo));
+  StringInfo.FontInfoMask       = EFI_FONT_INFO_ANY_FONT;
+  StringInfo.FontInfo.FontSize  = FP_TBAR_TEXT_FONT_HEIGHT;
+  StringInfo.FontInfo.FontStyle = EFI_HII_FONT_STYLE_NORMAL;
+
+  CopyMem (&StringInfo.ForegroundColor, &gMsColorTable.TitleBarTextColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  CopyMem (&StringInfo.BackgroundColor, &gMsColorTable.TitleBarBackgroundColor, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+
+  Message = HiiGetString (gStringPackHandle, MessageId, NULL);
+
+  // Lay out the panel: the message, then the bar, with a half line of space around each.
+  //
+  Margin       = FP_TBAR_TEXT_FONT_HEIGHT / 2;
+  mBarHeight   = Margin;
+  mPanelWidth  = (mBootHorizontalResolution * PWD_PROGRESS_WIDTH_PERCENT) / 100;
+  mPanelHeight = (3 * Margin) + FP_TBAR_TEXT_FONT_HEIGHT + mBarHeight;
+
+  if ((mPanelWidth <= (2 * Margin)) || (mPanelHeight > mBootVerticalResolution)) {
+    mHashProgress = NULL;
+    goto Exit;
+  }
+
+  mPanelX   = (mBootHorizontalResolution - mPanelWidth) / 2;
+  mPanelY   = (mBootVerticalResolution - mPanelHeight) / 2;
+  mBarX     = mPanelX + Margin;
+  mBarY     = mPanelY + (2 * Margin) + FP_TBAR_TEXT_FONT_HEIGHT;
+  mBarWidth = mPanelWidth - (2 * Margin);
+
+  mSavedPixels = AllocatePool (mPanelWidth * mPanelHeight * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  if (mSavedPixels != NULL) {
+    Status = mGop->Blt (mGop, mSavedPixels, EfiBltVideoToBltBuffer, mPanelX, mPanelY, 0, 0, mPanelWidth, mPanelHeight, 0);
+    if (EFI_ERROR (Status)) {
+      FreePool (mSavedPixels);
+      mSavedPixels = NULL;
+    }
+  }
+
+  FillRectangle (&gMsColorTable.TitleBarBackgroundColor, mPanelX, mPanelY, mPanelWidth, mPanelHeight);
+
+  if ((Message != NULL) && (mFont != NULL)) {
+    ZeroMem (&Screen, sizeof (Screen));
+    Screen.Width        = (UINT16)mBootHorizontalResolution;
+    Screen.Height       = (UINT16)mBootVerticalResolution;
+    Screen.Image.Screen = mGop;
+    ScreenPtr           = &Screen;
+
+    mFont->StringToImage (
+             mFont,
+             PWD_PROGRESS_RENDER_FLAGS,
+             Message,
+             &StringInfo,
+             &ScreenPtr,
+             mBarX,
+             mPanelY + Margin,
+             NULL,
+             NULL,
+             NULL
+             );
+  }
+
+  FillRectangle (&gMsColorTable.MasterFrameCellNormalColor, mBarX, mBarY, mBarWidth, mBarHeight);
+
+  Status = mHashProgress->Register (mHashProgress, PasswordProgressCallback, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a - Failed to register for password hash progress (%r).\n", __FUNCTION__, Status));
+    RemovePanel ();
+    mHashProgress = NULL;
+  }
+
+Exit:
+  if (Message != NULL) {
+    FreePool (Message);
+  }
+}
+
+/**
+  Remove the progress bar shown by FrontPagePasswordProgressBegin and restore the screen under it.
+
+  @retval     TRUE    The user cancelled the hash. The hash request returned EFI_ABORTED.
+  @retval     FALSE   Otherwise.
+
+**/
+BOOLEAN
+FrontPagePasswordProgressEnd (
+  VOID
+  )
+{
+  if (mHashProgress == NULL) {
+    return FALSE;
+  }
+
+  mHashProgress->Register (mHashProgress, NULL, NULL);
+  mHashProgress = NULL;
+
+  RemovePanel ();
+
+  return mCancelled;
+}
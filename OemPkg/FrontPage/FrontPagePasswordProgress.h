@@ -0,0 +1,36 @@
+/** @file
+  Progress indicator for password hashing in the FrontPage.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _FRONT_PAGE_PASSWORD_PROGRESS_H_
+#define _FRONT_PAGE_PASSWORD_PROGRESS_H_
+
+/**
+  Show a progress bar with a message while a password is being hashed, and let the user cancel the
+  hash with Esc. Does nothing if the password hash provider does not report progress.
+
+  @param[in]  MessageId   String shown above the progress bar.
+
+**/
+VOID
+FrontPagePasswordProgressBegin (
+  IN EFI_STRING_ID  MessageId
+  );
+
+/**
+  Remove the progress bar shown by FrontPagePasswordProgressBegin and restore the screen under it.
+
+  @retval     TRUE    The user cancelled the hash. The hash request returned EFI_ABORTED.
+  @retval     FALSE   Otherwise.
+
+**/
+BOOLEAN
+FrontPagePasswordProgressEnd (
+  VOID
+  );
+
+#endif // _FRONT_PAGE_PASSWORD_PROGRESS_H_
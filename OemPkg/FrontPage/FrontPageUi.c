@@ -8,6 +8,8 @@
 
 #include "FrontPage.h"
 #include "FrontPageUi.h"
+#include "FrontPageLatency.h"
+#include "FrontPagePasswordProgress.h"
 
 #include <PiDxe.h>          // This has to be here so Protocol/FirmwareVolume2.h doesn't puke errors.
 #include <UefiSecureBoot.h>
@@ -239,6 +241,7 @@ UiCallback (
   )
 {
   EFI_STATUS  Status = EFI_SUCCESS;
+  UINT64      CallbackTimestamp;
 
   DEBUG ((DEBUG_INFO, "FrontPage:UiCallback() - Question ID=0x%08x Type=0x%04x Action=0x%04x ShortValue=0x%02x\n", QuestionId, Type, Action, *(UINT8 *)Value));
 
@@ -259,7 +262,8 @@ UiCallback (
 
   //
   // Set a default action request.
-  *ActionRequest = EFI_BROWSER_ACTION_REQUEST_NONE;
+  *ActionRequest    = EFI_BROWSER_ACTION_REQUEST_NONE;
+  CallbackTimestamp = FrontPageLatencyTimestamp ();
 
   //
   // Handle the specific callback.
@@ -296,6 +300,8 @@ UiCallback (
       break;
   }
 
+  FrontPageLatencyRecord (FrontPageLatencyFormCallback, CallbackTimestamp);
+
   return Status;
 }
 
@@ -356,6 +362,22 @@ SetSystemPassword (
           // Password contains invalid characters.
           //
           pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_PWD_ERRORMSG_INVALID_CHAR), NULL);
+        } else if (PwdValidBitmap & PW_TEST_STRING_MISSING_UPPER) {
+          // Password needs more uppercase letters.
+          //
+          pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_PWD_ERRORMSG_MISSING_UPPER), NULL);
+        } else if (PwdValidBitmap & PW_TEST_STRING_MISSING_LOWER) {
+          // Password needs more lowercase letters.
+          //
+          pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_PWD_ERRORMSG_MISSING_LOWER), NULL);
+        } else if (PwdValidBitmap & PW_TEST_STRING_MISSING_DIGIT) {
+          // Password needs more numbers.
+          //
+          pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_PWD_ERRORMSG_MISSING_DIGIT), NULL);
+        } else if (PwdValidBitmap & PW_TEST_STRING_MISSING_SYMBOL) {
+          // Password needs more special characters.
+          //
+          pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_PWD_ERRORMSG_MISSING_SYMBOL), NULL);
         } else {
           // Some other (non-specific) failure.
           //
@@ -376,7 +398,21 @@ SetSystemPassword (
       //
       // Otherwise, try setting the password.  If it fails, free the password buffer and try again.
       //
+      FrontPagePasswordProgressBegin (STRING_TOKEN (STR_PWD_SET_PROGRESS));
       Status = PasswordPolicyGeneratePasswordHash (NULL, PasswordBuffer, &PasswordHash, &PasswordHashSize);
+      if (FrontPagePasswordProgressEnd () && (Status == EFI_ABORTED)) {
+        // The user cancelled the hash. Prompt again without an error.
+        //
+        pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_NULL_STRING), NULL);
+
+        if (NULL != PasswordBuffer) {
+          ZeroMem ((UINT8 *)PasswordBuffer, StrLen (PasswordBuffer) * sizeof (CHAR16));
+          FreePool (PasswordBuffer);
+          PasswordBuffer = NULL;
+        }
+
+        continue;
+      }
 
       if (!EFI_ERROR (Status)) {
         Status = mSettingAccess->Set (
@@ -705,7 +741,7 @@ ChallengeUserPassword (
   SWM_MB_RESULT  SwmResult = 0;
   CHAR16         *pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_NULL_STRING), NULL);
   CHAR16         *PasswordBuffer = NULL;           // This will be allocated by PasswordPrompt(). Needs to be tracked, wiped, and freed.
-  BOOLEAN        Result = FALSE, AttemptsExpired = FALSE;
+  BOOLEAN        Result = FALSE, AttemptsExpired = FALSE, HashCancelled = FALSE;
 
   // Primary UI loop.
   // Display prompt. Process results.
@@ -733,11 +769,25 @@ ChallengeUserPassword (
     // If the user selected "OK", check whether the password provided is valid.
     //
     if (SWM_MB_IDOK == SwmResult) {
-      if (GetAuthToken (PasswordBuffer) == EFI_SUCCESS) {
+      FrontPagePasswordProgressBegin (STRING_TOKEN (STR_PWD_VERIFY_PROGRESS));
+      Status        = GetAuthToken (PasswordBuffer);
+      HashCancelled = FrontPagePasswordProgressEnd ();
+
+      if (Status == EFI_SUCCESS) {
         // Password authentication successful.  Display the full menu.
         //
         Result = TRUE;
         break;
+      } else if (HashCancelled) {
+        // The user cancelled the verification. Ask again without an error and without using up an attempt.
+        //
+        pErrorMessage = (CHAR16 *)HiiGetString (gStringPackHandle, STRING_TOKEN (STR_NULL_STRING), NULL);
+
+        if (PasswordBuffer) {
+          ZeroMem ((UINT8 *)PasswordBuffer, StrLen (PasswordBuffer) * sizeof (CHAR16));
+          FreePool (PasswordBuffer);
+          PasswordBuffer = NULL;
+        }
       } else {
         // Password authentication error.  Display error text and ask the user for the password again.
         //
@@ -0,0 +1,61 @@
+/** @file FrontPageLatencyVariable.h
+
+  This file defines the GUID, variable name and data format of the latency histogram that FrontPage
+  publishes when it exits.
+
+  Bucket N of a histogram counts samples of at least 2^N microseconds and less than 2^(N+1)
+  microseconds. Bucket 0 also counts samples under 1 microsecond and the last bucket also counts
+  everything above its range.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __FRONT_PAGE_LATENCY_VARIABLE_GUID_H__
+#define __FRONT_PAGE_LATENCY_VARIABLE_GUID_H__
+
+#define FRONT_PAGE_LATENCY_VARIABLE_NAME   L"FrontPageLatency"
+#define FRONT_PAGE_LATENCY_VARIABLE_ATTRS  (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)     // Volatile.
+
+#define FRONT_PAGE_LATENCY_SIGNATURE     SIGNATURE_32 ('F', 'P', 'L', 'T')
+#define FRONT_PAGE_LATENCY_VERSION       1
+#define FRONT_PAGE_LATENCY_BUCKET_COUNT  20
+
+//
+// Measured paths, in the order they appear in FRONT_PAGE_LATENCY_VARIABLE.Histogram.
+//
+typedef enum {
+  FrontPageLatencyInputToPixel,     // Key arrival at the console to the end of the resulting menu draw.
+  FrontPageLatencyDispatchToPixel,  // Master frame notification dispatch to the end of the menu draw.
+  FrontPageLatencyFormCallback,     // Duration of a form callback (UiCallback).
+  FrontPageLatencyFormSwitch,       // Top menu selection to the browser being called with the new form.
+  FrontPageLatencyPathMax
+} FRONT_PAGE_LATENCY_PATH;
+
+#pragma pack (1)
+
+typedef struct {
+  UINT32    Count;
+  UINT32    Reserved;
+  UINT64    TotalMicroseconds;
+  UINT64    MaxMicroseconds;
+  UINT32    Buckets[FRONT_PAGE_LATENCY_BUCKET_COUNT];
+} FRONT_PAGE_LATENCY_HISTOGRAM;
+
+typedef struct {
+  UINT32                          Signature;
+  UINT16                          Version;
+  UINT16                          PathCount;
+  UINT16                          BucketCount;
+  UINT16                          Reserved;
+  UINT32                          PointerEventsDrawn;       // Pointer events that caused a top menu draw.
+  UINT32                          PointerEventsCoalesced;   // Pointer events dropped within a frame interval.
+  FRONT_PAGE_LATENCY_HISTOGRAM    Histogram[FrontPageLatencyPathMax];
+} FRONT_PAGE_LATENCY_VARIABLE;
+
+#pragma pack ()
+
+extern EFI_GUID  gOemFrontPageLatencyVarGuid;
+
+#endif
@@ -0,0 +1,37 @@
+/** @file OemActiveProfileSelection.h
+
+  This file defines the GUID, HOB and variable formats that select the active config profile at boot
+  for ActiveProfileIndexSelectorHobVarLib.
+
+  A profile is selected by its flavor name rather than its index, so a selection survives a firmware
+  update that adds or reorders profiles. GENERIC_PROFILE_FLAVOR_NAME selects the generic profile.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __OEM_ACTIVE_PROFILE_SELECTION_GUID_H__
+#define __OEM_ACTIVE_PROFILE_SELECTION_GUID_H__
+
+#define OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_NAME   L"ActiveProfile"
+#define OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)     // Non-volatile, BS-only.
+
+#define OEM_ACTIVE_PROFILE_SELECTION_SIGNATURE  SIGNATURE_32 ('O', 'A', 'P', 'S')
+
+#pragma pack (1)
+
+//
+// Data of the gOemActiveProfileSelectionGuid HOB, which a platform PEIM builds before
+// OemConfigPolicyCreatorPei runs, and of the variable of the same GUID.
+//
+typedef struct {
+  UINT32    Signature;
+  CHAR8     FlavorName[PROFILE_FLAVOR_NAME_LENGTH];     // Null-terminated.
+} OEM_ACTIVE_PROFILE_SELECTION;
+
+#pragma pack ()
+
+extern EFI_GUID  gOemActiveProfileSelectionGuid;
+
+#endif
@@ -6,6 +6,7 @@
 **/
 
 #include <Uefi.h>
+#include <Guid/OemConfigSnapshot.h>
 
 #ifndef  OEM_CONFIG_METADATA_POLICY_H_
 #define  OEM_CONFIG_METADATA_POLICY_H_
@@ -22,8 +23,10 @@
   #pragma pack(1)
 
 typedef struct {
-  UINT32    ActiveProfileIndex;
-  CHAR8     ActiveProfileFlavorName[PROFILE_FLAVOR_NAME_LENGTH];
+  UINT32     ActiveProfileIndex;
+  CHAR8      ActiveProfileFlavorName[PROFILE_FLAVOR_NAME_LENGTH];
+  UINT8      ConfigDigest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];   // Digest of the config snapshot, all zero if unknown.
+  BOOLEAN    ConfigUnchanged;                                 // ConfigDigest is also the digest of the previous boot.
 } OEM_CONFIG_METADATA_POLICY;
 
   #pragma pack()
@@ -0,0 +1,64 @@
+/** @file OemConfigOverrideStore.h
+
+  This file defines the GUID, variable name and format of the packed config knob override store.
+
+  The store holds the overrides of many knobs in a single variable, so a tool that changes many knobs
+  writes one variable, and OemConfigPolicyCreatorPei reads all of them with one lookup. Each entry is
+  keyed by the name and namespace of its knob, like the knob variables, so a build that adds, removes
+  or renames knobs only drops the entries that no longer name a knob of the same size. A knob that
+  also has its own override variable takes the value of that variable. OemConfigOverrideLib writes the
+  store in gKnobData order, so a reader of the same build finds each knob at the next index.
+
+  The store is non-volatile and boot services only, so it cannot be written from the OS, and
+  OemConfigPolicyCreatorPei ignores a store with any other attributes. Like the knob variables, it can
+  still be written by anything that runs in DXE before the platform locks config, so a platform has to
+  lock it with VariablePolicy at the same point it locks the knob variables, for instance:
+
+    RegisterBasicVariablePolicy (
+      VariablePolicy,
+      &gOemConfigOverrideStoreGuid,
+      OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME,
+      VARIABLE_POLICY_NO_MIN_SIZE,
+      VARIABLE_POLICY_NO_MAX_SIZE,
+      OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS,
+      (UINT32)~OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS,
+      VARIABLE_POLICY_TYPE_LOCK_NOW
+      );
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __OEM_CONFIG_OVERRIDE_STORE_GUID_H__
+#define __OEM_CONFIG_OVERRIDE_STORE_GUID_H__
+
+#define OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME   L"ConfigKnobOverrides"
+#define OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)      // Non-volatile, BS-only.
+
+#define OEM_CONFIG_OVERRIDE_STORE_SIGNATURE  SIGNATURE_32 ('O', 'C', 'K', 'O')
+#define OEM_CONFIG_OVERRIDE_STORE_VERSION    2
+
+#pragma pack (1)
+
+typedef struct {
+  EFI_GUID    VendorNamespace;  // Namespace of the knob.
+  UINT32      NameSize;         // Size of the ASCII knob name, including the null terminator.
+  UINT32      ValueSize;        // The entry is dropped if this is not the ValueSize of the knob.
+  // CHAR8    Name[NameSize];
+  // UINT8    Value[ValueSize];
+} OEM_CONFIG_OVERRIDE_STORE_ENTRY;
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Version;
+  UINT32    EntryCount;
+  UINT32    Crc32;              // CRC32 of the entries.
+  // Entries, each knob at most once.
+} OEM_CONFIG_OVERRIDE_STORE_HEADER;
+
+#pragma pack ()
+
+extern EFI_GUID  gOemConfigOverrideStoreGuid;
+
+#endif
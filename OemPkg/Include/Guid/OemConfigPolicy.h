@@ -0,0 +1,81 @@
+/** @file OemConfigPolicy.h
+
+  Format of the config policy published by OemConfigPolicyCreatorPei.
+
+  Policy service limits a policy to 64 KB, so the CONFIG_VAR_LIST of the config knobs is split into
+  chunks of whole entries. Chunk N is published under gOemConfigPolicyChunkGuid with N added to
+  Data1. The index entries, which give the chunk and offset of the entry of each knob, follow as
+  pages of OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE entries, page P published as chunk ChunkCount + P.
+  A small index is then published under gOemConfigPolicyGuid that gives the size of each chunk and
+  the perfect hash seeds. Consumers should use OemConfigPolicyLib rather than read these policies
+  directly.
+
+  The index entries are laid out by a minimal perfect hash of the knob name and namespace, so a knob
+  is found with a single probe:
+
+    BucketHash, CheckHash = FNV-1a of the UCS-2 name, null terminator included, then the namespace
+                            GUID, with the two seeds below.
+    Seed                  = Seeds[BucketHash % BucketCount]
+    Slot                  = Seed & OEM_CONFIG_POLICY_INDEX_SEED_DIRECT ?
+                              Seed & ~OEM_CONFIG_POLICY_INDEX_SEED_DIRECT :
+                              Mix (CheckHash ^ (Seed * OEM_CONFIG_POLICY_INDEX_SEED_STEP)) % KnobCount
+
+  where Mix is the MurmurHash3 32-bit finalizer. The knob, if present, is index entry Slot, whose
+  NameHash is its CheckHash. A BucketCount of 0 means no perfect hash could be built (two knobs with
+  the same hashes, such as a knob listed twice, no seed placed a bucket, or OEM_CONFIG_POLICY_INDEX_SEED_DIRECT
+  knobs or more) and the index entries are in list order.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_POLICY_H_
+#define OEM_CONFIG_POLICY_H_
+
+#define OEM_CONFIG_POLICY_INDEX_SIGNATURE  SIGNATURE_32 ('O', 'C', 'P', 'X')
+#define OEM_CONFIG_POLICY_INDEX_VERSION    3
+
+// FNV-1a parameters of the knob name hashes.
+#define OEM_CONFIG_POLICY_INDEX_BUCKET_HASH_SEED  0x811C9DC5
+#define OEM_CONFIG_POLICY_INDEX_CHECK_HASH_SEED   0x050C5D1F
+#define OEM_CONFIG_POLICY_INDEX_HASH_PRIME        0x01000193
+
+// Perfect hash parameters.
+#define OEM_CONFIG_POLICY_INDEX_KNOBS_PER_BUCKET  4
+#define OEM_CONFIG_POLICY_INDEX_SEED_DIRECT       0x8000
+#define OEM_CONFIG_POLICY_INDEX_SEED_STEP         0x9E3779B9
+
+// Index entries in each page but the last.
+#define OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE  4096
+
+#pragma pack (1)
+
+typedef struct {
+  UINT32    NameHash;           // CheckHash of the knob name and namespace.
+  UINT16    Chunk;              // Chunk that holds the knob's CONFIG_VAR_LIST entry.
+  UINT16    Offset;             // Offset of the entry from the start of the chunk.
+} OEM_CONFIG_POLICY_INDEX_KNOB;
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Version;
+  UINT32    ChunkCount;
+  UINT32    KnobCount;
+  UINT32    BucketCount;
+  // UINT32  ChunkSize[ChunkCount];
+  // UINT16  Seeds[BucketCount];
+} OEM_CONFIG_POLICY_INDEX_HEADER;
+
+#pragma pack ()
+
+#define OEM_CONFIG_POLICY_INDEX_SIZE(ChunkCount, BucketCount)                   \
+  (sizeof (OEM_CONFIG_POLICY_INDEX_HEADER) + (ChunkCount) * sizeof (UINT32) +  \
+   (BucketCount) * sizeof (UINT16))
+
+#define OEM_CONFIG_POLICY_INDEX_PAGE_COUNT(KnobCount) \
+  (((KnobCount) + OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE - 1) / OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE)
+
+extern EFI_GUID  gOemConfigPolicyGuid;
+extern EFI_GUID  gOemConfigPolicyChunkGuid;
+
+#endif // OEM_CONFIG_POLICY_H_
@@ -0,0 +1,49 @@
+/** @file OemConfigPolicyImage.h
+
+  Format of the prebuilt default config policy image that OemConfigPolicyCreatorPei can start from
+  instead of serializing every knob at boot.
+
+  The image is the first raw section of the FFS file named by PcdOemConfigPolicyImageFile. It holds
+  the CONFIG_VAR_LIST of every knob at its default value, in gKnobData order, exactly as
+  ConvertVariableEntryToVariableList produces it, preceded by a header and a table that locates the
+  entry and the value of each knob in the list. The platform build generates it from the same knob
+  definitions as PlatformConfigDataLib.
+
+  The file can also hold an image per profile: raw section N + 1 is the image with the base profiles
+  of PcdOemConfigBaseProfiles and profile N applied. A profile without an image uses the first one.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_POLICY_IMAGE_H_
+#define OEM_CONFIG_POLICY_IMAGE_H_
+
+#define OEM_CONFIG_POLICY_IMAGE_SIGNATURE  SIGNATURE_32 ('O', 'C', 'P', 'I')
+#define OEM_CONFIG_POLICY_IMAGE_VERSION    1
+
+// FNV-1a parameters of OEM_CONFIG_POLICY_IMAGE_HEADER.KnobHash.
+#define OEM_CONFIG_POLICY_IMAGE_HASH_SEED   0x811C9DC5
+#define OEM_CONFIG_POLICY_IMAGE_HASH_PRIME  0x01000193
+
+#pragma pack (1)
+
+typedef struct {
+  UINT32    EntryOffset;        // Offset of the knob's CONFIG_VAR_LIST entry from the start of the list.
+  UINT32    ValueOffset;        // Offset of the knob's value from the start of the list.
+} OEM_CONFIG_POLICY_IMAGE_KNOB;
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Version;
+  UINT32    KnobCount;          // Must equal gNumKnobs.
+  UINT32    KnobHash;           // FNV-1a over each knob's ASCII name, null terminator included, then its
+                                // vendor namespace GUID, in gKnobData order.
+  UINT32    ListSize;           // Size of the CONFIG_VAR_LIST in bytes.
+  // OEM_CONFIG_POLICY_IMAGE_KNOB  Knobs[KnobCount];
+  // UINT8                         List[ListSize];
+} OEM_CONFIG_POLICY_IMAGE_HEADER;
+
+#pragma pack ()
+
+#endif // OEM_CONFIG_POLICY_IMAGE_H_
@@ -0,0 +1,66 @@
+/** @file OemConfigSnapshot.h
+
+  Format of the config snapshot that OemConfigPolicyCreatorPei passes to DXE.
+
+  The snapshot holds the effective value of every knob, in gKnobData order, after the profiles and
+  the variable overrides have been applied and validated. It is published in gOemConfigSnapshotHobGuid
+  HOBs of up to OEM_CONFIG_SNAPSHOT_HOB_DATA_MAX bytes each, in order. Each HOB gives the offset and size
+  of its part in the snapshot. The size has to be kept in the HOB because the PEI core rounds HOB
+  lengths up to 8 bytes, so the HOB data can be longer than the part. Consumers should use OemConfigSnapshotLib rather than read the HOBs directly.
+
+  The digest of the snapshot is kept across boots in the gOemConfigSnapshotHobGuid variable
+  OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME, written by OemConfigDigestDxe, so the next boot can tell
+  whether the config changed. It covers the knob count, names and values only, not the firmware build.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_SNAPSHOT_H_
+#define OEM_CONFIG_SNAPSHOT_H_
+
+#define OEM_CONFIG_SNAPSHOT_SIGNATURE  SIGNATURE_32 ('O', 'C', 'S', 'N')
+#define OEM_CONFIG_SNAPSHOT_VERSION    1
+
+#define OEM_CONFIG_SNAPSHOT_DIGEST_SIZE   32          // SHA-256
+#define OEM_CONFIG_SNAPSHOT_HOB_DATA_MAX  0xF000      // Bytes of the snapshot in one HOB.
+
+#define OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME   L"ConfigDigest"
+#define OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_ATTRS  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)     // Non-volatile, BS-only.
+
+#pragma pack (1)
+
+typedef struct {
+  UINT32    ValueOffset;        // Offset of the value from the start of Values.
+  UINT32    ValueSize;
+} OEM_CONFIG_SNAPSHOT_KNOB;
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Version;
+  UINT8     Digest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];    // SHA-256 from KnobCount to the end of Values, or
+                                                        // zero if it could not be computed.
+  UINT32    KnobCount;          // gNumKnobs of the build that published it.
+  UINT32    KnobHash;           // As OEM_CONFIG_POLICY_IMAGE_HEADER.KnobHash.
+  UINT32    ValuesSize;
+  // OEM_CONFIG_SNAPSHOT_KNOB  Knobs[KnobCount];
+  // UINT8                     Values[ValuesSize];   // Not aligned.
+} OEM_CONFIG_SNAPSHOT_HEADER;
+
+//
+// Data of a gOemConfigSnapshotHobGuid HOB.
+//
+typedef struct {
+  UINT32    Offset;             // Offset of this part from the start of the snapshot.
+  UINT32    Size;               // Size of this part in bytes. The HOB data may be padded beyond it.
+  // UINT8  Part[];
+} OEM_CONFIG_SNAPSHOT_HOB;
+
+#pragma pack ()
+
+#define OEM_CONFIG_SNAPSHOT_SIZE(KnobCount, ValuesSize) \
+  (sizeof (OEM_CONFIG_SNAPSHOT_HEADER) + (UINT64)(KnobCount) * sizeof (OEM_CONFIG_SNAPSHOT_KNOB) + (ValuesSize))
+
+extern EFI_GUID  gOemConfigSnapshotHobGuid;
+
+#endif // OEM_CONFIG_SNAPSHOT_H_
@@ -0,0 +1,160 @@
+/** @file
+
+  Runs CPU-bound jobs on idle application processors.
+
+  A job is a procedure and a buffer. Jobs handed to the library must be pure: they may only read
+  their inputs and write their own buffer, and must not call UEFI services, allocate memory or
+  print debug messages, because they can run on an AP.
+
+  The caller owns the job array and an MP_JOB_QUEUE, usually both on its stack. MpJobQueueStart
+  hands jobs to idle APs, the caller runs the jobs no AP took through MpJobQueueNext, and
+  MpJobQueueWait waits for the APs. APs that finish are given the next waiting job each time
+  MpJobQueueNext is called. MpJobQueueCancel stops a queue early. When MP services are missing or
+  every AP is busy, every job runs on the caller, so results never depend on the number of
+  processors.
+
+  All functions must be called on the BSP at a TPL below TPL_NOTIFY. Only one queue should be
+  active at a time; jobs of a second queue run on the caller while the APs are busy with the first.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef MP_JOB_QUEUE_LIB_H_
+#define MP_JOB_QUEUE_LIB_H_
+
+// Most APs one queue uses.
+#define MP_JOB_QUEUE_MAX_APS  8
+
+/**
+  A job procedure.
+
+  @param[in,out]  Buffer  The job buffer.
+
+**/
+typedef
+VOID
+(EFIAPI *MP_JOB_PROCEDURE)(
+  IN OUT VOID  *Buffer
+  );
+
+/**
+  Called by MpJobQueueWait every so often while it waits for an AP, so that the caller can keep
+  a UI or watchdog alive. Runs on the BSP.
+
+  @param[in]  Context   The context given to MpJobQueueWait.
+
+**/
+typedef
+VOID
+(EFIAPI *MP_JOB_WAIT_CALLBACK)(
+  IN VOID  *Context
+  );
+
+typedef struct {
+  MP_JOB_PROCEDURE    Procedure;
+  VOID                *Buffer;
+  volatile BOOLEAN    Done;         // Set by the library once the job has finished.
+} MP_JOB;
+
+//
+// State of one queue. Owned by the caller, managed by the library.
+//
+typedef struct {
+  MP_JOB    *Jobs;
+  UINTN     JobCount;
+  UINTN     NextJob;                            // First job that has not been started.
+  MP_JOB    *ApJob[MP_JOB_QUEUE_MAX_APS];       // Job last started on each AP, or NULL.
+} MP_JOB_QUEUE;
+
+/**
+  Get the number of APs jobs can be started on. MP services are looked up on the first call.
+
+  @retval   The number of APs, or 0 if every job runs on the caller.
+
+**/
+UINTN
+EFIAPI
+MpJobQueueGetApCount (
+  VOID
+  );
+
+/**
+  Prepare a queue and start as many of its jobs as possible on idle APs.
+
+  @param[out] Queue     Queue to prepare.
+  @param[in]  Jobs      Jobs to run, in order. Procedure and Buffer must be set. The array must
+                        stay valid until MpJobQueueWait returns.
+  @param[in]  JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueStart (
+  OUT MP_JOB_QUEUE  *Queue,
+  IN  MP_JOB        *Jobs,
+  IN  UINTN         JobCount
+  );
+
+/**
+  Start waiting jobs on APs that have finished, then take the next waiting job for the caller.
+
+  The caller must run the returned job itself, either through its procedure or with an equivalent
+  BSP-only path, and then set its Done field.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+  @retval   The job for the caller to run, or NULL if every job has been started.
+
+**/
+MP_JOB *
+EFIAPI
+MpJobQueueNext (
+  IN OUT MP_JOB_QUEUE  *Queue
+  );
+
+/**
+  Stop starting jobs. Jobs that have not been started are left with Done clear, and
+  MpJobQueueNext returns NULL from now on.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+**/
+VOID
+EFIAPI
+MpJobQueueCancel (
+  IN OUT MP_JOB_QUEUE  *Queue
+  );
+
+/**
+  Wait for every job started on an AP to finish. A job started on an AP cannot be stopped.
+
+  @param[in,out]  Queue           Queue prepared by MpJobQueueStart. MpJobQueueNext must have
+                                  returned NULL, or MpJobQueueCancel must have been called.
+  @param[in]      Callback        Called while waiting, or NULL.
+  @param[in]      CallbackContext Passed to Callback.
+
+**/
+VOID
+EFIAPI
+MpJobQueueWait (
+  IN OUT MP_JOB_QUEUE          *Queue,
+  IN     MP_JOB_WAIT_CALLBACK  Callback OPTIONAL,
+  IN     VOID                  *CallbackContext OPTIONAL
+  );
+
+/**
+  Run a set of jobs on the APs and the caller, and return once all of them have finished.
+
+  @param[in,out]  Jobs      Jobs to run. Procedure and Buffer must be set.
+  @param[in]      JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueRun (
+  IN OUT MP_JOB  *Jobs,
+  IN     UINTN   JobCount
+  );
+
+#endif // MP_JOB_QUEUE_LIB_H_
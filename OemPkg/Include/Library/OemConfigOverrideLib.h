@@ -0,0 +1,112 @@
+/** @file
+
+  Batches config knob overrides into the packed override store.
+
+  Setting knobs through a batch changes memory only. Commit writes every change with a single
+  variable write to the store (see Guid/OemConfigOverrideStore.h), instead of one variable per knob.
+  Knobs are addressed by their index in gKnobData.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_OVERRIDE_LIB_H_
+#define OEM_CONFIG_OVERRIDE_LIB_H_
+
+typedef struct _OEM_CONFIG_OVERRIDE_BATCH OEM_CONFIG_OVERRIDE_BATCH;
+
+/**
+  Start a batch from the overrides in the store.
+
+  A store with other attributes than OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS, or that is not valid,
+  is treated as empty and is replaced by the next commit. Stored overrides of knobs this build no
+  longer has are dropped by the next commit.
+
+  @param[out] Batch     The batch. Free it with OemConfigOverrideBatchFree.
+
+  @retval EFI_SUCCESS             The batch was started.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Variable services failed to read the store.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchStart (
+  OUT OEM_CONFIG_OVERRIDE_BATCH  **Batch
+  );
+
+/**
+  Set the override of a knob.
+
+  @param[in]  Batch       The batch.
+  @param[in]  Knob        Index of the knob in gKnobData.
+  @param[in]  Value       The value.
+  @param[in]  ValueSize   Size of Value in bytes.
+
+  @retval EFI_SUCCESS             The override was set.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, Knob is out of range, or the knob validator
+                                  rejects Value.
+  @retval EFI_BAD_BUFFER_SIZE     ValueSize is not the size of the knob.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchSet (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch,
+  IN UINTN                      Knob,
+  IN CONST VOID                 *Value,
+  IN UINTN                      ValueSize
+  );
+
+/**
+  Remove the override of a knob, so that it takes its profile or default value.
+
+  @param[in]  Batch       The batch.
+  @param[in]  Knob        Index of the knob in gKnobData.
+
+  @retval EFI_SUCCESS             The override was removed.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL or Knob is out of range.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchClear (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch,
+  IN UINTN                      Knob
+  );
+
+/**
+  Write the batch to the store.
+
+  The store is written once if anything changed. The own override variables of the knobs that were
+  set or cleared are deleted, so they do not take precedence over the store.
+
+  @param[in]  Batch       The batch. It can be changed and committed again.
+
+  @retval EFI_SUCCESS             The batch was written.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Variable services failed to write the store.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchCommit (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch
+  );
+
+/**
+  Free a batch without writing the changes that were not committed.
+
+  @param[in]  Batch       The batch. May be NULL.
+
+**/
+VOID
+EFIAPI
+OemConfigOverrideBatchFree (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch
+  );
+
+#endif // OEM_CONFIG_OVERRIDE_LIB_H_
@@ -0,0 +1,233 @@
+/** @file
+
+  Publishes the config policy and resolves config knobs from it.
+
+  The config policy is a CONFIG_VAR_LIST of every config knob. It is published as an index policy
+  and as many chunk policies as it needs (see Guid/OemConfigPolicy.h), so it is not limited by the
+  64 KB size of a single policy. Consumers open the policy once, and each knob lookup is a single
+  probe of the index's perfect hash that fetches only the chunk holding the knob.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_POLICY_LIB_H_
+#define OEM_CONFIG_POLICY_LIB_H_
+
+typedef struct _OEM_CONFIG_POLICY OEM_CONFIG_POLICY;
+
+/**
+  Publish a CONFIG_VAR_LIST as the finalized config policy.
+
+  Chunk policies are set first, so once the index policy exists all of its chunks do as well.
+
+  @param[in]  ConfigVarList     The CONFIG_VAR_LIST of every config knob.
+  @param[in]  ConfigVarListSize Size of ConfigVarList in bytes.
+
+  @retval EFI_SUCCESS             The policy was published.
+  @retval EFI_INVALID_PARAMETER   ConfigVarList is NULL or is not a valid CONFIG_VAR_LIST.
+  @retval EFI_UNSUPPORTED         A single entry is larger than a policy, or there are too many
+                                  chunks for the index.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Policy service failed to set a policy.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyPublish (
+  IN CONST VOID  *ConfigVarList,
+  IN UINT32      ConfigVarListSize
+  );
+
+/**
+  Open the config policy.
+
+  @param[out] Policy    The opened policy. Free it with OemConfigPolicyClose.
+
+  @retval EFI_SUCCESS             The policy was opened.
+  @retval EFI_INVALID_PARAMETER   Policy is NULL.
+  @retval EFI_NOT_FOUND           The config policy has not been published.
+  @retval EFI_COMPROMISED_DATA    The index policy is not valid.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyOpen (
+  OUT OEM_CONFIG_POLICY  **Policy
+  );
+
+/**
+  Get the value of a config knob.
+
+  @param[in]  Policy      The policy from OemConfigPolicyOpen.
+  @param[in]  Name        Knob name, as stored in the CONFIG_VAR_LIST entry.
+  @param[in]  Guid        Knob vendor namespace.
+  @param[out] Data        The value, owned by Policy and valid until it is closed.
+  @param[out] DataSize    Optional size of Data in bytes.
+
+  @retval EFI_SUCCESS             The value was returned.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL.
+  @retval EFI_NOT_FOUND           The policy has no such knob.
+  @retval EFI_COMPROMISED_DATA    A chunk policy is missing or does not match the index.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetKnob (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT CONST VOID         **Data,
+  OUT UINT32             *DataSize OPTIONAL
+  );
+
+/**
+  Get the value of a BOOLEAN config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a BOOLEAN.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetBoolean (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT BOOLEAN            *Value
+  );
+
+/**
+  Get the value of a UINT8 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT8.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint8 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT8              *Value
+  );
+
+/**
+  Get the value of a UINT16 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT16.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint16 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT16             *Value
+  );
+
+/**
+  Get the value of a UINT32 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT32.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint32 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT32             *Value
+  );
+
+/**
+  Get the value of a UINT64 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT64.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint64 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT64             *Value
+  );
+
+/**
+  Get the digest of the config and whether it is the same as on the previous boot.
+
+  A consumer that derives its own settings from the config can cache them together with the digest,
+  and reuse them on a later boot whose digest matches instead of translating every knob again. The
+  digest only covers the knob count, names and values, not the firmware build, so Unchanged can be TRUE
+  on the first boot of a new build. The cache must also be keyed on the consumer's build identity, such
+  as a hash of its image or a version it bumps with every change to its translation.
+
+  @param[out] Digest      Optional, receives the OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest. All zero
+                          if it could not be computed.
+  @param[out] Unchanged   Optional, receives TRUE if the config is unchanged since the previous boot.
+
+  @retval EFI_SUCCESS             The digest was returned.
+  @retval EFI_NOT_FOUND           The config metadata policy has not been published.
+  @retval EFI_COMPROMISED_DATA    The config metadata policy is not valid.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetDigest (
+  OUT UINT8    *Digest     OPTIONAL,
+  OUT BOOLEAN  *Unchanged  OPTIONAL
+  );
+
+/**
+  Close a policy opened with OemConfigPolicyOpen and free the chunks it fetched.
+
+  @param[in]  Policy    The policy. May be NULL.
+
+**/
+VOID
+EFIAPI
+OemConfigPolicyClose (
+  IN OEM_CONFIG_POLICY  *Policy
+  );
+
+#endif // OEM_CONFIG_POLICY_LIB_H_
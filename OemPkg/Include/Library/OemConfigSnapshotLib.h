@@ -0,0 +1,58 @@
+/** @file
+
+  Read-only view of the effective config that OemConfigPolicyCreatorPei passed to DXE.
+
+  Knobs are addressed by their index in gKnobData, which is the order of the knobs generated for the
+  platform. A lookup reads memory only: no variable or policy service is used, and every consumer
+  sees the values PEI published in the config policy.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_SNAPSHOT_LIB_H_
+#define OEM_CONFIG_SNAPSHOT_LIB_H_
+
+#include <Guid/OemConfigSnapshot.h>
+
+/**
+  Get the value of a config knob.
+
+  @param[in]  Knob        Index of the knob in gKnobData.
+  @param[out] Value       The value, which stays valid for the life of the module. It is not aligned.
+  @param[out] ValueSize   Optional size of Value in bytes.
+
+  @retval EFI_SUCCESS             The value was returned.
+  @retval EFI_INVALID_PARAMETER   Value is NULL or Knob is out of range.
+  @retval EFI_NOT_FOUND           There is no valid snapshot.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigSnapshotGetKnob (
+  IN  UINTN       Knob,
+  OUT CONST VOID  **Value,
+  OUT UINTN       *ValueSize OPTIONAL
+  );
+
+/**
+  Get the digest of the snapshot content, which changes whenever a knob value does. It does not cover
+  the firmware build; see OemConfigPolicyGetDigest.
+
+  @param[out] Digest    Receives OEM_CONFIG_SNAPSHOT_DIGEST_SIZE bytes. All zero if PEI could not
+                        compute it.
+
+  @retval EFI_SUCCESS             The digest was returned.
+  @retval EFI_INVALID_PARAMETER   Digest is NULL.
+  @retval EFI_NOT_FOUND           There is no valid snapshot.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigSnapshotGetDigest (
+  OUT UINT8  *Digest
+  );
+
+#endif // OEM_CONFIG_SNAPSHOT_LIB_H_
@@ -22,10 +22,14 @@ typedef UINT8 *PASSWORD_HASH;
 // Definitions for the test failures for the password.
 //
 typedef UINT32 PW_TEST_BITMAP;
-#define PW_TEST_STRING_NULL          (1 << 0)
-#define PW_TEST_STRING_TOO_SHORT     (1 << 1)
-#define PW_TEST_STRING_TOO_LONG      (1 << 2)
-#define PW_TEST_STRING_INVALID_CHAR  (1 << 3)
+#define PW_TEST_STRING_NULL            (1 << 0)
+#define PW_TEST_STRING_TOO_SHORT       (1 << 1)
+#define PW_TEST_STRING_TOO_LONG        (1 << 2)
+#define PW_TEST_STRING_INVALID_CHAR    (1 << 3)
+#define PW_TEST_STRING_MISSING_UPPER   (1 << 4)     // Fewer than PcdPasswordMinUppercaseCount A-Z.
+#define PW_TEST_STRING_MISSING_LOWER   (1 << 5)     // Fewer than PcdPasswordMinLowercaseCount a-z.
+#define PW_TEST_STRING_MISSING_DIGIT   (1 << 6)     // Fewer than PcdPasswordMinDigitCount 0-9.
+#define PW_TEST_STRING_MISSING_SYMBOL  (1 << 7)     // Fewer than PcdPasswordMinSymbolCount special characters.
 
 /**
   Copies a password to a buffer, but will only copy the maximum
@@ -70,13 +74,14 @@ PasswordPolicyCleansePwBuffer (
 
   Will evaluate all current password strength/validity requirements and
   return a BOOLEAN for whether the password is valid. Also uses an optional
-  pointer to return a bitmap of which tests failed.
+  pointer to return a bitmap of which tests failed. This includes the class
+  minimums, which only apply to new passwords.
 
   NOTE: Returns FALSE on NULL strings.
 
   @param[in]  String    CHAR16 pointer to the string that's being evaluated.
   @param[out] Failures  [Optional] Pointer to a UINT32 that will have bits (defined
-                        in MsPasswordLib.h) set according to which tests may have failed.
+                        above) set for every test that failed.
                         If NULL, will not return a test bitmap and will fail ASAP.
 
   @retval     TRUE      Password is valid. "Failures" should be 0.
@@ -119,7 +124,10 @@ PasswordPolicyValidatePasswordHash (
   Public interface for generating a password hash.
 
   Will run internal checks on the password before setting it. Returns an
-  error if the password cannot be set.
+  error if the password cannot be set. A new password (OldSalt == NULL) must
+  pass PasswordPolicyIsPwStringValid. With OldSalt only its length and
+  character set are checked, so raising the class minimums does not lock out
+  a password that was set before.
 
   @param[in]  OldSalt               Pass in old PASSWORD_HASH to use the existing salt
   @param[in]  Password              Pointer to a buffer containing the clear text password.
@@ -147,4 +155,24 @@ PasswordPolicyGeneratePasswordHash (
   OUT       UINTN          *PasswordHashSize
   );
 
+/**
+  Public interface for checking whether a password hash uses the current format and cost.
+
+  A caller that has just authenticated a password against PasswordHash can regenerate the
+  hash with PasswordPolicyGeneratePasswordHash (NULL, Password, ...) when this returns FALSE.
+
+  @param[in]  PasswordHash      Pointer to the buffer containing the hash.
+  @param[in]  PasswordHashSize  Size of the buffer containing the hash.
+
+  @retval     TRUE    The hash is current, is the "no password" hash, or is not a valid hash.
+  @retval     FALSE   The hash should be regenerated.
+
+**/
+BOOLEAN
+EFIAPI
+PasswordPolicyIsPasswordHashCurrent (
+  IN CONST PASSWORD_HASH  PasswordHash,
+  IN       UINTN          PasswordHashSize
+  );
+
 #endif // _PASSWORD_POLICY_LIB_H_
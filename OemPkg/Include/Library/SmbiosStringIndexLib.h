@@ -0,0 +1,96 @@
+/** @file
+
+  Indexed access to SMBIOS records and their strings.
+
+  The library walks the SMBIOS protocol once and builds a per-type record list along with a string
+  offset table for every record. Strings are returned as zero-copy ASCII views into the SMBIOS records
+  or as UCS-2 copies that are converted once and cached. The index is rebuilt on the next query after
+  a record is added to or removed from the SMBIOS table.
+
+  Returned records and strings are owned by the library and remain valid until the SMBIOS table
+  changes. Callers must not free them.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef SMBIOS_STRING_INDEX_LIB_H_
+#define SMBIOS_STRING_INDEX_LIB_H_
+
+#include <IndustryStandard/SmBios.h>
+
+/**
+  Get a record of the given type.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type, in SMBIOS protocol enumeration order.
+  @param[out] Record        The record.
+
+  @retval EFI_SUCCESS             Record was returned.
+  @retval EFI_NOT_FOUND           There is no such record.
+  @retval EFI_INVALID_PARAMETER   Record is NULL.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetRecord (
+  IN  SMBIOS_TYPE             Type,
+  IN  UINTN                   Instance,
+  OUT CONST SMBIOS_STRUCTURE  **Record
+  );
+
+/**
+  Get a zero-copy view of a record string.
+
+  String number 0 means "no string" in SMBIOS; it returns an empty string.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type.
+  @param[in]  StringNumber  One-based string number, as stored in the record's string fields.
+  @param[out] String        Null-terminated ASCII string inside the SMBIOS record.
+  @param[out] Size          Optional size of String in bytes, including the null terminator.
+
+  @retval EFI_SUCCESS             String was returned.
+  @retval EFI_NOT_FOUND           There is no such record or string.
+  @retval EFI_INVALID_PARAMETER   String is NULL.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetString (
+  IN  SMBIOS_TYPE          Type,
+  IN  UINTN                Instance,
+  IN  SMBIOS_TABLE_STRING  StringNumber,
+  OUT CONST CHAR8          **String,
+  OUT UINTN                *Size OPTIONAL
+  );
+
+/**
+  Get a UCS-2 copy of a record string. The conversion is done on the first request and cached.
+
+  String number 0 means "no string" in SMBIOS; it returns an empty string.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type.
+  @param[in]  StringNumber  One-based string number, as stored in the record's string fields.
+  @param[out] String        Null-terminated UCS-2 string owned by the library.
+
+  @retval EFI_SUCCESS             String was returned.
+  @retval EFI_NOT_FOUND           There is no such record or string.
+  @retval EFI_INVALID_PARAMETER   String is NULL.
+  @retval EFI_OUT_OF_RESOURCES    The converted copy could not be allocated.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetUnicodeString (
+  IN  SMBIOS_TYPE          Type,
+  IN  UINTN                Instance,
+  IN  SMBIOS_TABLE_STRING  StringNumber,
+  OUT CONST CHAR16         **String
+  );
+
+#endif // SMBIOS_STRING_INDEX_LIB_H_
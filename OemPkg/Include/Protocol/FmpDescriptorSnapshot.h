@@ -0,0 +1,88 @@
+/** @file
+  FmpDescriptorSnapshot protocol provides a boot-lifetime copy of the image descriptors published by every
+  EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance. Descriptors are captured the first time they are requested and
+  are kept until the owning FMP instance is reinstalled, so consumers such as FrontPage do not have to call
+  GetImageInfo (which may touch a slow device) every time they are launched.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL_H_
+#define _FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL_H_
+
+#include <Protocol/FirmwareManagement.h>
+
+typedef struct _FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL;
+
+//
+// One captured image descriptor. Descriptor is a private copy whose ImageIdName and VersionName
+// strings are owned by the snapshot; Descriptor->Dependencies is always NULL.
+//
+typedef struct {
+  EFI_HANDLE                             Handle;
+  UINTN                                  DescriptorIndex;     // Index of this descriptor within its FMP instance
+  UINTN                                  DescriptorCount;     // Number of descriptors published by the FMP instance
+  UINT32                                 DescriptorVersion;
+  UINT32                                 PackageVersion;
+  CONST CHAR16                           *PackageVersionName; // May be NULL
+  CONST EFI_FIRMWARE_IMAGE_DESCRIPTOR    *Descriptor;
+} FMP_DESCRIPTOR_SNAPSHOT_ENTRY;
+
+/**
+  Iterate over the captured descriptors of all FMP instances.
+
+  Starting an iteration (*Cursor == 0) refreshes any FMP instance that has been installed or reinstalled
+  since the previous capture. The returned entry remains valid until the next call to Find or the next
+  call that starts a new iteration.
+
+  @param[in]      This      Protocol instance.
+  @param[in, out] Cursor    On input, 0 to start or the value returned by the previous call.
+                            On output, the value to pass to the next call.
+  @param[out]     Entry     The next captured descriptor.
+
+  @retval EFI_SUCCESS             Entry was returned.
+  @retval EFI_NOT_FOUND           There are no more entries.
+  @retval EFI_INVALID_PARAMETER   Cursor or Entry is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *FMP_DESCRIPTOR_SNAPSHOT_GET_NEXT)(
+  IN     FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL  *This,
+  IN OUT UINTN                             *Cursor,
+  OUT    CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY **Entry
+  );
+
+/**
+  Look up the captured descriptor for an image type. Like starting an iteration, this refreshes any
+  FMP instance that has been installed or reinstalled since the previous capture.
+
+  @param[in]  This          Protocol instance.
+  @param[in]  Handle        FMP handle to restrict the search to, or NULL to search every instance.
+  @param[in]  ImageTypeId   Image type to find.
+  @param[out] Entry         The matching descriptor.
+
+  @retval EFI_SUCCESS             Entry was returned.
+  @retval EFI_NOT_FOUND           No captured descriptor matches.
+  @retval EFI_INVALID_PARAMETER   ImageTypeId or Entry is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *FMP_DESCRIPTOR_SNAPSHOT_FIND)(
+  IN  FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL     *This,
+  IN  EFI_HANDLE                           Handle OPTIONAL,
+  IN  CONST EFI_GUID                       *ImageTypeId,
+  OUT CONST FMP_DESCRIPTOR_SNAPSHOT_ENTRY  **Entry
+  );
+
+struct _FMP_DESCRIPTOR_SNAPSHOT_PROTOCOL {
+  FMP_DESCRIPTOR_SNAPSHOT_GET_NEXT    GetNext;
+  FMP_DESCRIPTOR_SNAPSHOT_FIND        Find;
+};
+
+extern EFI_GUID  gFmpDescriptorSnapshotProtocolGuid;
+
+#endif
@@ -0,0 +1,89 @@
+/** @file
+  PasswordHashProgress protocol lets a UI follow and cancel a password hash while it is computed.
+
+  Password hashes are deliberately slow. A caller such as FrontPage registers a callback before asking
+  for a password to be verified or set, redraws a progress indicator and polls for input from the
+  callback, then unregisters when the operation returns. The callback runs on the BSP in the context
+  of the caller of the hash, so the caller's TPL and services apply.
+
+  A hash may take another path while a callback is registered, and the callback itself takes time, so a
+  caller that sizes hashes by their speed, such as PasswordPolicyLib picking an iteration count, asks
+  for the iteration rate of hashes without a callback instead of timing one.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PASSWORD_HASH_PROGRESS_PROTOCOL_H_
+#define _PASSWORD_HASH_PROGRESS_PROTOCOL_H_
+
+typedef struct _PASSWORD_HASH_PROGRESS_PROTOCOL PASSWORD_HASH_PROGRESS_PROTOCOL;
+
+/**
+  Reports the progress of a password hash.
+
+  @param[in]  Context     Context passed to Register.
+  @param[in]  Completed   Work done so far. Never more than Total.
+  @param[in]  Total       Total work of the hash. Each hash starts again from 0.
+
+  @retval     TRUE    Continue.
+  @retval     FALSE   Cancel. The hash returns EFI_ABORTED.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *PASSWORD_HASH_PROGRESS_CALLBACK)(
+  IN VOID    *Context,
+  IN UINT64  Completed,
+  IN UINT64  Total
+  );
+
+/**
+  Registers or unregisters the progress callback.
+
+  @param[in]  This      Protocol instance.
+  @param[in]  Callback  Callback to register, or NULL to unregister the current one.
+  @param[in]  Context   Passed to Callback.
+
+  @retval EFI_SUCCESS           The callback was registered or unregistered.
+  @retval EFI_ALREADY_STARTED   Another callback is registered.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *PASSWORD_HASH_PROGRESS_REGISTER)(
+  IN PASSWORD_HASH_PROGRESS_PROTOCOL  *This,
+  IN PASSWORD_HASH_PROGRESS_CALLBACK  Callback OPTIONAL,
+  IN VOID                             *Context OPTIONAL
+  );
+
+/**
+  Returns the PBKDF2 iteration rate of hashes computed without a progress callback. The rate is measured
+  the first time it is asked for each digest size.
+
+  @param[in]  This                  Protocol instance.
+  @param[in]  DigestSize            Digest size of the HMAC hash, as passed to HashPassword.
+  @param[out] IterationsPerSecond   PBKDF2 iterations computed per second for a one-digest key.
+
+  @retval EFI_SUCCESS             IterationsPerSecond is set.
+  @retval EFI_INVALID_PARAMETER   IterationsPerSecond is NULL.
+  @retval EFI_UNSUPPORTED         DigestSize is not supported, or the hash could not be timed.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *PASSWORD_HASH_PROGRESS_GET_ITERATION_RATE)(
+  IN  PASSWORD_HASH_PROGRESS_PROTOCOL  *This,
+  IN  UINTN                            DigestSize,
+  OUT UINT64                           *IterationsPerSecond
+  );
+
+struct _PASSWORD_HASH_PROGRESS_PROTOCOL {
+  PASSWORD_HASH_PROGRESS_REGISTER              Register;
+  PASSWORD_HASH_PROGRESS_GET_ITERATION_RATE    GetIterationRate;
+};
+
+extern EFI_GUID  gPasswordHashProgressProtocolGuid;
+
+#endif
@@ -0,0 +1,77 @@
+/** @file
+  PasswordStore protocol is produced by PasswordStoreDxe, which owns the administrator password store
+  variable. PasswordStoreLib forwards to it, so every image that links the library shares one cached copy
+  of the store instead of reading the variable on each call.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PASSWORD_STORE_PROTOCOL_H_
+#define _PASSWORD_STORE_PROTOCOL_H_
+
+typedef struct _PASSWORD_STORE_PROTOCOL PASSWORD_STORE_PROTOCOL;
+
+/**
+  Determine whether an administrator password is set.
+
+  @param[in]  This    Protocol instance.
+
+  @retval     TRUE    A password is set.
+  @retval     FALSE   No password is set.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *PASSWORD_STORE_IS_PASSWORD_SET)(
+  IN  PASSWORD_STORE_PROTOCOL  *This
+  );
+
+/**
+  Check a password against the stored password hash. Keys are compared in constant time.
+
+  @param[in]  This        Protocol instance.
+  @param[in]  Password    Password to check.
+
+  @retval     TRUE    Password matches the stored password, or no password is set.
+  @retval     FALSE   Password is NULL or empty, or does not match.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *PASSWORD_STORE_AUTHENTICATE_PASSWORD)(
+  IN  PASSWORD_STORE_PROTOCOL  *This,
+  IN  CONST CHAR16             *Password
+  );
+
+/**
+  Store a new password hash, as generated by PasswordPolicyGeneratePasswordHash.
+
+  @param[in]  This              Protocol instance.
+  @param[in]  PasswordHash      The password hash.
+  @param[in]  PasswordHashSize  Size of PasswordHash in bytes.
+
+  @retval     EFI_SUCCESS             The hash was stored.
+  @retval     EFI_INVALID_PARAMETER   PasswordHash is NULL or not a valid password hash.
+  @retval     EFI_ABORTED             The store variable could not be written.
+  @retval     EFI_OUT_OF_RESOURCES    There is no memory for the cached copy. Nothing was written.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *PASSWORD_STORE_SET_PASSWORD)(
+  IN  PASSWORD_STORE_PROTOCOL  *This,
+  IN  CONST UINT8              *PasswordHash,
+  IN  UINTN                    PasswordHashSize
+  );
+
+struct _PASSWORD_STORE_PROTOCOL {
+  PASSWORD_STORE_IS_PASSWORD_SET          IsPasswordSet;
+  PASSWORD_STORE_AUTHENTICATE_PASSWORD    AuthenticatePassword;
+  PASSWORD_STORE_SET_PASSWORD             SetPassword;
+};
+
+extern EFI_GUID  gPasswordStoreProtocolGuid;
+
+#endif
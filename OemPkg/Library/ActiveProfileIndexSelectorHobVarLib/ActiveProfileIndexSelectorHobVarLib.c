@@ -0,0 +1,195 @@
+/** @file ActiveProfileIndexSelectorHobVarLib.c
+  Boot time instance of ActiveProfileIndexSelectorLib. The active profile can be switched without
+  rebuilding the firmware, by the platform or by a variable.
+
+  The profile is selected by the first of these sources that names a profile of this build:
+
+    1. The gOemActiveProfileSelectionGuid HOB, built by a platform PEIM from a strap, jumper or
+       manufacturing flag.
+    2. The gOemActiveProfileSelectionGuid variable, for example written by a lab tool. It is only
+       honored with the NV and BS attributes, so it cannot be created from the OS.
+    3. gOemPkgTokenSpaceGuid.PcdActiveProfileIndex.
+
+  Both the HOB and the variable name the profile by its flavor name, which is looked up in the
+  profile table of the build. A source that names an unknown profile is logged and skipped.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemActiveProfileSelection.h>
+#include <Guid/OemConfigMetadataPolicy.h>
+#include <Ppi/ReadOnlyVariable2.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/ActiveProfileIndexSelectorLib.h>
+
+/**
+  Find the profile a selection names.
+
+  @param[in]  Selection           The selection.
+  @param[in]  SelectionSize       Size of the selection in bytes. The data of a HOB is padded to
+                                  8 bytes, so it can be larger than the selection.
+  @param[out] ActiveProfileIndex  Index of the profile, or MAX_UINT32 for the generic profile.
+
+  @retval     TRUE                The selection names a profile of this build.
+  @retval     FALSE               Not.
+**/
+STATIC
+BOOLEAN
+FindSelectedProfile (
+  IN  CONST OEM_ACTIVE_PROFILE_SELECTION  *Selection,
+  IN  UINTN                               SelectionSize,
+  OUT UINT32                              *ActiveProfileIndex
+  )
+{
+  UINT32  Index;
+
+  if ((SelectionSize < sizeof (OEM_ACTIVE_PROFILE_SELECTION)) ||
+      (Selection->Signature != OEM_ACTIVE_PROFILE_SELECTION_SIGNATURE) ||
+      (AsciiStrnLenS (Selection->FlavorName, PROFILE_FLAVOR_NAME_LENGTH) == PROFILE_FLAVOR_NAME_LENGTH))
+  {
+    return FALSE;
+  }
+
+  if (AsciiStrCmp (Selection->FlavorName, GENERIC_PROFILE_FLAVOR_NAME) == 0) {
+    *ActiveProfileIndex = MAX_UINT32;
+    return TRUE;
+  }
+
+  for (Index = 0; Index < gNumProfiles; Index++) {
+    if (AsciiStrCmp (Selection->FlavorName, gProfileFlavorNames[Index]) == 0) {
+      *ActiveProfileIndex = Index;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Get the profile selected by the platform HOB.
+
+  @param[out] ActiveProfileIndex  Index of the profile, or MAX_UINT32 for the generic profile.
+
+  @retval     TRUE                The HOB selects a profile of this build.
+  @retval     FALSE               There is no HOB, or it does not.
+**/
+STATIC
+BOOLEAN
+GetHobSelection (
+  OUT UINT32  *ActiveProfileIndex
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+
+  GuidHob = GetFirstGuidHob (&gOemActiveProfileSelectionGuid);
+  if (GuidHob == NULL) {
+    return FALSE;
+  }
+
+  if (!FindSelectedProfile (GET_GUID_HOB_DATA (GuidHob), GET_GUID_HOB_DATA_SIZE (GuidHob), ActiveProfileIndex)) {
+    DEBUG ((DEBUG_ERROR, "%a - Active profile HOB does not name a profile of this build, ignoring it.\n", __FUNCTION__));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Get the profile selected by the variable.
+
+  @param[out] ActiveProfileIndex  Index of the profile, or MAX_UINT32 for the generic profile.
+
+  @retval     TRUE                The variable selects a profile of this build.
+  @retval     FALSE               There is no variable, or it does not.
+**/
+STATIC
+BOOLEAN
+GetVariableSelection (
+  OUT UINT32  *ActiveProfileIndex
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *VariablePpi;
+  OEM_ACTIVE_PROFILE_SELECTION     Selection;
+  UINTN                            SelectionSize;
+  UINT32                           Attributes;
+
+  Status = PeiServicesLocatePpi (&gEfiPeiReadOnlyVariable2PpiGuid, 0, NULL, (VOID **)&VariablePpi);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a - Variable PPI not found, skipping the active profile variable.\n", __FUNCTION__));
+    return FALSE;
+  }
+
+  SelectionSize = sizeof (Selection);
+  Status        = VariablePpi->GetVariable (
+                                 VariablePpi,
+                                 OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_NAME,
+                                 &gOemActiveProfileSelectionGuid,
+                                 &Attributes,
+                                 &SelectionSize,
+                                 &Selection
+                                 );
+  if (Status == EFI_NOT_FOUND) {
+    return FALSE;
+  }
+
+  if (EFI_ERROR (Status) ||
+      (Attributes != OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS) ||
+      !FindSelectedProfile (&Selection, SelectionSize, ActiveProfileIndex))
+  {
+    DEBUG ((DEBUG_ERROR, "%a - Active profile variable is not valid, ignoring it. Status (%r)\n", __FUNCTION__, Status));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Return which profile is the active profile for this boot.
+  This function validates the profile GUID is valid.
+
+  @param[out] ActiveProfileIndex  The index for the active profile. A value of MAX_UINT32, when combined with a return
+                                  value of EFI_SUCCESS, indicates that the default profile has been chosen. If the
+                                  return value is not EFI_SUCCESS, the value of ActiveProfileIndex shall not be updated.
+
+  @retval EFI_INVALID_PARAMETER   Input argument is null.
+  @retval EFI_NO_RESPONSE         The source of truth for profile selection has returned a garbage value or not replied.
+  @retval EFI_SUCCESS             The operation succeeds and ActiveProfileIndex contains the valid active profile
+                                  index for this boot.
+**/
+EFI_STATUS
+EFIAPI
+GetActiveProfileIndex (
+  OUT UINT32  *ActiveProfileIndex
+  )
+{
+  UINT32  Index;
+
+  if (ActiveProfileIndex == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (GetHobSelection (&Index) || GetVariableSelection (&Index)) {
+    *ActiveProfileIndex = Index;
+    return EFI_SUCCESS;
+  }
+
+  Index = FixedPcdGet32 (PcdActiveProfileIndex);
+  if ((Index >= gNumProfiles) && (Index != MAX_UINT32)) {
+    DEBUG ((DEBUG_ERROR, "%a - PcdActiveProfileIndex %d is not a profile of this build!\n", __FUNCTION__, Index));
+    return EFI_NO_RESPONSE;
+  }
+
+  *ActiveProfileIndex = Index;
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,436 @@
+/** @file ActiveProfileIndexSelectorHobVarLibUnitTest.c
+
+  Host based unit tests of ActiveProfileIndexSelectorHobVarLib.
+
+  Every profile of a generated profile table is selected in turn by a HOB, built into a HOB list that
+  rounds HOB lengths up to 8 bytes like the PEI core, and by a variable read through a variable PPI.
+  Selections that are not valid must fall back to PcdActiveProfileIndex, which the DSC sets to 1.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../ActiveProfileIndexSelectorHobVarLib.c"
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <HostHobLibHelper.h>
+#include <HostPeiServicesLibHelper.h>
+
+#define UNIT_TEST_APP_NAME     "ActiveProfileIndexSelectorHobVarLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_PROFILE_COUNT  10
+#define TEST_PCD_PROFILE    1
+
+//
+// The profile table of the build.
+//
+UINTN  gNumProfiles                            = TEST_PROFILE_COUNT;
+CHAR8  *gProfileFlavorNames[TEST_PROFILE_COUNT] = { "P0", "P1", "P2", "P3", "P4", "P5", "P6", "P7", "P8", "P9" };
+
+//
+// The active profile variable the variable PPI returns.
+//
+STATIC BOOLEAN  mVariablePresent    = FALSE;
+STATIC UINT32   mVariableAttributes = 0;
+STATIC UINT8    mVariableData[2 * sizeof (OEM_ACTIVE_PROFILE_SELECTION)];
+STATIC UINTN    mVariableDataSize = 0;
+
+/**
+  Return the active profile variable, if the test set one.
+
+  @param[in]      This          The PPI.
+  @param[in]      VariableName  Name of the variable.
+  @param[in]      VariableGuid  Vendor GUID of the variable.
+  @param[out]     Attributes    Optional, receives the attributes of the variable.
+  @param[in,out]  DataSize      Size of Data on input, size of the variable on output.
+  @param[out]     Data          Receives the variable.
+
+  @retval EFI_SUCCESS           The variable was returned.
+  @retval EFI_NOT_FOUND         There is no such variable.
+  @retval EFI_BUFFER_TOO_SMALL  Data is too small for the variable.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestGetVariable (
+  IN CONST  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *This,
+  IN CONST  CHAR16                           *VariableName,
+  IN CONST  EFI_GUID                         *VariableGuid,
+  OUT       UINT32                           *Attributes OPTIONAL,
+  IN OUT    UINTN                            *DataSize,
+  OUT       VOID                             *Data OPTIONAL
+  )
+{
+  if (!mVariablePresent ||
+      (StrCmp (VariableName, OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_NAME) != 0) ||
+      !CompareGuid (VariableGuid, &gOemActiveProfileSelectionGuid))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  if (*DataSize < mVariableDataSize) {
+    *DataSize = mVariableDataSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  if (Attributes != NULL) {
+    *Attributes = mVariableAttributes;
+  }
+
+  *DataSize = mVariableDataSize;
+  CopyMem (Data, mVariableData, mVariableDataSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Variable names are not enumerated by the library.
+
+  @retval EFI_UNSUPPORTED   Always.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestGetNextVariableName (
+  IN CONST  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *This,
+  IN OUT    UINTN                            *VariableNameSize,
+  IN OUT    CHAR16                           *VariableName,
+  IN OUT    EFI_GUID                         *VariableGuid
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+STATIC EFI_PEI_READ_ONLY_VARIABLE2_PPI  mVariablePpi = {
+  TestGetVariable,
+  TestGetNextVariableName
+};
+
+STATIC EFI_PEI_PPI_DESCRIPTOR  mVariablePpiList = {
+  EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST,
+  &gEfiPeiReadOnlyVariable2PpiGuid,
+  &mVariablePpi
+};
+
+/**
+  Fill in a selection of a profile.
+
+  @param[out] Selection   The selection.
+  @param[in]  FlavorName  Flavor name of the profile, at most PROFILE_FLAVOR_NAME_LENGTH bytes.
+
+**/
+STATIC
+VOID
+InitSelection (
+  OUT OEM_ACTIVE_PROFILE_SELECTION  *Selection,
+  IN  CONST CHAR8                   *FlavorName
+  )
+{
+  ZeroMem (Selection, sizeof (*Selection));
+  Selection->Signature = OEM_ACTIVE_PROFILE_SELECTION_SIGNATURE;
+  CopyMem (Selection->FlavorName, FlavorName, MIN (AsciiStrSize (FlavorName), PROFILE_FLAVOR_NAME_LENGTH));
+}
+
+/**
+  Build the active profile HOB.
+
+  @param[in]  FlavorName  Flavor name of the profile.
+
+  @retval     TRUE        The HOB was built.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+BuildSelectionHob (
+  IN CONST CHAR8  *FlavorName
+  )
+{
+  OEM_ACTIVE_PROFILE_SELECTION  Selection;
+
+  InitSelection (&Selection, FlavorName);
+  return BuildGuidDataHob (&gOemActiveProfileSelectionGuid, &Selection, sizeof (Selection)) != NULL;
+}
+
+/**
+  Set the active profile variable.
+
+  @param[in]  FlavorName  Flavor name of the profile.
+  @param[in]  Attributes  Attributes of the variable.
+  @param[in]  DataSize    Size of the variable, at most twice the size of a selection.
+
+**/
+STATIC
+VOID
+SetSelectionVariable (
+  IN CONST CHAR8  *FlavorName,
+  IN UINT32       Attributes,
+  IN UINTN        DataSize
+  )
+{
+  ZeroMem (mVariableData, sizeof (mVariableData));
+  InitSelection ((OEM_ACTIVE_PROFILE_SELECTION *)mVariableData, FlavorName);
+  mVariablePresent    = TRUE;
+  mVariableAttributes = Attributes;
+  mVariableDataSize   = DataSize;
+}
+
+/**
+  Empty the HOB list, remove the variable and install the variable PPI.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED                      The PPI was installed.
+  @retval     UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SelectorTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  HostHobLibReset ();
+  HostPeiServicesLibReset ();
+  mVariablePresent = FALSE;
+
+  if (EFI_ERROR (PeiServicesInstallPpi (&mVariablePpiList))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The HOB selects each profile of the build, and the generic profile.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              Every profile was selected.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+HobSelectsEveryProfile (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32  Index;
+  UINT32  ActiveProfileIndex;
+
+  for (Index = 0; Index < gNumProfiles; Index++) {
+    HostHobLibReset ();
+    UT_ASSERT_TRUE (BuildSelectionHob (gProfileFlavorNames[Index]));
+    UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+    UT_ASSERT_EQUAL (ActiveProfileIndex, Index);
+  }
+
+  HostHobLibReset ();
+  UT_ASSERT_TRUE (BuildSelectionHob (GENERIC_PROFILE_FLAVOR_NAME));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, MAX_UINT32);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The variable selects each profile of the build, and the generic profile.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              Every profile was selected.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+VariableSelectsEveryProfile (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32  Index;
+  UINT32  ActiveProfileIndex;
+
+  for (Index = 0; Index < gNumProfiles; Index++) {
+    SetSelectionVariable (gProfileFlavorNames[Index], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION));
+    UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+    UT_ASSERT_EQUAL (ActiveProfileIndex, Index);
+  }
+
+  SetSelectionVariable (GENERIC_PROFILE_FLAVOR_NAME, OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, MAX_UINT32);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The HOB wins over the variable, and an unknown HOB selection falls through to the variable.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The sources were taken in order.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+HobTakesPrecedence (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32  ActiveProfileIndex;
+
+  SetSelectionVariable (gProfileFlavorNames[3], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION));
+  UT_ASSERT_TRUE (BuildSelectionHob (gProfileFlavorNames[2]));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, 2);
+
+  HostHobLibReset ();
+  UT_ASSERT_TRUE (BuildSelectionHob ("ZZ"));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, 3);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Selections that are not valid are skipped, leaving PcdActiveProfileIndex.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              Every selection was skipped.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+InvalidSelectionsAreSkipped (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  OEM_ACTIVE_PROFILE_SELECTION  Selection;
+  UINT32                        ActiveProfileIndex;
+
+  // no selection at all
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // HOB of a profile this build does not have
+  UT_ASSERT_TRUE (BuildSelectionHob ("ZZ"));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // HOB with a bad signature
+  HostHobLibReset ();
+  InitSelection (&Selection, gProfileFlavorNames[4]);
+  Selection.Signature = SIGNATURE_32 ('B', 'A', 'D', '!');
+  UT_ASSERT_NOT_NULL (BuildGuidDataHob (&gOemActiveProfileSelectionGuid, &Selection, sizeof (Selection)));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // HOB with an unterminated flavor name
+  HostHobLibReset ();
+  InitSelection (&Selection, gProfileFlavorNames[4]);
+  SetMem (Selection.FlavorName, PROFILE_FLAVOR_NAME_LENGTH, 'P');
+  UT_ASSERT_NOT_NULL (BuildGuidDataHob (&gOemActiveProfileSelectionGuid, &Selection, sizeof (Selection)));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // truncated HOB
+  HostHobLibReset ();
+  InitSelection (&Selection, gProfileFlavorNames[4]);
+  UT_ASSERT_NOT_NULL (BuildGuidDataHob (&gOemActiveProfileSelectionGuid, &Selection, OFFSET_OF (OEM_ACTIVE_PROFILE_SELECTION, FlavorName)));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // variable that the OS could have written
+  HostHobLibReset ();
+  SetSelectionVariable (gProfileFlavorNames[5], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS | EFI_VARIABLE_RUNTIME_ACCESS, sizeof (OEM_ACTIVE_PROFILE_SELECTION));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // variables shorter and longer than a selection
+  SetSelectionVariable (gProfileFlavorNames[5], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION) - 1);
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  SetSelectionVariable (gProfileFlavorNames[5], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION) + 1);
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  // no variable PPI
+  HostPeiServicesLibReset ();
+  SetSelectionVariable (gProfileFlavorNames[5], OEM_ACTIVE_PROFILE_SELECTION_VARIABLE_ATTRS, sizeof (OEM_ACTIVE_PROFILE_SELECTION));
+  UT_ASSERT_NOT_EFI_ERROR (GetActiveProfileIndex (&ActiveProfileIndex));
+  UT_ASSERT_EQUAL (ActiveProfileIndex, TEST_PCD_PROFILE);
+
+  UT_ASSERT_STATUS_EQUAL (GetActiveProfileIndex (NULL), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SelectorTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SelectorTests, Framework, "Active Profile Selector Tests", "OemPkg.ActiveProfileIndexSelectorHobVarLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SelectorTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SelectorTests, "HOB selects every profile", "HobSelectsEveryProfile", HobSelectsEveryProfile, SelectorTestSetup, NULL, NULL);
+  AddTestCase (SelectorTests, "Variable selects every profile", "VariableSelectsEveryProfile", VariableSelectsEveryProfile, SelectorTestSetup, NULL, NULL);
+  AddTestCase (SelectorTests, "HOB takes precedence over the variable", "HobTakesPrecedence", HobTakesPrecedence, SelectorTestSetup, NULL, NULL);
+  AddTestCase (SelectorTests, "Invalid selections are skipped", "InvalidSelections", InvalidSelectionsAreSkipped, SelectorTestSetup, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
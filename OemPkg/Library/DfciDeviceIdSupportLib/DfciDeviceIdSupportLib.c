@@ -15,62 +15,51 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/PrintLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/SmbiosStringIndexLib.h>
 
 #include <Uefi/UefiInternalFormRepresentation.h>
-#include <Protocol/Smbios.h>
 
 #define ID_NOT_FOUND  "Not Found"
 
-// Note: This protocol will guarantee to be met by the Depex and located at the
-// constructor of this library, thus no null-pointer check in library code flow.
-EFI_SMBIOS_PROTOCOL  *mSmbiosProtocol;
-
 /**
 
-  Acquire the string associated with the Index from smbios structure and return it.
+  Acquire a copy of the string associated with the Index from an smbios structure.
   The caller is responsible for free the string buffer.
 
-  @param    OptionalStrStart  The start position to search the string
+  @param    Type              The type of the smbios structure
   @param    Index             The index of the string to extract
   @param    String            The string that is extracted
   @param    Size              Optional pointer to hold size of returned string
 
-  @retval   EFI_SUCCESS       The function returns EFI_SUCCESS always.
+  @retval   EFI_SUCCESS           The string, or ID_NOT_FOUND if the structure has no such string, was returned.
+  @retval   EFI_OUT_OF_RESOURCES  The copy could not be allocated.
 
 **/
 EFI_STATUS
 GetOptionalStringByIndex (
-  IN      CHAR8  *OptionalStrStart,
-  IN      UINT8  Index,
-  OUT     CHAR8  **String,
-  OUT     UINTN  *Size   OPTIONAL
+  IN      SMBIOS_TYPE  Type,
+  IN      UINT8        Index,
+  OUT     CHAR8        **String,
+  OUT     UINTN        *Size   OPTIONAL
   )
 {
-  UINTN  StrSize;
-
-  if (Index == 0) {
-    *String = AllocateZeroPool (sizeof (CHAR16));
-    return EFI_SUCCESS;
-  }
-
-  StrSize = 0;
-  do {
-    Index--;
-    OptionalStrStart += StrSize;
-    StrSize           = AsciiStrSize (OptionalStrStart);
-  } while (OptionalStrStart[StrSize] != 0 && Index != 0);
+  EFI_STATUS   Status;
+  CONST CHAR8  *SmbiosString;
+  UINTN        StrSize;
 
-  if ((Index != 0) || (StrSize == 1)) {
+  Status = SmbiosIndexGetString (Type, 0, Index, &SmbiosString, &StrSize);
+  if (EFI_ERROR (Status) || ((Index != 0) && (StrSize == 1))) {
     //
-    // Meet the end of strings set but Index is non-zero, or
+    // Meet the end of strings set, or
     // Find an empty string
     //
-    StrSize = sizeof (ID_NOT_FOUND);
-    *String = AllocatePool (StrSize);
-    CopyMem (*String, ID_NOT_FOUND, StrSize);
-  } else {
-    *String = AllocatePool (StrSize);
-    CopyMem (*String, OptionalStrStart, StrSize);
+    SmbiosString = ID_NOT_FOUND;
+    StrSize      = sizeof (ID_NOT_FOUND);
+  }
+
+  *String = AllocateCopyPool (StrSize, SmbiosString);
+  if (*String == NULL) {
+    return EFI_OUT_OF_RESOURCES;
   }
 
   if (Size != NULL) {
@@ -95,28 +84,28 @@ DfciIdSupportV1GetSerialNumber (
   OUT UINTN  *SerialNumber
   )
 {
-  EFI_STATUS               Status;
-  CHAR8                    *NewString;
-  EFI_SMBIOS_HANDLE        SmbiosHandle;
-  EFI_SMBIOS_TABLE_HEADER  *Record;
-  SMBIOS_TYPE              Type;
-  SMBIOS_TABLE_TYPE1       *Type1Record = NULL;
-
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;      // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_INFORMATION; // Smbios type1
-  Status       = mSmbiosProtocol->GetNext (mSmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
-  if (!EFI_ERROR (Status)) {
-    Type1Record = (SMBIOS_TABLE_TYPE1 *)Record;
-  } else {
+  EFI_STATUS                Status;
+  CONST CHAR8               *SmbiosString;
+  UINTN                     StrSize;
+  CONST SMBIOS_STRUCTURE    *Record;
+  CONST SMBIOS_TABLE_TYPE1  *Type1Record;
+
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record); // Smbios type1
+  if (EFI_ERROR (Status)) {
     goto Exit;
   }
 
-  Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type1Record + Type1Record->Hdr.Length), Type1Record->SerialNumber, &NewString, NULL);
-  if (!EFI_ERROR (Status)) {
-    CopyMem (SerialNumber, NewString, sizeof (UINTN));
-    FreePool (NewString);
+  Type1Record = (CONST SMBIOS_TABLE_TYPE1 *)Record;
+  Status      = SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->SerialNumber, &SmbiosString, &StrSize);
+  if (EFI_ERROR (Status) || ((Type1Record->SerialNumber != 0) && (StrSize == 1))) {
+    SmbiosString = ID_NOT_FOUND;
+    StrSize      = sizeof (ID_NOT_FOUND);
   }
 
+  ZeroMem (SerialNumber, sizeof (UINTN));
+  CopyMem (SerialNumber, SmbiosString, MIN (StrSize, sizeof (UINTN)));
+  Status = EFI_SUCCESS;
+
 Exit:
   return Status;
 }
@@ -138,26 +127,19 @@ DfciIdSupportGetManufacturer (
   UINTN  *ManufacturerSize   OPTIONAL
   )
 {
-  EFI_STATUS               Status;
-  EFI_SMBIOS_HANDLE        SmbiosHandle;
-  EFI_SMBIOS_TABLE_HEADER  *Record;
-  SMBIOS_TYPE              Type;
-  SMBIOS_TABLE_TYPE1       *Type1Record = NULL;
+  EFI_STATUS              Status;
+  CONST SMBIOS_STRUCTURE  *Record;
 
   if (Manufacturer == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;      // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_INFORMATION; // Smbios type1
-  Status       = mSmbiosProtocol->GetNext (mSmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
-  if (!EFI_ERROR (Status)) {
-    Type1Record = (SMBIOS_TABLE_TYPE1 *)Record;
-  } else {
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record); // Smbios type1
+  if (EFI_ERROR (Status)) {
     goto Exit;
   }
 
-  Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type1Record + Type1Record->Hdr.Length), Type1Record->Manufacturer, Manufacturer, ManufacturerSize);
+  Status = GetOptionalStringByIndex (SMBIOS_TYPE_SYSTEM_INFORMATION, ((CONST SMBIOS_TABLE_TYPE1 *)Record)->Manufacturer, Manufacturer, ManufacturerSize);
 
 Exit:
   return Status;
@@ -180,26 +162,19 @@ DfciIdSupportGetProductName (
   UINTN  *ProductNameSize  OPTIONAL
   )
 {
-  EFI_STATUS               Status;
-  EFI_SMBIOS_HANDLE        SmbiosHandle;
-  EFI_SMBIOS_TABLE_HEADER  *Record;
-  SMBIOS_TYPE              Type;
-  SMBIOS_TABLE_TYPE1       *Type1Record = NULL;
+  EFI_STATUS              Status;
+  CONST SMBIOS_STRUCTURE  *Record;
 
   if (ProductName == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;      // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_INFORMATION; // Smbios type1
-  Status       = mSmbiosProtocol->GetNext (mSmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
-  if (!EFI_ERROR (Status)) {
-    Type1Record = (SMBIOS_TABLE_TYPE1 *)Record;
-  } else {
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record); // Smbios type1
+  if (EFI_ERROR (Status)) {
     goto Exit;
   }
 
-  Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type1Record + Type1Record->Hdr.Length), Type1Record->ProductName, ProductName, ProductNameSize);
+  Status = GetOptionalStringByIndex (SMBIOS_TYPE_SYSTEM_INFORMATION, ((CONST SMBIOS_TABLE_TYPE1 *)Record)->ProductName, ProductName, ProductNameSize);
 
 Exit:
   return Status;
@@ -222,52 +197,20 @@ DfciIdSupportGetSerialNumber (
   UINTN  *SerialNumberSize  OPTIONAL
   )
 {
-  EFI_STATUS               Status;
-  EFI_SMBIOS_HANDLE        SmbiosHandle;
-  EFI_SMBIOS_TABLE_HEADER  *Record;
-  SMBIOS_TYPE              Type;
-  SMBIOS_TABLE_TYPE3       *Type3Record = NULL;
+  EFI_STATUS              Status;
+  CONST SMBIOS_STRUCTURE  *Record;
 
   if (SerialNumber == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;    // Reset handle
-  Type         = SMBIOS_TYPE_SYSTEM_ENCLOSURE; // Smbios type3
-  Status       = mSmbiosProtocol->GetNext (mSmbiosProtocol, &SmbiosHandle, &Type, &Record, NULL);
-  if (!EFI_ERROR (Status)) {
-    Type3Record = (SMBIOS_TABLE_TYPE3 *)Record;
-  } else {
+  Status = SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_ENCLOSURE, 0, &Record); // Smbios type3
+  if (EFI_ERROR (Status)) {
     goto Exit;
   }
 
-  Status = GetOptionalStringByIndex ((CHAR8 *)((UINT8 *)Type3Record + Type3Record->Hdr.Length), Type3Record->SerialNumber, SerialNumber, SerialNumberSize);
+  Status = GetOptionalStringByIndex (SMBIOS_TYPE_SYSTEM_ENCLOSURE, ((CONST SMBIOS_TABLE_TYPE3 *)Record)->SerialNumber, SerialNumber, SerialNumberSize);
 
 Exit:
   return Status;
 }
-
-/**
-  Constructor for DfciIdSupportLib.
-
-  @param  ImageHandle   ImageHandle of the loaded driver.
-  @param  SystemTable   Pointer to the EFI System Table.
-
-  @retval EFI_SUCCESS   The handlers were registered successfully.
-**/
-EFI_STATUS
-EFIAPI
-DfciIdSupportConstructor (
-  IN EFI_HANDLE        ImageHandle,
-  IN EFI_SYSTEM_TABLE  *SystemTable
-  )
-{
-  EFI_STATUS  Status;
-
-  Status = gBS->LocateProtocol (&gEfiSmbiosProtocolGuid, NULL, (VOID **)&mSmbiosProtocol);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((EFI_D_ERROR, "Could not locate SMBIOS protocol.  %r\n", Status));
-  }
-
-  return Status;
-}
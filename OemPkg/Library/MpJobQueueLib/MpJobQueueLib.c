@@ -0,0 +1,302 @@
+/** @file MpJobQueueLib.c
+
+  Runs CPU-bound jobs on idle application processors.
+
+  Jobs are started with the non-blocking form of StartupThisAP. The library wraps each job so that
+  the AP sets the job's Done flag as its last store; the BSP polls that flag rather than the MP
+  services event, which is only used because non-blocking mode requires one. An AP whose last job
+  is Done but which MP services has not yet seen finish refuses a new job with EFI_NOT_READY, and
+  the job is simply run by the caller instead.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Protocol/MpService.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MpJobQueueLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+// Pause loops between wait callbacks.
+#define MP_JOB_QUEUE_CALLBACK_SPINS  0x10000
+
+//
+// An AP that jobs can be started on. MP services signals Event once it has seen the AP finish.
+//
+typedef struct {
+  UINTN        ProcessorNumber;
+  EFI_EVENT    Event;
+} MP_JOB_QUEUE_AP;
+
+STATIC EFI_MP_SERVICES_PROTOCOL  *mMpServices  = NULL;
+STATIC BOOLEAN                   mApLookupDone = FALSE;
+STATIC MP_JOB_QUEUE_AP           mAps[MP_JOB_QUEUE_MAX_APS];
+STATIC UINTN                     mApCount = 0;
+
+/**
+  Get the number of APs jobs can be started on. MP services are looked up on the first call.
+
+  @retval   The number of APs, or 0 if every job runs on the caller.
+
+**/
+UINTN
+EFIAPI
+MpJobQueueGetApCount (
+  VOID
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_PROCESSOR_INFORMATION  ProcessorInfo;
+  UINTN                      ProcessorCount;
+  UINTN                      EnabledCount;
+  UINTN                      Index;
+
+  if (mApLookupDone) {
+    return mApCount;
+  }
+
+  mApLookupDone = TRUE;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&mMpServices);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "%a - No MP services. Jobs run on the BSP.\n", __FUNCTION__));
+    mMpServices = NULL;
+    return 0;
+  }
+
+  Status = mMpServices->GetNumberOfProcessors (mMpServices, &ProcessorCount, &EnabledCount);
+  if (EFI_ERROR (Status)) {
+    mMpServices = NULL;
+    return 0;
+  }
+
+  for (Index = 0; (Index < ProcessorCount) && (mApCount < ARRAY_SIZE (mAps)); Index++) {
+    Status = mMpServices->GetProcessorInfo (mMpServices, Index, &ProcessorInfo);
+    if (EFI_ERROR (Status) ||
+        ((ProcessorInfo.StatusFlag & PROCESSOR_AS_BSP_BIT) != 0) ||
+        ((ProcessorInfo.StatusFlag & PROCESSOR_ENABLED_BIT) == 0))
+    {
+      continue;
+    }
+
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &mAps[mApCount].Event);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    mAps[mApCount].ProcessorNumber = Index;
+    mApCount++;
+  }
+
+  DEBUG ((DEBUG_INFO, "%a - %d of %d processors available for jobs.\n", __FUNCTION__, mApCount, ProcessorCount));
+  return mApCount;
+}
+
+/**
+  AP procedure. Runs one job and marks it done.
+
+  @param[in,out]  Buffer  The MP_JOB.
+
+**/
+STATIC
+VOID
+EFIAPI
+MpJobQueueApProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  MP_JOB  *Job;
+
+  Job = (MP_JOB *)Buffer;
+  Job->Procedure (Job->Buffer);
+
+  // The job's results must be visible before the BSP sees Done.
+  MemoryFence ();
+  Job->Done = TRUE;
+}
+
+/**
+  Start waiting jobs on every AP that is not running one of this queue's jobs.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+**/
+STATIC
+VOID
+DispatchToIdleAps (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  EFI_STATUS  Status;
+  MP_JOB      *Job;
+  UINTN       Index;
+
+  for (Index = 0; (Index < mApCount) && (Queue->NextJob < Queue->JobCount); Index++) {
+    if ((Queue->ApJob[Index] != NULL) && !Queue->ApJob[Index]->Done) {
+      continue;
+    }
+
+    Job    = &Queue->Jobs[Queue->NextJob];
+    Status = mMpServices->StartupThisAP (
+                            mMpServices,
+                            MpJobQueueApProcedure,
+                            mAps[Index].ProcessorNumber,
+                            mAps[Index].Event,
+                            0,
+                            Job,
+                            NULL
+                            );
+    if (!EFI_ERROR (Status)) {
+      Queue->ApJob[Index] = Job;
+      Queue->NextJob++;
+    }
+  }
+}
+
+/**
+  Prepare a queue and start as many of its jobs as possible on idle APs.
+
+  @param[out] Queue     Queue to prepare.
+  @param[in]  Jobs      Jobs to run, in order. Procedure and Buffer must be set. The array must
+                        stay valid until MpJobQueueWait returns.
+  @param[in]  JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueStart (
+  OUT MP_JOB_QUEUE  *Queue,
+  IN  MP_JOB        *Jobs,
+  IN  UINTN         JobCount
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (Queue, sizeof (*Queue));
+  Queue->Jobs     = Jobs;
+  Queue->JobCount = JobCount;
+
+  for (Index = 0; Index < JobCount; Index++) {
+    ASSERT (Jobs[Index].Procedure != NULL);
+    Jobs[Index].Done = FALSE;
+  }
+
+  if (MpJobQueueGetApCount () != 0) {
+    DispatchToIdleAps (Queue);
+  }
+}
+
+/**
+  Start waiting jobs on APs that have finished, then take the next waiting job for the caller.
+
+  The caller must run the returned job itself, either through its procedure or with an equivalent
+  BSP-only path, and then set its Done field.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+  @retval   The job for the caller to run, or NULL if every job has been started.
+
+**/
+MP_JOB *
+EFIAPI
+MpJobQueueNext (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  if (mApCount != 0) {
+    DispatchToIdleAps (Queue);
+  }
+
+  if (Queue->NextJob >= Queue->JobCount) {
+    return NULL;
+  }
+
+  return &Queue->Jobs[Queue->NextJob++];
+}
+
+/**
+  Stop starting jobs. Jobs that have not been started are left with Done clear, and
+  MpJobQueueNext returns NULL from now on.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+**/
+VOID
+EFIAPI
+MpJobQueueCancel (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  Queue->NextJob = Queue->JobCount;
+}
+
+/**
+  Wait for every job started on an AP to finish. A job started on an AP cannot be stopped.
+
+  @param[in,out]  Queue           Queue prepared by MpJobQueueStart. MpJobQueueNext must have
+                                  returned NULL, or MpJobQueueCancel must have been called.
+  @param[in]      Callback        Called while waiting, or NULL.
+  @param[in]      CallbackContext Passed to Callback.
+
+**/
+VOID
+EFIAPI
+MpJobQueueWait (
+  IN OUT MP_JOB_QUEUE          *Queue,
+  IN     MP_JOB_WAIT_CALLBACK  Callback OPTIONAL,
+  IN     VOID                  *CallbackContext OPTIONAL
+  )
+{
+  UINTN  Index;
+  UINTN  Spins;
+
+  ASSERT (Queue->NextJob >= Queue->JobCount);
+
+  for (Index = 0; Index < mApCount; Index++) {
+    if (Queue->ApJob[Index] == NULL) {
+      continue;
+    }
+
+    for (Spins = 1; !Queue->ApJob[Index]->Done; Spins++) {
+      CpuPause ();
+      if ((Callback != NULL) && ((Spins % MP_JOB_QUEUE_CALLBACK_SPINS) == 0)) {
+        Callback (CallbackContext);
+      }
+    }
+
+    Queue->ApJob[Index] = NULL;
+  }
+}
+
+/**
+  Run a set of jobs on the APs and the caller, and return once all of them have finished.
+
+  @param[in,out]  Jobs      Jobs to run. Procedure and Buffer must be set.
+  @param[in]      JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueRun (
+  IN OUT MP_JOB  *Jobs,
+  IN     UINTN   JobCount
+  )
+{
+  MP_JOB_QUEUE  Queue;
+  MP_JOB        *Job;
+
+  MpJobQueueStart (&Queue, Jobs, JobCount);
+
+  for (Job = MpJobQueueNext (&Queue); Job != NULL; Job = MpJobQueueNext (&Queue)) {
+    Job->Procedure (Job->Buffer);
+    Job->Done = TRUE;
+  }
+
+  MpJobQueueWait (&Queue, NULL, NULL);
+}
@@ -0,0 +1,878 @@
+/** @file MpJobQueueLibUnitTest.c
+
+  Host based unit tests of MpJobQueueLib.
+
+  The library runs against a mock MP services protocol behind a minimal boot services table. The
+  mock processors run a started job only when the test lets them: from the caller's own jobs, from
+  the wait callback, or at once for MpJobQueueRun, which has no callback. They can refuse starts
+  with EFI_NOT_READY, and can stay busy for one more start after finishing, the way an AP does that
+  has set Done but that MP services has not yet seen finish. Processor 1 is the BSP and processor 3
+  is disabled, so the AP lookup has to skip both. The library source is included so each test can
+  look the APs up again.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../MpJobQueueLib.c"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "MpJobQueueLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define MOCK_MAX_PROCESSORS      16
+#define MOCK_BSP                 1
+#define MOCK_DISABLED_PROCESSOR  3
+
+#define TEST_JOB_COUNT   40
+#define TEST_JOB_ROUNDS  1000
+
+//
+// A mock processor. Procedure is set from the start of a job until the test lets the processor
+// run it.
+//
+typedef struct {
+  BOOLEAN             Enabled;
+  BOOLEAN             Busy;             // MP services has not seen the processor finish.
+  BOOLEAN             Retiring;         // Finished, but refuses the next start.
+  EFI_AP_PROCEDURE    Procedure;
+  VOID                *Argument;
+  UINTN               Jobs;
+} MOCK_PROCESSOR;
+
+//
+// The processors a test runs with.
+//
+typedef struct {
+  UINTN      ProcessorCount;    // 0 when MP services are not installed.
+  UINTN      RefusedStarts;     // Starts refused with EFI_NOT_READY.
+  BOOLEAN    Immediate;         // Processors run a job as soon as it is started.
+  BOOLEAN    LateRetire;        // Processors refuse one start after each job.
+} MP_TEST_CONTEXT;
+
+typedef struct {
+  UINT32    Seed;
+  UINT32    Value;
+  UINTN     RunCount;
+  UINTN     Processor;
+} TEST_JOB;
+
+STATIC MOCK_PROCESSOR     mMockProcessors[MOCK_MAX_PROCESSORS];
+STATIC UINTN              mMockProcessorCount;
+STATIC UINTN              mMockCurrentProcessor;
+STATIC UINTN              mMockRefusedStarts;
+STATIC BOOLEAN            mMockImmediate;
+STATIC BOOLEAN            mMockLateRetire;
+STATIC BOOLEAN            mAdvanceApsFromCaller;    // The caller's jobs let the processors run.
+STATIC UINTN              mLocateCalls;
+STATIC UINTN              mCreatedEvents;
+STATIC UINTN              mStarts;
+STATIC UINTN              mBadStarts;
+STATIC UINT8              mMockEvents[MOCK_MAX_PROCESSORS];
+STATIC EFI_BOOT_SERVICES  mTestBootServices;
+STATIC TEST_JOB           mTestJobs[TEST_JOB_COUNT];
+STATIC MP_JOB             mJobs[TEST_JOB_COUNT];
+
+EFI_BOOT_SERVICES  *gBS = &mTestBootServices;
+
+/**
+  Let every mock processor with a started job run it.
+**/
+STATIC
+VOID
+MockRunAps (
+  VOID
+  )
+{
+  EFI_AP_PROCEDURE  Procedure;
+  UINTN             Index;
+
+  for (Index = 0; Index < mMockProcessorCount; Index++) {
+    Procedure = mMockProcessors[Index].Procedure;
+    if (Procedure == NULL) {
+      continue;
+    }
+
+    mMockProcessors[Index].Procedure = NULL;
+    mMockCurrentProcessor            = Index;
+    Procedure (mMockProcessors[Index].Argument);
+    mMockCurrentProcessor = MOCK_BSP;
+
+    mMockProcessors[Index].Jobs++;
+    if (mMockLateRetire) {
+      mMockProcessors[Index].Retiring = TRUE;
+    } else {
+      mMockProcessors[Index].Busy = FALSE;
+    }
+  }
+}
+
+/**
+  Return the number of mock processors.
+
+  @param[in]  This                    Not used.
+  @param[out] NumberOfProcessors      Receives the number of processors.
+  @param[out] NumberOfEnabledProcessors Receives the number of enabled processors.
+
+  @retval EFI_SUCCESS   The numbers were returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetNumberOfProcessors (
+  IN  EFI_MP_SERVICES_PROTOCOL  *This,
+  OUT UINTN                     *NumberOfProcessors,
+  OUT UINTN                     *NumberOfEnabledProcessors
+  )
+{
+  UINTN  Index;
+
+  *NumberOfProcessors        = mMockProcessorCount;
+  *NumberOfEnabledProcessors = 0;
+  for (Index = 0; Index < mMockProcessorCount; Index++) {
+    if (mMockProcessors[Index].Enabled) {
+      (*NumberOfEnabledProcessors)++;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the status flags of a mock processor.
+
+  @param[in]  This                Not used.
+  @param[in]  ProcessorNumber     Number of the processor.
+  @param[out] ProcessorInfoBuffer Receives the information.
+
+  @retval EFI_SUCCESS             The information was returned.
+  @retval EFI_NOT_FOUND           There is no such processor.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetProcessorInfo (
+  IN  EFI_MP_SERVICES_PROTOCOL   *This,
+  IN  UINTN                      ProcessorNumber,
+  OUT EFI_PROCESSOR_INFORMATION  *ProcessorInfoBuffer
+  )
+{
+  if (ProcessorNumber >= mMockProcessorCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem (ProcessorInfoBuffer, sizeof (*ProcessorInfoBuffer));
+  ProcessorInfoBuffer->ProcessorId = ProcessorNumber;
+  ProcessorInfoBuffer->StatusFlag  = PROCESSOR_HEALTH_STATUS_BIT;
+  if (mMockProcessors[ProcessorNumber].Enabled) {
+    ProcessorInfoBuffer->StatusFlag |= PROCESSOR_ENABLED_BIT;
+  }
+
+  if (ProcessorNumber == MOCK_BSP) {
+    ProcessorInfoBuffer->StatusFlag |= PROCESSOR_AS_BSP_BIT;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Start a procedure on a mock processor in non-blocking mode.
+
+  @param[in]  This                  Not used.
+  @param[in]  Procedure             Procedure to run.
+  @param[in]  ProcessorNumber       Number of the processor, which must be an enabled AP.
+  @param[in]  WaitEvent             Completion event, which must be set.
+  @param[in]  TimeoutInMicroseconds Must be 0.
+  @param[in]  ProcedureArgument     Passed to Procedure.
+  @param[out] Finished              Must be NULL in non-blocking mode.
+
+  @retval EFI_SUCCESS             The procedure was started.
+  @retval EFI_NOT_READY           The processor is busy or refuses the start.
+  @retval EFI_INVALID_PARAMETER   The library called it the wrong way.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockStartupThisAP (
+  IN  EFI_MP_SERVICES_PROTOCOL  *This,
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  UINTN                     ProcessorNumber,
+  IN  EFI_EVENT                 WaitEvent OPTIONAL,
+  IN  UINTN                     TimeoutInMicroseconds,
+  IN  VOID                      *ProcedureArgument OPTIONAL,
+  OUT BOOLEAN                   *Finished OPTIONAL
+  )
+{
+  MOCK_PROCESSOR  *Processor;
+
+  if ((ProcessorNumber >= mMockProcessorCount) || (ProcessorNumber == MOCK_BSP) ||
+      !mMockProcessors[ProcessorNumber].Enabled || (WaitEvent == NULL) ||
+      (TimeoutInMicroseconds != 0) || (Finished != NULL))
+  {
+    mBadStarts++;
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Processor = &mMockProcessors[ProcessorNumber];
+  if (Processor->Busy) {
+    if (Processor->Retiring) {
+      Processor->Busy     = FALSE;
+      Processor->Retiring = FALSE;
+    }
+
+    return EFI_NOT_READY;
+  }
+
+  if (mMockRefusedStarts != 0) {
+    mMockRefusedStarts--;
+    return EFI_NOT_READY;
+  }
+
+  Processor->Busy      = TRUE;
+  Processor->Procedure = Procedure;
+  Processor->Argument  = ProcedureArgument;
+  mStarts++;
+
+  if (mMockImmediate) {
+    MockRunAps ();
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC EFI_MP_SERVICES_PROTOCOL  mMockMpServices = {
+  MockGetNumberOfProcessors,
+  MockGetProcessorInfo,
+  NULL,
+  MockStartupThisAP,
+  NULL,
+  NULL,
+  NULL
+};
+
+/**
+  Return the mock MP services when the test has processors.
+
+  @param[in]  Protocol      Must be the MP services protocol.
+  @param[in]  Registration  Not used.
+  @param[out] Interface     Receives the protocol.
+
+  @retval EFI_SUCCESS       The protocol was returned.
+  @retval EFI_NOT_FOUND     MP services are not installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  mLocateCalls++;
+  if (!CompareGuid (Protocol, &gEfiMpServiceProtocolGuid) || (mMockProcessorCount == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Interface = &mMockMpServices;
+  return EFI_SUCCESS;
+}
+
+/**
+  Create a mock event.
+
+  @param[in]  Type            Not used.
+  @param[in]  NotifyTpl       Not used.
+  @param[in]  NotifyFunction  Not used.
+  @param[in]  NotifyContext   Not used.
+  @param[out] Event           Receives the event.
+
+  @retval EFI_SUCCESS           The event was created.
+  @retval EFI_OUT_OF_RESOURCES  Every mock event is in use.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestCreateEvent (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction OPTIONAL,
+  IN  VOID              *NotifyContext OPTIONAL,
+  OUT EFI_EVENT         *Event
+  )
+{
+  if (mCreatedEvents >= ARRAY_SIZE (mMockEvents)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Event = &mMockEvents[mCreatedEvents++];
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of APs the library should find among the mock processors.
+
+  @param[in]  ProcessorCount  Number of mock processors.
+
+  @retval   The number of APs.
+**/
+STATIC
+UINTN
+ExpectedApCount (
+  IN UINTN  ProcessorCount
+  )
+{
+  UINTN  ApCount;
+
+  if (ProcessorCount <= MOCK_BSP) {
+    return 0;
+  }
+
+  ApCount = ProcessorCount - 1;
+  if (ProcessorCount > MOCK_DISABLED_PROCESSOR) {
+    ApCount--;
+  }
+
+  return MIN (ApCount, MP_JOB_QUEUE_MAX_APS);
+}
+
+/**
+  A pure job. Its value depends only on its seed, so every job can be checked whichever processor
+  ran it. A job the caller runs lets the processors run theirs when the test asks for it.
+
+  @param[in,out]  Buffer  The TEST_JOB.
+**/
+STATIC
+VOID
+EFIAPI
+TestJobProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  TEST_JOB  *TestJob;
+  UINT32    Value;
+  UINTN     Round;
+
+  TestJob = (TEST_JOB *)Buffer;
+  Value   = TestJob->Seed;
+  for (Round = 0; Round < TEST_JOB_ROUNDS; Round++) {
+    Value ^= Value << 13;
+    Value ^= Value >> 17;
+    Value ^= Value << 5;
+  }
+
+  TestJob->Value     = Value;
+  TestJob->Processor = mMockCurrentProcessor;
+  TestJob->RunCount++;
+
+  if ((mMockCurrentProcessor == MOCK_BSP) && mAdvanceApsFromCaller) {
+    MockRunAps ();
+  }
+}
+
+/**
+  Compute what TestJobProcedure stores for a seed.
+
+  @param[in]  Seed  The seed.
+
+  @retval   The value.
+**/
+STATIC
+UINT32
+ExpectedJobValue (
+  IN UINT32  Seed
+  )
+{
+  TEST_JOB  TestJob;
+  UINTN     ProcessorSave;
+  BOOLEAN   AdvanceSave;
+
+  ProcessorSave         = mMockCurrentProcessor;
+  AdvanceSave           = mAdvanceApsFromCaller;
+  mAdvanceApsFromCaller = FALSE;
+
+  ZeroMem (&TestJob, sizeof (TestJob));
+  TestJob.Seed = Seed;
+  TestJobProcedure (&TestJob);
+
+  mMockCurrentProcessor = ProcessorSave;
+  mAdvanceApsFromCaller = AdvanceSave;
+  return TestJob.Value;
+}
+
+/**
+  Prepare a range of the test jobs.
+
+  @param[in]  First   First job.
+  @param[in]  Count   Number of jobs.
+**/
+STATIC
+VOID
+PrepareJobs (
+  IN UINTN  First,
+  IN UINTN  Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = First; Index < First + Count; Index++) {
+    ZeroMem (&mTestJobs[Index], sizeof (mTestJobs[Index]));
+    mTestJobs[Index].Seed = 0x9E3779B9 * (UINT32)(Index + 1);
+    mJobs[Index].Procedure = TestJobProcedure;
+    mJobs[Index].Buffer    = &mTestJobs[Index];
+  }
+}
+
+/**
+  Check that a range of the test jobs each ran once with the right result.
+
+  @param[in]  First   First job.
+  @param[in]  Count   Number of jobs.
+
+  @retval   TRUE if they did.
+**/
+STATIC
+BOOLEAN
+JobsRanOnce (
+  IN UINTN  First,
+  IN UINTN  Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = First; Index < First + Count; Index++) {
+    if (!mJobs[Index].Done || (mTestJobs[Index].RunCount != 1) ||
+        (mTestJobs[Index].Value != ExpectedJobValue (mTestJobs[Index].Seed)))
+    {
+      DEBUG ((DEBUG_ERROR, "Job %d: Done %d, ran %d times\n", Index, mJobs[Index].Done, mTestJobs[Index].RunCount));
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Count the jobs of a range that ran on the caller.
+
+  @param[in]  First   First job.
+  @param[in]  Count   Number of jobs.
+
+  @retval   The number of jobs.
+**/
+STATIC
+UINTN
+CallerJobCount (
+  IN UINTN  First,
+  IN UINTN  Count
+  )
+{
+  UINTN  Index;
+  UINTN  CallerJobs;
+
+  CallerJobs = 0;
+  for (Index = First; Index < First + Count; Index++) {
+    if ((mTestJobs[Index].RunCount != 0) && (mTestJobs[Index].Processor == MOCK_BSP)) {
+      CallerJobs++;
+    }
+  }
+
+  return CallerJobs;
+}
+
+/**
+  Wait callback. Counts its calls and lets the processors run their jobs.
+
+  @param[in]  Context   The UINTN call count.
+**/
+STATIC
+VOID
+EFIAPI
+TestWaitCallback (
+  IN VOID  *Context
+  )
+{
+  (*(UINTN *)Context)++;
+  MockRunAps ();
+}
+
+/**
+  Run the caller's part of a queue: every job MpJobQueueNext hands out.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+**/
+STATIC
+VOID
+RunCallerJobs (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  MP_JOB  *Job;
+
+  for (Job = MpJobQueueNext (Queue); Job != NULL; Job = MpJobQueueNext (Queue)) {
+    Job->Procedure (Job->Buffer);
+    Job->Done = TRUE;
+  }
+}
+
+/**
+  Reset the mock processors and make the library look the APs up again.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED    The test can run.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MpTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TEST_CONTEXT  *TestContext;
+  UINTN            Index;
+
+  TestContext = (MP_TEST_CONTEXT *)Context;
+  UT_ASSERT_TRUE (TestContext->ProcessorCount <= MOCK_MAX_PROCESSORS);
+
+  ZeroMem (&mTestBootServices, sizeof (mTestBootServices));
+  mTestBootServices.LocateProtocol = TestLocateProtocol;
+  mTestBootServices.CreateEvent    = TestCreateEvent;
+
+  ZeroMem (mMockProcessors, sizeof (mMockProcessors));
+  for (Index = 0; Index < TestContext->ProcessorCount; Index++) {
+    mMockProcessors[Index].Enabled = (Index != MOCK_DISABLED_PROCESSOR);
+  }
+
+  mMockProcessorCount   = TestContext->ProcessorCount;
+  mMockCurrentProcessor = MOCK_BSP;
+  mMockRefusedStarts    = TestContext->RefusedStarts;
+  mMockImmediate        = TestContext->Immediate;
+  mMockLateRetire       = TestContext->LateRetire;
+  mAdvanceApsFromCaller = TRUE;
+  mLocateCalls          = 0;
+  mCreatedEvents        = 0;
+  mStarts               = 0;
+  mBadStarts            = 0;
+
+  mMpServices   = NULL;
+  mApLookupDone = FALSE;
+  mApCount      = 0;
+  ZeroMem (mAps, sizeof (mAps));
+
+  PrepareJobs (0, TEST_JOB_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The library finds the enabled APs once, skips the BSP and disabled processors, uses at most
+  MP_JOB_QUEUE_MAX_APS of them and creates one event for each.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ApLookup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TEST_CONTEXT  *TestContext;
+  UINTN            ApCount;
+  UINTN            Index;
+
+  TestContext = (MP_TEST_CONTEXT *)Context;
+  ApCount     = ExpectedApCount (TestContext->ProcessorCount);
+
+  UT_ASSERT_EQUAL (MpJobQueueGetApCount (), ApCount);
+  UT_ASSERT_EQUAL (MpJobQueueGetApCount (), ApCount);
+  UT_ASSERT_EQUAL (mLocateCalls, 1);
+  UT_ASSERT_EQUAL (mCreatedEvents, ApCount);
+
+  for (Index = 0; Index < ApCount; Index++) {
+    UT_ASSERT_NOT_EQUAL (mAps[Index].ProcessorNumber, MOCK_BSP);
+    UT_ASSERT_NOT_EQUAL (mAps[Index].ProcessorNumber, MOCK_DISABLED_PROCESSOR);
+    UT_ASSERT_NOT_NULL (mAps[Index].Event);
+    if (Index != 0) {
+      UT_ASSERT_TRUE (mAps[Index].ProcessorNumber > mAps[Index - 1].ProcessorNumber);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  MpJobQueueRun runs every job once with the same result whatever the APs do, and gives APs work
+  unless every start is refused.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RunMatchesSerial (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TEST_CONTEXT  *TestContext;
+  UINTN            CallerJobs;
+
+  TestContext = (MP_TEST_CONTEXT *)Context;
+
+  MpJobQueueRun (mJobs, TEST_JOB_COUNT);
+
+  UT_ASSERT_TRUE (JobsRanOnce (0, TEST_JOB_COUNT));
+  UT_ASSERT_EQUAL (mBadStarts, 0);
+
+  CallerJobs = CallerJobCount (0, TEST_JOB_COUNT);
+  UT_ASSERT_EQUAL (CallerJobs + mStarts, TEST_JOB_COUNT);
+  if ((ExpectedApCount (TestContext->ProcessorCount) == 0) || (TestContext->RefusedStarts == MAX_UINTN)) {
+    UT_ASSERT_EQUAL (mStarts, 0);
+  } else {
+    UT_ASSERT_NOT_EQUAL (mStarts, 0);
+  }
+
+  DEBUG ((DEBUG_INFO, "%d APs: %d jobs on APs, %d on the caller\n", mApCount, mStarts, CallerJobs));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  APs run their jobs while the caller runs its own. Each time the caller takes a job, the APs that
+  finished are given the next ones, and MpJobQueueWait waits for the last AP jobs through the
+  callback.
+
+  With 3 APs that each finish while the caller runs one job, the 22 jobs go 3 to the APs and 1 to
+  the caller five times, and the last 2 to the APs.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+QueueOverlapsCaller (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_JOB_QUEUE  Queue;
+  UINTN         Callbacks;
+  UINTN         Index;
+
+  UT_ASSERT_EQUAL (MpJobQueueGetApCount (), 3);
+
+  MpJobQueueStart (&Queue, mJobs, 22);
+  UT_ASSERT_EQUAL (mStarts, 3);
+  for (Index = 0; Index < 22; Index++) {
+    UT_ASSERT_EQUAL (mTestJobs[Index].RunCount, 0);
+  }
+
+  RunCallerJobs (&Queue);
+  UT_ASSERT_EQUAL (mStarts, 17);
+  UT_ASSERT_EQUAL (CallerJobCount (0, 22), 5);
+
+  Callbacks = 0;
+  MpJobQueueWait (&Queue, TestWaitCallback, &Callbacks);
+  UT_ASSERT_EQUAL (Callbacks, 1);
+
+  UT_ASSERT_TRUE (JobsRanOnce (0, 22));
+  UT_ASSERT_EQUAL (mBadStarts, 0);
+  for (Index = 0; Index < MP_JOB_QUEUE_MAX_APS; Index++) {
+    UT_ASSERT_TRUE (Queue.ApJob[Index] == NULL);
+  }
+
+  for (Index = 0; Index < mMockProcessorCount; Index++) {
+    if ((Index != MOCK_BSP) && (Index != MOCK_DISABLED_PROCESSOR)) {
+      UT_ASSERT_TRUE (mMockProcessors[Index].Jobs >= 5);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Cancelling a queue leaves the jobs that were not started alone, while the jobs already started on
+  APs still finish in MpJobQueueWait.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CancelLeavesWaitingJobs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_JOB_QUEUE  Queue;
+  MP_JOB        *Job;
+  UINTN         Callbacks;
+  UINTN         Index;
+
+  mAdvanceApsFromCaller = FALSE;
+
+  MpJobQueueStart (&Queue, mJobs, 22);
+  UT_ASSERT_EQUAL (mStarts, 3);
+
+  Job = MpJobQueueNext (&Queue);
+  UT_ASSERT_TRUE (Job == &mJobs[3]);
+  Job->Procedure (Job->Buffer);
+  Job->Done = TRUE;
+
+  MpJobQueueCancel (&Queue);
+  UT_ASSERT_TRUE (MpJobQueueNext (&Queue) == NULL);
+  UT_ASSERT_EQUAL (mStarts, 3);
+
+  Callbacks = 0;
+  MpJobQueueWait (&Queue, TestWaitCallback, &Callbacks);
+  UT_ASSERT_EQUAL (Callbacks, 1);
+
+  UT_ASSERT_TRUE (JobsRanOnce (0, 4));
+  for (Index = 4; Index < 22; Index++) {
+    UT_ASSERT_FALSE (mJobs[Index].Done);
+    UT_ASSERT_EQUAL (mTestJobs[Index].RunCount, 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  While one queue keeps the APs busy, a second queue runs on the caller, and the first one still
+  finishes afterwards.
+
+  @param[in]  Context   The MP_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SecondQueueRunsOnCaller (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_JOB_QUEUE  Queue;
+  UINTN         Callbacks;
+
+  mAdvanceApsFromCaller = FALSE;
+
+  MpJobQueueStart (&Queue, mJobs, 8);
+  UT_ASSERT_EQUAL (mStarts, 3);
+
+  MpJobQueueRun (&mJobs[8], 8);
+  UT_ASSERT_TRUE (JobsRanOnce (8, 8));
+  UT_ASSERT_EQUAL (CallerJobCount (8, 8), 8);
+  UT_ASSERT_EQUAL (mStarts, 3);
+  UT_ASSERT_EQUAL (mTestJobs[0].RunCount, 0);
+
+  RunCallerJobs (&Queue);
+  Callbacks = 0;
+  MpJobQueueWait (&Queue, TestWaitCallback, &Callbacks);
+
+  UT_ASSERT_TRUE (JobsRanOnce (0, 8));
+  UT_ASSERT_EQUAL (CallerJobCount (0, 8), 5);
+  UT_ASSERT_EQUAL (mBadStarts, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      LookupTests;
+  UNIT_TEST_SUITE_HANDLE      QueueTests;
+  STATIC MP_TEST_CONTEXT      NoMpServices  = { 0, 0, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      OneAp         = { 2, 0, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      ThreeAps      = { 5, 0, FALSE, FALSE };
+  STATIC MP_TEST_CONTEXT      ThreeApsNow   = { 5, 0, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      MaxAps        = { 12, 0, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      RefusingAps   = { 12, 5, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      BusyAps       = { 12, MAX_UINTN, TRUE, FALSE };
+  STATIC MP_TEST_CONTEXT      LateRetireAps = { 12, 0, TRUE, TRUE };
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&LookupTests, Framework, "MP Job Queue AP Lookup Tests", "OemPkg.MpJobQueueLib.Lookup", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LookupTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (LookupTests, "No MP services means no APs", "NoMpServices", ApLookup, MpTestSetup, NULL, &NoMpServices);
+  AddTestCase (LookupTests, "The BSP and disabled processors are skipped", "ThreeAps", ApLookup, MpTestSetup, NULL, &ThreeAps);
+  AddTestCase (LookupTests, "At most MP_JOB_QUEUE_MAX_APS APs are used", "MaxAps", ApLookup, MpTestSetup, NULL, &MaxAps);
+
+  Status = CreateUnitTestSuite (&QueueTests, Framework, "MP Job Queue Tests", "OemPkg.MpJobQueueLib.Queue", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for QueueTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (QueueTests, "Jobs run on the caller without MP services", "RunNoMpServices", RunMatchesSerial, MpTestSetup, NULL, &NoMpServices);
+  AddTestCase (QueueTests, "Jobs run on one AP and the caller", "RunOneAp", RunMatchesSerial, MpTestSetup, NULL, &OneAp);
+  AddTestCase (QueueTests, "Jobs run on three APs and the caller", "RunThreeAps", RunMatchesSerial, MpTestSetup, NULL, &ThreeApsNow);
+  AddTestCase (QueueTests, "Jobs run on every AP a queue can use", "RunMaxAps", RunMatchesSerial, MpTestSetup, NULL, &MaxAps);
+  AddTestCase (QueueTests, "Refused starts fall back to the caller", "RunRefusingAps", RunMatchesSerial, MpTestSetup, NULL, &RefusingAps);
+  AddTestCase (QueueTests, "Jobs run on the caller when every AP is busy", "RunBusyAps", RunMatchesSerial, MpTestSetup, NULL, &BusyAps);
+  AddTestCase (QueueTests, "APs not yet seen finishing fall back to the caller", "RunLateRetire", RunMatchesSerial, MpTestSetup, NULL, &LateRetireAps);
+  AddTestCase (QueueTests, "APs run jobs alongside the caller", "Overlap", QueueOverlapsCaller, MpTestSetup, NULL, &ThreeAps);
+  AddTestCase (QueueTests, "Cancel leaves waiting jobs and waits for started ones", "Cancel", CancelLeavesWaitingJobs, MpTestSetup, NULL, &ThreeAps);
+  AddTestCase (QueueTests, "A second queue runs on the caller while the APs are busy", "SecondQueue", SecondQueueRunsOnCaller, MpTestSetup, NULL, &ThreeAps);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
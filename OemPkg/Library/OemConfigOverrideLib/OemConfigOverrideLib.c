@@ -0,0 +1,539 @@
+/** @file OemConfigOverrideLib.c
+
+  Batches config knob overrides and writes them to the packed override store with one variable write.
+
+  The batch keeps the override of each knob in memory. Commit packs them in knob order, which is the
+  order OemConfigPolicyCreatorPei looks for first, and replaces the store as a whole. Entries of a
+  store written by a build with other knobs are matched by knob name and namespace, and those that no
+  longer name a knob of the same size are dropped at the next commit.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigOverrideStore.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OemConfigOverrideLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+struct _OEM_CONFIG_OVERRIDE_BATCH {
+  UINT8      **Values;      // Override of each knob, NULL if it has none.
+  BOOLEAN    *Touched;      // Knobs set or cleared since the last commit.
+  BOOLEAN    Dirty;         // The overrides differ from the store.
+  BOOLEAN    Foreign;       // The store has other attributes, so it has to be deleted to be written.
+};
+
+/**
+  Check whether a store entry names a knob.
+
+  @param[in]  Entry       An entry whose name lies within the store.
+  @param[in]  Knob        Index of the knob in gKnobData.
+
+  @retval     TRUE        The entry has the name and namespace of the knob.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsEntryOfKnob (
+  IN CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry,
+  IN UINTN                                  Knob
+  )
+{
+  return (BOOLEAN)((Entry->NameSize == gKnobData[Knob].NameSize) &&
+                   CompareGuid (&Entry->VendorNamespace, &gKnobData[Knob].VendorNamespace) &&
+                   (CompareMem (Entry + 1, gKnobData[Knob].Name, Entry->NameSize) == 0));
+}
+
+/**
+  Find the knob a store entry names.
+
+  The store is written in knob order, so the search starts at the knob after the one of the previous
+  entry and wraps around. For a store of this build, the entries are found in one walk over the knobs.
+
+  @param[in]  Entry       An entry whose name lies within the store.
+  @param[in]  NextKnob    Index of the knob after the one of the previous entry.
+
+  @retval     The knob index, or gNumKnobs if the entry names no knob of this build.
+**/
+STATIC
+UINTN
+FindEntryKnob (
+  IN CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry,
+  IN UINTN                                  NextKnob
+  )
+{
+  UINTN  Knob;
+  UINTN  Index;
+
+  for (Index = 0; Index < gNumKnobs; Index++) {
+    Knob = (NextKnob + Index) % gNumKnobs;
+    if (IsEntryOfKnob (Entry, Knob)) {
+      return Knob;
+    }
+  }
+
+  return gNumKnobs;
+}
+
+/**
+  Load the overrides of a valid store into a batch.
+
+  Entries that name no knob of this build, have another size than their knob, or repeat a knob are
+  dropped, and the batch is marked to be written again without them.
+
+  @param[in,out]  Batch       The batch, with no overrides.
+  @param[in]      Store       The store.
+  @param[in]      StoreSize   Size of the store in bytes.
+
+  @retval EFI_SUCCESS             The overrides were loaded.
+  @retval EFI_COMPROMISED_DATA    The store is not valid.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+LoadStore (
+  IN OUT OEM_CONFIG_OVERRIDE_BATCH               *Batch,
+  IN     CONST OEM_CONFIG_OVERRIDE_STORE_HEADER  *Store,
+  IN     UINTN                                   StoreSize
+  )
+{
+  CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry;
+  CONST UINT8                            *End;
+  CONST UINT8                            *Value;
+  UINTN                                  Index;
+  UINTN                                  Left;
+  UINTN                                  NextKnob;
+  UINTN                                  Knob;
+
+  if ((StoreSize < sizeof (OEM_CONFIG_OVERRIDE_STORE_HEADER)) ||
+      (Store->Signature != OEM_CONFIG_OVERRIDE_STORE_SIGNATURE) ||
+      (Store->Version != OEM_CONFIG_OVERRIDE_STORE_VERSION) ||
+      (CalculateCrc32 ((VOID *)(Store + 1), StoreSize - sizeof (*Store)) != Store->Crc32))
+  {
+    return EFI_COMPROMISED_DATA;
+  }
+
+  End      = (CONST UINT8 *)Store + StoreSize;
+  Entry    = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Store + 1);
+  NextKnob = 0;
+  for (Index = 0; Index < Store->EntryCount; Index++) {
+    if ((UINTN)(End - (CONST UINT8 *)Entry) < sizeof (*Entry)) {
+      return EFI_COMPROMISED_DATA;
+    }
+
+    Left = (UINTN)(End - (CONST UINT8 *)(Entry + 1));
+    if ((Entry->NameSize == 0) || (Left < Entry->NameSize) || (Left - Entry->NameSize < Entry->ValueSize)) {
+      return EFI_COMPROMISED_DATA;
+    }
+
+    Value = (CONST UINT8 *)(Entry + 1) + Entry->NameSize;
+    Knob  = FindEntryKnob (Entry, NextKnob);
+    if ((Knob >= gNumKnobs) || (Entry->ValueSize != gKnobData[Knob].ValueSize) || (Batch->Values[Knob] != NULL)) {
+      Batch->Dirty = TRUE;
+    } else {
+      Batch->Values[Knob] = AllocateCopyPool (Entry->ValueSize, Value);
+      if (Batch->Values[Knob] == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+
+      NextKnob = Knob + 1;
+    }
+
+    Entry = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Value + Entry->ValueSize);
+  }
+
+  return ((CONST UINT8 *)Entry == End) ? EFI_SUCCESS : EFI_COMPROMISED_DATA;
+}
+
+/**
+  Remove every override from a batch.
+
+  @param[in,out]  Batch       The batch.
+**/
+STATIC
+VOID
+FreeValues (
+  IN OUT OEM_CONFIG_OVERRIDE_BATCH  *Batch
+  )
+{
+  UINTN  Knob;
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (Batch->Values[Knob] != NULL) {
+      FreePool (Batch->Values[Knob]);
+      Batch->Values[Knob] = NULL;
+    }
+  }
+}
+
+/**
+  Delete the own override variable of a knob, so it does not take precedence over the store.
+
+  @param[in]  Knob        Index of the knob in gKnobData.
+
+  @retval EFI_SUCCESS             The variable was deleted or did not exist.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Variable services failed to delete the variable.
+**/
+STATIC
+EFI_STATUS
+DeleteKnobVariable (
+  IN UINTN  Knob
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      *UnicodeName;
+
+  UnicodeName = AllocatePool (gKnobData[Knob].NameSize * sizeof (CHAR16));
+  if (UnicodeName == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  AsciiStrToUnicodeStrS (gKnobData[Knob].Name, UnicodeName, gKnobData[Knob].NameSize);
+  Status = gRT->SetVariable (UnicodeName, (EFI_GUID *)&gKnobData[Knob].VendorNamespace, 0, 0, NULL);
+  FreePool (UnicodeName);
+
+  return (Status == EFI_NOT_FOUND) ? EFI_SUCCESS : Status;
+}
+
+/**
+  Start a batch from the overrides in the store.
+
+  A store that is not valid is treated as empty. Overrides of knobs this build no longer has are
+  dropped.
+
+  @param[out] Batch     The batch. Free it with OemConfigOverrideBatchFree.
+
+  @retval EFI_SUCCESS             The batch was started.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Variable services failed to read the store.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchStart (
+  OUT OEM_CONFIG_OVERRIDE_BATCH  **Batch
+  )
+{
+  EFI_STATUS                 Status;
+  OEM_CONFIG_OVERRIDE_BATCH  *NewBatch;
+  VOID                       *Store;
+  UINTN                      StoreSize;
+  UINT32                     Attributes;
+
+  if (Batch == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Store    = NULL;
+  NewBatch = AllocateZeroPool (sizeof (*NewBatch));
+  if (NewBatch == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  NewBatch->Values  = AllocateZeroPool (gNumKnobs * sizeof (*NewBatch->Values));
+  NewBatch->Touched = AllocateZeroPool (gNumKnobs * sizeof (*NewBatch->Touched));
+  if ((NewBatch->Values == NULL) || (NewBatch->Touched == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  StoreSize = 0;
+  Status    = gRT->GetVariable (OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, NULL, &StoreSize, NULL);
+  if (Status == EFI_NOT_FOUND) {
+    Status = EFI_SUCCESS;
+    goto Exit;
+  }
+
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    DEBUG ((DEBUG_ERROR, "%a variable services failed to find the config override store (%r)\n", __FUNCTION__, Status));
+    Status = EFI_ERROR (Status) ? Status : EFI_DEVICE_ERROR;
+    goto Exit;
+  }
+
+  Store = AllocatePool (StoreSize);
+  if (Store == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  Status = gRT->GetVariable (OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, &Attributes, &StoreSize, Store);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a variable services failed to read the config override store (%r)\n", __FUNCTION__, Status));
+    goto Exit;
+  }
+
+  if (Attributes != OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS) {
+    // PEI ignores it as well
+    NewBatch->Foreign = TRUE;
+    Status            = EFI_COMPROMISED_DATA;
+  } else {
+    Status = LoadStore (NewBatch, Store, StoreSize);
+  }
+
+  if (Status == EFI_COMPROMISED_DATA) {
+    // the next commit replaces it
+    DEBUG ((DEBUG_WARN, "%a - Config override store is not valid, starting from no overrides.\n", __FUNCTION__));
+    FreeValues (NewBatch);
+    NewBatch->Dirty = TRUE;
+    Status          = EFI_SUCCESS;
+  }
+
+Exit:
+  if (Store != NULL) {
+    FreePool (Store);
+  }
+
+  if (EFI_ERROR (Status)) {
+    OemConfigOverrideBatchFree (NewBatch);
+    NewBatch = NULL;
+  }
+
+  *Batch = NewBatch;
+  return Status;
+}
+
+/**
+  Set the override of a knob.
+
+  @param[in]  Batch       The batch.
+  @param[in]  Knob        Index of the knob in gKnobData.
+  @param[in]  Value       The value.
+  @param[in]  ValueSize   Size of Value in bytes.
+
+  @retval EFI_SUCCESS             The override was set.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, Knob is out of range, or the knob validator
+                                  rejects Value.
+  @retval EFI_BAD_BUFFER_SIZE     ValueSize is not the size of the knob.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchSet (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch,
+  IN UINTN                      Knob,
+  IN CONST VOID                 *Value,
+  IN UINTN                      ValueSize
+  )
+{
+  UINT8  *NewValue;
+
+  if ((Batch == NULL) || (Value == NULL) || (Knob >= gNumKnobs)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (ValueSize != gKnobData[Knob].ValueSize) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  if ((gKnobData[Knob].Validator != NULL) && !gKnobData[Knob].Validator (Value)) {
+    DEBUG ((DEBUG_ERROR, "%a - Value of knob %a is not valid.\n", __FUNCTION__, gKnobData[Knob].Name));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Batch->Touched[Knob] = TRUE;
+  if ((Batch->Values[Knob] != NULL) && (CompareMem (Batch->Values[Knob], Value, ValueSize) == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  NewValue = AllocateCopyPool (ValueSize, Value);
+  if (NewValue == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Batch->Values[Knob] != NULL) {
+    FreePool (Batch->Values[Knob]);
+  }
+
+  Batch->Values[Knob] = NewValue;
+  Batch->Dirty        = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Remove the override of a knob, so that it takes its profile or default value.
+
+  @param[in]  Batch       The batch.
+  @param[in]  Knob        Index of the knob in gKnobData.
+
+  @retval EFI_SUCCESS             The override was removed.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL or Knob is out of range.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchClear (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch,
+  IN UINTN                      Knob
+  )
+{
+  if ((Batch == NULL) || (Knob >= gNumKnobs)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Batch->Touched[Knob] = TRUE;
+  if (Batch->Values[Knob] != NULL) {
+    FreePool (Batch->Values[Knob]);
+    Batch->Values[Knob] = NULL;
+    Batch->Dirty        = TRUE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write the batch to the store.
+
+  The store is written once if anything changed. The own override variables of the knobs that were
+  set or cleared are deleted, so they do not take precedence over the store.
+
+  @param[in]  Batch       The batch. It can be changed and committed again.
+
+  @retval EFI_SUCCESS             The batch was written.
+  @retval EFI_INVALID_PARAMETER   Batch is NULL.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Variable services failed to write the store.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigOverrideBatchCommit (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch
+  )
+{
+  EFI_STATUS                        Status;
+  OEM_CONFIG_OVERRIDE_STORE_HEADER  *Store;
+  OEM_CONFIG_OVERRIDE_STORE_ENTRY   *Entry;
+  UINTN                             StoreSize;
+  UINTN                             Knob;
+
+  if (Batch == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Store = NULL;
+  if (Batch->Dirty) {
+    if (Batch->Foreign) {
+      Status = gRT->SetVariable (OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, 0, 0, NULL);
+      if (EFI_ERROR (Status) && (Status != EFI_NOT_FOUND)) {
+        DEBUG ((DEBUG_ERROR, "%a variable services failed to delete the config override store (%r)\n", __FUNCTION__, Status));
+        goto Exit;
+      }
+
+      Batch->Foreign = FALSE;
+    }
+
+    StoreSize = sizeof (OEM_CONFIG_OVERRIDE_STORE_HEADER);
+    for (Knob = 0; Knob < gNumKnobs; Knob++) {
+      if (Batch->Values[Knob] != NULL) {
+        StoreSize += sizeof (OEM_CONFIG_OVERRIDE_STORE_ENTRY) + gKnobData[Knob].NameSize + gKnobData[Knob].ValueSize;
+      }
+    }
+
+    if (StoreSize == sizeof (OEM_CONFIG_OVERRIDE_STORE_HEADER)) {
+      Status = gRT->SetVariable (OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, 0, 0, NULL);
+      if (Status == EFI_NOT_FOUND) {
+        Status = EFI_SUCCESS;
+      }
+    } else {
+      Store = AllocateZeroPool (StoreSize);
+      if (Store == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto Exit;
+      }
+
+      Store->Signature = OEM_CONFIG_OVERRIDE_STORE_SIGNATURE;
+      Store->Version   = OEM_CONFIG_OVERRIDE_STORE_VERSION;
+
+      Entry = (OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Store + 1);
+      for (Knob = 0; Knob < gNumKnobs; Knob++) {
+        if (Batch->Values[Knob] != NULL) {
+          CopyGuid (&Entry->VendorNamespace, &gKnobData[Knob].VendorNamespace);
+          Entry->NameSize  = (UINT32)gKnobData[Knob].NameSize;
+          Entry->ValueSize = (UINT32)gKnobData[Knob].ValueSize;
+          CopyMem (Entry + 1, gKnobData[Knob].Name, Entry->NameSize);
+          CopyMem ((UINT8 *)(Entry + 1) + Entry->NameSize, Batch->Values[Knob], Entry->ValueSize);
+          Store->EntryCount++;
+          Entry = (OEM_CONFIG_OVERRIDE_STORE_ENTRY *)((UINT8 *)(Entry + 1) + Entry->NameSize + Entry->ValueSize);
+        }
+      }
+
+      Store->Crc32 = CalculateCrc32 (Store + 1, StoreSize - sizeof (*Store));
+      Status       = gRT->SetVariable (
+                            OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME,
+                            &gOemConfigOverrideStoreGuid,
+                            OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS,
+                            StoreSize,
+                            Store
+                            );
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a variable services failed to write the config override store (%r)\n", __FUNCTION__, Status));
+      goto Exit;
+    }
+
+    Batch->Dirty = FALSE;
+  }
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (Batch->Touched[Knob]) {
+      Status = DeleteKnobVariable (Knob);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "%a failed to delete the override variable of knob %a (%r)\n", __FUNCTION__, gKnobData[Knob].Name, Status));
+        goto Exit;
+      }
+
+      Batch->Touched[Knob] = FALSE;
+    }
+  }
+
+  Status = EFI_SUCCESS;
+
+Exit:
+  if (Store != NULL) {
+    FreePool (Store);
+  }
+
+  return Status;
+}
+
+/**
+  Free a batch without writing the changes that were not committed.
+
+  @param[in]  Batch       The batch. May be NULL.
+
+**/
+VOID
+EFIAPI
+OemConfigOverrideBatchFree (
+  IN OEM_CONFIG_OVERRIDE_BATCH  *Batch
+  )
+{
+  if (Batch == NULL) {
+    return;
+  }
+
+  if (Batch->Values != NULL) {
+    FreeValues (Batch);
+    FreePool (Batch->Values);
+  }
+
+  if (Batch->Touched != NULL) {
+    FreePool (Batch->Touched);
+  }
+
+  FreePool (Batch);
+}
@@ -0,0 +1,1253 @@
+/** @file OemConfigPolicyLib.c
+
+  Publishes the config policy as an index and chunk policies, and resolves config knobs from it.
+
+  A CONFIG_VAR_LIST entry is a CONFIG_VAR_LIST_HDR followed by the UCS-2 name, the namespace GUID,
+  the attributes, the data and a CRC32. Entries are never split across chunks.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigMetadataPolicy.h>
+#include <Guid/OemConfigPolicy.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/ConfigVariableListLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OemConfigPolicyLib.h>
+#include <Library/PolicyLib.h>
+
+struct _OEM_CONFIG_POLICY {
+  OEM_CONFIG_POLICY_INDEX_HEADER    *Index;
+  CONST UINT32                      *ChunkSize;
+  CONST UINT16                      *Seeds;
+  UINT8                             **Chunks;   // Chunks then index pages, fetched on first use
+};
+
+/**
+  Get the GUID a chunk policy is published under.
+
+  @param[in]  Chunk   Chunk number.
+  @param[out] Guid    The GUID.
+
+**/
+STATIC
+VOID
+GetChunkGuid (
+  IN  UINTN     Chunk,
+  OUT EFI_GUID  *Guid
+  )
+{
+  CopyGuid (Guid, &gOemConfigPolicyChunkGuid);
+  Guid->Data1 += (UINT32)Chunk;
+}
+
+/**
+  Get the size of a page of index entries.
+
+  @param[in]  KnobCount   Number of knobs in the index.
+  @param[in]  Page        Page number.
+
+  @retval     The size of the page in bytes.
+**/
+STATIC
+UINT32
+GetIndexPageSize (
+  IN UINT32  KnobCount,
+  IN UINTN   Page
+  )
+{
+  return (UINT32)MIN (
+                   OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE,
+                   KnobCount - Page * OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE
+                   ) * sizeof (OEM_CONFIG_POLICY_INDEX_KNOB);
+}
+
+/**
+  Hash a knob name and namespace as described in Guid/OemConfigPolicy.h.
+
+  @param[in]  Name        UCS-2 name. Need not be aligned.
+  @param[in]  NameSize    Size of Name in bytes, including the null terminator.
+  @param[in]  Guid        Namespace GUID. Need not be aligned.
+  @param[out] BucketHash  Hash that selects the perfect hash bucket.
+  @param[out] CheckHash   Hash that selects the slot within the index and is kept in it.
+
+**/
+STATIC
+VOID
+HashKnobName (
+  IN  CONST VOID  *Name,
+  IN  UINTN       NameSize,
+  IN  CONST VOID  *Guid,
+  OUT UINT32      *BucketHash,
+  OUT UINT32      *CheckHash
+  )
+{
+  CONST UINT8  *Bytes;
+  UINT32       Hash1;
+  UINT32       Hash2;
+  UINTN        Index;
+
+  Hash1 = OEM_CONFIG_POLICY_INDEX_BUCKET_HASH_SEED;
+  Hash2 = OEM_CONFIG_POLICY_INDEX_CHECK_HASH_SEED;
+  Bytes = Name;
+  for (Index = 0; Index < NameSize; Index++) {
+    Hash1 = (Hash1 ^ Bytes[Index]) * OEM_CONFIG_POLICY_INDEX_HASH_PRIME;
+    Hash2 = (Hash2 ^ Bytes[Index]) * OEM_CONFIG_POLICY_INDEX_HASH_PRIME;
+  }
+
+  Bytes = Guid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash1 = (Hash1 ^ Bytes[Index]) * OEM_CONFIG_POLICY_INDEX_HASH_PRIME;
+    Hash2 = (Hash2 ^ Bytes[Index]) * OEM_CONFIG_POLICY_INDEX_HASH_PRIME;
+  }
+
+  *BucketHash = Hash1;
+  *CheckHash  = Hash2;
+}
+
+/**
+  Get the index slot of a knob from its check hash and the seed of its bucket.
+
+  @param[in]  CheckHash   Check hash of the knob.
+  @param[in]  Seed        Seed of the knob's bucket.
+  @param[in]  KnobCount   Number of knobs in the index.
+
+  @retval     The slot.
+**/
+STATIC
+UINT32
+GetKnobSlot (
+  IN UINT32  CheckHash,
+  IN UINT16  Seed,
+  IN UINT32  KnobCount
+  )
+{
+  UINT32  Hash;
+
+  if ((Seed & OEM_CONFIG_POLICY_INDEX_SEED_DIRECT) != 0) {
+    return Seed & ~OEM_CONFIG_POLICY_INDEX_SEED_DIRECT;
+  }
+
+  // MurmurHash3 finalizer
+  Hash  = CheckHash ^ (Seed * OEM_CONFIG_POLICY_INDEX_SEED_STEP);
+  Hash ^= Hash >> 16;
+  Hash *= 0x85EBCA6B;
+  Hash ^= Hash >> 13;
+  Hash *= 0xC2B2AE35;
+  Hash ^= Hash >> 16;
+  return Hash % KnobCount;
+}
+
+/**
+  Get the size of the CONFIG_VAR_LIST entry at the start of a buffer.
+
+  @param[in]  Entry       The entry.
+  @param[in]  Remaining   Bytes left in the buffer from Entry on.
+  @param[out] EntrySize   Size of the entry.
+
+  @retval EFI_SUCCESS             EntrySize was returned.
+  @retval EFI_INVALID_PARAMETER   The entry does not fit in the buffer.
+**/
+STATIC
+EFI_STATUS
+GetEntrySize (
+  IN  CONST UINT8  *Entry,
+  IN  UINTN        Remaining,
+  OUT UINT32       *EntrySize
+  )
+{
+  EFI_STATUS                 Status;
+  CONST CONFIG_VAR_LIST_HDR  *Header;
+
+  if (Remaining < sizeof (CONFIG_VAR_LIST_HDR)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Header = (CONST CONFIG_VAR_LIST_HDR *)Entry;
+  Status = GetVarListSize (Header->NameSize, Header->DataSize, EntrySize);
+  if (EFI_ERROR (Status) || (*EntrySize > Remaining)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Split a CONFIG_VAR_LIST into chunks of whole entries that each fit in a policy.
+
+  @param[in]  List        The CONFIG_VAR_LIST.
+  @param[in]  ListSize    Size of List in bytes.
+  @param[out] ChunkCount  Number of chunks.
+  @param[out] KnobCount   Number of entries.
+  @param[out] ChunkSize   Optional array of ChunkCount entries that receives the size of each chunk.
+  @param[out] Knobs       Optional array of KnobCount entries that receives the index entry of each
+                          knob, in list order.
+  @param[out] BucketHash  Optional array of KnobCount entries that receives the bucket hash of each
+                          knob, in list order.
+
+  @retval EFI_SUCCESS             The list was split.
+  @retval EFI_INVALID_PARAMETER   The list is not a valid CONFIG_VAR_LIST.
+  @retval EFI_UNSUPPORTED         An entry is larger than a policy.
+**/
+STATIC
+EFI_STATUS
+SplitConfigVarList (
+  IN  CONST UINT8                   *List,
+  IN  UINT32                        ListSize,
+  OUT UINT32                        *ChunkCount,
+  OUT UINT32                        *KnobCount,
+  OUT UINT32                        *ChunkSize OPTIONAL,
+  OUT OEM_CONFIG_POLICY_INDEX_KNOB  *Knobs OPTIONAL,
+  OUT UINT32                        *BucketHash OPTIONAL
+  )
+{
+  EFI_STATUS                 Status;
+  CONST CONFIG_VAR_LIST_HDR  *Header;
+  UINT32                     Offset;
+  UINT32                     EntrySize;
+  UINT32                     ChunkStart;
+
+  *ChunkCount = 0;
+  *KnobCount  = 0;
+  ChunkStart  = 0;
+  for (Offset = 0; Offset < ListSize; Offset += EntrySize) {
+    Status = GetEntrySize (&List[Offset], ListSize - Offset, &EntrySize);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Bad config var list entry at offset 0x%x!\n", __FUNCTION__, Offset));
+      return EFI_INVALID_PARAMETER;
+    }
+
+    if (EntrySize > MAX_UINT16) {
+      DEBUG ((DEBUG_ERROR, "%a - Config var list entry at offset 0x%x is larger than a policy!\n", __FUNCTION__, Offset));
+      return EFI_UNSUPPORTED;
+    }
+
+    if ((*KnobCount == 0) || (Offset + EntrySize - ChunkStart > MAX_UINT16)) {
+      ChunkStart = Offset;
+      (*ChunkCount)++;
+    }
+
+    if (ChunkSize != NULL) {
+      ChunkSize[*ChunkCount - 1] = Offset + EntrySize - ChunkStart;
+    }
+
+    if ((Knobs != NULL) && (BucketHash != NULL)) {
+      Header = (CONST CONFIG_VAR_LIST_HDR *)&List[Offset];
+      HashKnobName (
+        Header + 1,
+        Header->NameSize,
+        (CONST UINT8 *)(Header + 1) + Header->NameSize,
+        &BucketHash[*KnobCount],
+        &Knobs[*KnobCount].NameHash
+        );
+      Knobs[*KnobCount].Chunk  = (UINT16)(*ChunkCount - 1);
+      Knobs[*KnobCount].Offset = (UINT16)(Offset - ChunkStart);
+    }
+
+    (*KnobCount)++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Lay out the index entries by a minimal perfect hash.
+
+  Knobs are grouped into buckets by their bucket hash. Buckets of two or more knobs are placed
+  first, largest first, each with the first seed that sends all of its knobs to free slots. The
+  knobs of single-knob buckets then take the remaining slots directly, so they never need a seed
+  search.
+
+  Two knobs with the same bucket and check hash, which is what two entries of the same knob have,
+  cannot be separated by any seed. They are found before the seed search of their bucket.
+
+  @param[in,out]  Knobs         Index entries, in list order on input and in slot order on output.
+                                Left in list order if the perfect hash cannot be built.
+  @param[in]      BucketHash    Bucket hash of each entry, in list order.
+  @param[in]      KnobCount     Number of entries.
+  @param[out]     Seeds         Seed of each bucket.
+  @param[in]      BucketCount   Number of buckets.
+  @param[out]     Collision     Receives the list order of two knobs with the same hashes.
+  @param[out]     SeedsTried    Receives the number of seeds tried, a measure of the search cost.
+
+  @retval EFI_SUCCESS           The perfect hash was built.
+  @retval EFI_ALREADY_STARTED   Two knobs have the same bucket and check hash. They are returned in
+                                Collision.
+  @retval EFI_NOT_FOUND         No seed places a bucket.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+BuildPerfectHash (
+  IN OUT OEM_CONFIG_POLICY_INDEX_KNOB  *Knobs,
+  IN     CONST UINT32                  *BucketHash,
+  IN     UINT32                        KnobCount,
+  OUT    UINT16                        *Seeds,
+  IN     UINT32                        BucketCount,
+  OUT    UINT32                        Collision[2],
+  OUT    UINT64                        *SeedsTried
+  )
+{
+  EFI_STATUS                    Status;
+  UINT32                        *BucketStart;
+  UINT32                        *Order;
+  UINT32                        *Slot;
+  UINT64                        *Used;
+  OEM_CONFIG_POLICY_INDEX_KNOB  *Placed;
+  UINT32                        Bucket;
+  UINT32                        BucketSize;
+  UINT32                        MaxBucketSize;
+  UINT32                        Knob;
+  UINT32                        Free;
+  UINT32                        Seed;
+  UINT32                        Index;
+  UINT32                        Other;
+
+  *SeedsTried = 0;
+  BucketStart = AllocateZeroPool ((BucketCount + 2) * sizeof (UINT32));
+  Order       = AllocatePool (KnobCount * sizeof (UINT32));
+  Slot        = AllocatePool (KnobCount * sizeof (UINT32));
+  Used        = AllocateZeroPool (((KnobCount + 63) / 64) * sizeof (UINT64));
+  Placed      = AllocatePool (KnobCount * sizeof (OEM_CONFIG_POLICY_INDEX_KNOB));
+  if ((BucketStart == NULL) || (Order == NULL) || (Slot == NULL) || (Used == NULL) || (Placed == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  // group the knobs by bucket: the knobs of bucket B are Order[BucketStart[B]] up to, but not
+  // including, Order[BucketStart[B + 1]]
+  for (Knob = 0; Knob < KnobCount; Knob++) {
+    BucketStart[BucketHash[Knob] % BucketCount + 2]++;
+  }
+
+  MaxBucketSize = 0;
+  for (Bucket = 0; Bucket < BucketCount; Bucket++) {
+    MaxBucketSize            = MAX (MaxBucketSize, BucketStart[Bucket + 2]);
+    BucketStart[Bucket + 2] += BucketStart[Bucket + 1];
+  }
+
+  for (Knob = 0; Knob < KnobCount; Knob++) {
+    Order[BucketStart[BucketHash[Knob] % BucketCount + 1]++] = Knob;
+  }
+
+  for (BucketSize = MaxBucketSize; BucketSize >= 2; BucketSize--) {
+    for (Bucket = 0; Bucket < BucketCount; Bucket++) {
+      if (BucketStart[Bucket + 1] - BucketStart[Bucket] != BucketSize) {
+        continue;
+      }
+
+      for (Index = 1; Index < BucketSize; Index++) {
+        for (Other = 0; Other < Index; Other++) {
+          if (Knobs[Order[BucketStart[Bucket] + Index]].NameHash == Knobs[Order[BucketStart[Bucket] + Other]].NameHash) {
+            Collision[0] = MIN (Order[BucketStart[Bucket] + Index], Order[BucketStart[Bucket] + Other]);
+            Collision[1] = MAX (Order[BucketStart[Bucket] + Index], Order[BucketStart[Bucket] + Other]);
+            Status       = EFI_ALREADY_STARTED;
+            goto Exit;
+          }
+        }
+      }
+
+      for (Seed = 0; Seed < OEM_CONFIG_POLICY_INDEX_SEED_DIRECT; Seed++) {
+        (*SeedsTried)++;
+        for (Index = 0; Index < BucketSize; Index++) {
+          Slot[Index] = GetKnobSlot (Knobs[Order[BucketStart[Bucket] + Index]].NameHash, (UINT16)Seed, KnobCount);
+          if ((Used[Slot[Index] / 64] & LShiftU64 (1, Slot[Index] % 64)) != 0) {
+            break;
+          }
+
+          Used[Slot[Index] / 64] |= LShiftU64 (1, Slot[Index] % 64);
+        }
+
+        if (Index == BucketSize) {
+          break;
+        }
+
+        // release the slots this seed took and try the next one
+        while (Index > 0) {
+          Index--;
+          Used[Slot[Index] / 64] &= ~LShiftU64 (1, Slot[Index] % 64);
+        }
+      }
+
+      if (Seed == OEM_CONFIG_POLICY_INDEX_SEED_DIRECT) {
+        Status = EFI_NOT_FOUND;
+        goto Exit;
+      }
+
+      Seeds[Bucket] = (UINT16)Seed;
+      for (Index = 0; Index < BucketSize; Index++) {
+        Placed[Slot[Index]] = Knobs[Order[BucketStart[Bucket] + Index]];
+      }
+    }
+  }
+
+  Free = 0;
+  for (Bucket = 0; Bucket < BucketCount; Bucket++) {
+    BucketSize = BucketStart[Bucket + 1] - BucketStart[Bucket];
+    if (BucketSize == 0) {
+      Seeds[Bucket] = 0;
+    } else if (BucketSize == 1) {
+      while ((Used[Free / 64] & LShiftU64 (1, Free % 64)) != 0) {
+        Free++;
+      }
+
+      Used[Free / 64] |= LShiftU64 (1, Free % 64);
+      Seeds[Bucket]    = (UINT16)(OEM_CONFIG_POLICY_INDEX_SEED_DIRECT | Free);
+      Placed[Free]     = Knobs[Order[BucketStart[Bucket]]];
+    }
+  }
+
+  CopyMem (Knobs, Placed, KnobCount * sizeof (OEM_CONFIG_POLICY_INDEX_KNOB));
+  Status = EFI_SUCCESS;
+
+Exit:
+  if (BucketStart != NULL) {
+    FreePool (BucketStart);
+  }
+
+  if (Order != NULL) {
+    FreePool (Order);
+  }
+
+  if (Slot != NULL) {
+    FreePool (Slot);
+  }
+
+  if (Used != NULL) {
+    FreePool (Used);
+  }
+
+  if (Placed != NULL) {
+    FreePool (Placed);
+  }
+
+  return Status;
+}
+
+/**
+  Get the CONFIG_VAR_LIST entry of an index entry in list order.
+
+  @param[in]  List        The CONFIG_VAR_LIST.
+  @param[in]  ChunkSize   Size of each chunk.
+  @param[in]  Knob        The index entry.
+
+  @retval     The entry.
+**/
+STATIC
+CONST CONFIG_VAR_LIST_HDR *
+GetKnobEntry (
+  IN CONST UINT8                         *List,
+  IN CONST UINT32                        *ChunkSize,
+  IN CONST OEM_CONFIG_POLICY_INDEX_KNOB  *Knob
+  )
+{
+  UINTN  Offset;
+  UINTN  Chunk;
+
+  Offset = Knob->Offset;
+  for (Chunk = 0; Chunk < Knob->Chunk; Chunk++) {
+    Offset += ChunkSize[Chunk];
+  }
+
+  return (CONST CONFIG_VAR_LIST_HDR *)&List[Offset];
+}
+
+/**
+  Log two knobs that have the same name hashes, telling a knob that is in the list twice from two
+  different knobs whose hashes collide.
+
+  @param[in]  List        The CONFIG_VAR_LIST.
+  @param[in]  ChunkSize   Size of each chunk.
+  @param[in]  Knobs       Index entries in list order.
+  @param[in]  Collision   List order of the two knobs.
+
+**/
+STATIC
+VOID
+ReportKnobCollision (
+  IN CONST UINT8                         *List,
+  IN CONST UINT32                        *ChunkSize,
+  IN CONST OEM_CONFIG_POLICY_INDEX_KNOB  *Knobs,
+  IN CONST UINT32                        Collision[2]
+  )
+{
+  CONST CONFIG_VAR_LIST_HDR  *First;
+  CONST CONFIG_VAR_LIST_HDR  *Second;
+
+  First  = GetKnobEntry (List, ChunkSize, &Knobs[Collision[0]]);
+  Second = GetKnobEntry (List, ChunkSize, &Knobs[Collision[1]]);
+  if ((First->NameSize == Second->NameSize) &&
+      (CompareMem (First + 1, Second + 1, First->NameSize + sizeof (EFI_GUID)) == 0))
+  {
+    DEBUG ((
+      DEBUG_WARN,
+      "%a - Knob %s is in the config list twice (entries %d and %d), publishing the index without a perfect hash.\n",
+      __FUNCTION__,
+      (CONST CHAR16 *)(First + 1),
+      Collision[0],
+      Collision[1]
+      ));
+  } else {
+    DEBUG ((
+      DEBUG_WARN,
+      "%a - Knobs %s and %s have the same name hashes, publishing the index without a perfect hash.\n",
+      __FUNCTION__,
+      (CONST CHAR16 *)(First + 1),
+      (CONST CHAR16 *)(Second + 1)
+      ));
+  }
+}
+
+/**
+  Publish a CONFIG_VAR_LIST as the finalized config policy.
+
+  Chunk policies and index pages are set first, so once the index policy exists all of them do as
+  well.
+
+  @param[in]  ConfigVarList     The CONFIG_VAR_LIST of every config knob.
+  @param[in]  ConfigVarListSize Size of ConfigVarList in bytes.
+
+  @retval EFI_SUCCESS             The policy was published.
+  @retval EFI_INVALID_PARAMETER   ConfigVarList is NULL or is not a valid CONFIG_VAR_LIST.
+  @retval EFI_UNSUPPORTED         A single entry is larger than a policy, or there are too many
+                                  chunks for the index.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+  @retval Others                  Policy service failed to set a policy.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyPublish (
+  IN CONST VOID  *ConfigVarList,
+  IN UINT32      ConfigVarListSize
+  )
+{
+  EFI_STATUS                      Status;
+  OEM_CONFIG_POLICY_INDEX_HEADER  *Index;
+  UINT32                          *ChunkSize;
+  OEM_CONFIG_POLICY_INDEX_KNOB    *Knobs;
+  UINT16                          *Seeds;
+  UINT32                          *BucketHash;
+  UINT32                          ChunkCount;
+  UINT32                          KnobCount;
+  UINT32                          BucketCount;
+  UINT32                          Collision[2];
+  UINT64                          SeedsTried;
+  UINT64                          IndexSize;
+  UINT32                          Offset;
+  EFI_GUID                        ChunkGuid;
+  UINTN                           Chunk;
+  UINTN                           Page;
+
+  if (ConfigVarList == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Index      = NULL;
+  Knobs      = NULL;
+  BucketHash = NULL;
+  Status     = SplitConfigVarList (ConfigVarList, ConfigVarListSize, &ChunkCount, &KnobCount, NULL, NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    goto Exit;
+  }
+
+  // direct slots need KnobCount below OEM_CONFIG_POLICY_INDEX_SEED_DIRECT, more knobs are left in list order
+  if (KnobCount < OEM_CONFIG_POLICY_INDEX_SEED_DIRECT) {
+    BucketCount = (KnobCount + OEM_CONFIG_POLICY_INDEX_KNOBS_PER_BUCKET - 1) / OEM_CONFIG_POLICY_INDEX_KNOBS_PER_BUCKET;
+  } else {
+    DEBUG ((DEBUG_WARN, "%a - %d knobs are too many for a perfect hash, publishing the index without one.\n", __FUNCTION__, KnobCount));
+    BucketCount = 0;
+  }
+
+  IndexSize   = OEM_CONFIG_POLICY_INDEX_SIZE ((UINT64)ChunkCount, (UINT64)BucketCount);
+  if (IndexSize > MAX_UINT16) {
+    DEBUG ((DEBUG_ERROR, "%a - %d chunks are too many for the config policy index!\n", __FUNCTION__, ChunkCount));
+    Status = EFI_UNSUPPORTED;
+    goto Exit;
+  }
+
+  Index      = AllocatePool ((UINTN)IndexSize);
+  Knobs      = AllocatePool (MAX (KnobCount, 1) * sizeof (OEM_CONFIG_POLICY_INDEX_KNOB));
+  BucketHash = AllocatePool (MAX (KnobCount, 1) * sizeof (UINT32));
+  if ((Index == NULL) || (Knobs == NULL) || (BucketHash == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  Index->Signature   = OEM_CONFIG_POLICY_INDEX_SIGNATURE;
+  Index->Version     = OEM_CONFIG_POLICY_INDEX_VERSION;
+  Index->ChunkCount  = ChunkCount;
+  Index->KnobCount   = KnobCount;
+  Index->BucketCount = BucketCount;
+  ChunkSize          = (UINT32 *)(Index + 1);
+  Seeds              = (UINT16 *)(ChunkSize + ChunkCount);
+
+  Status = SplitConfigVarList (ConfigVarList, ConfigVarListSize, &ChunkCount, &KnobCount, ChunkSize, Knobs, BucketHash);
+  if (EFI_ERROR (Status)) {
+    goto Exit;
+  }
+
+  if (BucketCount != 0) {
+    Status = BuildPerfectHash (Knobs, BucketHash, KnobCount, Seeds, BucketCount, Collision, &SeedsTried);
+    DEBUG ((DEBUG_INFO, "%a - Perfect hash of %d knobs in %d buckets tried %ld seeds.\n", __FUNCTION__, KnobCount, BucketCount, SeedsTried));
+    if (Status == EFI_ALREADY_STARTED) {
+      ReportKnobCollision (ConfigVarList, ChunkSize, Knobs, Collision);
+    } else if (Status == EFI_NOT_FOUND) {
+      DEBUG ((DEBUG_WARN, "%a - No perfect hash seed places every knob, publishing the index without a perfect hash.\n", __FUNCTION__));
+    }
+
+    if ((Status == EFI_ALREADY_STARTED) || (Status == EFI_NOT_FOUND)) {
+      // consumers fall back to comparing the check hash of every knob
+      Index->BucketCount = 0;
+      IndexSize         -= BucketCount * sizeof (UINT16);
+      Status             = EFI_SUCCESS;
+    } else if (EFI_ERROR (Status)) {
+      goto Exit;
+    }
+  }
+
+  Offset = 0;
+  for (Chunk = 0; Chunk < ChunkCount; Chunk++) {
+    GetChunkGuid (Chunk, &ChunkGuid);
+    Status = SetPolicy (&ChunkGuid, POLICY_ATTRIBUTE_FINALIZED, (UINT8 *)ConfigVarList + Offset, (UINT16)ChunkSize[Chunk]);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to set config policy chunk %d! Status (%r)\n", __FUNCTION__, Chunk, Status));
+      goto Exit;
+    }
+
+    Offset += ChunkSize[Chunk];
+  }
+
+  for (Page = 0; Page < OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (KnobCount); Page++) {
+    GetChunkGuid (ChunkCount + Page, &ChunkGuid);
+    Status = SetPolicy (
+               &ChunkGuid,
+               POLICY_ATTRIBUTE_FINALIZED,
+               &Knobs[Page * OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE],
+               (UINT16)GetIndexPageSize (KnobCount, Page)
+               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to set config policy index page %d! Status (%r)\n", __FUNCTION__, Page, Status));
+      goto Exit;
+    }
+  }
+
+  Status = SetPolicy (&gOemConfigPolicyGuid, POLICY_ATTRIBUTE_FINALIZED, Index, (UINT16)IndexSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to set config policy index! Status (%r)\n", __FUNCTION__, Status));
+    goto Exit;
+  }
+
+  DEBUG ((DEBUG_INFO, "%a - %d knobs, %d bytes in %d chunks.\n", __FUNCTION__, KnobCount, ConfigVarListSize, ChunkCount));
+
+Exit:
+  if (Index != NULL) {
+    FreePool (Index);
+  }
+
+  if (Knobs != NULL) {
+    FreePool (Knobs);
+  }
+
+  if (BucketHash != NULL) {
+    FreePool (BucketHash);
+  }
+
+  return Status;
+}
+
+/**
+  Check that an index policy is consistent.
+
+  @param[in]  Index       The index policy.
+  @param[in]  IndexSize   Size of the index policy.
+
+  @retval     TRUE        The index can be used.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsIndexValid (
+  IN CONST OEM_CONFIG_POLICY_INDEX_HEADER  *Index,
+  IN UINTN                                 IndexSize
+  )
+{
+  CONST UINT32  *ChunkSize;
+  CONST UINT16  *Seeds;
+  UINTN         Chunk;
+  UINTN         Bucket;
+
+  // the index entries are checked as their pages are fetched
+  if ((IndexSize < sizeof (OEM_CONFIG_POLICY_INDEX_HEADER)) ||
+      (Index->Signature != OEM_CONFIG_POLICY_INDEX_SIGNATURE) ||
+      (Index->Version != OEM_CONFIG_POLICY_INDEX_VERSION) ||
+      (Index->ChunkCount > MAX_UINT16) ||
+      ((Index->BucketCount != 0) && (Index->KnobCount >= OEM_CONFIG_POLICY_INDEX_SEED_DIRECT)) ||
+      (Index->BucketCount > Index->KnobCount) ||
+      (IndexSize != OEM_CONFIG_POLICY_INDEX_SIZE (Index->ChunkCount, Index->BucketCount)))
+  {
+    return FALSE;
+  }
+
+  ChunkSize = (CONST UINT32 *)(Index + 1);
+  Seeds     = (CONST UINT16 *)(ChunkSize + Index->ChunkCount);
+  for (Chunk = 0; Chunk < Index->ChunkCount; Chunk++) {
+    if ((ChunkSize[Chunk] == 0) || (ChunkSize[Chunk] > MAX_UINT16)) {
+      return FALSE;
+    }
+  }
+
+  for (Bucket = 0; Bucket < Index->BucketCount; Bucket++) {
+    if (GetKnobSlot (0, Seeds[Bucket], Index->KnobCount) >= Index->KnobCount) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Open the config policy.
+
+  @param[out] Policy    The opened policy. Free it with OemConfigPolicyClose.
+
+  @retval EFI_SUCCESS             The policy was opened.
+  @retval EFI_INVALID_PARAMETER   Policy is NULL.
+  @retval EFI_NOT_FOUND           The config policy has not been published.
+  @retval EFI_COMPROMISED_DATA    The index policy is not valid.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyOpen (
+  OUT OEM_CONFIG_POLICY  **Policy
+  )
+{
+  EFI_STATUS                      Status;
+  OEM_CONFIG_POLICY               *NewPolicy;
+  OEM_CONFIG_POLICY_INDEX_HEADER  *Index;
+  UINT16                          IndexSize;
+
+  if (Policy == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NewPolicy = NULL;
+  Index     = NULL;
+  IndexSize = 0;
+  Status    = GetPolicy (&gOemConfigPolicyGuid, NULL, NULL, &IndexSize);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    DEBUG ((DEBUG_ERROR, "%a - Config policy not found! Status (%r)\n", __FUNCTION__, Status));
+    return EFI_NOT_FOUND;
+  }
+
+  Index = AllocatePool (IndexSize);
+  if (Index == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  Status = GetPolicy (&gOemConfigPolicyGuid, NULL, Index, &IndexSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to get config policy! Status (%r)\n", __FUNCTION__, Status));
+    Status = EFI_NOT_FOUND;
+    goto Exit;
+  }
+
+  if (!IsIndexValid (Index, IndexSize)) {
+    DEBUG ((DEBUG_ERROR, "%a - Config policy index is not valid!\n", __FUNCTION__));
+    Status = EFI_COMPROMISED_DATA;
+    goto Exit;
+  }
+
+  NewPolicy = AllocateZeroPool (sizeof (OEM_CONFIG_POLICY));
+  if (NewPolicy == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  NewPolicy->Index     = Index;
+  NewPolicy->ChunkSize = (CONST UINT32 *)(Index + 1);
+  NewPolicy->Seeds     = (CONST UINT16 *)(NewPolicy->ChunkSize + Index->ChunkCount);
+  NewPolicy->Chunks    = AllocateZeroPool (
+                           MAX (Index->ChunkCount + OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Index->KnobCount), 1) * sizeof (UINT8 *)
+                           );
+  if (NewPolicy->Chunks == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  *Policy   = NewPolicy;
+  NewPolicy = NULL;
+  Index     = NULL;
+  Status    = EFI_SUCCESS;
+
+Exit:
+  if (NewPolicy != NULL) {
+    FreePool (NewPolicy);
+  }
+
+  if (Index != NULL) {
+    FreePool (Index);
+  }
+
+  return Status;
+}
+
+/**
+  Get a chunk or index page of the config policy, fetching it from policy service on first use.
+
+  @param[in]  Policy    The policy.
+  @param[in]  Chunk     Chunk number. Index page P is chunk ChunkCount + P.
+  @param[out] Data      The chunk.
+
+  @retval EFI_SUCCESS             Data was returned.
+  @retval EFI_COMPROMISED_DATA    The chunk policy is missing or has the wrong size.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+GetChunk (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  UINTN              Chunk,
+  OUT CONST UINT8        **Data
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    ChunkGuid;
+  UINT8       *Buffer;
+  UINT32      ChunkSize;
+  UINT16      Size;
+
+  if (Policy->Chunks[Chunk] == NULL) {
+    if (Chunk < Policy->Index->ChunkCount) {
+      ChunkSize = Policy->ChunkSize[Chunk];
+    } else {
+      ChunkSize = GetIndexPageSize (Policy->Index->KnobCount, Chunk - Policy->Index->ChunkCount);
+    }
+
+    Buffer = AllocatePool (ChunkSize);
+    if (Buffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    GetChunkGuid (Chunk, &ChunkGuid);
+    Size   = (UINT16)ChunkSize;
+    Status = GetPolicy (&ChunkGuid, NULL, Buffer, &Size);
+    if (EFI_ERROR (Status) || (Size != ChunkSize)) {
+      DEBUG ((DEBUG_ERROR, "%a - Config policy chunk %d is missing or has the wrong size! Status (%r)\n", __FUNCTION__, Chunk, Status));
+      FreePool (Buffer);
+      return EFI_COMPROMISED_DATA;
+    }
+
+    Policy->Chunks[Chunk] = Buffer;
+  }
+
+  *Data = Policy->Chunks[Chunk];
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether an index entry is the given knob and return its value if it is.
+
+  @param[in]  Policy      The policy.
+  @param[in]  Slot        Index entry.
+  @param[in]  Name        Knob name.
+  @param[in]  NameSize    Size of Name in bytes, including the null terminator.
+  @param[in]  Guid        Knob vendor namespace.
+  @param[in]  CheckHash   Check hash of Name and Guid.
+  @param[out] Data        The value.
+  @param[out] DataSize    Optional size of Data in bytes.
+
+  @retval EFI_SUCCESS             The entry is the knob.
+  @retval EFI_NOT_FOUND           The entry is another knob.
+  @retval EFI_COMPROMISED_DATA    The index page or chunk policy is missing or does not match the
+                                  index.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+MatchKnob (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  UINTN              Slot,
+  IN  CONST CHAR16       *Name,
+  IN  UINTN              NameSize,
+  IN  CONST EFI_GUID     *Guid,
+  IN  UINT32             CheckHash,
+  OUT CONST VOID         **Data,
+  OUT UINT32             *DataSize OPTIONAL
+  )
+{
+  EFI_STATUS                          Status;
+  CONST OEM_CONFIG_POLICY_INDEX_KNOB  *Knob;
+  CONST CONFIG_VAR_LIST_HDR           *Header;
+  CONST UINT8                         *Page;
+  CONST UINT8                         *Chunk;
+  CONST UINT8                         *EntryName;
+  UINT32                              EntrySize;
+
+  Status = GetChunk (Policy, Policy->Index->ChunkCount + Slot / OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE, &Page);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Knob = (CONST OEM_CONFIG_POLICY_INDEX_KNOB *)Page + Slot % OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE;
+  if (Knob->NameHash != CheckHash) {
+    return EFI_NOT_FOUND;
+  }
+
+  if ((Knob->Chunk >= Policy->Index->ChunkCount) || (Knob->Offset >= Policy->ChunkSize[Knob->Chunk])) {
+    DEBUG ((DEBUG_ERROR, "%a - Config policy index entry %d is not valid!\n", __FUNCTION__, Slot));
+    return EFI_COMPROMISED_DATA;
+  }
+
+  Status = GetChunk (Policy, Knob->Chunk, &Chunk);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = GetEntrySize (&Chunk[Knob->Offset], Policy->ChunkSize[Knob->Chunk] - Knob->Offset, &EntrySize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Config policy index does not match chunk %d!\n", __FUNCTION__, Knob->Chunk));
+    return EFI_COMPROMISED_DATA;
+  }
+
+  Header    = (CONST CONFIG_VAR_LIST_HDR *)&Chunk[Knob->Offset];
+  EntryName = (CONST UINT8 *)(Header + 1);
+  if ((Header->NameSize != NameSize) ||
+      (CompareMem (EntryName, Name, NameSize) != 0) ||
+      !CompareGuid ((CONST EFI_GUID *)(EntryName + NameSize), Guid))
+  {
+    return EFI_NOT_FOUND;
+  }
+
+  *Data = EntryName + NameSize + sizeof (EFI_GUID) + sizeof (UINT32);
+  if (DataSize != NULL) {
+    *DataSize = Header->DataSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the value of a config knob.
+
+  @param[in]  Policy      The policy from OemConfigPolicyOpen.
+  @param[in]  Name        Knob name, as stored in the CONFIG_VAR_LIST entry.
+  @param[in]  Guid        Knob vendor namespace.
+  @param[out] Data        The value, owned by Policy and valid until it is closed.
+  @param[out] DataSize    Optional size of Data in bytes.
+
+  @retval EFI_SUCCESS             The value was returned.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL.
+  @retval EFI_NOT_FOUND           The policy has no such knob.
+  @retval EFI_COMPROMISED_DATA    An index page or chunk policy is missing or does not match the
+                                  index.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetKnob (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT CONST VOID         **Data,
+  OUT UINT32             *DataSize OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      BucketHash;
+  UINT32      CheckHash;
+  UINT32      KnobCount;
+  UINT32      BucketCount;
+  UINTN       NameSize;
+  UINTN       Slot;
+
+  if ((Policy == NULL) || (Name == NULL) || (Guid == NULL) || (Data == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  KnobCount   = Policy->Index->KnobCount;
+  BucketCount = Policy->Index->BucketCount;
+  if (KnobCount == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  NameSize = StrSize (Name);
+  HashKnobName (Name, NameSize, Guid, &BucketHash, &CheckHash);
+
+  if (BucketCount != 0) {
+    Slot = GetKnobSlot (CheckHash, Policy->Seeds[BucketHash % BucketCount], KnobCount);
+    return MatchKnob (Policy, Slot, Name, NameSize, Guid, CheckHash, Data, DataSize);
+  }
+
+  // no perfect hash, check every knob
+  for (Slot = 0; Slot < KnobCount; Slot++) {
+    Status = MatchKnob (Policy, Slot, Name, NameSize, Guid, CheckHash, Data, DataSize);
+    if (Status != EFI_NOT_FOUND) {
+      return Status;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Get the value of a config knob of a given size.
+
+  @param[in]  Policy      The policy from OemConfigPolicyOpen.
+  @param[in]  Name        Knob name.
+  @param[in]  Guid        Knob vendor namespace.
+  @param[out] Value       Receives the value.
+  @param[in]  ValueSize   Size of Value in bytes.
+
+  @retval EFI_SUCCESS             The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE     The knob has a different size.
+  @retval Others                  See OemConfigPolicyGetKnob.
+**/
+STATIC
+EFI_STATUS
+GetKnobOfSize (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT VOID               *Value,
+  IN  UINT32             ValueSize
+  )
+{
+  EFI_STATUS  Status;
+  CONST VOID  *Data;
+  UINT32      DataSize;
+
+  if (Value == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (DataSize != ValueSize) {
+    DEBUG ((DEBUG_ERROR, "%a - Knob %s is %d bytes, not %d!\n", __FUNCTION__, Name, DataSize, ValueSize));
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  // the value need not be aligned in the chunk
+  CopyMem (Value, Data, ValueSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the value of a BOOLEAN config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a BOOLEAN.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetBoolean (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT BOOLEAN            *Value
+  )
+{
+  return GetKnobOfSize (Policy, Name, Guid, Value, sizeof (BOOLEAN));
+}
+
+/**
+  Get the value of a UINT8 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT8.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint8 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT8              *Value
+  )
+{
+  return GetKnobOfSize (Policy, Name, Guid, Value, sizeof (UINT8));
+}
+
+/**
+  Get the value of a UINT16 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT16.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint16 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT16             *Value
+  )
+{
+  return GetKnobOfSize (Policy, Name, Guid, Value, sizeof (UINT16));
+}
+
+/**
+  Get the value of a UINT32 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT32.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint32 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT32             *Value
+  )
+{
+  return GetKnobOfSize (Policy, Name, Guid, Value, sizeof (UINT32));
+}
+
+/**
+  Get the value of a UINT64 config knob.
+
+  @param[in]  Policy    The policy from OemConfigPolicyOpen.
+  @param[in]  Name      Knob name.
+  @param[in]  Guid      Knob vendor namespace.
+  @param[out] Value     Receives the value.
+
+  @retval EFI_SUCCESS           The value was returned.
+  @retval EFI_BAD_BUFFER_SIZE   The knob is not the size of a UINT64.
+  @retval Others                See OemConfigPolicyGetKnob.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetUint64 (
+  IN  OEM_CONFIG_POLICY  *Policy,
+  IN  CONST CHAR16       *Name,
+  IN  CONST EFI_GUID     *Guid,
+  OUT UINT64             *Value
+  )
+{
+  return GetKnobOfSize (Policy, Name, Guid, Value, sizeof (UINT64));
+}
+
+/**
+  Get the digest of the config and whether it is the same as on the previous boot.
+
+  A consumer that derives its own settings from the config can cache them together with the digest,
+  and reuse them on a later boot whose digest matches instead of translating every knob again. The
+  cache should also be tagged with the version of the consumer, since its translation can change while
+  the config does not.
+
+  @param[out] Digest      Optional, receives the OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest. All zero
+                          if it could not be computed.
+  @param[out] Unchanged   Optional, receives TRUE if the config is unchanged since the previous boot.
+
+  @retval EFI_SUCCESS             The digest was returned.
+  @retval EFI_NOT_FOUND           The config metadata policy has not been published.
+  @retval EFI_COMPROMISED_DATA    The config metadata policy is not valid.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigPolicyGetDigest (
+  OUT UINT8    *Digest     OPTIONAL,
+  OUT BOOLEAN  *Unchanged  OPTIONAL
+  )
+{
+  EFI_STATUS                  Status;
+  OEM_CONFIG_METADATA_POLICY  Metadata;
+  UINT16                      MetadataSize;
+
+  MetadataSize = sizeof (Metadata);
+  Status       = GetPolicy (&gOemConfigMetadataPolicyGuid, NULL, &Metadata, &MetadataSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Config metadata policy not found! Status (%r)\n", __FUNCTION__, Status));
+    return (Status == EFI_BUFFER_TOO_SMALL) ? EFI_COMPROMISED_DATA : EFI_NOT_FOUND;
+  }
+
+  if (MetadataSize != OEM_CONFIG_METADATA_POLICY_SIZE) {
+    return EFI_COMPROMISED_DATA;
+  }
+
+  if (Digest != NULL) {
+    CopyMem (Digest, Metadata.ConfigDigest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE);
+  }
+
+  if (Unchanged != NULL) {
+    *Unchanged = Metadata.ConfigUnchanged;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Close a policy opened with OemConfigPolicyOpen and free the chunks and index pages it fetched.
+
+  @param[in]  Policy    The policy. May be NULL.
+
+**/
+VOID
+EFIAPI
+OemConfigPolicyClose (
+  IN OEM_CONFIG_POLICY  *Policy
+  )
+{
+  UINTN  Chunk;
+
+  if (Policy == NULL) {
+    return;
+  }
+
+  for (Chunk = 0; Chunk < Policy->Index->ChunkCount + OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Policy->Index->KnobCount); Chunk++) {
+    if (Policy->Chunks[Chunk] != NULL) {
+      FreePool (Policy->Chunks[Chunk]);
+    }
+  }
+
+  FreePool (Policy->Chunks);
+  FreePool (Policy->Index);
+  FreePool (Policy);
+}
@@ -0,0 +1,618 @@
+/** @file OemConfigPolicyLibUnitTest.c
+
+  Host based unit tests of OemConfigPolicyLib.
+
+  Config var lists of up to the most knobs the perfect hash allows, and of more than 1 MB, are
+  published into a host policy store and read back knob by knob. The library source is included so
+  the tests can see which chunks and index pages a lookup fetched.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../OemConfigPolicyLib.c"
+
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <HostPolicyLibHelper.h>
+
+#define UNIT_TEST_APP_NAME     "OemConfigPolicyLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define KNOB_NAME_LENGTH  16
+
+typedef struct {
+  UINT32    KnobCount;
+  UINT32    ValueSizeMod;       // Knob i has a value of 1 + i % ValueSizeMod bytes,
+  UINT32    NameCount;          // and the name of knob i % NameCount.
+} POLICY_TEST_CONTEXT;
+
+STATIC POLICY_TEST_CONTEXT  mFewKnobs        = { 10, 7, 10 };
+STATIC POLICY_TEST_CONTEXT  mOneIndexPage    = { OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE, 13, OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE };
+STATIC POLICY_TEST_CONTEXT  mBeyondOldLimit  = { 7501, 29, 7501 };
+STATIC POLICY_TEST_CONTEXT  mOverOneMegabyte = { 20000, 97, 20000 };
+STATIC POLICY_TEST_CONTEXT  mMostKnobs       = { OEM_CONFIG_POLICY_INDEX_SEED_DIRECT - 1, 1, OEM_CONFIG_POLICY_INDEX_SEED_DIRECT - 1 };
+STATIC POLICY_TEST_CONTEXT  mBeyondPerfectHash = { OEM_CONFIG_POLICY_INDEX_SEED_DIRECT + 1000, 1, OEM_CONFIG_POLICY_INDEX_SEED_DIRECT + 1000 };
+STATIC POLICY_TEST_CONTEXT  mDuplicateKnobs  = { 100, 7, 60 };
+
+STATIC EFI_GUID  mTestNamespace1 = {
+  0xaf9494f8, 0xb444, 0x47da, { 0x91, 0xe2, 0x02, 0x22, 0x92, 0xff, 0xc1, 0x7a }
+};
+
+STATIC EFI_GUID  mTestNamespace2 = {
+  0xb4c2bdaf, 0xc445, 0x4ede, { 0xbd, 0x0d, 0x0a, 0xfe, 0x5a, 0xe1, 0xd3, 0xfb }
+};
+
+STATIC UINT8   *mTestList    = NULL;
+STATIC UINT32  mTestListSize = 0;
+
+/**
+  Get the name and namespace of a knob in a test config var list.
+
+  @param[in]  Context   The list layout.
+  @param[in]  Knob      Index of the knob.
+  @param[out] Name      Receives the name, KNOB_NAME_LENGTH characters.
+  @param[out] Guid      Receives the namespace.
+
+**/
+STATIC
+VOID
+GetKnobName (
+  IN  CONST POLICY_TEST_CONTEXT  *Context,
+  IN  UINTN                      Knob,
+  OUT CHAR16                     *Name,
+  OUT CONST EFI_GUID             **Guid
+  )
+{
+  UINTN  NameIndex;
+
+  NameIndex = Knob % Context->NameCount;
+  UnicodeSPrint (Name, KNOB_NAME_LENGTH * sizeof (CHAR16), L"Knob%05d", NameIndex);
+  *Guid = (NameIndex % 2 == 0) ? &mTestNamespace1 : &mTestNamespace2;
+}
+
+/**
+  Get the value size of a knob in a test config var list.
+
+  @param[in]  Context   The list layout.
+  @param[in]  Knob      Index of the knob.
+
+  @return     The size in bytes.
+**/
+STATIC
+UINT32
+KnobValueSize (
+  IN CONST POLICY_TEST_CONTEXT  *Context,
+  IN UINTN                      Knob
+  )
+{
+  return 1 + (UINT32)(Knob % Context->ValueSizeMod);
+}
+
+/**
+  Get the value of a knob in a test config var list.
+
+  @param[in]  Knob    Index of the knob.
+  @param[in]  Index   Index of the byte in the value.
+
+  @return     The byte.
+**/
+STATIC
+UINT8
+KnobValueByte (
+  IN UINTN  Knob,
+  IN UINTN  Index
+  )
+{
+  return (UINT8)(Knob * 7 + Index);
+}
+
+/**
+  Check the value a lookup returned against the test config var list.
+
+  @param[in]  Context   The list layout.
+  @param[in]  Knob      Index of the knob.
+  @param[in]  Data      The value.
+  @param[in]  DataSize  Size of the value.
+
+  @retval     TRUE      The value is the knob's.
+  @retval     FALSE     Not.
+**/
+STATIC
+BOOLEAN
+IsKnobValue (
+  IN CONST POLICY_TEST_CONTEXT  *Context,
+  IN UINTN                      Knob,
+  IN CONST UINT8                *Data,
+  IN UINT32                     DataSize
+  )
+{
+  UINTN  Index;
+
+  if (DataSize != KnobValueSize (Context, Knob)) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < DataSize; Index++) {
+    if (Data[Index] != KnobValueByte (Knob, Index)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Count the chunks and index pages a policy has fetched.
+
+  @param[in]  Policy    The policy.
+
+  @return     The number fetched.
+**/
+STATIC
+UINTN
+CountFetchedChunks (
+  IN CONST OEM_CONFIG_POLICY  *Policy
+  )
+{
+  UINTN  Chunk;
+  UINTN  Count;
+
+  Count = 0;
+  for (Chunk = 0; Chunk < Policy->Index->ChunkCount + OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Policy->Index->KnobCount); Chunk++) {
+    if (Policy->Chunks[Chunk] != NULL) {
+      Count++;
+    }
+  }
+
+  return Count;
+}
+
+/**
+  Build the config var list of a test and empty the policy store.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED                    The list was built.
+  @retval     UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+PolicyTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT    *Layout;
+  CONFIG_VAR_LIST_ENTRY  Entry;
+  CHAR16                 Name[KNOB_NAME_LENGTH];
+  CONST EFI_GUID         *Guid;
+  UINT8                  Value[MAX_UINT8];
+  UINT32                 EntrySize;
+  UINTN                  Size;
+  UINTN                  Knob;
+  UINTN                  Index;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  HostPolicyLibReset ();
+
+  mTestListSize = 0;
+  for (Knob = 0; Knob < Layout->KnobCount; Knob++) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    if (EFI_ERROR (GetVarListSize ((UINT32)StrSize (Name), KnobValueSize (Layout, Knob), &EntrySize))) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+
+    mTestListSize += EntrySize;
+  }
+
+  mTestList = AllocatePool (mTestListSize);
+  if (mTestList == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Size = 0;
+  for (Knob = 0; Knob < Layout->KnobCount; Knob++) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    for (Index = 0; Index < KnobValueSize (Layout, Knob); Index++) {
+      Value[Index] = KnobValueByte (Knob, Index);
+    }
+
+    Entry.Name       = Name;
+    Entry.Guid       = *Guid;
+    Entry.Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+    Entry.Data       = Value;
+    Entry.DataSize   = KnobValueSize (Layout, Knob);
+    EntrySize        = mTestListSize - (UINT32)Size;
+    Index            = EntrySize;
+    if (EFI_ERROR (ConvertVariableEntryToVariableList (&Entry, mTestList + Size, &Index))) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+
+    Size += Index;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the config var list of a test and empty the policy store.
+
+  @param[in]  Context   Not used.
+**/
+STATIC
+VOID
+EFIAPI
+PolicyTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mTestList != NULL) {
+    FreePool (mTestList);
+    mTestList = NULL;
+  }
+
+  HostPolicyLibReset ();
+}
+
+/**
+  A published list is indexed by a perfect hash, a lookup fetches only the index page and chunk of
+  its knob, and every knob is found with its value.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED              Every knob was found.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+PublishedKnobsAreFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT  *Layout;
+  OEM_CONFIG_POLICY    *Policy;
+  CHAR16               Name[KNOB_NAME_LENGTH];
+  CONST EFI_GUID       *Guid;
+  CONST VOID           *Data;
+  UINT32               DataSize;
+  UINT64               Value;
+  UINTN                Knob;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyPublish (mTestList, mTestListSize));
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  UT_ASSERT_EQUAL (Policy->Index->KnobCount, Layout->KnobCount);
+  UT_ASSERT_NOT_EQUAL (Policy->Index->BucketCount, 0);
+  UT_ASSERT_EQUAL (CountFetchedChunks (Policy), 0);
+
+  GetKnobName (Layout, Layout->KnobCount - 1, Name, &Guid);
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize));
+  UT_ASSERT_EQUAL (CountFetchedChunks (Policy), 2);
+
+  for (Knob = 0; Knob < Layout->KnobCount; Knob++) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize));
+    UT_ASSERT_TRUE (IsKnobValue (Layout, Knob, Data, DataSize));
+  }
+
+  // a knob of another size is refused by the typed getters
+  GetKnobName (Layout, 0, Name, &Guid);
+  UT_ASSERT_STATUS_EQUAL (OemConfigPolicyGetUint64 (Policy, Name, Guid, &Value), EFI_BAD_BUFFER_SIZE);
+
+  UT_ASSERT_STATUS_EQUAL (OemConfigPolicyGetKnob (Policy, L"NoSuchKnob", &mTestNamespace1, &Data, &DataSize), EFI_NOT_FOUND);
+  GetKnobName (Layout, 0, Name, &Guid);
+  UT_ASSERT_STATUS_EQUAL (OemConfigPolicyGetKnob (Policy, Name, &mTestNamespace2, &Data, &DataSize), EFI_NOT_FOUND);
+
+  OemConfigPolicyClose (Policy);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A list with more knobs than the perfect hash can place is published in list order, and its knobs
+  are found by scanning. Every 97th knob and the last are looked up, since each lookup scans.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED              The knobs were found.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ManyKnobsAreScanned (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT  *Layout;
+  OEM_CONFIG_POLICY    *Policy;
+  CHAR16               Name[KNOB_NAME_LENGTH];
+  CONST EFI_GUID       *Guid;
+  CONST VOID           *Data;
+  UINT32               DataSize;
+  UINTN                Knob;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyPublish (mTestList, mTestListSize));
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  UT_ASSERT_EQUAL (Policy->Index->KnobCount, Layout->KnobCount);
+  UT_ASSERT_EQUAL (Policy->Index->BucketCount, 0);
+
+  for (Knob = 0; Knob < Layout->KnobCount; Knob += 97) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize));
+    UT_ASSERT_TRUE (IsKnobValue (Layout, Knob, Data, DataSize));
+  }
+
+  Knob = Layout->KnobCount - 1;
+  GetKnobName (Layout, Knob, Name, &Guid);
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize));
+  UT_ASSERT_TRUE (IsKnobValue (Layout, Knob, Data, DataSize));
+
+  UT_ASSERT_STATUS_EQUAL (OemConfigPolicyGetKnob (Policy, L"NoSuchKnob", &mTestNamespace1, &Data, &DataSize), EFI_NOT_FOUND);
+
+  OemConfigPolicyClose (Policy);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A list with two knobs of the same name and namespace is published in list order, and lookups
+  find the first of them.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED              Every knob was found.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DuplicateKnobsAreScanned (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT  *Layout;
+  OEM_CONFIG_POLICY    *Policy;
+  CHAR16               Name[KNOB_NAME_LENGTH];
+  CONST EFI_GUID       *Guid;
+  CONST VOID           *Data;
+  UINT32               DataSize;
+  UINTN                Knob;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyPublish (mTestList, mTestListSize));
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  UT_ASSERT_EQUAL (Policy->Index->BucketCount, 0);
+
+  for (Knob = 0; Knob < Layout->KnobCount; Knob++) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize));
+    UT_ASSERT_TRUE (IsKnobValue (Layout, Knob % Layout->NameCount, Data, DataSize));
+  }
+
+  OemConfigPolicyClose (Policy);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The perfect hash build reports two entries of the same knob as a collision before it searches
+  their bucket for a seed.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED              The duplicate entries were reported.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+DuplicateKnobsAreReported (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT           *Layout;
+  OEM_CONFIG_POLICY_INDEX_KNOB  *Knobs;
+  UINT32                        *BucketHash;
+  UINT32                        *ChunkSize;
+  UINT16                        *Seeds;
+  UINT32                        ChunkCount;
+  UINT32                        KnobCount;
+  UINT32                        BucketCount;
+  UINT32                        Collision[2];
+  UINT64                        SeedsTried;
+  EFI_STATUS                    Status;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (SplitConfigVarList (mTestList, mTestListSize, &ChunkCount, &KnobCount, NULL, NULL, NULL));
+  UT_ASSERT_EQUAL (KnobCount, Layout->KnobCount);
+
+  BucketCount = (KnobCount + OEM_CONFIG_POLICY_INDEX_KNOBS_PER_BUCKET - 1) / OEM_CONFIG_POLICY_INDEX_KNOBS_PER_BUCKET;
+  Knobs       = AllocatePool (KnobCount * sizeof (OEM_CONFIG_POLICY_INDEX_KNOB));
+  BucketHash  = AllocatePool (KnobCount * sizeof (UINT32));
+  ChunkSize   = AllocatePool (ChunkCount * sizeof (UINT32));
+  Seeds       = AllocatePool (BucketCount * sizeof (UINT16));
+  UT_ASSERT_TRUE ((Knobs != NULL) && (BucketHash != NULL) && (ChunkSize != NULL) && (Seeds != NULL));
+
+  Status = SplitConfigVarList (mTestList, mTestListSize, &ChunkCount, &KnobCount, ChunkSize, Knobs, BucketHash);
+  if (!EFI_ERROR (Status)) {
+    Status = BuildPerfectHash (Knobs, BucketHash, KnobCount, Seeds, BucketCount, Collision, &SeedsTried);
+  }
+
+  FreePool (Knobs);
+  FreePool (BucketHash);
+  FreePool (ChunkSize);
+  FreePool (Seeds);
+
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_ALREADY_STARTED);
+  UT_ASSERT_TRUE (Collision[0] < Collision[1]);
+  UT_ASSERT_EQUAL (Collision[0], Collision[1] % Layout->NameCount);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Knobs whose index page is missing are reported as compromised, and the others are still found.
+
+  @param[in]  Context   The list layout.
+
+  @retval     UNIT_TEST_PASSED              The missing page was reported.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MissingIndexPageIsCompromised (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POLICY_TEST_CONTEXT  *Layout;
+  OEM_CONFIG_POLICY    *Policy;
+  UINT8                **Saved;
+  UINT16               *SavedSize;
+  VOID                 *Index;
+  UINT16               IndexSize;
+  EFI_GUID             ChunkGuid;
+  CHAR16               Name[KNOB_NAME_LENGTH];
+  CONST EFI_GUID       *Guid;
+  CONST VOID           *Data;
+  UINT32               DataSize;
+  EFI_STATUS           Status;
+  UINTN                ChunkCount;
+  UINTN                Chunk;
+  UINTN                Knob;
+  UINTN                Found;
+  UINTN                Compromised;
+
+  Layout = (POLICY_TEST_CONTEXT *)Context;
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyPublish (mTestList, mTestListSize));
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  ChunkCount = Policy->Index->ChunkCount + OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Policy->Index->KnobCount);
+  UT_ASSERT_TRUE (OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Policy->Index->KnobCount) >= 2);
+  OemConfigPolicyClose (Policy);
+
+  // publish everything again but the first index page
+  Saved     = AllocateZeroPool (ChunkCount * sizeof (UINT8 *));
+  SavedSize = AllocateZeroPool (ChunkCount * sizeof (UINT16));
+  UT_ASSERT_NOT_NULL (Saved);
+  UT_ASSERT_NOT_NULL (SavedSize);
+  for (Chunk = 0; Chunk < ChunkCount; Chunk++) {
+    GetChunkGuid (Chunk, &ChunkGuid);
+    SavedSize[Chunk] = 0;
+    UT_ASSERT_STATUS_EQUAL (GetPolicy (&ChunkGuid, NULL, NULL, &SavedSize[Chunk]), EFI_BUFFER_TOO_SMALL);
+    Saved[Chunk] = AllocatePool (SavedSize[Chunk]);
+    UT_ASSERT_NOT_NULL (Saved[Chunk]);
+    UT_ASSERT_NOT_EFI_ERROR (GetPolicy (&ChunkGuid, NULL, Saved[Chunk], &SavedSize[Chunk]));
+  }
+
+  IndexSize = 0;
+  UT_ASSERT_STATUS_EQUAL (GetPolicy (&gOemConfigPolicyGuid, NULL, NULL, &IndexSize), EFI_BUFFER_TOO_SMALL);
+  Index = AllocatePool (IndexSize);
+  UT_ASSERT_NOT_NULL (Index);
+  UT_ASSERT_NOT_EFI_ERROR (GetPolicy (&gOemConfigPolicyGuid, NULL, Index, &IndexSize));
+
+  HostPolicyLibReset ();
+  for (Chunk = 0; Chunk < ChunkCount; Chunk++) {
+    if (Chunk != ChunkCount - OEM_CONFIG_POLICY_INDEX_PAGE_COUNT (Layout->KnobCount)) {
+      GetChunkGuid (Chunk, &ChunkGuid);
+      UT_ASSERT_NOT_EFI_ERROR (SetPolicy (&ChunkGuid, POLICY_ATTRIBUTE_FINALIZED, Saved[Chunk], SavedSize[Chunk]));
+    }
+
+    FreePool (Saved[Chunk]);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (SetPolicy (&gOemConfigPolicyGuid, POLICY_ATTRIBUTE_FINALIZED, Index, IndexSize));
+  FreePool (Index);
+  FreePool (SavedSize);
+  FreePool (Saved);
+
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  Found       = 0;
+  Compromised = 0;
+  for (Knob = 0; Knob < Layout->KnobCount; Knob++) {
+    GetKnobName (Layout, Knob, Name, &Guid);
+    Status = OemConfigPolicyGetKnob (Policy, Name, Guid, &Data, &DataSize);
+    if (Status == EFI_COMPROMISED_DATA) {
+      Compromised++;
+    } else {
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_TRUE (IsKnobValue (Layout, Knob, Data, DataSize));
+      Found++;
+    }
+  }
+
+  UT_ASSERT_EQUAL (Compromised, OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE);
+  UT_ASSERT_EQUAL (Found, Layout->KnobCount - OEM_CONFIG_POLICY_INDEX_KNOBS_PER_PAGE);
+
+  OemConfigPolicyClose (Policy);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PolicyTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PolicyTests, Framework, "Config Policy Tests", "OemPkg.OemConfigPolicyLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PolicyTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PolicyTests, "A few knobs", "FewKnobs", PublishedKnobsAreFound, PolicyTestSetup, PolicyTestCleanup, &mFewKnobs);
+  AddTestCase (PolicyTests, "One full index page", "OneIndexPage", PublishedKnobsAreFound, PolicyTestSetup, PolicyTestCleanup, &mOneIndexPage);
+  AddTestCase (PolicyTests, "More knobs than an unpaged index held", "BeyondOldLimit", PublishedKnobsAreFound, PolicyTestSetup, PolicyTestCleanup, &mBeyondOldLimit);
+  AddTestCase (PolicyTests, "More than 1 MB of knobs", "OverOneMegabyte", PublishedKnobsAreFound, PolicyTestSetup, PolicyTestCleanup, &mOverOneMegabyte);
+  AddTestCase (PolicyTests, "The most knobs the perfect hash allows", "MostKnobs", PublishedKnobsAreFound, PolicyTestSetup, PolicyTestCleanup, &mMostKnobs);
+  AddTestCase (PolicyTests, "More knobs than the perfect hash allows", "BeyondPerfectHash", ManyKnobsAreScanned, PolicyTestSetup, PolicyTestCleanup, &mBeyondPerfectHash);
+  AddTestCase (PolicyTests, "Duplicate knob names", "DuplicateKnobs", DuplicateKnobsAreScanned, PolicyTestSetup, PolicyTestCleanup, &mDuplicateKnobs);
+  AddTestCase (PolicyTests, "Duplicate knob names are reported", "DuplicateReport", DuplicateKnobsAreReported, PolicyTestSetup, PolicyTestCleanup, &mDuplicateKnobs);
+  AddTestCase (PolicyTests, "Missing index page", "MissingIndexPage", MissingIndexPageIsCompromised, PolicyTestSetup, PolicyTestCleanup, &mOverOneMegabyte);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,253 @@
+/** @file OemConfigSnapshotLib.c
+
+  Reads the config snapshot HOBs published by OemConfigPolicyCreatorPei.
+
+  The snapshot is located on first use. A snapshot that fits in one HOB is used in place, otherwise
+  its parts are copied into one buffer, once per module.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Guid/OemConfigSnapshot.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OemConfigSnapshotLib.h>
+
+STATIC CONST OEM_CONFIG_SNAPSHOT_HEADER  *mSnapshot = NULL;
+
+/**
+  Check that a snapshot is complete and that its knob table fits its values.
+
+  @param[in]  Snapshot      The snapshot.
+  @param[in]  SnapshotSize  Size of the snapshot in bytes.
+
+  @retval     TRUE          The snapshot can be used.
+  @retval     FALSE         Not.
+**/
+STATIC
+BOOLEAN
+IsSnapshotValid (
+  IN CONST OEM_CONFIG_SNAPSHOT_HEADER  *Snapshot,
+  IN UINT64                            SnapshotSize
+  )
+{
+  CONST OEM_CONFIG_SNAPSHOT_KNOB  *Knobs;
+  UINTN                           Knob;
+
+  if ((SnapshotSize < sizeof (OEM_CONFIG_SNAPSHOT_HEADER)) ||
+      (Snapshot->Signature != OEM_CONFIG_SNAPSHOT_SIGNATURE) ||
+      (Snapshot->Version != OEM_CONFIG_SNAPSHOT_VERSION) ||
+      (SnapshotSize != OEM_CONFIG_SNAPSHOT_SIZE (Snapshot->KnobCount, Snapshot->ValuesSize)))
+  {
+    return FALSE;
+  }
+
+  Knobs = (CONST OEM_CONFIG_SNAPSHOT_KNOB *)(Snapshot + 1);
+  for (Knob = 0; Knob < Snapshot->KnobCount; Knob++) {
+    if ((Knobs[Knob].ValueOffset > Snapshot->ValuesSize) ||
+        (Knobs[Knob].ValueSize > Snapshot->ValuesSize - Knobs[Knob].ValueOffset))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Get the part of the snapshot in a gOemConfigSnapshotHobGuid HOB.
+
+  The HOB data can be longer than the part, as HOB lengths are rounded up to 8 bytes.
+
+  @param[in]  GuidHob   The HOB.
+
+  @return     The part header, or NULL if the part does not fit the HOB.
+**/
+STATIC
+CONST OEM_CONFIG_SNAPSHOT_HOB *
+GetSnapshotPart (
+  IN EFI_HOB_GUID_TYPE  *GuidHob
+  )
+{
+  CONST OEM_CONFIG_SNAPSHOT_HOB  *Hob;
+
+  if (GET_GUID_HOB_DATA_SIZE (GuidHob) < sizeof (OEM_CONFIG_SNAPSHOT_HOB)) {
+    return NULL;
+  }
+
+  Hob = GET_GUID_HOB_DATA (GuidHob);
+  if ((Hob->Size == 0) || (Hob->Size > GET_GUID_HOB_DATA_SIZE (GuidHob) - sizeof (OEM_CONFIG_SNAPSHOT_HOB))) {
+    return NULL;
+  }
+
+  return Hob;
+}
+
+/**
+  Locate the snapshot, assembling it from its HOBs if it needs more than one.
+
+  @retval EFI_SUCCESS             mSnapshot is set.
+  @retval EFI_NOT_FOUND           There is no valid snapshot.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+LoadSnapshot (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE                 *GuidHob;
+  CONST OEM_CONFIG_SNAPSHOT_HOB     *Hob;
+  CONST OEM_CONFIG_SNAPSHOT_HEADER  *Header;
+  UINT8                             *Buffer;
+  UINT64                            SnapshotSize;
+  UINT64                            Offset;
+
+  if (mSnapshot != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  GuidHob = GetFirstGuidHob (&gOemConfigSnapshotHobGuid);
+  if (GuidHob == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a - Config snapshot not found.\n", __FUNCTION__));
+    return EFI_NOT_FOUND;
+  }
+
+  Hob = GetSnapshotPart (GuidHob);
+  if ((Hob == NULL) || (Hob->Offset != 0) || (Hob->Size < sizeof (OEM_CONFIG_SNAPSHOT_HEADER))) {
+    DEBUG ((DEBUG_ERROR, "%a - Config snapshot is not valid.\n", __FUNCTION__));
+    return EFI_NOT_FOUND;
+  }
+
+  Header       = (CONST OEM_CONFIG_SNAPSHOT_HEADER *)(Hob + 1);
+  SnapshotSize = OEM_CONFIG_SNAPSHOT_SIZE (Header->KnobCount, Header->ValuesSize);
+  if (SnapshotSize > MAX_UINT32) {
+    DEBUG ((DEBUG_ERROR, "%a - Config snapshot is not valid.\n", __FUNCTION__));
+    return EFI_NOT_FOUND;
+  }
+
+  if (SnapshotSize == Hob->Size) {
+    if (!IsSnapshotValid (Header, SnapshotSize)) {
+      DEBUG ((DEBUG_ERROR, "%a - Config snapshot is not valid.\n", __FUNCTION__));
+      return EFI_NOT_FOUND;
+    }
+
+    mSnapshot = Header;
+    return EFI_SUCCESS;
+  }
+
+  Buffer = AllocatePool ((UINTN)SnapshotSize);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // the parts follow each other in HOB order
+  Offset = 0;
+  while ((GuidHob != NULL) && (Offset < SnapshotSize)) {
+    Hob = GetSnapshotPart (GuidHob);
+    if ((Hob == NULL) || (Hob->Offset != Offset) || (Hob->Size > SnapshotSize - Offset)) {
+      break;
+    }
+
+    CopyMem (&Buffer[Offset], Hob + 1, Hob->Size);
+    Offset += Hob->Size;
+
+    GuidHob = GetNextGuidHob (&gOemConfigSnapshotHobGuid, GET_NEXT_HOB (GuidHob));
+  }
+
+  if ((Offset != SnapshotSize) || !IsSnapshotValid ((CONST OEM_CONFIG_SNAPSHOT_HEADER *)Buffer, SnapshotSize)) {
+    DEBUG ((DEBUG_ERROR, "%a - Config snapshot is incomplete or not valid.\n", __FUNCTION__));
+    FreePool (Buffer);
+    return EFI_NOT_FOUND;
+  }
+
+  mSnapshot = (CONST OEM_CONFIG_SNAPSHOT_HEADER *)Buffer;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the value of a config knob.
+
+  @param[in]  Knob        Index of the knob in gKnobData.
+  @param[out] Value       The value, which stays valid for the life of the module. It is not aligned.
+  @param[out] ValueSize   Optional size of Value in bytes.
+
+  @retval EFI_SUCCESS             The value was returned.
+  @retval EFI_INVALID_PARAMETER   Value is NULL or Knob is out of range.
+  @retval EFI_NOT_FOUND           There is no valid snapshot.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigSnapshotGetKnob (
+  IN  UINTN       Knob,
+  OUT CONST VOID  **Value,
+  OUT UINTN       *ValueSize OPTIONAL
+  )
+{
+  EFI_STATUS                      Status;
+  CONST OEM_CONFIG_SNAPSHOT_KNOB  *Knobs;
+
+  if (Value == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = LoadSnapshot ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Knob >= mSnapshot->KnobCount) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Knobs  = (CONST OEM_CONFIG_SNAPSHOT_KNOB *)(mSnapshot + 1);
+  *Value = (CONST UINT8 *)(Knobs + mSnapshot->KnobCount) + Knobs[Knob].ValueOffset;
+  if (ValueSize != NULL) {
+    *ValueSize = Knobs[Knob].ValueSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the digest of the snapshot content, which changes whenever a knob value does.
+
+  @param[out] Digest    Receives OEM_CONFIG_SNAPSHOT_DIGEST_SIZE bytes. All zero if PEI could not
+                        compute it.
+
+  @retval EFI_SUCCESS             The digest was returned.
+  @retval EFI_INVALID_PARAMETER   Digest is NULL.
+  @retval EFI_NOT_FOUND           There is no valid snapshot.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigSnapshotGetDigest (
+  OUT UINT8  *Digest
+  )
+{
+  EFI_STATUS  Status;
+
+  if (Digest == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = LoadSnapshot ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  CopyMem (Digest, mSnapshot->Digest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,460 @@
+/** @file OemConfigSnapshotLibUnitTest.c
+
+  Host based unit tests of OemConfigSnapshotLib.
+
+  Snapshots are published the way OemConfigPolicyCreatorPei does, into a HOB list that rounds HOB
+  lengths up to 8 bytes like the PEI core, and read back knob by knob. The library source is
+  included so each test can drop the snapshot the library cached.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../OemConfigSnapshotLib.c"
+
+#include <Library/UnitTestLib.h>
+
+#include <HostHobLibHelper.h>
+
+#define UNIT_TEST_APP_NAME     "OemConfigSnapshotLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+typedef struct {
+  UINT32    KnobCount;
+  UINT32    ValueSizeMod;       // Knob i has a value of 1 + i % ValueSizeMod bytes,
+  UINT32    LastKnobExtra;      // and the last knob this many bytes more.
+} SNAPSHOT_TEST_CONTEXT;
+
+//
+// One byte knobs that fill exactly one HOB, the remainder going to the last knob.
+//
+#define FULL_HOB_BYTES  (OEM_CONFIG_SNAPSHOT_HOB_DATA_MAX - sizeof (OEM_CONFIG_SNAPSHOT_HEADER))
+#define FULL_HOB_KNOBS  (UINT32)(FULL_HOB_BYTES / (sizeof (OEM_CONFIG_SNAPSHOT_KNOB) + 1))
+#define FULL_HOB_EXTRA  (UINT32)(FULL_HOB_BYTES % (sizeof (OEM_CONFIG_SNAPSHOT_KNOB) + 1))
+
+STATIC SNAPSHOT_TEST_CONTEXT  mOneByte       = { 1, 1, 0 };
+STATIC SNAPSHOT_TEST_CONTEXT  mFewKnobs      = { 3, 3, 0 };
+STATIC SNAPSHOT_TEST_CONTEXT  mOddKnobs      = { 37, 7, 0 };
+STATIC SNAPSHOT_TEST_CONTEXT  mExactlyAPart  = { FULL_HOB_KNOBS, 1, FULL_HOB_EXTRA };
+STATIC SNAPSHOT_TEST_CONTEXT  mOneByteBeyond = { FULL_HOB_KNOBS, 1, FULL_HOB_EXTRA + 1 };
+STATIC SNAPSHOT_TEST_CONTEXT  mTwoParts      = { 4001, 29, 0 };
+STATIC SNAPSHOT_TEST_CONTEXT  mManyParts     = { 12001, 16, 0 };
+
+STATIC OEM_CONFIG_SNAPSHOT_HEADER  *mTestSnapshot     = NULL;
+STATIC UINT32                      mTestSnapshotSize  = 0;
+STATIC UINTN                       mTestSnapshotParts = 0;
+
+/**
+  Get the value size of a knob in a test snapshot.
+
+  @param[in]  Context   The snapshot layout.
+  @param[in]  Knob      Index of the knob.
+
+  @return     The size in bytes.
+**/
+STATIC
+UINT32
+KnobValueSize (
+  IN CONST SNAPSHOT_TEST_CONTEXT  *Context,
+  IN UINTN                        Knob
+  )
+{
+  return 1 + (UINT32)(Knob % Context->ValueSizeMod) + ((Knob == Context->KnobCount - 1) ? Context->LastKnobExtra : 0);
+}
+
+/**
+  Get the value of a knob in a test snapshot.
+
+  @param[in]  Knob    Index of the knob.
+  @param[in]  Index   Index of the byte in the value.
+
+  @return     The byte.
+**/
+STATIC
+UINT8
+KnobValueByte (
+  IN UINTN  Knob,
+  IN UINTN  Index
+  )
+{
+  return (UINT8)(Knob * 7 + Index + 1);
+}
+
+/**
+  Build a test snapshot in mTestSnapshot.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     TRUE      The snapshot was built.
+  @retval     FALSE     Memory allocation failed.
+**/
+STATIC
+BOOLEAN
+BuildTestSnapshot (
+  IN CONST SNAPSHOT_TEST_CONTEXT  *Context
+  )
+{
+  OEM_CONFIG_SNAPSHOT_KNOB  *Knobs;
+  UINT8                     *Values;
+  UINT32                    ValuesSize;
+  UINTN                     Knob;
+  UINTN                     Index;
+
+  ValuesSize = 0;
+  for (Knob = 0; Knob < Context->KnobCount; Knob++) {
+    ValuesSize += KnobValueSize (Context, Knob);
+  }
+
+  mTestSnapshotSize = (UINT32)OEM_CONFIG_SNAPSHOT_SIZE (Context->KnobCount, ValuesSize);
+  mTestSnapshot     = AllocateZeroPool (mTestSnapshotSize);
+  if (mTestSnapshot == NULL) {
+    return FALSE;
+  }
+
+  mTestSnapshot->Signature  = OEM_CONFIG_SNAPSHOT_SIGNATURE;
+  mTestSnapshot->Version    = OEM_CONFIG_SNAPSHOT_VERSION;
+  mTestSnapshot->KnobCount  = Context->KnobCount;
+  mTestSnapshot->KnobHash   = 0x4B4E4F42;
+  mTestSnapshot->ValuesSize = ValuesSize;
+  SetMem (mTestSnapshot->Digest, sizeof (mTestSnapshot->Digest), 0x5A);
+
+  Knobs      = (OEM_CONFIG_SNAPSHOT_KNOB *)(mTestSnapshot + 1);
+  Values     = (UINT8 *)(Knobs + Context->KnobCount);
+  ValuesSize = 0;
+  for (Knob = 0; Knob < Context->KnobCount; Knob++) {
+    Knobs[Knob].ValueOffset = ValuesSize;
+    Knobs[Knob].ValueSize   = KnobValueSize (Context, Knob);
+    for (Index = 0; Index < Knobs[Knob].ValueSize; Index++) {
+      Values[ValuesSize++] = KnobValueByte (Knob, Index);
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Publish the test snapshot in HOBs, as OemConfigPolicyCreatorPei does.
+
+  @param[in]  PartCount   Number of parts to publish, from the first. MAX_UINTN for all.
+
+  @retval     TRUE        The HOBs were built.
+  @retval     FALSE       The HOB list is full.
+**/
+STATIC
+BOOLEAN
+PublishTestSnapshot (
+  IN UINTN  PartCount
+  )
+{
+  OEM_CONFIG_SNAPSHOT_HOB  *Hob;
+  UINT32                   Offset;
+  UINT32                   PartSize;
+
+  mTestSnapshotParts = 0;
+  for (Offset = 0; Offset < mTestSnapshotSize && mTestSnapshotParts < PartCount; Offset += PartSize) {
+    PartSize = MIN (mTestSnapshotSize - Offset, OEM_CONFIG_SNAPSHOT_HOB_DATA_MAX);
+    Hob      = BuildGuidHob (&gOemConfigSnapshotHobGuid, sizeof (OEM_CONFIG_SNAPSHOT_HOB) + PartSize);
+    if (Hob == NULL) {
+      return FALSE;
+    }
+
+    Hob->Offset = Offset;
+    Hob->Size   = PartSize;
+    CopyMem (Hob + 1, (UINT8 *)mTestSnapshot + Offset, PartSize);
+    mTestSnapshotParts++;
+  }
+
+  return TRUE;
+}
+
+/**
+  Check that every knob of the test snapshot reads back.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     UNIT_TEST_PASSED              All knobs read back.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckAllKnobs (
+  IN CONST SNAPSHOT_TEST_CONTEXT  *Context
+  )
+{
+  EFI_STATUS   Status;
+  CONST UINT8  *Value;
+  UINTN        ValueSize;
+  UINTN        Knob;
+  UINTN        Index;
+  UINT8        Digest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];
+
+  for (Knob = 0; Knob < Context->KnobCount; Knob++) {
+    Status = OemConfigSnapshotGetKnob (Knob, (CONST VOID **)&Value, &ValueSize);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (ValueSize, KnobValueSize (Context, Knob));
+    for (Index = 0; Index < ValueSize; Index++) {
+      UT_ASSERT_EQUAL (Value[Index], KnobValueByte (Knob, Index));
+    }
+  }
+
+  Status = OemConfigSnapshotGetKnob (Context->KnobCount, (CONST VOID **)&Value, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+
+  Status = OemConfigSnapshotGetDigest (Digest);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (Digest, mTestSnapshot->Digest, sizeof (Digest));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Empty the HOB list and drop the snapshot the library cached.
+
+  @param[in]  Context   The snapshot layout, or NULL.
+
+  @retval     UNIT_TEST_PASSED                    The test can run.
+  @retval     UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Memory allocation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SnapshotTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  HostHobLibReset ();
+  mSnapshot = NULL;
+
+  if ((Context != NULL) && !BuildTestSnapshot ((SNAPSHOT_TEST_CONTEXT *)Context)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test snapshot and the one the library assembled.
+
+  @param[in]  Context   Not used.
+**/
+STATIC
+VOID
+EFIAPI
+SnapshotTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if ((mSnapshot != NULL) && (mTestSnapshotParts > 1)) {
+    FreePool ((VOID *)mSnapshot);
+  }
+
+  mSnapshot = NULL;
+  if (mTestSnapshot != NULL) {
+    FreePool (mTestSnapshot);
+    mTestSnapshot = NULL;
+  }
+}
+
+/**
+  A snapshot that fits one HOB is used in place, whatever the HOB padding.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     UNIT_TEST_PASSED              The snapshot was read.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SingleHobIsUsedInPlace (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+
+  UT_ASSERT_TRUE (PublishTestSnapshot (MAX_UINTN));
+  UT_ASSERT_EQUAL (mTestSnapshotParts, 1);
+
+  UT_ASSERT_EQUAL (CheckAllKnobs ((SNAPSHOT_TEST_CONTEXT *)Context), UNIT_TEST_PASSED);
+
+  GuidHob = GetFirstGuidHob (&gOemConfigSnapshotHobGuid);
+  UT_ASSERT_NOT_NULL (GuidHob);
+  UT_ASSERT_TRUE (mSnapshot == (VOID *)((OEM_CONFIG_SNAPSHOT_HOB *)GET_GUID_HOB_DATA (GuidHob) + 1));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A snapshot in several HOBs is assembled, whatever the padding of its last HOB.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     UNIT_TEST_PASSED              The snapshot was read.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MultipleHobsAreAssembled (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_TRUE (PublishTestSnapshot (MAX_UINTN));
+  UT_ASSERT_TRUE (mTestSnapshotParts > 1);
+
+  return CheckAllKnobs ((SNAPSHOT_TEST_CONTEXT *)Context);
+}
+
+/**
+  A snapshot with its last HOB missing is not used.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     UNIT_TEST_PASSED              The snapshot was rejected.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MissingPartIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST VOID  *Value;
+
+  UT_ASSERT_TRUE (PublishTestSnapshot (MAX_UINTN));
+  UT_ASSERT_TRUE (mTestSnapshotParts > 1);
+
+  HostHobLibReset ();
+  UT_ASSERT_TRUE (PublishTestSnapshot (mTestSnapshotParts - 1));
+
+  UT_ASSERT_STATUS_EQUAL (OemConfigSnapshotGetKnob (0, &Value, NULL), EFI_NOT_FOUND);
+  mTestSnapshotParts = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A part that claims more bytes than its HOB holds is not used.
+
+  @param[in]  Context   The snapshot layout.
+
+  @retval     UNIT_TEST_PASSED              The snapshot was rejected.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+OversizedPartIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_HOB_GUID_TYPE        *GuidHob;
+  OEM_CONFIG_SNAPSHOT_HOB  *Hob;
+  CONST VOID               *Value;
+
+  UT_ASSERT_TRUE (PublishTestSnapshot (MAX_UINTN));
+
+  GuidHob = GetFirstGuidHob (&gOemConfigSnapshotHobGuid);
+  UT_ASSERT_NOT_NULL (GuidHob);
+  Hob       = GET_GUID_HOB_DATA (GuidHob);
+  Hob->Size = GET_GUID_HOB_DATA_SIZE (GuidHob) - sizeof (OEM_CONFIG_SNAPSHOT_HOB) + 1;
+
+  UT_ASSERT_STATUS_EQUAL (OemConfigSnapshotGetKnob (0, &Value, NULL), EFI_NOT_FOUND);
+  mTestSnapshotParts = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Without snapshot HOBs there is no snapshot.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              No snapshot was found.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NoHobIsNotFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST VOID  *Value;
+  UINT8       Digest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];
+
+  UT_ASSERT_STATUS_EQUAL (OemConfigSnapshotGetKnob (0, &Value, NULL), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL (OemConfigSnapshotGetDigest (Digest), EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SnapshotTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SnapshotTests, Framework, "Config Snapshot Tests", "OemPkg.OemConfigSnapshotLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SnapshotTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SnapshotTests, "One knob of one byte in one HOB", "OneByte", SingleHobIsUsedInPlace, SnapshotTestSetup, SnapshotTestCleanup, &mOneByte);
+  AddTestCase (SnapshotTests, "A few knobs in one HOB", "FewKnobs", SingleHobIsUsedInPlace, SnapshotTestSetup, SnapshotTestCleanup, &mFewKnobs);
+  AddTestCase (SnapshotTests, "Odd sized knobs in one HOB", "OddKnobs", SingleHobIsUsedInPlace, SnapshotTestSetup, SnapshotTestCleanup, &mOddKnobs);
+  AddTestCase (SnapshotTests, "A full HOB", "ExactlyAPart", SingleHobIsUsedInPlace, SnapshotTestSetup, SnapshotTestCleanup, &mExactlyAPart);
+  AddTestCase (SnapshotTests, "One byte beyond a full HOB", "OneByteBeyond", MultipleHobsAreAssembled, SnapshotTestSetup, SnapshotTestCleanup, &mOneByteBeyond);
+  AddTestCase (SnapshotTests, "Snapshot in two HOBs", "TwoParts", MultipleHobsAreAssembled, SnapshotTestSetup, SnapshotTestCleanup, &mTwoParts);
+  AddTestCase (SnapshotTests, "Snapshot in many HOBs", "ManyParts", MultipleHobsAreAssembled, SnapshotTestSetup, SnapshotTestCleanup, &mManyParts);
+  AddTestCase (SnapshotTests, "Missing last HOB", "MissingPart", MissingPartIsRejected, SnapshotTestSetup, SnapshotTestCleanup, &mManyParts);
+  AddTestCase (SnapshotTests, "Part larger than its HOB", "OversizedPart", OversizedPartIsRejected, SnapshotTestSetup, SnapshotTestCleanup, &mOddKnobs);
+  AddTestCase (SnapshotTests, "No snapshot HOB", "NoHob", NoHobIsNotFound, SnapshotTestSetup, SnapshotTestCleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
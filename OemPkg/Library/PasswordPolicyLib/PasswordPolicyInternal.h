@@ -38,20 +38,36 @@ typedef struct {
 
 #define PRIVATE_HASH_VER_1_VERSION_SIZE  sizeof(PRIVATE_HASH_VER_1)
 
+//
+// Version 2 Definitions
+//
+// The hash records its own algorithm, iteration count and key size, so the cost can be calibrated per
+// platform when the password is set and raised later without invalidating existing hashes.
+//
+#define PRIVATE_HASH_VER_2_VERSION       2
+#define PRIVATE_HASH_VER_2_SALT_SIZE     32
+#define PRIVATE_HASH_VER_2_KEY_SIZE      SHA256_DIGEST_SIZE   // One PBKDF2 block; V1's 40 bytes cost two full block chains.
+#define PRIVATE_HASH_VER_2_MAX_KEY_SIZE  64
+
+#define PRIVATE_HASH_ALGORITHM_SHA256  1
+
+typedef struct {
+  PASSWORD_HASH_HEADER    Header;
+  UINT16                  HashAlgorithm;    // PRIVATE_HASH_ALGORITHM_*
+  UINT32                  IterationCount;
+  UINT16                  KeySize;          // Bytes of Key in use.
+  UINT8                   Salt[PRIVATE_HASH_VER_2_SALT_SIZE];
+  UINT8                   Key[PRIVATE_HASH_VER_2_MAX_KEY_SIZE];
+} PRIVATE_HASH_VER_2;
+
+#define PRIVATE_HASH_VER_2_VERSION_SIZE  sizeof(PRIVATE_HASH_VER_2)
+
 #pragma pack()
 
 // Special version for Deleting a password
 #define PASSWORD_HASH_VER_DELETE       0xADDEADDE       // Version reserved for deleting a password
 #define PASSWORD_HASH_VER_DELETE_SIZE  sizeof(UINT32)
 
-//
-// Definitions for working with password tests.
-//
-typedef UINT32 PW_TEST_BITMAP;
-#define PW_TEST_STRING_NULL          (1 << 0)
-#define PW_TEST_STRING_TOO_SHORT     (1 << 1)
-#define PW_TEST_STRING_TOO_LONG      (1 << 2)
-#define PW_TEST_STRING_INVALID_CHAR  (1 << 3)
 //
 // Data Store Union - A structure large enough to hold any password store.
 //
@@ -60,6 +76,7 @@ typedef union {
   PASSWORD_HASH_DELETED    Deleted;
   PASSWORD_HASH_HEADER     Hdr;
   PRIVATE_HASH_VER_1       Ver1;
+  PRIVATE_HASH_VER_2       Ver2;
 } INTERNAL_PASSWORD_HASH;
 
 #endif
@@ -10,6 +10,7 @@
 #include <PiDxe.h>
 
 #include <Protocol/MuPkcs5PasswordHash.h>
+#include <Protocol/PasswordHashProgress.h>
 #include <Protocol/Rng.h>               // Random number generation used for SALTs.
 
 #include <Library/BaseLib.h>
@@ -18,6 +19,8 @@
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PasswordPolicyLib.h>
+#include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 
 #include "PasswordPolicyInternal.h"
@@ -28,49 +31,301 @@ typedef struct {
 } MS_PASSWORD_HASH;
 
 STATIC MS_PASSWORD_HASH  mPasswordHashVersions[] = {
-  { PRIVATE_HASH_VER_1_VERSION, sizeof (PRIVATE_HASH_VER_1) }
+  { PRIVATE_HASH_VER_1_VERSION, sizeof (PRIVATE_HASH_VER_1) },
+  { PRIVATE_HASH_VER_2_VERSION, sizeof (PRIVATE_HASH_VER_2) }
 };
 
-// A string containing all valid characters.
-STATIC CHAR16  *ValidChars = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*()?<>{}[]-_=+|.,;:'`~\"";
+// Iterations used to time the PBKDF2 engine before picking the V2 iteration count.
+#define PRIVATE_HASH_CALIBRATION_ITERATIONS  4096
+
+STATIC UINT32  mCalibratedIterationCount = 0;
+
+//
+// Character classes of the password policy. Bit N of a class map is set when ASCII character N
+// belongs to the class. A character that is in no class, or is not ASCII, is invalid.
+//
+typedef enum {
+  PwCharClassUpper,
+  PwCharClassLower,
+  PwCharClassDigit,
+  PwCharClassSymbol,
+  PwCharClassMax
+} PW_CHAR_CLASS;
+
+typedef struct {
+  UINT64            Map[2];
+  UINT8             MinCount;       // Characters of the class a password needs.
+  PW_TEST_BITMAP    MissingTest;    // Failure reported when there are fewer than MinCount.
+} PW_CHAR_CLASS_RULE;
+
+STATIC CONST PW_CHAR_CLASS_RULE  mCharClassRules[PwCharClassMax] = {
+  // A-Z
+  { { 0x0000000000000000ULL, 0x0000000007FFFFFEULL }, FixedPcdGet8 (PcdPasswordMinUppercaseCount), PW_TEST_STRING_MISSING_UPPER  },
+  // a-z
+  { { 0x0000000000000000ULL, 0x07FFFFFE00000000ULL }, FixedPcdGet8 (PcdPasswordMinLowercaseCount), PW_TEST_STRING_MISSING_LOWER  },
+  // 0-9
+  { { 0x03FF000000000000ULL, 0x0000000000000000ULL }, FixedPcdGet8 (PcdPasswordMinDigitCount),     PW_TEST_STRING_MISSING_DIGIT  },
+  // !@#$%^&*()?<>{}[]-_=+|.,;:'`~"
+  { { 0xFC007FFE00000000ULL, 0x78000001E8000001ULL }, FixedPcdGet8 (PcdPasswordMinSymbolCount),    PW_TEST_STRING_MISSING_SYMBOL }
+};
 
 STATIC MU_PKCS5_PASSWORD_HASH_PROTOCOL  *mPkcs5Protocol = NULL;
 
 /**
-  Determines whether a single character is valid.
-
-  CURRENT IMPLEMENTATION:
-    Search for character in valid char string.
-    Return TRUE if found.
+  Finds the policy class of a single character.
 
   @param[in]  Char    Character being evaluated.
 
-  @retval     TRUE    Character is valid for a password.
-  @retval     FALSE   Not.
+  @retval     The PW_CHAR_CLASS of the character, or PwCharClassMax if the character is
+              not valid for a password.
 
 **/
 STATIC
-BOOLEAN
-IsValidChar (
+UINTN
+GetCharClass (
   IN  CHAR16  Char
   )
 {
-  BOOLEAN  Result = FALSE;
-  UINTN    ValidCharsCount, Index;
+  UINTN  Class;
 
-  // Assume FALSE unless the character is found.
+  if (Char >= 128) {
+    return PwCharClassMax;
+  }
 
-  // Search all valid characters for the character in question.
-  ValidCharsCount = StrLen (ValidChars);
-  for (Index = 0; Index < ValidCharsCount; Index++) {
-    if (Char == ValidChars[Index]) {
-      Result = TRUE;
+  for (Class = 0; Class < PwCharClassMax; Class++) {
+    if ((RShiftU64 (mCharClassRules[Class].Map[Char >> 6], Char & 0x3F) & 1) != 0) {
       break;
     }
   }
 
-  return Result;
-} // IsValidChar()
+  return Class;
+} // GetCharClass()
+
+/**
+  Returns the digest size for a V2 hash algorithm identifier.
+
+  @param[in]  HashAlgorithm   PRIVATE_HASH_ALGORITHM_* value.
+
+  @retval     The digest size, or 0 if the algorithm is not supported.
+
+**/
+STATIC
+UINTN
+GetHashAlgorithmDigestSize (
+  IN  UINT16  HashAlgorithm
+  )
+{
+  switch (HashAlgorithm) {
+    case PRIVATE_HASH_ALGORITHM_SHA256:
+      return SHA256_DIGEST_SIZE;
+
+    default:
+      return 0;
+  }
+} // GetHashAlgorithmDigestSize()
+
+/**
+  Checks the parameters recorded in a V2 store. The iteration count is capped at
+  PcdPasswordHashMaxIterationCount so that a tampered store cannot make an authentication hash for hours.
+
+  @param[in]  Store   The V2 store.
+
+  @retval     TRUE    The algorithm, key size and iteration count are usable.
+  @retval     FALSE   Not.
+
+**/
+STATIC
+BOOLEAN
+IsVer2StoreValid (
+  IN  CONST PRIVATE_HASH_VER_2  *Store
+  )
+{
+  return (BOOLEAN)((GetHashAlgorithmDigestSize (Store->HashAlgorithm) != 0) &&
+                   (Store->KeySize != 0) &&
+                   (Store->KeySize <= PRIVATE_HASH_VER_2_MAX_KEY_SIZE) &&
+                   (Store->IterationCount != 0) &&
+                   (Store->IterationCount <= PcdGet32 (PcdPasswordHashMaxIterationCount)));
+} // IsVer2StoreValid()
+
+/**
+  Derives a password key with PBKDF2 through the PKCS5 password hash protocol.
+
+  @param[in]  Password        Null-terminated password.
+  @param[in]  Salt            Salt buffer.
+  @param[in]  SaltSize        Size of Salt.
+  @param[in]  IterationCount  PBKDF2 iteration count.
+  @param[in]  DigestSize      Digest size of the hash algorithm to use.
+  @param[in]  KeySize         Number of key bytes to derive.
+  @param[out] Key             Buffer receiving KeySize bytes.
+
+  @retval     EFI_SUCCESS     The key was derived.
+  @retval     EFI_ABORTED     Password was too long.
+  @retval     Others          The protocol was not found or returned an error.
+
+**/
+STATIC
+EFI_STATUS
+DerivePasswordKey (
+  IN CONST CHAR16  *Password,
+  IN CONST UINT8   *Salt,
+  IN       UINTN   SaltSize,
+  IN       UINTN   IterationCount,
+  IN       UINTN   DigestSize,
+  IN       UINTN   KeySize,
+  OUT      UINT8   *Key
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       PasswordSize;
+
+  if (mPkcs5Protocol == NULL) {
+    Status = gBS->LocateProtocol (
+                    &gMuPKCS5PasswordHashProtocolGuid,
+                    NULL,
+                    (VOID **)&mPkcs5Protocol
+                    );
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Failed to locate PKCS5 Protocol.\n", __FUNCTION__));
+      return Status;
+    }
+  }
+
+  // First, get the number of CHARs in the password.
+  PasswordSize = StrLen (Password);
+  // Now check for possible overflow.
+  if ((PasswordSize * sizeof (*Password)) < PasswordSize) {
+    DEBUG ((DEBUG_ERROR, "%a - Password is too long!\n", __FUNCTION__));
+    return EFI_ABORTED;
+  }
+
+  PasswordSize = PasswordSize * sizeof (*Password);
+
+  ZeroMem (Key, KeySize);
+  return mPkcs5Protocol->HashPassword (
+                           mPkcs5Protocol,
+                           PasswordSize,        // PasswordSize
+                           (CHAR8 *)Password,   // Password
+                           SaltSize,            // SaltSize
+                           Salt,                // Salt
+                           IterationCount,      // IterationCount
+                           DigestSize,          // DigestSize
+                           KeySize,             // OutputSize
+                           Key
+                           );                   // Output
+} // DerivePasswordKey()
+
+/**
+  Clamps and caches the V2 iteration count picked for this platform.
+
+  @param[in]  Iterations  Iteration count for the target latency.
+
+  @retval     The iteration count for new V2 stores.
+
+**/
+STATIC
+UINT32
+SetCalibratedIterationCount (
+  IN UINT64  Iterations
+  )
+{
+  Iterations = MAX (Iterations, PcdGet32 (PcdPasswordHashMinIterationCount));
+  Iterations = MIN (Iterations, PcdGet32 (PcdPasswordHashMaxIterationCount));
+  Iterations = MAX (Iterations, 1);
+
+  mCalibratedIterationCount = (UINT32)Iterations;
+  DEBUG ((DEBUG_INFO, "%a - Using %d iterations for a %dms target.\n", __FUNCTION__, mCalibratedIterationCount, PcdGet32 (PcdPasswordHashTargetLatencyMs)));
+
+  return mCalibratedIterationCount;
+} // SetCalibratedIterationCount()
+
+/**
+  Picks the V2 iteration count for this platform.
+
+  The iteration count is scaled to PcdPasswordHashTargetLatencyMs, then clamped to
+  PcdPasswordHashMinIterationCount and PcdPasswordHashMaxIterationCount. The speed is the iteration
+  rate the PasswordHashProgress protocol reports for hashes without a progress callback, since a
+  registered callback would slow a timed hash down. Without that protocol no callback can be
+  registered, and a short PBKDF2 run is timed once instead. If neither works, the V1 iteration count
+  is used.
+
+  @retval     The iteration count for new V2 stores.
+
+**/
+STATIC
+UINT32
+GetCalibratedIterationCount (
+  VOID
+  )
+{
+  EFI_STATUS                       Status;
+  PASSWORD_HASH_PROGRESS_PROTOCOL  *ProgressProtocol;
+  UINT8                            Salt[PRIVATE_HASH_VER_2_SALT_SIZE];
+  UINT8                            Key[PRIVATE_HASH_VER_2_KEY_SIZE];
+  UINT64                           CounterStart;
+  UINT64                           CounterEnd;
+  UINT64                           Start;
+  UINT64                           End;
+  UINT64                           Ticks;
+  UINT64                           ElapsedNs;
+  UINT64                           IterationsPerSecond;
+  UINT64                           Iterations;
+
+  if (mCalibratedIterationCount != 0) {
+    return mCalibratedIterationCount;
+  }
+
+  Status = gBS->LocateProtocol (&gPasswordHashProgressProtocolGuid, NULL, (VOID **)&ProgressProtocol);
+  if (!EFI_ERROR (Status)) {
+    Status = ProgressProtocol->GetIterationRate (ProgressProtocol, SHA256_DIGEST_SIZE, &IterationsPerSecond);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    return SetCalibratedIterationCount (DivU64x32 (MultU64x32 (IterationsPerSecond, PcdGet32 (PcdPasswordHashTargetLatencyMs)), 1000));
+  }
+
+  Iterations = PRIVATE_HASH_VER_1_ITERATION_COUNT;
+
+  ZeroMem (Salt, sizeof (Salt));
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  Start  = GetPerformanceCounter ();
+  Status = DerivePasswordKey (
+             L"Calibration",
+             Salt,
+             sizeof (Salt),
+             PRIVATE_HASH_CALIBRATION_ITERATIONS,
+             SHA256_DIGEST_SIZE,
+             sizeof (Key),
+             Key
+             );
+  End = GetPerformanceCounter ();
+
+  // A probe cancelled through the hash progress callback says nothing about the hash speed,
+  // so don't cache a result for it.
+  //
+  if (Status == EFI_ABORTED) {
+    return MAX (PcdGet32 (PcdPasswordHashMinIterationCount), 1);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    if (CounterEnd >= CounterStart) {
+      Ticks = (End >= Start) ? (End - Start) : ((CounterEnd - Start) + (End - CounterStart));
+    } else {
+      Ticks = (Start >= End) ? (Start - End) : ((CounterStart - End) + (Start - CounterEnd));
+    }
+
+    ElapsedNs = GetTimeInNanoSecond (Ticks);
+    if (ElapsedNs != 0) {
+      Iterations = DivU64x64Remainder (
+                     MultU64x32 (MultU64x32 (PRIVATE_HASH_CALIBRATION_ITERATIONS, PcdGet32 (PcdPasswordHashTargetLatencyMs)), 1000000),
+                     ElapsedNs,
+                     NULL
+                     );
+    }
+  }
+
+  return SetCalibratedIterationCount (Iterations);
+} // GetCalibratedIterationCount()
 
 /**
   This helper function will lookup and return the correct parameters
@@ -103,16 +358,34 @@ GetPasswordStoreParameters (
 {
   DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
 
+  //
+  // V2 stores record their own parameters. These are the ones used for new V2 stores.
+  if (Version == PRIVATE_HASH_VER_2_VERSION) {
+    if (DigestSize) {
+      *DigestSize = GetHashAlgorithmDigestSize (PRIVATE_HASH_ALGORITHM_SHA256);
+    }
+
+    if (SaltSize) {
+      *SaltSize = PRIVATE_HASH_VER_2_SALT_SIZE;
+    }
+
+    if (KeySize) {
+      *KeySize = PRIVATE_HASH_VER_2_KEY_SIZE;
+    }
+
+    if (IterationCount) {
+      *IterationCount = GetCalibratedIterationCount ();
+    }
+
+    return EFI_SUCCESS;
+  }
+
   //
   // Right off the bat, bail if we don't recognize the version.
-  // TODO: Update this test to include future versions if they're created.
   if (Version != PRIVATE_HASH_VER_1_VERSION) {
     return EFI_INVALID_PARAMETER;
   }
 
-  //
-  // For now, we only have the one version, so we can
-  // quickly return these values if requested.
   if (DigestSize) {
     *DigestSize = PRIVATE_HASH_VER_1_HASH_DIGEST_SIZE;
   }
@@ -232,7 +505,6 @@ BuildV1PasswordStore (
   UINTN       IterationCount;
   UINT8       *SaltBuffer;
   UINT8       *KeyBuffer;
-  UINTN       PasswordSize;
 
   DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
 
@@ -264,48 +536,84 @@ BuildV1PasswordStore (
     CopyMem (&Store->Ver1.Salt, OldStore->Ver1.Salt, SaltSize);
   }
 
-  if (mPkcs5Protocol == NULL) {
-    Status = gBS->LocateProtocol (
-                    &gMuPKCS5PasswordHashProtocolGuid,
-                    NULL,
-                    (VOID **)&mPkcs5Protocol
-                    );
+  //
+  // Finally, populate the key.
+  return DerivePasswordKey (Password, SaltBuffer, SaltSize, IterationCount, DigestSize, KeySize, KeyBuffer);
+} // BuildV1PasswordStore()
+
+/**
+  This function will produce a full, correctly formatted V2 password store buffer.
+
+  IMPORTANT: Password must be copied to a fresh buffer by SafeCopyPassword().
+             This function does not perform any bounds checking on the password.
 
+  @param[in]  OldStore    If present, the OldStore algorithm, iteration count, key size and salt are
+                          used. Otherwise, a new salt is generated and the current parameters are used.
+  @param[in]  Store       A pointer to an empty VER_2 hash structure to be populated.
+  @param[in]  Password    A pointer to the password buffer to be operated upon.
+
+  @retval     EFI_SUCCESS           The password store has been built.
+  @retval     EFI_INVALID_PARAMETER OldStore has unusable parameters.
+  @retval     EFI_OUT_OF_RESOURCES  There was insufficient entropy to generate the SALT.
+  @retval     EFI_ABORTED           Password was too long.
+  @retval     Others                Error was returned from Pkcs5HashPassword().
+
+**/
+STATIC
+EFI_STATUS
+BuildV2PasswordStore (
+  IN       INTERNAL_PASSWORD_HASH  *OldStore OPTIONAL,
+  IN       INTERNAL_PASSWORD_HASH  *Store,
+  IN CONST CHAR16                  *Password
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       DigestSize;
+  UINTN       SaltSize;
+  UINTN       KeySize;
+  UINTN       IterationCount;
+
+  DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
+
+  if ((Store == NULL) || (Password == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Store->Ver2.Header.Version = PRIVATE_HASH_VER_2_VERSION;
+
+  if (NULL == OldStore) {
+    Status = GetPasswordStoreParameters (PRIVATE_HASH_VER_2_VERSION, &DigestSize, &SaltSize, &KeySize, &IterationCount);
     if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a Failed to locate PKCS5 Protocol.\n", __FUNCTION__));
       return Status;
     }
-  }
 
-  // First, get the number of CHARs in the password.
-  PasswordSize = StrLen (Password);
-  // Now check for possible overflow.
-  if ((PasswordSize * sizeof (*Password)) < PasswordSize) {
-    DEBUG ((DEBUG_ERROR, "%a - Password is too long!\n", __FUNCTION__));
-    return EFI_ABORTED;
-  }
-
-  PasswordSize = PasswordSize * sizeof (*Password);
+    Store->Ver2.HashAlgorithm  = PRIVATE_HASH_ALGORITHM_SHA256;
+    Store->Ver2.IterationCount = (UINT32)IterationCount;
+    Store->Ver2.KeySize        = (UINT16)KeySize;
+    if (!GenerateSalt (Store->Ver2.Salt, SaltSize)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  } else {
+    if (!IsVer2StoreValid (&OldStore->Ver2)) {
+      return EFI_INVALID_PARAMETER;
+    }
 
-  //
-  // Finally, populate the key.
-  ZeroMem (KeyBuffer, KeySize);
-  if (!EFI_ERROR (Status) && (mPkcs5Protocol != NULL)) {
-    Status = mPkcs5Protocol->HashPassword (
-                               mPkcs5Protocol,
-                               PasswordSize,        // PasswordSize
-                               (CHAR8 *)Password,   // Password
-                               SaltSize,            // SaltSize
-                               SaltBuffer,          // Salt
-                               IterationCount,      // IterationCount
-                               DigestSize,          // DigestSize
-                               KeySize,             // OutputSize
-                               KeyBuffer
-                               );                   // Output
+    Store->Ver2.HashAlgorithm  = OldStore->Ver2.HashAlgorithm;
+    Store->Ver2.IterationCount = OldStore->Ver2.IterationCount;
+    Store->Ver2.KeySize        = OldStore->Ver2.KeySize;
+    CopyMem (Store->Ver2.Salt, OldStore->Ver2.Salt, sizeof (Store->Ver2.Salt));
   }
 
-  return Status;
-} // BuildV1PasswordStore()
+  return DerivePasswordKey (
+           Password,
+           Store->Ver2.Salt,
+           sizeof (Store->Ver2.Salt),
+           Store->Ver2.IterationCount,
+           GetHashAlgorithmDigestSize (Store->Ver2.HashAlgorithm),
+           Store->Ver2.KeySize,
+           Store->Ver2.Key
+           );
+} // BuildV2PasswordStore()
 
 /**
   Copies a password to a buffer, but will only copy the maximum
@@ -371,33 +679,35 @@ PasswordPolicyCleansePwBuffer (
 } // PasswordPolicyCleansePwBuffer()
 
 /**
-  Public interface for validating password strings.
+  Checks a password string against the length and character set rules and,
+  optionally, the class minimums.
 
-  Will evaluate all current password strength/validity requirements and
-  return a BOOLEAN for whether the password is valid. Also uses an optional
-  pointer to return a bitmap of which tests failed.
+  The string is walked once. Each character is classified against the policy
+  class maps and counted, and all tests are evaluated from the counts.
 
   NOTE: Returns FALSE on NULL strings.
 
-  @param[in]  String    CHAR16 pointer to the string that's being evaluated.
-  @param[out] Failures  [Optional] Pointer to a UINT32 that will have bits (defined
-                        in PasswordPolicyLib.h) set according to which tests may have failed.
-                        If NULL, will not return a test bitmap and will fail ASAP.
+  @param[in]  String          CHAR16 pointer to the string that's being evaluated.
+  @param[in]  ClassMinimums   TRUE to also require the class minimum counts.
+  @param[out] Failures        [Optional] Pointer to a UINT32 that will have bits (defined
+                              in PasswordPolicyLib.h) set for every test that failed.
+                              If NULL, will not return a test bitmap and will fail ASAP.
 
   @retval     TRUE      Password is valid. "Failures" should be 0.
   @retval     FALSE     Password is invalid. "Failures" will have bits set for which tests failed.
 
 **/
+STATIC
 BOOLEAN
-EFIAPI
-PasswordPolicyIsPwStringValid (
+CheckPwString (
   IN  CONST CHAR16          *String,
+  IN        BOOLEAN         ClassMinimums,
   OUT       PW_TEST_BITMAP  *Failures OPTIONAL
   )
 {
-  BOOLEAN  Result = TRUE;
-  UINTN    StringLen = 0, Index;
-  CHAR16   TempPassword[PW_MAX_LENGTH + 1];   // Maximum password length plus a NULL terminator.
+  PW_TEST_BITMAP  Tests = 0;
+  UINTN           ClassCount[PwCharClassMax + 1];   // The extra counter is for invalid characters.
+  UINTN           StringLen, Class;
 
   DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
 
@@ -416,61 +726,73 @@ PasswordPolicyIsPwStringValid (
   }
 
   //
-  // Step 1: Check for strings that are too long.
-  PasswordPolicySafeCopyPassword (
-    TempPassword,
-    ARRAY_SIZE (TempPassword),
-    String
-    );
-  if (StrCmp (String, TempPassword) != 0) {
-    if (Failures) {
-      *Failures |= PW_TEST_STRING_TOO_LONG;
+  // Step 1: Count the characters of each class in a single pass.
+  // Without a Failures parameter, we can't return any more information
+  // than a failure condition, so stop at the first invalid or excess character.
+  //
+  ZeroMem (ClassCount, sizeof (ClassCount));
+  for (StringLen = 0; String[StringLen] != L'\0'; StringLen++) {
+    Class = GetCharClass (String[StringLen]);
+    ClassCount[Class]++;
+    if ((Failures == NULL) && ((Class == PwCharClassMax) || (StringLen >= PW_MAX_LENGTH))) {
+      return FALSE;
     }
-
-    Result = FALSE;
   }
 
   //
-  // For all remaining tests, if Failures doesn't exist and
-  // we already have a failure, there's no sense checking futher.
-  // Without a Failures parameter, we can't return any more information
-  // than a failure condition.
-  //
+  // Step 2: Evaluate all of the tests from the counts.
+  if (StringLen > PW_MAX_LENGTH) {
+    Tests |= PW_TEST_STRING_TOO_LONG;
+  } else if (StringLen < PW_MIN_LENGTH) {
+    Tests |= PW_TEST_STRING_TOO_SHORT;
+  }
 
-  //
-  // Step 2: Check for strings that are too short.
-  if (Result || Failures) {
-    // Run this test if either the last test passed or we want detailed results.
-    StringLen = StrLen (TempPassword);
-    if (StringLen < PW_MIN_LENGTH) {
-      if (Failures) {
-        *Failures |= PW_TEST_STRING_TOO_SHORT;
-      }
+  if (ClassCount[PwCharClassMax] != 0) {
+    Tests |= PW_TEST_STRING_INVALID_CHAR;
+  }
 
-      Result = FALSE;
+  for (Class = 0; ClassMinimums && (Class < PwCharClassMax); Class++) {
+    if (ClassCount[Class] < mCharClassRules[Class].MinCount) {
+      Tests |= mCharClassRules[Class].MissingTest;
     }
   }
 
-  //
-  // Step 3: Make sure that the string does not contain invalid characters.
-  if (Result || Failures) {
-    // Run this test if either the last test passed or we want detailed results.
-    for (Index = 0; Index < StringLen; Index++) {
-      if (!IsValidChar (TempPassword[Index])) {
-        if (Failures) {
-          *Failures |= PW_TEST_STRING_INVALID_CHAR;
-        }
-
-        Result = FALSE;
-        break;
-      }
-    }
+  if (Failures) {
+    *Failures = Tests;
   }
 
-  // Always put away your toys.
-  PasswordPolicyCleansePwBuffer (TempPassword, sizeof (TempPassword));
+  return (BOOLEAN)(Tests == 0);
+} // CheckPwString()
 
-  return Result;
+/**
+  Public interface for validating password strings.
+
+  Will evaluate all current password strength/validity requirements and
+  return a BOOLEAN for whether the password is valid. Also uses an optional
+  pointer to return a bitmap of which tests failed.
+
+  The class minimums are requirements for new passwords. Authentication only
+  checks the length and character set, see PasswordPolicyGeneratePasswordHash.
+
+  NOTE: Returns FALSE on NULL strings.
+
+  @param[in]  String    CHAR16 pointer to the string that's being evaluated.
+  @param[out] Failures  [Optional] Pointer to a UINT32 that will have bits (defined
+                        in PasswordPolicyLib.h) set for every test that failed.
+                        If NULL, will not return a test bitmap and will fail ASAP.
+
+  @retval     TRUE      Password is valid. "Failures" should be 0.
+  @retval     FALSE     Password is invalid. "Failures" will have bits set for which tests failed.
+
+**/
+BOOLEAN
+EFIAPI
+PasswordPolicyIsPwStringValid (
+  IN  CONST CHAR16          *String,
+  OUT       PW_TEST_BITMAP  *Failures OPTIONAL
+  )
+{
+  return CheckPwString (String, TRUE, Failures);
 } // PasswordPolicyIsPwStringValid()
 
 /**
@@ -524,6 +846,13 @@ PasswordPolicyValidatePasswordHash (
     }
   }
 
+  if (!EFI_ERROR (Status) &&
+      (PwdHash->Hdr.Version == PRIVATE_HASH_VER_2_VERSION) &&
+      !IsVer2StoreValid (&PwdHash->Ver2))
+  {
+    Status = EFI_INVALID_PARAMETER;
+  }
+
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "Password store has incorrect version (0x%X). Cannot Apply new password \n", PwdHash->Hdr.Version));
   }
@@ -535,7 +864,8 @@ PasswordPolicyValidatePasswordHash (
   Public interface for generating the password hash.
 
   Will run internal checks on the password before setting it. Returns an
-  error if the password cannot be set.
+  error if the password cannot be set. The class minimums are only checked
+  for a new password (OldSalt == NULL).
 
   @param[in]  OldSalt               Pass in old PASSWORD_HASH to use the existing salt
   @param[in]  Password              Pointer to a buffer containing the clear text password.
@@ -563,14 +893,17 @@ PasswordPolicyGeneratePasswordHash (
   EFI_STATUS              Status = EFI_SUCCESS;
   INTERNAL_PASSWORD_HASH  *PwdHash;
   INTERNAL_PASSWORD_HASH  *OldStore;
+  UINT16                  Version;
+  UINTN                   StoreSize;
 
   DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
 
-  // Make sure that it's a valid password.
+  // Make sure that it's a valid password. The class minimums only apply to new passwords, so raising
+  // them does not lock out a password that was set before.
   if ((PasswordHash == NULL) ||
       (PasswordHashSize == NULL) ||
       ((Password == NULL) && (OldSalt != NULL)) || // OldSalt cannot be present if Password == NULL
-      ((Password != NULL) && !PasswordPolicyIsPwStringValid (Password, NULL)))
+      ((Password != NULL) && !CheckPwString (Password, (BOOLEAN)(OldSalt == NULL), NULL)))
   {
     Status = EFI_INVALID_PARAMETER;
     goto Exit;
@@ -591,35 +924,94 @@ PasswordPolicyGeneratePasswordHash (
 
   OldStore = (INTERNAL_PASSWORD_HASH *)OldSalt;
 
+  // New stores are always V2. An old store is rebuilt in its own version so the keys can be compared.
+  Version = PRIVATE_HASH_VER_2_VERSION;
   if (NULL != OldStore) {
-    if (OldStore->Ver1.Header.Version != PRIVATE_HASH_VER_1_VERSION) {
-      Status = EFI_INVALID_PARAMETER;   // Currently, only support V1 password hash.
+    Version = OldStore->Hdr.Version;
+    if ((Version != PRIVATE_HASH_VER_1_VERSION) && (Version != PRIVATE_HASH_VER_2_VERSION)) {
+      Status = EFI_INVALID_PARAMETER;
       goto Exit;
     }
   }
 
-  PwdHash = (INTERNAL_PASSWORD_HASH *)AllocateZeroPool (PRIVATE_HASH_VER_1_VERSION_SIZE);
+  StoreSize = (Version == PRIVATE_HASH_VER_1_VERSION) ? PRIVATE_HASH_VER_1_VERSION_SIZE : PRIVATE_HASH_VER_2_VERSION_SIZE;
+  PwdHash   = (INTERNAL_PASSWORD_HASH *)AllocateZeroPool (StoreSize);
   if (NULL == PwdHash) {
     Status = EFI_OUT_OF_RESOURCES;
     goto Exit;
   }
 
   // Now build the store.
-  Status = BuildV1PasswordStore (
-             OldStore,                             // Old Salt? (Old PwdHash has old Salt)
-             PwdHash,                              // Store
-             Password
-             );                                    // Password
+  if (Version == PRIVATE_HASH_VER_1_VERSION) {
+    Status = BuildV1PasswordStore (
+               OldStore,                             // Old Salt? (Old PwdHash has old Salt)
+               PwdHash,                              // Store
+               Password
+               );                                    // Password
+  } else {
+    Status = BuildV2PasswordStore (
+               OldStore,                             // Old parameters and Salt?
+               PwdHash,                              // Store
+               Password
+               );                                    // Password
+  }
+
   if (EFI_ERROR (Status)) {
+    ZeroMem (PwdHash, StoreSize);
+    FreePool (PwdHash);
     Status = EFI_ABORTED;
     goto Exit;
   }
 
   *PasswordHash     = &PwdHash->HashBytes;
-  *PasswordHashSize = sizeof (PRIVATE_HASH_VER_1);
+  *PasswordHashSize = StoreSize;
 
 Exit:
   DEBUG ((DEBUG_INFO, "%a: Exit. Code=%r\n", __FUNCTION__, Status));
 
   return Status;
 } // PasswordSupportGeneratePasswordHash()
+
+/**
+  Public interface for checking whether a password hash uses the current format and cost.
+
+  A caller that has just authenticated a password against PasswordHash can regenerate the
+  hash with PasswordPolicyGeneratePasswordHash (NULL, Password, ...) when this returns FALSE.
+
+  @param[in]  PasswordHash      Pointer to the buffer containing the hash.
+  @param[in]  PasswordHashSize  Size of the buffer containing the hash.
+
+  @retval     TRUE    The hash is current, is the "no password" hash, or is not a valid hash.
+  @retval     FALSE   The hash should be regenerated.
+
+**/
+BOOLEAN
+EFIAPI
+PasswordPolicyIsPasswordHashCurrent (
+  IN  CONST PASSWORD_HASH  PasswordHash,
+  IN        UINTN          PasswordHashSize
+  )
+{
+  CONST INTERNAL_PASSWORD_HASH  *PwdHash;
+
+  DEBUG ((DEBUG_INFO, "%a: Entry\n", __FUNCTION__));
+
+  if (EFI_ERROR (PasswordPolicyValidatePasswordHash (PasswordHash, PasswordHashSize))) {
+    return TRUE;
+  }
+
+  PwdHash = (INTERNAL_PASSWORD_HASH *)PasswordHash;
+  if ((PasswordHashSize >= PASSWORD_HASH_VER_DELETE_SIZE) &&
+      (PwdHash->Deleted.DeletedHash == PASSWORD_HASH_VER_DELETE))
+  {
+    return TRUE;
+  }
+
+  if (PwdHash->Hdr.Version != PRIVATE_HASH_VER_2_VERSION) {
+    return FALSE;
+  }
+
+  return (BOOLEAN)((PwdHash->Ver2.HashAlgorithm == PRIVATE_HASH_ALGORITHM_SHA256) &&
+                   (PwdHash->Ver2.KeySize == PRIVATE_HASH_VER_2_KEY_SIZE) &&
+                   (PwdHash->Ver2.IterationCount >= PcdGet32 (PcdPasswordHashMinIterationCount)));
+} // PasswordPolicyIsPasswordHashCurrent()
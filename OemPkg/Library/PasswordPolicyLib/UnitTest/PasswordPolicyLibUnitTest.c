@@ -0,0 +1,884 @@
+/** @file PasswordPolicyLibUnitTest.c
+
+  Host based fuzz test and benchmark of PasswordPolicyIsPwStringValid.
+
+  The class maps of the library are checked against the check they replaced, which searched the
+  string of valid characters below for each character of a copy of the password truncated to
+  PW_MAX_LENGTH. That check is kept here as the reference. The new check also looks for invalid
+  characters past PW_MAX_LENGTH and counts the characters of each class; the expected failures
+  add both, with the classes taken from the old string of valid characters.
+
+  Every CHAR16, the length limits and random strings are checked with and without a failure bitmap,
+  and both checks are timed over the same passwords. OemPkgHostTest.dsc builds the test twice, with
+  the class minimum PCDs at 0 and at 1. The library source is included so the reference can use its
+  copy function.
+
+  The V2 iteration count is calibrated against mock PKCS5 and PasswordHashProgress protocols. With
+  the progress protocol the count must come from its iteration rate without a timed hash, and
+  without it one timed hash must be run.
+
+  A store set before the class minimums is rebuilt from its salt the way PasswordStoreDxe
+  authenticates, which must only check the length and character set, while a new password must also
+  meet the minimums.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "../PasswordPolicyLib.c"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "PasswordPolicyLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_RANDOM_STRINGS     50000
+#define TEST_BENCHMARK_STRINGS  4096
+#define TEST_BENCHMARK_ROUNDS   16
+
+// Valid characters before the class maps, uppercase, lowercase, digits and then symbols.
+STATIC CONST CHAR16  mOldValidChars[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*()?<>{}[]-_=+|.,;:'`~\"";
+
+#define OLD_LOWER_START   26
+#define OLD_DIGIT_START   52
+#define OLD_SYMBOL_START  62
+
+#define TEST_ITERATION_RATE  40000
+
+STATIC UINT32                           mRandomState;
+STATIC UINTN                            mHashCalls;
+STATIC BOOLEAN                          mProgressInstalled;
+STATIC EFI_BOOT_SERVICES                mBootServices;
+STATIC MU_PKCS5_PASSWORD_HASH_PROTOCOL  mMockPkcs5;
+STATIC PASSWORD_HASH_PROGRESS_PROTOCOL  mMockProgress;
+STATIC EFI_RNG_PROTOCOL                 mMockRng;
+
+// Valid length and characters, but only lowercase.
+STATIC CONST CHAR16  mLowercasePassword[] = L"onlylowercase";
+
+EFI_BOOT_SERVICES  *gBS = &mBootServices;
+
+/**
+  Get the current time in nanoseconds.
+
+  @return     Nanoseconds since an arbitrary start.
+**/
+STATIC
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Get the next pseudo random number. The sequence is the same on every run.
+
+  @retval   The number.
+**/
+STATIC
+UINT32
+NextRandom (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState << 13;
+  mRandomState ^= mRandomState >> 17;
+  mRandomState ^= mRandomState << 5;
+  return mRandomState;
+}
+
+/**
+  Mock of the PKCS5 HashPassword. It counts the calls and hashes with BaseCryptLib.
+
+  @retval     EFI_SUCCESS     Output holds the key.
+  @retval     EFI_ABORTED     BaseCryptLib failed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockHashPassword (
+  IN CONST MU_PKCS5_PASSWORD_HASH_PROTOCOL  *This,
+  IN       UINTN                            PasswordSize,
+  IN CONST CHAR8                            *Password,
+  IN       UINTN                            SaltSize,
+  IN CONST UINT8                            *Salt,
+  IN       UINTN                            IterationCount,
+  IN       UINTN                            DigestSize,
+  IN       UINTN                            OutputSize,
+  OUT      UINT8                            *Output
+  )
+{
+  mHashCalls++;
+  if (!Pkcs5HashPassword (PasswordSize, Password, SaltSize, Salt, IterationCount, DigestSize, OutputSize, Output)) {
+    return EFI_ABORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Mock of the PasswordHashProgress GetIterationRate. The rate is fixed.
+
+  @retval     EFI_SUCCESS             IterationsPerSecond is TEST_ITERATION_RATE.
+  @retval     EFI_UNSUPPORTED         DigestSize is not SHA-256.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetIterationRate (
+  IN  PASSWORD_HASH_PROGRESS_PROTOCOL  *This,
+  IN  UINTN                            DigestSize,
+  OUT UINT64                           *IterationsPerSecond
+  )
+{
+  if (DigestSize != SHA256_DIGEST_SIZE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *IterationsPerSecond = TEST_ITERATION_RATE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Mock of the RNG GetRNG. The bytes come from NextRandom.
+
+  @retval     EFI_SUCCESS     RNGValue is filled.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetRng (
+  IN  EFI_RNG_PROTOCOL   *This,
+  IN  EFI_RNG_ALGORITHM  *RNGAlgorithm OPTIONAL,
+  IN  UINTN              RNGValueLength,
+  OUT UINT8              *RNGValue
+  )
+{
+  while (RNGValueLength-- > 0) {
+    *RNGValue++ = (UINT8)NextRandom ();
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Mock of LocateProtocol for the PKCS5 and RNG and, if installed, the PasswordHashProgress protocol.
+
+  @retval     EFI_SUCCESS     Interface points to the mock protocol.
+  @retval     EFI_NOT_FOUND   The protocol is not installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  if (CompareGuid (Protocol, &gMuPKCS5PasswordHashProtocolGuid)) {
+    *Interface = &mMockPkcs5;
+    return EFI_SUCCESS;
+  }
+
+  if (CompareGuid (Protocol, &gEfiRngProtocolGuid)) {
+    *Interface = &mMockRng;
+    return EFI_SUCCESS;
+  }
+
+  if (mProgressInstalled && CompareGuid (Protocol, &gPasswordHashProgressProtocolGuid)) {
+    *Interface = &mMockProgress;
+    return EFI_SUCCESS;
+  }
+
+  *Interface = NULL;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Clamp an iteration count the way the library does.
+
+  @param[in]  Iterations  Iteration count.
+
+  @retval     The clamped count.
+**/
+STATIC
+UINT64
+ClampIterations (
+  IN UINT64  Iterations
+  )
+{
+  Iterations = MAX (Iterations, PcdGet32 (PcdPasswordHashMinIterationCount));
+  Iterations = MIN (Iterations, PcdGet32 (PcdPasswordHashMaxIterationCount));
+  return MAX (Iterations, 1);
+}
+
+/**
+  Find a character in the old string of valid characters.
+
+  @param[in]  Char    Character being evaluated.
+
+  @retval     The index of the character, or the length of the string if it is not valid.
+**/
+STATIC
+UINTN
+OldValidCharIndex (
+  IN  CHAR16  Char
+  )
+{
+  UINTN  ValidCharsCount, Index;
+
+  ValidCharsCount = StrLen (mOldValidChars);
+  for (Index = 0; Index < ValidCharsCount; Index++) {
+    if (Char == mOldValidChars[Index]) {
+      break;
+    }
+  }
+
+  return Index;
+}
+
+/**
+  The password string check before the class maps.
+
+  @param[in]  String    CHAR16 pointer to the string that's being evaluated.
+  @param[out] Failures  [Optional] Receives the tests that failed.
+
+  @retval     TRUE      Password is valid.
+  @retval     FALSE     Password is invalid.
+**/
+STATIC
+BOOLEAN
+OldIsPwStringValid (
+  IN  CONST CHAR16          *String,
+  OUT       PW_TEST_BITMAP  *Failures OPTIONAL
+  )
+{
+  BOOLEAN  Result = TRUE;
+  UINTN    StringLen = 0, Index;
+  CHAR16   TempPassword[PW_MAX_LENGTH + 1];
+
+  if (Failures) {
+    *Failures = 0;
+  }
+
+  if (String == NULL) {
+    if (Failures) {
+      *Failures |= PW_TEST_STRING_NULL;
+    }
+
+    return FALSE;
+  }
+
+  PasswordPolicySafeCopyPassword (TempPassword, ARRAY_SIZE (TempPassword), String);
+  if (StrCmp (String, TempPassword) != 0) {
+    if (Failures) {
+      *Failures |= PW_TEST_STRING_TOO_LONG;
+    }
+
+    Result = FALSE;
+  }
+
+  if (Result || Failures) {
+    StringLen = StrLen (TempPassword);
+    if (StringLen < PW_MIN_LENGTH) {
+      if (Failures) {
+        *Failures |= PW_TEST_STRING_TOO_SHORT;
+      }
+
+      Result = FALSE;
+    }
+  }
+
+  if (Result || Failures) {
+    for (Index = 0; Index < StringLen; Index++) {
+      if (OldValidCharIndex (TempPassword[Index]) == StrLen (mOldValidChars)) {
+        if (Failures) {
+          *Failures |= PW_TEST_STRING_INVALID_CHAR;
+        }
+
+        Result = FALSE;
+        break;
+      }
+    }
+  }
+
+  PasswordPolicyCleansePwBuffer (TempPassword, sizeof (TempPassword));
+
+  return Result;
+}
+
+/**
+  Get the failures PasswordPolicyIsPwStringValid should report: those of the old check, an invalid
+  character past PW_MAX_LENGTH, and a class with fewer characters than its PCD requires.
+
+  @param[in]  String    The string.
+
+  @retval     The expected failures.
+**/
+STATIC
+PW_TEST_BITMAP
+ExpectedFailures (
+  IN  CONST CHAR16  *String
+  )
+{
+  PW_TEST_BITMAP  Expected;
+  UINTN           Counts[4];
+  UINTN           Index;
+  UINTN           CharIndex;
+
+  OldIsPwStringValid (String, &Expected);
+
+  ZeroMem (Counts, sizeof (Counts));
+  for (Index = 0; String[Index] != L'\0'; Index++) {
+    CharIndex = OldValidCharIndex (String[Index]);
+    if (CharIndex >= OLD_SYMBOL_START) {
+      if (CharIndex == StrLen (mOldValidChars)) {
+        if (Index >= PW_MAX_LENGTH) {
+          Expected |= PW_TEST_STRING_INVALID_CHAR;
+        }
+      } else {
+        Counts[3]++;
+      }
+    } else if (CharIndex >= OLD_DIGIT_START) {
+      Counts[2]++;
+    } else if (CharIndex >= OLD_LOWER_START) {
+      Counts[1]++;
+    } else {
+      Counts[0]++;
+    }
+  }
+
+  if (Counts[0] < FixedPcdGet8 (PcdPasswordMinUppercaseCount)) {
+    Expected |= PW_TEST_STRING_MISSING_UPPER;
+  }
+
+  if (Counts[1] < FixedPcdGet8 (PcdPasswordMinLowercaseCount)) {
+    Expected |= PW_TEST_STRING_MISSING_LOWER;
+  }
+
+  if (Counts[2] < FixedPcdGet8 (PcdPasswordMinDigitCount)) {
+    Expected |= PW_TEST_STRING_MISSING_DIGIT;
+  }
+
+  if (Counts[3] < FixedPcdGet8 (PcdPasswordMinSymbolCount)) {
+    Expected |= PW_TEST_STRING_MISSING_SYMBOL;
+  }
+
+  return Expected;
+}
+
+/**
+  Check a string with and without a failure bitmap.
+
+  @param[in]  String    The string.
+
+  @retval     TRUE      PasswordPolicyIsPwStringValid returned what was expected.
+  @retval     FALSE     Not.
+**/
+STATIC
+BOOLEAN
+CheckString (
+  IN  CONST CHAR16  *String
+  )
+{
+  PW_TEST_BITMAP  Expected;
+  PW_TEST_BITMAP  Failures;
+  BOOLEAN         Valid;
+
+  Expected = ExpectedFailures (String);
+  Valid    = PasswordPolicyIsPwStringValid (String, &Failures);
+  if ((Failures != Expected) || (Valid != (Expected == 0)) ||
+      (PasswordPolicyIsPwStringValid (String, NULL) != (Expected == 0)))
+  {
+    UT_LOG_ERROR ("String of %d characters starting with 0x%04x: failures 0x%x, expected 0x%x\n", StrLen (String), String[0], Failures, Expected);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Fill a buffer with a random string.
+
+  @param[out] String      Receives the string. Must hold MaxLength + 1 characters.
+  @param[in]  MaxLength   Longest string.
+  @param[in]  ValidOnly   Use only valid characters.
+**/
+STATIC
+VOID
+RandomString (
+  OUT CHAR16   *String,
+  IN  UINTN    MaxLength,
+  IN  BOOLEAN  ValidOnly
+  )
+{
+  UINTN   Length;
+  UINTN   Index;
+  UINT32  Random;
+
+  Length = NextRandom () % (MaxLength + 1);
+  for (Index = 0; Index < Length; Index++) {
+    Random = NextRandom ();
+    if (ValidOnly || ((Random & 0xF) > 1)) {
+      String[Index] = mOldValidChars[(Random >> 8) % StrLen (mOldValidChars)];
+    } else if ((Random & 0xF) == 1) {
+      String[Index] = (CHAR16)(1 + (Random >> 8) % 0x7F);
+    } else {
+      String[Index] = (CHAR16)(1 + (Random >> 8) % 0xFFFF);
+    }
+  }
+
+  String[Length] = L'\0';
+}
+
+/**
+  A NULL string fails with PW_TEST_STRING_NULL only.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NullString (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PW_TEST_BITMAP  Failures;
+
+  UT_ASSERT_FALSE (PasswordPolicyIsPwStringValid (NULL, &Failures));
+  UT_ASSERT_EQUAL (Failures, PW_TEST_STRING_NULL);
+  UT_ASSERT_FALSE (PasswordPolicyIsPwStringValid (NULL, NULL));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Every CHAR16 is valid or invalid exactly as it was, in a password of every class and in a password
+  made only of that character.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+EveryCharacter (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  Mixed[]  = L"Aa1!Bb2@";
+  CHAR16  Single[PW_MIN_LENGTH + 1];
+  UINTN   Char;
+  UINTN   Index;
+
+  for (Char = 1; Char <= MAX_UINT16; Char++) {
+    Mixed[2] = (CHAR16)Char;
+    UT_ASSERT_TRUE (CheckString (Mixed));
+
+    for (Index = 0; Index < PW_MIN_LENGTH; Index++) {
+      Single[Index] = (CHAR16)Char;
+    }
+
+    Single[PW_MIN_LENGTH] = L'\0';
+    UT_ASSERT_TRUE (CheckString (Single));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Strings at and around PW_MIN_LENGTH and PW_MAX_LENGTH, with an invalid character before and past
+  PW_MAX_LENGTH.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+LengthLimits (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST UINTN  Lengths[] = { 0, 1, PW_MIN_LENGTH - 1, PW_MIN_LENGTH, PW_MAX_LENGTH - 1, PW_MAX_LENGTH, PW_MAX_LENGTH + 1, PW_MAX_LENGTH + 8 };
+  CHAR16       String[PW_MAX_LENGTH + 9];
+  UINTN        Length;
+  UINTN        Index;
+
+  for (Length = 0; Length < ARRAY_SIZE (Lengths); Length++) {
+    for (Index = 0; Index < Lengths[Length]; Index++) {
+      String[Index] = mOldValidChars[Index % StrLen (mOldValidChars)];
+    }
+
+    String[Lengths[Length]] = L'\0';
+    UT_ASSERT_TRUE (CheckString (String));
+
+    if (Lengths[Length] != 0) {
+      String[Lengths[Length] - 1] = L' ';
+      UT_ASSERT_TRUE (CheckString (String));
+    }
+
+    if (Lengths[Length] > PW_MAX_LENGTH) {
+      String[Lengths[Length] - 1] = L'A';
+      String[PW_MAX_LENGTH]       = 0x00E9;
+      UT_ASSERT_TRUE (CheckString (String));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random strings up to 8 characters past PW_MAX_LENGTH, half of them made only of valid characters.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RandomStrings (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  String[PW_MAX_LENGTH + 9];
+  UINTN   Index;
+  UINTN   ValidCount;
+
+  mRandomState = 0x2545F491;
+  ValidCount   = 0;
+  for (Index = 0; Index < TEST_RANDOM_STRINGS; Index++) {
+    RandomString (String, PW_MAX_LENGTH + 8, (BOOLEAN)((Index & 1) == 0));
+    UT_ASSERT_TRUE (CheckString (String));
+    if (PasswordPolicyIsPwStringValid (String, NULL)) {
+      ValidCount++;
+    }
+  }
+
+  UT_LOG_INFO ("%d random strings, %d valid\n", TEST_RANDOM_STRINGS, ValidCount);
+  UT_ASSERT_NOT_EQUAL (ValidCount, 0);
+  UT_ASSERT_NOT_EQUAL (ValidCount, TEST_RANDOM_STRINGS);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Time the old and the new check over the same valid passwords of PW_MIN_LENGTH to 64 characters.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Benchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16          *Strings;
+  PW_TEST_BITMAP  Failures;
+  UINTN           Index;
+  UINTN           Round;
+  UINTN           OldValid;
+  UINTN           NewValid;
+  UINT64          Start;
+  UINT64          OldNanoseconds;
+  UINT64          NewNanoseconds;
+
+  Strings = AllocatePool (TEST_BENCHMARK_STRINGS * 65 * sizeof (CHAR16));
+  UT_ASSERT_NOT_NULL (Strings);
+
+  mRandomState = 0x9E3779B9;
+  for (Index = 0; Index < TEST_BENCHMARK_STRINGS; Index++) {
+    do {
+      RandomString (&Strings[Index * 65], 64, TRUE);
+    } while (StrLen (&Strings[Index * 65]) < PW_MIN_LENGTH);
+  }
+
+  OldValid = 0;
+  Start    = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    for (Index = 0; Index < TEST_BENCHMARK_STRINGS; Index++) {
+      OldValid += OldIsPwStringValid (&Strings[Index * 65], &Failures);
+    }
+  }
+
+  OldNanoseconds = GetNanoseconds () - Start;
+
+  NewValid = 0;
+  Start    = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    for (Index = 0; Index < TEST_BENCHMARK_STRINGS; Index++) {
+      NewValid += PasswordPolicyIsPwStringValid (&Strings[Index * 65], &Failures);
+    }
+  }
+
+  NewNanoseconds = GetNanoseconds () - Start;
+  FreePool (Strings);
+
+  UT_LOG_INFO (
+    "%d checks: old %ld ns, new %ld ns per password\n",
+    TEST_BENCHMARK_STRINGS * TEST_BENCHMARK_ROUNDS,
+    DivU64x32 (OldNanoseconds, TEST_BENCHMARK_STRINGS * TEST_BENCHMARK_ROUNDS),
+    DivU64x32 (NewNanoseconds, TEST_BENCHMARK_STRINGS * TEST_BENCHMARK_ROUNDS)
+    );
+
+  UT_ASSERT_EQUAL (OldValid, TEST_BENCHMARK_STRINGS * TEST_BENCHMARK_ROUNDS);
+  if ((FixedPcdGet8 (PcdPasswordMinUppercaseCount) == 0) && (FixedPcdGet8 (PcdPasswordMinLowercaseCount) == 0) &&
+      (FixedPcdGet8 (PcdPasswordMinDigitCount) == 0) && (FixedPcdGet8 (PcdPasswordMinSymbolCount) == 0))
+  {
+    UT_ASSERT_EQUAL (NewValid, OldValid);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reset the mock protocols and the calibration of the library.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED    The mocks are reset.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MockProtocolSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mBootServices.LocateProtocol   = MockLocateProtocol;
+  mMockPkcs5.HashPassword        = MockHashPassword;
+  mMockProgress.Register         = NULL;
+  mMockProgress.GetIterationRate = MockGetIterationRate;
+  mMockRng.GetInfo               = NULL;
+  mMockRng.GetRNG                = MockGetRng;
+  mPkcs5Protocol                 = NULL;
+  mCalibratedIterationCount      = 0;
+  mHashCalls                     = 0;
+  mProgressInstalled             = FALSE;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The iteration count comes from the rate of the progress protocol, without a timed hash.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CalibrateFromRate (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Expected;
+
+  mProgressInstalled = TRUE;
+  Expected           = ClampIterations (DivU64x32 (MultU64x32 (TEST_ITERATION_RATE, PcdGet32 (PcdPasswordHashTargetLatencyMs)), 1000));
+
+  UT_ASSERT_EQUAL (GetCalibratedIterationCount (), Expected);
+  UT_ASSERT_EQUAL (mHashCalls, 0);
+
+  // The count is cached.
+  mProgressInstalled = FALSE;
+  UT_ASSERT_EQUAL (GetCalibratedIterationCount (), Expected);
+  UT_ASSERT_EQUAL (mHashCalls, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Without the progress protocol one hash is timed.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CalibrateTimed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT32  Iterations;
+
+  Iterations = GetCalibratedIterationCount ();
+  UT_LOG_INFO ("Timed calibration picked %d iterations\n", Iterations);
+
+  UT_ASSERT_EQUAL (mHashCalls, 1);
+  UT_ASSERT_EQUAL (Iterations, ClampIterations (Iterations));
+
+  UT_ASSERT_EQUAL (GetCalibratedIterationCount (), Iterations);
+  UT_ASSERT_EQUAL (mHashCalls, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A password set before the class minimums still authenticates, but cannot be set again while the
+  minimums reject it. Authentication still checks the length and character set.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ClassMinimumsOnNewPasswords (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS              Status;
+  INTERNAL_PASSWORD_HASH  Store;
+  PASSWORD_HASH           Hash;
+  UINTN                   HashSize;
+  PW_TEST_BITMAP          Failures;
+  BOOLEAN                 Same;
+
+  mCalibratedIterationCount = MAX (PcdGet32 (PcdPasswordHashMinIterationCount), 1);
+  mRandomState              = 0x2545F491;
+
+  // the store of a password set before the minimums were raised
+  ZeroMem (&Store, sizeof (Store));
+  UT_ASSERT_NOT_EFI_ERROR (BuildV2PasswordStore (NULL, &Store, mLowercasePassword));
+
+  PasswordPolicyIsPwStringValid (mLowercasePassword, &Failures);
+  UT_ASSERT_EQUAL (Failures & (PW_TEST_STRING_TOO_SHORT | PW_TEST_STRING_TOO_LONG | PW_TEST_STRING_INVALID_CHAR), 0);
+
+  // setting it again is up to the minimums
+  Status = PasswordPolicyGeneratePasswordHash (NULL, mLowercasePassword, &Hash, &HashSize);
+  if (!EFI_ERROR (Status)) {
+    FreePool (Hash);
+  }
+
+  if (Failures != 0) {
+    UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  } else {
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // authenticating it is not
+  Status = PasswordPolicyGeneratePasswordHash ((PASSWORD_HASH)&Store, mLowercasePassword, &Hash, &HashSize);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Same = (HashSize == PRIVATE_HASH_VER_2_VERSION_SIZE) && (CompareMem (Hash, &Store, HashSize) == 0);
+  FreePool (Hash);
+  UT_ASSERT_TRUE (Same);
+
+  // but the length and the character set are
+  UT_ASSERT_STATUS_EQUAL (PasswordPolicyGeneratePasswordHash ((PASSWORD_HASH)&Store, L"short", &Hash, &HashSize), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (PasswordPolicyGeneratePasswordHash ((PASSWORD_HASH)&Store, L"tab\there", &Hash, &HashSize), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      StringTests;
+  UNIT_TEST_SUITE_HANDLE      CalibrationTests;
+  UNIT_TEST_SUITE_HANDLE      HashTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&StringTests, Framework, "Password String Tests", "OemPkg.PasswordPolicyLib.String", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for StringTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (StringTests, "A NULL string is invalid", "Null", NullString, NULL, NULL, NULL);
+  AddTestCase (StringTests, "Every character is checked like the old character set", "EveryChar", EveryCharacter, NULL, NULL, NULL);
+  AddTestCase (StringTests, "Strings around the length limits", "Length", LengthLimits, NULL, NULL, NULL);
+  AddTestCase (StringTests, "Random strings match the old check", "Random", RandomStrings, NULL, NULL, NULL);
+  AddTestCase (StringTests, "The old and the new check are timed", "Benchmark", Benchmark, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&CalibrationTests, Framework, "Iteration Count Calibration Tests", "OemPkg.PasswordPolicyLib.Calibration", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CalibrationTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (CalibrationTests, "The count comes from the reported iteration rate", "Rate", CalibrateFromRate, MockProtocolSetup, NULL, NULL);
+  AddTestCase (CalibrationTests, "Without a reported rate one hash is timed", "Timed", CalibrateTimed, MockProtocolSetup, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&HashTests, Framework, "Password Hash Tests", "OemPkg.PasswordPolicyLib.Hash", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HashTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (HashTests, "Class minimums only apply to new passwords", "ClassMinimums", ClassMinimumsOnNewPasswords, MockProtocolSetup, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -138,3 +138,22 @@ PasswordPolicyGeneratePasswordHash (
 {
   return EFI_UNSUPPORTED;
 } // PasswordSupportGeneratePasswordHash()
+
+/**
+  Public interface for checking whether a password hash uses the current format and cost.
+
+  @param[in]  PasswordHash      Pointer to the buffer containing the hash.
+  @param[in]  PasswordHashSize  Size of the buffer containing the hash.
+
+  @retval     TRUE    Always. There is nothing to regenerate.
+
+**/
+BOOLEAN
+EFIAPI
+PasswordPolicyIsPasswordHashCurrent (
+  IN  CONST PASSWORD_HASH  PasswordHash,
+  IN        UINTN          PasswordHashSize
+  )
+{
+  return TRUE;
+} // PasswordPolicyIsPasswordHashCurrent()
@@ -0,0 +1,543 @@
+/** @file SmbiosStringIndexLib.c
+
+  Indexed access to SMBIOS records and their strings.
+
+  The SMBIOS protocol is walked once to build a per-type record list and a string table for every
+  record. The index is dropped when SmbiosDxe republishes the SMBIOS configuration table, which it
+  does on every record add and remove, and rebuilt on the next query.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Guid/SmBios.h>
+#include <Protocol/Smbios.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SmbiosStringIndexLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#define SMBIOS_TYPE_COUNT          (MAX_UINT8 + 1)
+#define SMBIOS_INDEX_INITIAL_SIZE  64
+
+typedef struct {
+  CONST CHAR8    *Ascii;    // View into the SMBIOS record
+  UINTN          Size;      // Size of Ascii in bytes, including the null terminator
+  CHAR16         *Unicode;  // Cached conversion, allocated on first request
+} SMBIOS_INDEXED_STRING;
+
+typedef struct {
+  CONST SMBIOS_STRUCTURE    *Header;
+  SMBIOS_INDEXED_STRING     *Strings;
+  UINTN                     StringCount;
+} SMBIOS_INDEXED_RECORD;
+
+STATIC EFI_SMBIOS_PROTOCOL    *mSmbios           = NULL;
+STATIC BOOLEAN                mIndexValid        = FALSE;
+STATIC SMBIOS_INDEXED_RECORD  *mRecords          = NULL;
+STATIC SMBIOS_INDEXED_STRING  *mStrings          = NULL;
+STATIC UINTN                  mStringCount       = 0;
+STATIC EFI_EVENT              mSmbiosTableEvent  = NULL;
+STATIC EFI_EVENT              mSmbios3TableEvent = NULL;
+
+//
+// Records are grouped by type: the records of type T are mRecords[mTypeFirst[T]] up to, but not
+// including, mRecords[mTypeFirst[T + 1]], in SMBIOS protocol enumeration order.
+//
+STATIC UINTN  mTypeFirst[SMBIOS_TYPE_COUNT + 1];
+
+STATIC CONST CHAR16  mEmptyUnicodeString[] = L"";
+
+/**
+  Count the strings in the string set that follows a record's formatted area.
+
+  @param[in]  Header    SMBIOS record.
+
+  @retval  Number of strings in the record.
+
+**/
+STATIC
+UINTN
+CountRecordStrings (
+  IN CONST SMBIOS_STRUCTURE  *Header
+  )
+{
+  CONST CHAR8  *String;
+  UINTN        Count;
+
+  //
+  // A record without strings is followed by two null bytes, so the first string is empty.
+  //
+  String = (CONST CHAR8 *)Header + Header->Length;
+  Count  = 0;
+  while (*String != '\0') {
+    String += AsciiStrSize (String);
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Release the index and every cached string conversion.
+
+**/
+STATIC
+VOID
+FreeIndex (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if (mStrings != NULL) {
+    for (Index = 0; Index < mStringCount; Index++) {
+      if (mStrings[Index].Unicode != NULL) {
+        FreePool (mStrings[Index].Unicode);
+      }
+    }
+
+    FreePool (mStrings);
+    mStrings = NULL;
+  }
+
+  if (mRecords != NULL) {
+    FreePool (mRecords);
+    mRecords = NULL;
+  }
+
+  mStringCount = 0;
+  ZeroMem (mTypeFirst, sizeof (mTypeFirst));
+  mIndexValid = FALSE;
+}
+
+/**
+  Walk the SMBIOS protocol once and build the record and string index.
+
+  @retval EFI_SUCCESS             The index was built.
+  @retval EFI_OUT_OF_RESOURCES    The index could not be allocated.
+  @retval Others                  The SMBIOS protocol is not available.
+
+**/
+STATIC
+EFI_STATUS
+BuildIndex (
+  VOID
+  )
+{
+  EFI_STATUS               Status;
+  EFI_SMBIOS_HANDLE        SmbiosHandle;
+  EFI_SMBIOS_TABLE_HEADER  *Record;
+  CONST SMBIOS_STRUCTURE   **Headers;
+  CONST SMBIOS_STRUCTURE   **NewHeaders;
+  UINTN                    HeaderCount;
+  UINTN                    HeaderCapacity;
+  UINTN                    NextSlot[SMBIOS_TYPE_COUNT];
+  UINTN                    Index;
+  UINTN                    Slot;
+  UINTN                    StringIndex;
+  UINTN                    StringNumber;
+  CONST CHAR8              *String;
+  SMBIOS_INDEXED_RECORD    *Indexed;
+
+  if (mSmbios == NULL) {
+    Status = gBS->LocateProtocol (&gEfiSmbiosProtocolGuid, NULL, (VOID **)&mSmbios);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Could not locate SMBIOS protocol.  %r\n", __FUNCTION__, Status));
+      mSmbios = NULL;
+      return Status;
+    }
+  }
+
+  FreeIndex ();
+
+  HeaderCapacity = SMBIOS_INDEX_INITIAL_SIZE;
+  HeaderCount    = 0;
+  Headers        = AllocatePool (HeaderCapacity * sizeof (*Headers));
+  if (Headers == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // One pass over the protocol: remember every record and count records per type and strings.
+  //
+  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;
+  while (!EFI_ERROR (mSmbios->GetNext (mSmbios, &SmbiosHandle, NULL, &Record, NULL))) {
+    if (HeaderCount == HeaderCapacity) {
+      NewHeaders = ReallocatePool (
+                     HeaderCapacity * sizeof (*Headers),
+                     HeaderCapacity * 2 * sizeof (*Headers),
+                     (VOID *)Headers
+                     );
+      if (NewHeaders == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto Exit;
+      }
+
+      Headers         = NewHeaders;
+      HeaderCapacity *= 2;
+    }
+
+    Headers[HeaderCount++] = (CONST SMBIOS_STRUCTURE *)Record;
+    mTypeFirst[Record->Type + 1]++;
+    mStringCount += CountRecordStrings ((CONST SMBIOS_STRUCTURE *)Record);
+  }
+
+  if (HeaderCount == 0) {
+    Status = EFI_SUCCESS;
+    goto Exit;
+  }
+
+  mRecords = AllocateZeroPool (HeaderCount * sizeof (SMBIOS_INDEXED_RECORD));
+  if (mRecords == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  if (mStringCount > 0) {
+    mStrings = AllocateZeroPool (mStringCount * sizeof (SMBIOS_INDEXED_STRING));
+    if (mStrings == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+  }
+
+  //
+  // Turn the per-type counts into start offsets, then place every record in its type group.
+  //
+  for (Index = 1; Index <= SMBIOS_TYPE_COUNT; Index++) {
+    mTypeFirst[Index] += mTypeFirst[Index - 1];
+  }
+
+  CopyMem (NextSlot, mTypeFirst, sizeof (NextSlot));
+
+  StringIndex = 0;
+  for (Index = 0; Index < HeaderCount; Index++) {
+    Slot             = NextSlot[Headers[Index]->Type]++;
+    Indexed          = &mRecords[Slot];
+    Indexed->Header  = Headers[Index];
+    Indexed->Strings = (mStrings != NULL) ? &mStrings[StringIndex] : NULL;
+
+    String = (CONST CHAR8 *)Headers[Index] + Headers[Index]->Length;
+    for (StringNumber = 0; *String != '\0'; StringNumber++) {
+      mStrings[StringIndex].Ascii = String;
+      mStrings[StringIndex].Size  = AsciiStrSize (String);
+      String                     += mStrings[StringIndex].Size;
+      StringIndex++;
+    }
+
+    Indexed->StringCount = StringNumber;
+  }
+
+  ASSERT (StringIndex == mStringCount);
+  Status = EFI_SUCCESS;
+
+Exit:
+  FreePool ((VOID *)Headers);
+  if (EFI_ERROR (Status)) {
+    FreeIndex ();
+  } else {
+    mIndexValid = TRUE;
+  }
+
+  return Status;
+}
+
+/**
+  Find an indexed record, building the index first if the SMBIOS table changed.
+
+  @param[in]  Type        SMBIOS structure type.
+  @param[in]  Instance    Zero-based instance of that type.
+  @param[out] Indexed     The indexed record.
+
+  @retval EFI_SUCCESS     The record was found.
+  @retval EFI_NOT_FOUND   There is no such record.
+  @retval Others          The SMBIOS table could not be indexed.
+
+**/
+STATIC
+EFI_STATUS
+FindIndexedRecord (
+  IN  SMBIOS_TYPE            Type,
+  IN  UINTN                  Instance,
+  OUT SMBIOS_INDEXED_RECORD  **Indexed
+  )
+{
+  EFI_STATUS  Status;
+
+  if (!mIndexValid) {
+    Status = BuildIndex ();
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (Instance >= (mTypeFirst[Type + 1] - mTypeFirst[Type])) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Indexed = &mRecords[mTypeFirst[Type] + Instance];
+  return EFI_SUCCESS;
+}
+
+/**
+  Get a record of the given type.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type, in SMBIOS protocol enumeration order.
+  @param[out] Record        The record.
+
+  @retval EFI_SUCCESS             Record was returned.
+  @retval EFI_NOT_FOUND           There is no such record.
+  @retval EFI_INVALID_PARAMETER   Record is NULL.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetRecord (
+  IN  SMBIOS_TYPE             Type,
+  IN  UINTN                   Instance,
+  OUT CONST SMBIOS_STRUCTURE  **Record
+  )
+{
+  EFI_STATUS             Status;
+  SMBIOS_INDEXED_RECORD  *Indexed;
+
+  if (Record == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = FindIndexedRecord (Type, Instance, &Indexed);
+  if (!EFI_ERROR (Status)) {
+    *Record = Indexed->Header;
+  }
+
+  return Status;
+}
+
+/**
+  Get a zero-copy view of a record string.
+
+  String number 0 means "no string" in SMBIOS; it returns an empty string.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type.
+  @param[in]  StringNumber  One-based string number, as stored in the record's string fields.
+  @param[out] String        Null-terminated ASCII string inside the SMBIOS record.
+  @param[out] Size          Optional size of String in bytes, including the null terminator.
+
+  @retval EFI_SUCCESS             String was returned.
+  @retval EFI_NOT_FOUND           There is no such record or string.
+  @retval EFI_INVALID_PARAMETER   String is NULL.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetString (
+  IN  SMBIOS_TYPE          Type,
+  IN  UINTN                Instance,
+  IN  SMBIOS_TABLE_STRING  StringNumber,
+  OUT CONST CHAR8          **String,
+  OUT UINTN                *Size OPTIONAL
+  )
+{
+  EFI_STATUS             Status;
+  SMBIOS_INDEXED_RECORD  *Indexed;
+
+  if (String == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = FindIndexedRecord (Type, Instance, &Indexed);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (StringNumber == 0) {
+    *String = "";
+    if (Size != NULL) {
+      *Size = sizeof (CHAR8);
+    }
+
+    return EFI_SUCCESS;
+  }
+
+  if (StringNumber > Indexed->StringCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  *String = Indexed->Strings[StringNumber - 1].Ascii;
+  if (Size != NULL) {
+    *Size = Indexed->Strings[StringNumber - 1].Size;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get a UCS-2 copy of a record string. The conversion is done on the first request and cached.
+
+  String number 0 means "no string" in SMBIOS; it returns an empty string.
+
+  @param[in]  Type          SMBIOS structure type.
+  @param[in]  Instance      Zero-based instance of that type.
+  @param[in]  StringNumber  One-based string number, as stored in the record's string fields.
+  @param[out] String        Null-terminated UCS-2 string owned by the library.
+
+  @retval EFI_SUCCESS             String was returned.
+  @retval EFI_NOT_FOUND           There is no such record or string.
+  @retval EFI_INVALID_PARAMETER   String is NULL.
+  @retval EFI_OUT_OF_RESOURCES    The converted copy could not be allocated.
+  @retval Others                  The SMBIOS table could not be indexed.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosIndexGetUnicodeString (
+  IN  SMBIOS_TYPE          Type,
+  IN  UINTN                Instance,
+  IN  SMBIOS_TABLE_STRING  StringNumber,
+  OUT CONST CHAR16         **String
+  )
+{
+  EFI_STATUS             Status;
+  SMBIOS_INDEXED_RECORD  *Indexed;
+  SMBIOS_INDEXED_STRING  *Entry;
+
+  if (String == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = FindIndexedRecord (Type, Instance, &Indexed);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (StringNumber == 0) {
+    *String = mEmptyUnicodeString;
+    return EFI_SUCCESS;
+  }
+
+  if (StringNumber > Indexed->StringCount) {
+    return EFI_NOT_FOUND;
+  }
+
+  Entry = &Indexed->Strings[StringNumber - 1];
+  if (Entry->Unicode == NULL) {
+    Entry->Unicode = AllocatePool (Entry->Size * sizeof (CHAR16));
+    if (Entry->Unicode == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    AsciiStrToUnicodeStrS (Entry->Ascii, Entry->Unicode, Entry->Size);
+  }
+
+  *String = Entry->Unicode;
+  return EFI_SUCCESS;
+}
+
+/**
+  SmbiosDxe republishes the SMBIOS configuration table whenever a record is added or removed.
+  Drop the index so the next query rebuilds it; the old records may already be freed.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+SmbiosTableChangedNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  mIndexValid = FALSE;
+}
+
+/**
+  Constructor for SmbiosStringIndexLib. Registers for SMBIOS table changes.
+
+  @param  ImageHandle   ImageHandle of the loaded driver.
+  @param  SystemTable   Pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   The notifications were registered.
+  @retval Others        An event could not be created.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosStringIndexLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SmbiosTableChangedNotify,
+                  NULL,
+                  &gEfiSmbiosTableGuid,
+                  &mSmbiosTableEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to register for SMBIOS table changes.  %r\n", __FUNCTION__, Status));
+    return Status;
+  }
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SmbiosTableChangedNotify,
+                  NULL,
+                  &gEfiSmbios3TableGuid,
+                  &mSmbios3TableEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to register for SMBIOS 3 table changes.  %r\n", __FUNCTION__, Status));
+    gBS->CloseEvent (mSmbiosTableEvent);
+    mSmbiosTableEvent = NULL;
+  }
+
+  return Status;
+}
+
+/**
+  Destructor for SmbiosStringIndexLib. Closes the notifications and frees the index.
+
+  @param  ImageHandle   ImageHandle of the loaded driver.
+  @param  SystemTable   Pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   Always.
+
+**/
+EFI_STATUS
+EFIAPI
+SmbiosStringIndexLibDestructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  if (mSmbiosTableEvent != NULL) {
+    gBS->CloseEvent (mSmbiosTableEvent);
+    mSmbiosTableEvent = NULL;
+  }
+
+  if (mSmbios3TableEvent != NULL) {
+    gBS->CloseEvent (mSmbios3TableEvent);
+    mSmbios3TableEvent = NULL;
+  }
+
+  FreeIndex ();
+  return EFI_SUCCESS;
+}
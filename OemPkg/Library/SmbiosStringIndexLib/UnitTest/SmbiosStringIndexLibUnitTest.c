@@ -0,0 +1,965 @@
+/** @file SmbiosStringIndexLibUnitTest.c
+
+  Host based unit tests of SmbiosStringIndexLib.
+
+  The library runs against a mock SMBIOS protocol behind a minimal boot services table. The mock
+  holds every record in its own allocation and frees it when the record is removed, as SmbiosDxe
+  does, so a lookup from an index that was not dropped reads freed memory. Its tables are a table
+  laid out like the one OVMF publishes on a QEMU q35 machine and random tables with every record
+  type, records without strings and duplicated strings.
+
+  Every lookup is checked against a lookup that restarts GetNext from the first record of the type
+  and walks the string set, the way FrontPage and DfciDeviceIdSupportLib found their strings before
+  the index. Both are timed over the identity strings. The library source is included so each test
+  can start from an empty index.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "../SmbiosStringIndexLib.c"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "SmbiosStringIndexLib Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define MOCK_MAX_RECORDS         160
+#define MOCK_EVENT_GROUPS        2
+
+#define TEST_RANDOM_TABLES       1000
+#define TEST_RANDOM_MAX_STRINGS  6
+#define TEST_RANDOM_MAX_LENGTH   24
+#define TEST_BENCHMARK_ROUNDS    20000
+
+//
+// A table laid out like the one OVMF publishes on a QEMU q35 machine, with a serial number set:
+// BIOS and system information, the chassis, two memory devices, boot information and the end of
+// the table. Type 2 is missing and type 32 has no strings.
+//
+STATIC CONST CHAR8  mQemuTable[] =
+  // Type 0, BIOS information
+  "\x00\x18\x00\x00\x01\x02\x00\xE8\x03\x00\x08\x00\x00\x00\x00\x00\x00\x00\x00\x1C\x00\x00\xFF\xFF"
+  "EFI Development Kit II / OVMF\0" "0.0.0\0" "02/06/2015\0" "\0"
+  // Type 1, system information
+  "\x01\x1B\x00\x01\x01\x02\x03\x04"
+  "\x8D\x6A\x3F\x21\x55\x1C\x4C\x4A\x9E\x5B\x0B\x76\x5E\x0A\x1F\x32"
+  "\x06\x00\x00"
+  "QEMU\0" "Standard PC (Q35 + ICH9, 2009)\0" "pc-q35-8.2\0" "SN-0042\0" "\0"
+  // Type 3, system enclosure
+  "\x03\x16\x00\x03\x01\x01\x02\x00\x00\x03\x03\x03\x02\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+  "QEMU\0" "pc-q35-8.2\0" "\0"
+  // Type 17, memory devices
+  "\x11\x1B\x00\x11\x00\x10\xFE\xFF\xFF\xFF\xFF\xFF\x00\x04\x09\x00\x01\x00\x07\x02\x00\x00\x00\x02\x00\x00\x00"
+  "DIMM 0\0" "QEMU\0" "\0"
+  "\x11\x1B\x01\x11\x00\x10\xFE\xFF\xFF\xFF\xFF\xFF\x00\x04\x09\x00\x01\x00\x07\x02\x00\x00\x00\x02\x00\x00\x00"
+  "DIMM 1\0" "QEMU\0" "\0"
+  // Type 32, system boot information
+  "\x20\x0B\x00\x20\x00\x00\x00\x00\x00\x00\x00"
+  "\0\0"
+  // Type 127, end of table
+  "\x7F\x04\xFF\xFE"
+  "\0\0";
+
+#define QEMU_TABLE_RECORDS  7
+
+//
+// Type 11, OEM strings, added to the table by a test.
+//
+STATIC CONST CHAR8  mOemStrings[] =
+  "\x0B\x05\x00\x0B\x02"
+  "OEM string 1\0" "OEM string 2\0" "\0";
+
+STATIC EFI_SMBIOS_TABLE_HEADER  *mMockRecords[MOCK_MAX_RECORDS];
+STATIC UINTN                    mMockRecordCount;
+STATIC BOOLEAN                  mMockInstalled;
+STATIC EFI_EVENT_NOTIFY         mMockNotify[MOCK_EVENT_GROUPS];
+STATIC UINTN                    mLocateCalls;
+STATIC UINTN                    mGetNextCalls;
+STATIC EFI_SMBIOS_PROTOCOL      mMockSmbios;
+STATIC EFI_BOOT_SERVICES        mTestBootServices;
+STATIC UINT32                   mRandomState;
+
+EFI_BOOT_SERVICES  *gBS = &mTestBootServices;
+
+/**
+  Get the current time in nanoseconds.
+
+  @return     Nanoseconds since an arbitrary start.
+**/
+STATIC
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Get the next pseudo random number. The sequence is the same on every run.
+
+  @retval   The number.
+**/
+STATIC
+UINT32
+NextRandom (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState << 13;
+  mRandomState ^= mRandomState >> 17;
+  mRandomState ^= mRandomState << 5;
+  return mRandomState;
+}
+
+/**
+  Get the size of a record, including its string set.
+
+  @param[in]  Record    SMBIOS record.
+
+  @retval     The size in bytes.
+**/
+STATIC
+UINTN
+RecordSize (
+  IN CONST SMBIOS_STRUCTURE  *Record
+  )
+{
+  CONST CHAR8  *String;
+
+  String = (CONST CHAR8 *)Record + Record->Length;
+  if (*String == '\0') {
+    return Record->Length + 2;
+  }
+
+  while (*String != '\0') {
+    String += AsciiStrSize (String);
+  }
+
+  return (UINTN)(String + 1 - (CONST CHAR8 *)Record);
+}
+
+/**
+  Add a record to the end of the mock table. The record is copied into its own allocation.
+
+  @param[in]  Record    SMBIOS record.
+
+  @retval     The size of the record in bytes.
+**/
+STATIC
+UINTN
+MockAddRecord (
+  IN CONST SMBIOS_STRUCTURE  *Record
+  )
+{
+  UINTN  Size;
+
+  Size = RecordSize (Record);
+  ASSERT (mMockRecordCount < MOCK_MAX_RECORDS);
+  mMockRecords[mMockRecordCount] = AllocateCopyPool (Size, Record);
+  ASSERT (mMockRecords[mMockRecordCount] != NULL);
+  mMockRecordCount++;
+
+  return Size;
+}
+
+/**
+  Replace the mock table with the records of a table.
+
+  @param[in]  Table     SMBIOS records, one after another.
+  @param[in]  Size      Size of Table in bytes.
+**/
+STATIC
+VOID
+MockLoadTable (
+  IN CONST VOID  *Table,
+  IN UINTN       Size
+  )
+{
+  CONST SMBIOS_STRUCTURE  *Record;
+  UINTN                   Offset;
+
+  while (mMockRecordCount > 0) {
+    FreePool (mMockRecords[--mMockRecordCount]);
+  }
+
+  for (Offset = 0; Offset + sizeof (SMBIOS_STRUCTURE) < Size; ) {
+    Record  = (CONST SMBIOS_STRUCTURE *)((CONST UINT8 *)Table + Offset);
+    Offset += MockAddRecord (Record);
+  }
+}
+
+/**
+  Remove a record from the mock table and free it.
+
+  @param[in]  Type      SMBIOS structure type.
+  @param[in]  Instance  Zero-based instance of that type.
+**/
+STATIC
+VOID
+MockRemoveRecord (
+  IN SMBIOS_TYPE  Type,
+  IN UINTN        Instance
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mMockRecordCount; Index++) {
+    if ((mMockRecords[Index]->Type == Type) && (Instance-- == 0)) {
+      FreePool (mMockRecords[Index]);
+      CopyMem (&mMockRecords[Index], &mMockRecords[Index + 1], (mMockRecordCount - Index - 1) * sizeof (mMockRecords[0]));
+      mMockRecordCount--;
+      return;
+    }
+  }
+
+  ASSERT (FALSE);
+}
+
+/**
+  Signal an SMBIOS table event group, as installing the SMBIOS configuration table does.
+
+  @param[in]  Group   0 for gEfiSmbiosTableGuid, 1 for gEfiSmbios3TableGuid.
+**/
+STATIC
+VOID
+MockSignalTableChanged (
+  IN UINTN  Group
+  )
+{
+  if (mMockNotify[Group] != NULL) {
+    mMockNotify[Group]((EFI_EVENT)&mMockNotify[Group], NULL);
+  }
+}
+
+/**
+  Get the next record of the mock table, as SmbiosDxe does.
+
+  @param[in]      This            Not used.
+  @param[in,out]  SmbiosHandle    Handle of the previous record, or SMBIOS_HANDLE_PI_RESERVED for
+                                  the first. Receives the handle of the record.
+  @param[in]      Type            Optional type of the record to find.
+  @param[out]     Record          Receives the record.
+  @param[out]     ProducerHandle  Not used.
+
+  @retval EFI_SUCCESS     The record was returned.
+  @retval EFI_NOT_FOUND   There are no more records.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockGetNext (
+  IN CONST EFI_SMBIOS_PROTOCOL      *This,
+  IN OUT   EFI_SMBIOS_HANDLE        *SmbiosHandle,
+  IN       EFI_SMBIOS_TYPE          *Type OPTIONAL,
+  OUT      EFI_SMBIOS_TABLE_HEADER  **Record,
+  OUT      EFI_HANDLE               *ProducerHandle OPTIONAL
+  )
+{
+  UINTN  Index;
+
+  mGetNextCalls++;
+
+  Index = 0;
+  if (*SmbiosHandle != SMBIOS_HANDLE_PI_RESERVED) {
+    while ((Index < mMockRecordCount) && (mMockRecords[Index]->Handle != *SmbiosHandle)) {
+      Index++;
+    }
+
+    Index++;
+  }
+
+  for ( ; Index < mMockRecordCount; Index++) {
+    if ((Type == NULL) || (mMockRecords[Index]->Type == *Type)) {
+      *SmbiosHandle = mMockRecords[Index]->Handle;
+      *Record       = mMockRecords[Index];
+      return EFI_SUCCESS;
+    }
+  }
+
+  *SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Return the mock SMBIOS protocol once it is installed.
+
+  @param[in]  Protocol      Protocol GUID.
+  @param[in]  Registration  Not used.
+  @param[out] Interface     Receives the protocol.
+
+  @retval EFI_SUCCESS     The protocol was returned.
+  @retval EFI_NOT_FOUND   It is not installed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  mLocateCalls++;
+  if (!mMockInstalled || !CompareGuid (Protocol, &gEfiSmbiosProtocolGuid)) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Interface = &mMockSmbios;
+  return EFI_SUCCESS;
+}
+
+/**
+  Register for one of the two SMBIOS table event groups.
+
+  @param[in]  Type            Event type.
+  @param[in]  NotifyTpl       Not used.
+  @param[in]  NotifyFunction  Called when the group is signaled.
+  @param[in]  NotifyContext   Not used.
+  @param[in]  EventGroup      gEfiSmbiosTableGuid or gEfiSmbios3TableGuid.
+  @param[out] Event           Receives the event.
+
+  @retval EFI_SUCCESS             The event was created.
+  @retval EFI_INVALID_PARAMETER   Not a notify event for an SMBIOS table group.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestCreateEventEx (
+  IN  UINT32            Type,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction OPTIONAL,
+  IN  CONST VOID        *NotifyContext OPTIONAL,
+  IN  CONST EFI_GUID    *EventGroup OPTIONAL,
+  OUT EFI_EVENT         *Event
+  )
+{
+  UINTN  Group;
+
+  if ((Type != EVT_NOTIFY_SIGNAL) || (NotifyFunction == NULL) || (EventGroup == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (CompareGuid (EventGroup, &gEfiSmbiosTableGuid)) {
+    Group = 0;
+  } else if (CompareGuid (EventGroup, &gEfiSmbios3TableGuid)) {
+    Group = 1;
+  } else {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mMockNotify[Group] = NotifyFunction;
+  *Event             = (EFI_EVENT)&mMockNotify[Group];
+  return EFI_SUCCESS;
+}
+
+/**
+  Close an SMBIOS table event.
+
+  @param[in]  Event   Event from TestCreateEventEx.
+
+  @retval EFI_SUCCESS   The event was closed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestCloseEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  *(EFI_EVENT_NOTIFY *)Event = NULL;
+  return EFI_SUCCESS;
+}
+
+/**
+  Find a record by restarting GetNext from the first record of its type.
+
+  @param[in]  Type      SMBIOS structure type.
+  @param[in]  Instance  Zero-based instance of that type.
+  @param[out] Record    The record.
+
+  @retval EFI_SUCCESS     The record was found.
+  @retval EFI_NOT_FOUND   There is no such record.
+**/
+STATIC
+EFI_STATUS
+ReferenceGetRecord (
+  IN  SMBIOS_TYPE              Type,
+  IN  UINTN                    Instance,
+  OUT EFI_SMBIOS_TABLE_HEADER  **Record
+  )
+{
+  EFI_STATUS         Status;
+  EFI_SMBIOS_HANDLE  SmbiosHandle;
+  EFI_SMBIOS_TYPE    RecordType;
+
+  SmbiosHandle = SMBIOS_HANDLE_PI_RESERVED;
+  RecordType   = Type;
+  do {
+    Status = MockGetNext (&mMockSmbios, &SmbiosHandle, &RecordType, Record, NULL);
+  } while (!EFI_ERROR (Status) && (Instance-- != 0));
+
+  return Status;
+}
+
+/**
+  Find a string by walking the string set of a record.
+
+  @param[in]  Record        SMBIOS record.
+  @param[in]  StringNumber  One-based string number, or 0 for no string.
+  @param[out] String        The string.
+
+  @retval EFI_SUCCESS     The string was found.
+  @retval EFI_NOT_FOUND   There is no such string.
+**/
+STATIC
+EFI_STATUS
+ReferenceGetString (
+  IN  CONST SMBIOS_STRUCTURE  *Record,
+  IN  SMBIOS_TABLE_STRING     StringNumber,
+  OUT CONST CHAR8             **String
+  )
+{
+  CONST CHAR8  *Walk;
+
+  if (StringNumber == 0) {
+    *String = "";
+    return EFI_SUCCESS;
+  }
+
+  for (Walk = (CONST CHAR8 *)Record + Record->Length; *Walk != '\0'; Walk += AsciiStrSize (Walk)) {
+    if (--StringNumber == 0) {
+      *String = Walk;
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Check every string of a record and the strings just past it against the reference.
+
+  @param[in]  Type      SMBIOS structure type.
+  @param[in]  Instance  Zero-based instance of that type.
+  @param[in]  Record    The record the reference found.
+
+  @retval     UNIT_TEST_PASSED              The strings match.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckStrings (
+  IN SMBIOS_TYPE                    Type,
+  IN UINTN                          Instance,
+  IN CONST EFI_SMBIOS_TABLE_HEADER  *Record
+  )
+{
+  EFI_STATUS    Status;
+  UINTN         StringNumber;
+  CONST CHAR8   *Expected;
+  CONST CHAR8   *String;
+  UINTN         Size;
+  CONST CHAR16  *Unicode;
+  CONST CHAR16  *Cached;
+  UINTN         Index;
+
+  for (StringNumber = 0; StringNumber <= MAX_UINT8; StringNumber++) {
+    Status = SmbiosIndexGetString (Type, Instance, (SMBIOS_TABLE_STRING)StringNumber, &String, &Size);
+    if (EFI_ERROR (ReferenceGetString (Record, (SMBIOS_TABLE_STRING)StringNumber, &Expected))) {
+      UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+      UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetUnicodeString (Type, Instance, (SMBIOS_TABLE_STRING)StringNumber, &Unicode), EFI_NOT_FOUND);
+      break;
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Size, AsciiStrSize (Expected));
+    if (StringNumber == 0) {
+      UT_ASSERT_EQUAL (String[0], '\0');
+    } else {
+      // A view into the record, not a copy.
+      UT_ASSERT_TRUE (String == Expected);
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (Type, Instance, (SMBIOS_TABLE_STRING)StringNumber, &String, NULL));
+
+    UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (Type, Instance, (SMBIOS_TABLE_STRING)StringNumber, &Unicode));
+    for (Index = 0; Index < Size; Index++) {
+      UT_ASSERT_EQUAL (Unicode[Index], (CHAR16)(UINT8)Expected[Index]);
+    }
+
+    // Converted once.
+    UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (Type, Instance, (SMBIOS_TABLE_STRING)StringNumber, &Cached));
+    UT_ASSERT_TRUE (Cached == Unicode);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check every record of every type, the instance past the last of each type, and their strings,
+  against the reference.
+
+  @retval     UNIT_TEST_PASSED              The lookups match.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckTable (
+  VOID
+  )
+{
+  EFI_STATUS               Status;
+  UINTN                    Type;
+  UINTN                    Instance;
+  CONST SMBIOS_STRUCTURE   *Record;
+  EFI_SMBIOS_TABLE_HEADER  *Expected;
+  CONST CHAR8              *String;
+
+  for (Type = 0; Type <= MAX_UINT8; Type++) {
+    for (Instance = 0; ; Instance++) {
+      Status = SmbiosIndexGetRecord ((SMBIOS_TYPE)Type, Instance, &Record);
+      if (EFI_ERROR (ReferenceGetRecord ((SMBIOS_TYPE)Type, Instance, &Expected))) {
+        UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+        UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetString ((SMBIOS_TYPE)Type, Instance, 0, &String, NULL), EFI_NOT_FOUND);
+        break;
+      }
+
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_TRUE (Record == Expected);
+      if (CheckStrings ((SMBIOS_TYPE)Type, Instance, Expected) != UNIT_TEST_PASSED) {
+        return UNIT_TEST_ERROR_TEST_FAILED;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Install the mock SMBIOS protocol with the QEMU table and start from an empty index.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED    The test can run.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SmbiosTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (&mTestBootServices, sizeof (mTestBootServices));
+  mTestBootServices.LocateProtocol = TestLocateProtocol;
+  mTestBootServices.CreateEventEx  = TestCreateEventEx;
+  mTestBootServices.CloseEvent     = TestCloseEvent;
+
+  ZeroMem (&mMockSmbios, sizeof (mMockSmbios));
+  mMockSmbios.GetNext      = MockGetNext;
+  mMockSmbios.MajorVersion = 3;
+  mMockInstalled           = TRUE;
+  ZeroMem (mMockNotify, sizeof (mMockNotify));
+  MockLoadTable (mQemuTable, sizeof (mQemuTable));
+
+  mSmbios = NULL;
+  FreeIndex ();
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosStringIndexLibConstructor (NULL, NULL));
+  UT_ASSERT_NOT_NULL (mMockNotify[0]);
+  UT_ASSERT_NOT_NULL (mMockNotify[1]);
+
+  mLocateCalls  = 0;
+  mGetNextCalls = 0;
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Close the library and free the mock table.
+
+  @param[in]  Context   Not used.
+**/
+STATIC
+VOID
+EFIAPI
+SmbiosTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SmbiosStringIndexLibDestructor (NULL, NULL);
+  MockLoadTable (NULL, 0);
+}
+
+/**
+  The QEMU table gives the expected identity strings, and every lookup matches the reference after
+  one walk of the protocol.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+QemuTable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SMBIOS_STRUCTURE  *Record;
+  SMBIOS_TABLE_TYPE1      *Type1Record;
+  CONST CHAR8             *String;
+  UINTN                   Size;
+  CONST CHAR16            *Unicode;
+
+  UT_ASSERT_EQUAL (mMockRecordCount, QEMU_TABLE_RECORDS);
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record));
+  UT_ASSERT_EQUAL (Record->Handle, 0x0100);
+  Type1Record = (SMBIOS_TABLE_TYPE1 *)Record;
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->ProductName, &String, &Size));
+  UT_ASSERT_EQUAL (AsciiStrCmp (String, "Standard PC (Q35 + ICH9, 2009)"), 0);
+  UT_ASSERT_EQUAL (Size, sizeof ("Standard PC (Q35 + ICH9, 2009)"));
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->SerialNumber, &Unicode));
+  UT_ASSERT_MEM_EQUAL (Unicode, L"SN-0042", sizeof (L"SN-0042"));
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, Type1Record->SKUNumber, &String, &Size));
+  UT_ASSERT_EQUAL (Size, sizeof (CHAR8));
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_MEMORY_DEVICE, 1, 1, &String, NULL));
+  UT_ASSERT_EQUAL (AsciiStrCmp (String, "DIMM 1"), 0);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetString (SMBIOS_TYPE_MEMORY_DEVICE, 1, 3, &String, NULL), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_BOOT_INFORMATION, 0, 1, &String, NULL), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetRecord (SMBIOS_TYPE_BASEBOARD_INFORMATION, 0, &Record), EFI_NOT_FOUND);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetRecord (SMBIOS_TYPE_MEMORY_DEVICE, 2, &Record), EFI_NOT_FOUND);
+
+  // One walk of the protocol, to the end.
+  UT_ASSERT_EQUAL (mLocateCalls, 1);
+  UT_ASSERT_EQUAL (mGetNextCalls, QEMU_TABLE_RECORDS + 1);
+
+  return CheckTable ();
+}
+
+/**
+  Random tables with every record type, records without strings and repeated strings match the
+  reference, each after one walk of the protocol.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RandomTables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                   Table[MOCK_MAX_RECORDS * (MAX_UINT8 + TEST_RANDOM_MAX_STRINGS * (TEST_RANDOM_MAX_LENGTH + 1) + 2)];
+  CONST SMBIOS_STRUCTURE  *Found;
+  UINTN                   Iteration;
+  UINTN                   RecordCount;
+  UINTN                   Record;
+  UINTN                   Offset;
+  UINTN                   Length;
+  UINTN                   StringCount;
+  UINTN                   StringLength;
+  UINTN                   PreviousString;
+  UINTN                   Index;
+  UINTN                   Strings;
+
+  mRandomState = 0x1B873593;
+  Strings      = 0;
+
+  for (Iteration = 0; Iteration < TEST_RANDOM_TABLES; Iteration++) {
+    RecordCount = NextRandom () % MOCK_MAX_RECORDS;
+    Offset      = 0;
+    for (Record = 0; Record < RecordCount; Record++) {
+      Length = sizeof (SMBIOS_STRUCTURE) + NextRandom () % (MAX_UINT8 - sizeof (SMBIOS_STRUCTURE) + 1);
+      for (Index = 0; Index < Length; Index++) {
+        Table[Offset + Index] = (UINT8)NextRandom ();
+      }
+
+      // Mostly a few types, so that there are several instances of each, and type 255.
+      Table[Offset]     = (UINT8)(((NextRandom () % 2) == 0) ? NextRandom () : NextRandom () % 4 + MAX_UINT8 - 3);
+      Table[Offset + 1] = (UINT8)Length;
+      Table[Offset + 2] = (UINT8)Record;
+      Table[Offset + 3] = (UINT8)(Record >> 8);
+      Offset           += Length;
+
+      StringCount    = NextRandom () % (TEST_RANDOM_MAX_STRINGS + 1);
+      PreviousString = Offset;
+      for (Index = 0; Index < StringCount; Index++) {
+        if ((Index != 0) && ((NextRandom () % 4) == 0)) {
+          // The same string as the one before.
+          CopyMem (&Table[Offset], &Table[PreviousString], Offset - PreviousString);
+        } else {
+          StringLength = 1 + NextRandom () % TEST_RANDOM_MAX_LENGTH;
+          for (Length = 0; Length < StringLength; Length++) {
+            Table[Offset + Length] = (UINT8)(1 + NextRandom () % MAX_UINT8);
+          }
+
+          Table[Offset + StringLength] = 0;
+        }
+
+        Length         = AsciiStrSize ((CHAR8 *)&Table[Offset]);
+        PreviousString = Offset;
+        Offset        += Length;
+      }
+
+      Strings        += StringCount;
+      Table[Offset++] = 0;
+      if (StringCount == 0) {
+        Table[Offset++] = 0;
+      }
+    }
+
+    MockLoadTable (Table, Offset);
+    MockSignalTableChanged (Iteration % MOCK_EVENT_GROUPS);
+    mGetNextCalls = 0;
+
+    // The first lookup walks the protocol; the reference lookups after it count their own calls.
+    UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetRecord (MAX_UINT8, RecordCount, &Found), EFI_NOT_FOUND);
+    UT_ASSERT_EQUAL (mGetNextCalls, RecordCount + 1);
+    if (CheckTable () != UNIT_TEST_PASSED) {
+      UT_LOG_ERROR ("Table %d of %d records\n", Iteration, RecordCount);
+      return UNIT_TEST_ERROR_TEST_FAILED;
+    }
+  }
+
+  UT_LOG_INFO ("%d tables, %d strings\n", TEST_RANDOM_TABLES, Strings);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The index is kept until an SMBIOS table event group is signaled, and rebuilt from the changed
+  table on the next query. The removed record has been freed by then.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+TableChanges (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SMBIOS_STRUCTURE  *Record;
+  CONST CHAR8             *String;
+  CONST CHAR16            *Unicode;
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_MEMORY_DEVICE, 0, 1, &Unicode));
+  UT_ASSERT_MEM_EQUAL (Unicode, L"DIMM 0", sizeof (L"DIMM 0"));
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_MEMORY_DEVICE, 1, 1, &Unicode));
+  UT_ASSERT_EQUAL (mGetNextCalls, QEMU_TABLE_RECORDS + 1);
+
+  // Remove the first memory device, through the SMBIOS 2 table.
+  MockRemoveRecord (SMBIOS_TYPE_MEMORY_DEVICE, 0);
+  MockSignalTableChanged (0);
+  mGetNextCalls = 0;
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_MEMORY_DEVICE, 0, 1, &String, NULL));
+  UT_ASSERT_EQUAL (AsciiStrCmp (String, "DIMM 1"), 0);
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_MEMORY_DEVICE, 0, 1, &Unicode));
+  UT_ASSERT_MEM_EQUAL (Unicode, L"DIMM 1", sizeof (L"DIMM 1"));
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetRecord (SMBIOS_TYPE_MEMORY_DEVICE, 1, &Record), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL (mGetNextCalls, QEMU_TABLE_RECORDS);
+
+  // Add OEM strings, through the SMBIOS 3 table.
+  MockAddRecord ((CONST SMBIOS_STRUCTURE *)mOemStrings);
+  MockSignalTableChanged (1);
+  mGetNextCalls = 0;
+
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_OEM_STRINGS, 0, 2, &String, NULL));
+  UT_ASSERT_EQUAL (AsciiStrCmp (String, "OEM string 2"), 0);
+  UT_ASSERT_EQUAL (mGetNextCalls, QEMU_TABLE_RECORDS + 1);
+  UT_ASSERT_EQUAL (mLocateCalls, 1);
+
+  if (CheckTable () != UNIT_TEST_PASSED) {
+    return UNIT_TEST_ERROR_TEST_FAILED;
+  }
+
+  // The destructor closes both events.
+  SmbiosStringIndexLibDestructor (NULL, NULL);
+  UT_ASSERT_TRUE (mMockNotify[0] == NULL);
+  UT_ASSERT_TRUE (mMockNotify[1] == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Lookups fail until the SMBIOS protocol is installed, and bad parameters are rejected without
+  indexing the table.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NoSmbiosProtocol (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST SMBIOS_STRUCTURE  *Record;
+  CONST CHAR8             *String;
+  CONST CHAR16            *Unicode;
+
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, 1, NULL, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, 1, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mLocateCalls, 0);
+
+  mMockInstalled = FALSE;
+  UT_ASSERT_TRUE (EFI_ERROR (SmbiosIndexGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record)));
+  UT_ASSERT_TRUE (EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, 1, &String, NULL)));
+  UT_ASSERT_TRUE (EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, 1, &Unicode)));
+  UT_ASSERT_EQUAL (mLocateCalls, 3);
+  UT_ASSERT_EQUAL (mGetNextCalls, 0);
+
+  mMockInstalled = TRUE;
+  UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, 1, &String, NULL));
+  UT_ASSERT_EQUAL (AsciiStrCmp (String, "QEMU"), 0);
+  UT_ASSERT_EQUAL (mLocateCalls, 4);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Time the identity string lookups of the reference, with the converted copy it allocated, against
+  the index.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Benchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST SMBIOS_TABLE_STRING  IdentityStrings[] = { 1, 2, 4 };   // Manufacturer, product, serial
+  EFI_SMBIOS_TABLE_HEADER           *Record;
+  CONST CHAR8                       *String;
+  CONST CHAR16                      *Unicode;
+  CHAR16                            *Copy;
+  UINTN                             Round;
+  UINTN                             Index;
+  UINT64                            Start;
+  UINT64                            ReferenceNanoseconds;
+  UINT64                            IndexNanoseconds;
+
+  Start = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    for (Index = 0; Index < ARRAY_SIZE (IdentityStrings); Index++) {
+      UT_ASSERT_NOT_EFI_ERROR (ReferenceGetRecord (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, &Record));
+      UT_ASSERT_NOT_EFI_ERROR (ReferenceGetString (Record, IdentityStrings[Index], &String));
+      Copy = AllocatePool (AsciiStrSize (String) * sizeof (CHAR16));
+      UT_ASSERT_NOT_NULL (Copy);
+      AsciiStrToUnicodeStrS (String, Copy, AsciiStrSize (String));
+      FreePool (Copy);
+    }
+  }
+
+  ReferenceNanoseconds = GetNanoseconds () - Start;
+
+  Start = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    for (Index = 0; Index < ARRAY_SIZE (IdentityStrings); Index++) {
+      UT_ASSERT_NOT_EFI_ERROR (SmbiosIndexGetUnicodeString (SMBIOS_TYPE_SYSTEM_INFORMATION, 0, IdentityStrings[Index], &Unicode));
+    }
+  }
+
+  IndexNanoseconds = GetNanoseconds () - Start;
+
+  UT_LOG_INFO (
+    "%d identity strings: rescanning %ld ns, indexed %ld ns per string\n",
+    TEST_BENCHMARK_ROUNDS * ARRAY_SIZE (IdentityStrings),
+    DivU64x32 (ReferenceNanoseconds, TEST_BENCHMARK_ROUNDS * ARRAY_SIZE (IdentityStrings)),
+    DivU64x32 (IndexNanoseconds, TEST_BENCHMARK_ROUNDS * ARRAY_SIZE (IdentityStrings))
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "SMBIOS Index Tests", "OemPkg.SmbiosStringIndexLib.Index", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (IndexTests, "The QEMU table is indexed in one walk", "QemuTable", QemuTable, SmbiosTestSetup, SmbiosTestCleanup, NULL);
+  AddTestCase (IndexTests, "Random tables match rescanning the table", "Random", RandomTables, SmbiosTestSetup, SmbiosTestCleanup, NULL);
+  AddTestCase (IndexTests, "The index is rebuilt after the table changes", "TableChanges", TableChanges, SmbiosTestSetup, SmbiosTestCleanup, NULL);
+  AddTestCase (IndexTests, "Lookups wait for the SMBIOS protocol", "NoSmbiosProtocol", NoSmbiosProtocol, SmbiosTestSetup, SmbiosTestCleanup, NULL);
+  AddTestCase (IndexTests, "Identity string lookups are timed", "Benchmark", Benchmark, SmbiosTestSetup, SmbiosTestCleanup, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,114 @@
+/** @file OemConfigDigestDxe.c
+
+  This module stores the digest of the config snapshot of this boot, so OemConfigPolicyCreatorPei can
+  tell on the next boot whether the config changed since.
+
+  The digest is stored at ReadyToBoot, so only a boot that got as far as boot selection counts, and
+  consumers that cache results derived from the config have written them by then. The variable is
+  only written when the digest differs from the stored one.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Guid/OemConfigSnapshot.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/OemConfigSnapshotLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+/**
+  ReadyToBoot notification. Store the config digest of this boot if it changed.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+StoreConfigDigest (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       Digest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];
+  UINT8       StoredDigest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];
+  UINTN       DigestSize;
+  UINT32      Attributes;
+
+  gBS->CloseEvent (Event);
+
+  Status = OemConfigSnapshotGetDigest (Digest);
+  if (EFI_ERROR (Status) || IsZeroBuffer (Digest, sizeof (Digest))) {
+    DEBUG ((DEBUG_WARN, "%a - No config digest for this boot. %r\n", __FUNCTION__, Status));
+    return;
+  }
+
+  DigestSize = sizeof (StoredDigest);
+  Status     = gRT->GetVariable (
+                      OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME,
+                      &gOemConfigSnapshotHobGuid,
+                      &Attributes,
+                      &DigestSize,
+                      StoredDigest
+                      );
+  if (!EFI_ERROR (Status) &&
+      (Attributes == OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_ATTRS) &&
+      (DigestSize == sizeof (StoredDigest)) &&
+      (CompareMem (StoredDigest, Digest, sizeof (Digest)) == 0))
+  {
+    return;
+  }
+
+  // a variable with other attributes has to be deleted before it can be written
+  if (!EFI_ERROR (Status) && (Attributes != OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_ATTRS)) {
+    gRT->SetVariable (OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME, &gOemConfigSnapshotHobGuid, 0, 0, NULL);
+  }
+
+  Status = gRT->SetVariable (
+                  OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME,
+                  &gOemConfigSnapshotHobGuid,
+                  OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_ATTRS,
+                  sizeof (Digest),
+                  Digest
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to store the config digest. %r\n", __FUNCTION__, Status));
+  }
+}
+
+/**
+  Entry point. Register to store the config digest at ReadyToBoot.
+
+  @param[in]  ImageHandle   The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The notification was registered.
+  @retval Others            The notification could not be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+OemConfigDigestEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   Event;
+
+  Status = EfiCreateEventReadyToBootEx (TPL_CALLBACK, StoreConfigDigest, NULL, &Event);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to create ReadyToBoot event. %r\n", __FUNCTION__, Status));
+  }
+
+  return Status;
+}
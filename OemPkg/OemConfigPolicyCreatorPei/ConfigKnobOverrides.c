@@ -0,0 +1,534 @@
+/** @file
+  Reads the variable overrides of all config knobs in one pass over the variable stores.
+
+  GetConfigKnobOverride looks up one knob through the PEI variable PPI, which walks the variable store
+  from its start on every call, so reading every knob that way costs the number of knobs times the size
+  of the store. When PcdOemConfigScanVariableStores is TRUE, the knobs are instead put in a hash table
+  keyed by their name, the variable stores the PEI variable driver reads are walked once, and every
+  variable found is matched against the table.
+
+  The stores are searched in the same order and with the same state rules as the PEI variable driver:
+  the variable HOB store first, then the NV store, and within a store an added variable wins over one
+  in deleted transition. While a fault tolerant write is pending the PEI variable driver reads part of
+  the NV store from the spare block, so in that case, or when a store cannot be validated, every knob
+  is read through GetConfigKnobOverride instead.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/FaultTolerantWrite.h>
+#include <Guid/SystemNvDataGuid.h>
+#include <Guid/VariableFormat.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/ConfigKnobShimLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/VariableFlashInfoLib.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+// FNV-1a over the UCS-2 code units of a knob name.
+#define KNOB_NAME_HASH_SEED   0x811C9DC5
+#define KNOB_NAME_HASH_PRIME  0x01000193
+
+//
+// The variable found for a knob.
+//
+typedef struct {
+  CONST UINT8    *Data;                 // NULL if no variable was found.
+  UINT32         DataSize;
+  UINT8          StoreIndex;            // Store the variable was found in.
+  BOOLEAN        InDeletedTransition;
+} KNOB_VARIABLE;
+
+/**
+  Hash the ASCII name of a knob the same way HashVariableName hashes a UCS-2 variable name.
+
+  @param[in]  Name      Null-terminated ASCII knob name.
+
+  @retval     The hash of the name.
+**/
+STATIC
+UINT32
+HashKnobName (
+  IN CONST CHAR8  *Name
+  )
+{
+  UINT32  Hash;
+
+  for (Hash = KNOB_NAME_HASH_SEED; *Name != '\0'; Name++) {
+    Hash = (Hash ^ (UINT8)*Name) * KNOB_NAME_HASH_PRIME;
+  }
+
+  return Hash;
+}
+
+/**
+  Hash a UCS-2 variable name.
+
+  @param[in]  Name      Variable name. Need not be aligned.
+  @param[in]  Length    Number of characters, not counting the null terminator.
+
+  @retval     The hash of the name.
+**/
+STATIC
+UINT32
+HashVariableName (
+  IN CONST UINT8  *Name,
+  IN UINTN        Length
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  Hash = KNOB_NAME_HASH_SEED;
+  for (Index = 0; Index < Length; Index++) {
+    Hash = (Hash ^ ReadUnaligned16 ((CONST UINT16 *)&Name[Index * sizeof (CHAR16)])) * KNOB_NAME_HASH_PRIME;
+  }
+
+  return Hash;
+}
+
+/**
+  Build the hash table of the knob names.
+
+  @param[out] Table     Table to build. Free Table->Slots when done.
+
+  @retval EFI_SUCCESS           The table was built.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+**/
+EFI_STATUS
+BuildKnobNameTable (
+  OUT KNOB_NAME_TABLE  *Table
+  )
+{
+  UINT32  SlotCount;
+  UINT32  Slot;
+  UINTN   Knob;
+
+  // At least twice as many slots as knobs keeps the probe sequences short.
+  SlotCount = GetPowerOfTwo32 ((UINT32)gNumKnobs) << 2;
+
+  Table->Slots = AllocateZeroPool (SlotCount * sizeof (UINT32));
+  if (Table->Slots == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table->SlotMask = SlotCount - 1;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    for (Slot = HashKnobName (gKnobData[Knob].Name) & Table->SlotMask; Table->Slots[Slot] != 0; Slot = (Slot + 1) & Table->SlotMask) {
+    }
+
+    Table->Slots[Slot] = (UINT32)Knob + 1;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Find the knob a variable belongs to.
+
+  @param[in]  Table       Table built by BuildKnobNameTable.
+  @param[in]  Name        Variable name. Need not be aligned.
+  @param[in]  NameSize    Size of Name in bytes, including the null terminator.
+  @param[in]  VendorGuid  Variable GUID.
+
+  @retval     The knob index, or gNumKnobs if the variable is not a knob.
+**/
+STATIC
+UINTN
+FindKnob (
+  IN CONST KNOB_NAME_TABLE  *Table,
+  IN CONST UINT8            *Name,
+  IN UINT32                 NameSize,
+  IN CONST EFI_GUID         *VendorGuid
+  )
+{
+  UINTN   Length;
+  UINTN   Knob;
+  UINTN   Index;
+  UINT32  Slot;
+
+  if ((NameSize < sizeof (CHAR16)) || ((NameSize % sizeof (CHAR16)) != 0)) {
+    return gNumKnobs;
+  }
+
+  Length = NameSize / sizeof (CHAR16) - 1;
+  for (Slot = HashVariableName (Name, Length) & Table->SlotMask; Table->Slots[Slot] != 0; Slot = (Slot + 1) & Table->SlotMask) {
+    Knob = Table->Slots[Slot] - 1;
+    if ((gKnobData[Knob].NameSize != Length + 1) || !CompareGuid (&gKnobData[Knob].VendorNamespace, VendorGuid)) {
+      continue;
+    }
+
+    for (Index = 0; Index <= Length; Index++) {
+      if (ReadUnaligned16 ((CONST UINT16 *)&Name[Index * sizeof (CHAR16)]) != (UINT8)gKnobData[Knob].Name[Index]) {
+        break;
+      }
+    }
+
+    if (Index > Length) {
+      return Knob;
+    }
+  }
+
+  return gNumKnobs;
+}
+
+/**
+  Find a knob by its ASCII name and namespace.
+
+  @param[in]  Table       Table built by BuildKnobNameTable.
+  @param[in]  Name        Knob name. Need not be null-terminated.
+  @param[in]  NameSize    Size of Name in bytes, including the null terminator.
+  @param[in]  VendorGuid  Namespace of the knob.
+
+  @retval     The knob index, or gNumKnobs if there is no such knob.
+**/
+UINTN
+FindKnobByName (
+  IN CONST KNOB_NAME_TABLE  *Table,
+  IN CONST CHAR8            *Name,
+  IN UINTN                  NameSize,
+  IN CONST EFI_GUID         *VendorGuid
+  )
+{
+  UINTN   Knob;
+  UINT32  Hash;
+  UINT32  Slot;
+  UINTN   Index;
+
+  if ((NameSize == 0) || (Name[NameSize - 1] != '\0')) {
+    return gNumKnobs;
+  }
+
+  Hash = KNOB_NAME_HASH_SEED;
+  for (Index = 0; Index < NameSize - 1; Index++) {
+    Hash = (Hash ^ (UINT8)Name[Index]) * KNOB_NAME_HASH_PRIME;
+  }
+
+  for (Slot = Hash & Table->SlotMask; Table->Slots[Slot] != 0; Slot = (Slot + 1) & Table->SlotMask) {
+    Knob = Table->Slots[Slot] - 1;
+    if ((gKnobData[Knob].NameSize == NameSize) &&
+        CompareGuid (&gKnobData[Knob].VendorNamespace, VendorGuid) &&
+        (CompareMem (gKnobData[Knob].Name, Name, NameSize) == 0))
+    {
+      return Knob;
+    }
+  }
+
+  return gNumKnobs;
+}
+
+/**
+  Check that a variable store header is one the PEI variable driver reads.
+
+  @param[in]  Store       The variable store.
+  @param[in]  MaxSize     Bytes available for the store.
+
+  @retval     TRUE        The store can be walked.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsValidVariableStore (
+  IN CONST VARIABLE_STORE_HEADER  *Store,
+  IN UINT64                       MaxSize
+  )
+{
+  return (BOOLEAN)((MaxSize >= sizeof (VARIABLE_STORE_HEADER)) &&
+                   (CompareGuid (&Store->Signature, &gEfiAuthenticatedVariableGuid) ||
+                    CompareGuid (&Store->Signature, &gEfiVariableGuid)) &&
+                   (Store->Format == VARIABLE_STORE_FORMATTED) &&
+                   (Store->State == VARIABLE_STORE_HEALTHY) &&
+                   (Store->Size >= sizeof (VARIABLE_STORE_HEADER)) &&
+                   (Store->Size <= MaxSize));
+}
+
+/**
+  Walk a variable store and record the variable of every knob found in it.
+
+  @param[in]      Store       A store accepted by IsValidVariableStore.
+  @param[in]      StoreIndex  Search order of the store. Knobs found in an earlier store are kept.
+  @param[in]      Table       Table built by BuildKnobNameTable.
+  @param[in,out]  Found       Array of gNumKnobs entries.
+**/
+STATIC
+VOID
+ScanVariableStore (
+  IN     CONST VARIABLE_STORE_HEADER  *Store,
+  IN     UINT8                        StoreIndex,
+  IN     CONST KNOB_NAME_TABLE        *Table,
+  IN OUT KNOB_VARIABLE                *Found
+  )
+{
+  CONST AUTHENTICATED_VARIABLE_HEADER  *AuthHeader;
+  CONST VARIABLE_HEADER                *Header;
+  CONST UINT8                          *End;
+  CONST UINT8                          *Variable;
+  CONST UINT8                          *Name;
+  CONST UINT8                          *Data;
+  CONST EFI_GUID                       *VendorGuid;
+  BOOLEAN                              AuthFormat;
+  UINTN                                HeaderSize;
+  UINT32                               NameSize;
+  UINT32                               DataSize;
+  UINT8                                State;
+  UINTN                                Knob;
+
+  AuthFormat = CompareGuid (&Store->Signature, &gEfiAuthenticatedVariableGuid);
+  HeaderSize = AuthFormat ? sizeof (AUTHENTICATED_VARIABLE_HEADER) : sizeof (VARIABLE_HEADER);
+  End        = (CONST UINT8 *)Store + Store->Size;
+
+  for (Variable = (CONST UINT8 *)HEADER_ALIGN (Store + 1); (UINTN)(End - Variable) >= HeaderSize; Variable = (CONST UINT8 *)HEADER_ALIGN (Data + DataSize)) {
+    if (AuthFormat) {
+      AuthHeader = (CONST AUTHENTICATED_VARIABLE_HEADER *)Variable;
+      if (AuthHeader->StartId != VARIABLE_DATA) {
+        break;
+      }
+
+      State      = AuthHeader->State;
+      NameSize   = AuthHeader->NameSize;
+      DataSize   = AuthHeader->DataSize;
+      VendorGuid = &AuthHeader->VendorGuid;
+    } else {
+      Header = (CONST VARIABLE_HEADER *)Variable;
+      if (Header->StartId != VARIABLE_DATA) {
+        break;
+      }
+
+      State      = Header->State;
+      NameSize   = Header->NameSize;
+      DataSize   = Header->DataSize;
+      VendorGuid = &Header->VendorGuid;
+    }
+
+    Name = Variable + HeaderSize;
+    if (((UINTN)(End - Name) < NameSize) || ((UINTN)(End - Name) - NameSize < GET_PAD_SIZE (NameSize))) {
+      break;
+    }
+
+    Data = Name + NameSize + GET_PAD_SIZE (NameSize);
+    if ((UINTN)(End - Data) < DataSize) {
+      break;
+    }
+
+    if ((State != VAR_ADDED) && (State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      continue;
+    }
+
+    Knob = FindKnob (Table, Name, NameSize, VendorGuid);
+    if (Knob >= gNumKnobs) {
+      continue;
+    }
+
+    // The first added variable in the first store that has the knob wins.
+    if ((Found[Knob].Data != NULL) &&
+        ((Found[Knob].StoreIndex != StoreIndex) || !Found[Knob].InDeletedTransition))
+    {
+      continue;
+    }
+
+    Found[Knob].Data                = Data;
+    Found[Knob].DataSize            = DataSize;
+    Found[Knob].StoreIndex          = StoreIndex;
+    Found[Knob].InDeletedTransition = (BOOLEAN)(State != VAR_ADDED);
+  }
+}
+
+/**
+  Get the variable stores the PEI variable driver reads, in its search order.
+
+  @param[out] Stores      Receives the stores. Unused entries are NULL.
+
+  @retval EFI_SUCCESS       Stores holds every store there is.
+  @retval EFI_UNSUPPORTED   A store cannot be walked directly.
+**/
+STATIC
+EFI_STATUS
+GetVariableStores (
+  OUT CONST VARIABLE_STORE_HEADER  *Stores[2]
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_HOB_GUID_TYPE           *GuidHob;
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+  EFI_PHYSICAL_ADDRESS        NvStorageBase;
+  UINT64                      NvStorageSize;
+
+  Stores[0] = NULL;
+  Stores[1] = NULL;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiFaultTolerantWriteGuid);
+  if (GuidHob != NULL) {
+    DEBUG ((DEBUG_INFO, "%a - Fault tolerant write pending.\n", __FUNCTION__));
+    return EFI_UNSUPPORTED;
+  }
+
+  GuidHob = GetFirstGuidHob (&gEfiAuthenticatedVariableGuid);
+  if (GuidHob == NULL) {
+    GuidHob = GetFirstGuidHob (&gEfiVariableGuid);
+  }
+
+  if (GuidHob != NULL) {
+    Stores[0] = (CONST VARIABLE_STORE_HEADER *)GET_GUID_HOB_DATA (GuidHob);
+    if (!IsValidVariableStore (Stores[0], GET_GUID_HOB_DATA_SIZE (GuidHob))) {
+      DEBUG ((DEBUG_WARN, "%a - Variable HOB store is not valid.\n", __FUNCTION__));
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  Status = GetVariableFlashNvStorageInfo (&NvStorageBase, &NvStorageSize);
+  if (EFI_ERROR (Status) || (NvStorageBase == 0) || (NvStorageSize < sizeof (EFI_FIRMWARE_VOLUME_HEADER))) {
+    DEBUG ((DEBUG_WARN, "%a - No NV variable storage (%r).\n", __FUNCTION__, Status));
+    return EFI_UNSUPPORTED;
+  }
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *)(UINTN)NvStorageBase;
+  if ((FvHeader->Signature != EFI_FVH_SIGNATURE) ||
+      !CompareGuid (&FvHeader->FileSystemGuid, &gEfiSystemNvDataFvGuid) ||
+      (FvHeader->HeaderLength >= NvStorageSize))
+  {
+    DEBUG ((DEBUG_WARN, "%a - NV variable storage has no valid firmware volume header.\n", __FUNCTION__));
+    return EFI_UNSUPPORTED;
+  }
+
+  Stores[1] = (CONST VARIABLE_STORE_HEADER *)((UINT8 *)FvHeader + FvHeader->HeaderLength);
+  if (!IsValidVariableStore (Stores[1], NvStorageSize - FvHeader->HeaderLength)) {
+    DEBUG ((DEBUG_WARN, "%a - NV variable store is not valid.\n", __FUNCTION__));
+    return EFI_UNSUPPORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read the override of every knob through GetConfigKnobOverride, one variable lookup per knob.
+
+  @param[out] Overridden    Array of gNumKnobs entries.
+
+  @retval EFI_SUCCESS       All overrides were read.
+  @retval Others            Variable services failed.
+**/
+STATIC
+EFI_STATUS
+ReadConfigKnobOverridesByName (
+  OUT BOOLEAN  *Overridden
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      UnicodeName[CONF_VAR_NAME_LEN];           // get a buffer of the max name size
+  UINTN       Knob;
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    AsciiStrToUnicodeStrS (gKnobData[Knob].Name, UnicodeName, gKnobData[Knob].NameSize);
+
+    Status = GetConfigKnobOverride (
+               &gKnobData[Knob].VendorNamespace,
+               UnicodeName,
+               gKnobData[Knob].CacheValueAddress,
+               gKnobData[Knob].ValueSize
+               );
+
+    // if variable services fails other than failing to find the variable (it was not overridden)
+    // or a size mismatch (stale data from a previous definition of the knob), we should fail
+    // as we may be missing overridden knobs
+    if (EFI_ERROR (Status) && (Status != EFI_NOT_FOUND) && (Status != EFI_BAD_BUFFER_SIZE)) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "%a variable services failed to find %a with status (%r)\n",
+        __FUNCTION__,
+        gKnobData[Knob].Name,
+        Status
+        ));
+      return Status;
+    }
+
+    Overridden[Knob] = (BOOLEAN)(Status == EFI_SUCCESS);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read the variable overrides of all config knobs into their cache values.
+
+  Knobs without an override, or whose override has a different size than the knob (stale data from
+  a previous definition of the knob), keep their current cache value.
+
+  @param[out] Overridden    Array of gNumKnobs entries. Entry N is set to TRUE if knob N was
+                            overridden from variable storage and must be validated.
+
+  @retval EFI_SUCCESS           All overrides were read.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                Variable services failed, so overridden knobs may be missing.
+**/
+EFI_STATUS
+ReadConfigKnobOverrides (
+  OUT BOOLEAN  *Overridden
+  )
+{
+  EFI_STATUS                   Status;
+  CONST VARIABLE_STORE_HEADER  *Stores[2];
+  KNOB_NAME_TABLE              Table;
+  KNOB_VARIABLE                *Found;
+  UINTN                        OverrideCount;
+  UINTN                        Knob;
+  UINT8                        StoreIndex;
+
+  ZeroMem (Overridden, gNumKnobs * sizeof (BOOLEAN));
+  if (gNumKnobs == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (!FeaturePcdGet (PcdOemConfigScanVariableStores)) {
+    return ReadConfigKnobOverridesByName (Overridden);
+  }
+
+  Status = GetVariableStores (Stores);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "%a - Reading %d knob overrides one at a time.\n", __FUNCTION__, gNumKnobs));
+    return ReadConfigKnobOverridesByName (Overridden);
+  }
+
+  Found = AllocateZeroPool (gNumKnobs * sizeof (KNOB_VARIABLE));
+  if (Found == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = BuildKnobNameTable (&Table);
+  if (EFI_ERROR (Status)) {
+    FreePool (Found);
+    return Status;
+  }
+
+  for (StoreIndex = 0; StoreIndex < ARRAY_SIZE (Stores); StoreIndex++) {
+    if (Stores[StoreIndex] != NULL) {
+      ScanVariableStore (Stores[StoreIndex], StoreIndex, &Table, Found);
+    }
+  }
+
+  OverrideCount = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    // A size mismatch is stale data from a previous definition of the knob and is ignored.
+    if ((Found[Knob].Data != NULL) && (Found[Knob].DataSize == gKnobData[Knob].ValueSize)) {
+      CopyMem (gKnobData[Knob].CacheValueAddress, Found[Knob].Data, gKnobData[Knob].ValueSize);
+      Overridden[Knob] = TRUE;
+      OverrideCount++;
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "%a - %d of %d knobs overridden.\n", __FUNCTION__, OverrideCount, gNumKnobs));
+
+  FreePool (Table.Slots);
+  FreePool (Found);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,227 @@
+/** @file
+  Applies the packed config knob override store.
+
+  The store is one variable that holds the overrides of many knobs by knob name and namespace (see
+  OemConfigOverrideStore.h). It is read with a single variable lookup and its layout is checked as a
+  whole: a store with attributes other than non-volatile and boot services only, or with a bad
+  checksum or entry layout, is ignored. Entries that name no knob of this build, or have another size
+  than their knob, are dropped one by one. Knobs with their own override variable keep that value, so
+  per-knob variables work as before.
+
+  The store is written in gKnobData order, so its entries are matched by walking the knobs once from
+  the knob of the previous entry. The knob name table is only built for the first entry that walk does
+  not find, after knobs were removed, renamed or reordered, and finds the knobs of the entries after it.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigOverrideStore.h>
+#include <Ppi/ReadOnlyVariable2.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PlatformConfigDataLib.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+/**
+  Check the header, checksum and entry layout of an override store.
+
+  @param[in]  Store       The store.
+  @param[in]  StoreSize   Size of the store in bytes.
+
+  @retval     TRUE        The entries of the store can be walked.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsOverrideStoreValid (
+  IN CONST OEM_CONFIG_OVERRIDE_STORE_HEADER  *Store,
+  IN UINTN                                   StoreSize
+  )
+{
+  CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry;
+  CONST UINT8                            *End;
+  UINTN                                  Index;
+  UINTN                                  Left;
+
+  if ((StoreSize < sizeof (OEM_CONFIG_OVERRIDE_STORE_HEADER)) ||
+      (Store->Signature != OEM_CONFIG_OVERRIDE_STORE_SIGNATURE) ||
+      (Store->Version != OEM_CONFIG_OVERRIDE_STORE_VERSION))
+  {
+    return FALSE;
+  }
+
+  if (CalculateCrc32 ((VOID *)(Store + 1), StoreSize - sizeof (*Store)) != Store->Crc32) {
+    return FALSE;
+  }
+
+  End   = (CONST UINT8 *)Store + StoreSize;
+  Entry = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Store + 1);
+  for (Index = 0; Index < Store->EntryCount; Index++) {
+    if ((UINTN)(End - (CONST UINT8 *)Entry) < sizeof (*Entry)) {
+      return FALSE;
+    }
+
+    Left = (UINTN)(End - (CONST UINT8 *)(Entry + 1));
+    if ((Entry->NameSize == 0) || (Left < Entry->NameSize) || (Left - Entry->NameSize < Entry->ValueSize)) {
+      return FALSE;
+    }
+
+    Entry = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)((CONST UINT8 *)(Entry + 1) + Entry->NameSize + Entry->ValueSize);
+  }
+
+  return (BOOLEAN)((CONST UINT8 *)Entry == End);
+}
+
+/**
+  Check whether a store entry names a knob.
+
+  @param[in]  Entry       An entry of a store accepted by IsOverrideStoreValid.
+  @param[in]  Knob        Index of the knob in gKnobData.
+
+  @retval     TRUE        The entry has the name and namespace of the knob.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsEntryOfKnob (
+  IN CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry,
+  IN UINTN                                  Knob
+  )
+{
+  return (BOOLEAN)((Entry->NameSize == gKnobData[Knob].NameSize) &&
+                   CompareGuid (&Entry->VendorNamespace, &gKnobData[Knob].VendorNamespace) &&
+                   (CompareMem (Entry + 1, gKnobData[Knob].Name, Entry->NameSize) == 0));
+}
+
+/**
+  Apply the packed override store to the knob cache.
+
+  Knobs already overridden by their own variable are left alone. Entries that name no knob, or have
+  another size than their knob, are dropped.
+
+  @param[in,out]  Overridden    Array of gNumKnobs entries. Entry N is set to TRUE if knob N was
+                                overridden from the store and must be validated.
+
+  @retval EFI_SUCCESS           The store was applied, or there is no valid store.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                Variable services failed, so overridden knobs may be missing.
+**/
+EFI_STATUS
+ApplyConfigOverrideStore (
+  IN OUT BOOLEAN  *Overridden
+  )
+{
+  EFI_STATUS                             Status;
+  EFI_PEI_READ_ONLY_VARIABLE2_PPI        *VariablePpi;
+  OEM_CONFIG_OVERRIDE_STORE_HEADER       *Store;
+  CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY  *Entry;
+  CONST CHAR8                            *Name;
+  KNOB_NAME_TABLE                        Table;
+  UINTN                                  StoreSize;
+  UINT32                                 Attributes;
+  UINTN                                  AppliedCount;
+  UINTN                                  DroppedCount;
+  UINTN                                  NextKnob;
+  UINTN                                  Knob;
+  UINTN                                  Index;
+
+  Status = PeiServicesLocatePpi (&gEfiPeiReadOnlyVariable2PpiGuid, 0, NULL, (VOID **)&VariablePpi);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  StoreSize = 0;
+  Status    = VariablePpi->GetVariable (VariablePpi, OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, NULL, &StoreSize, NULL);
+  if (Status == EFI_NOT_FOUND) {
+    return EFI_SUCCESS;
+  }
+
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    DEBUG ((DEBUG_ERROR, "%a variable services failed to find the config override store (%r)\n", __FUNCTION__, Status));
+    return EFI_ERROR (Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  Store = AllocatePool (StoreSize);
+  if (Store == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = VariablePpi->GetVariable (VariablePpi, OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME, &gOemConfigOverrideStoreGuid, &Attributes, &StoreSize, Store);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a variable services failed to read the config override store (%r)\n", __FUNCTION__, Status));
+    FreePool (Store);
+    return Status;
+  }
+
+  // a store with other attributes could have been written from the OS
+  if ((Attributes != OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS) || !IsOverrideStoreValid (Store, StoreSize)) {
+    DEBUG ((DEBUG_WARN, "%a - Config override store is not valid, ignoring it.\n", __FUNCTION__));
+    FreePool (Store);
+    return EFI_SUCCESS;
+  }
+
+  Table.Slots  = NULL;
+  AppliedCount = 0;
+  DroppedCount = 0;
+  NextKnob     = 0;
+  Entry        = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Store + 1);
+  for (Index = 0; Index < Store->EntryCount; Index++) {
+    Name = (CONST CHAR8 *)(Entry + 1);
+    Knob = gNumKnobs;
+    if (Table.Slots == NULL) {
+      for (Knob = NextKnob; (Knob < gNumKnobs) && !IsEntryOfKnob (Entry, Knob); Knob++) {
+      }
+    }
+
+    if (Knob >= gNumKnobs) {
+      // the knobs changed since the store was written
+      if (Table.Slots == NULL) {
+        Status = BuildKnobNameTable (&Table);
+        if (EFI_ERROR (Status)) {
+          break;
+        }
+      }
+
+      Knob = FindKnobByName (&Table, Name, Entry->NameSize, &Entry->VendorNamespace);
+    }
+
+    if ((Knob >= gNumKnobs) || (Entry->ValueSize != gKnobData[Knob].ValueSize)) {
+      DroppedCount++;
+    } else {
+      if (!Overridden[Knob]) {
+        CopyMem (gKnobData[Knob].CacheValueAddress, Name + Entry->NameSize, Entry->ValueSize);
+        Overridden[Knob] = TRUE;
+        AppliedCount++;
+      }
+
+      NextKnob = Knob + 1;
+    }
+
+    Entry = (CONST OEM_CONFIG_OVERRIDE_STORE_ENTRY *)((CONST UINT8 *)(Entry + 1) + Entry->NameSize + Entry->ValueSize);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a - %d of %d stored overrides applied, %d dropped.\n",
+    __FUNCTION__,
+    AppliedCount,
+    Store->EntryCount,
+    DroppedCount
+    ));
+
+  if (Table.Slots != NULL) {
+    FreePool (Table.Slots);
+  }
+
+  FreePool (Store);
+  return Status;
+}
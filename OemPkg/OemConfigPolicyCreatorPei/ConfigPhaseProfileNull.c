@@ -0,0 +1,40 @@
+/** @file
+  Phase markers of creating the config policy, which do nothing in the PEIM.
+
+  OemConfigPolicyCreatorPeiHostTest replaces this file with one that logs the time, allocations and
+  peak pool use of each phase on the host. The PEIM does not measure itself, so it needs no timer and
+  does not walk the HOB list.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+/**
+  Start measuring a phase.
+
+  @param[out] Phase   Receives the state at the start of the phase.
+**/
+VOID
+BeginConfigPhase (
+  OUT CONFIG_PHASE  *Phase
+  )
+{
+}
+
+/**
+  Stop measuring a phase and log what it took.
+
+  @param[in]  Phase   The state at the start of the phase.
+  @param[in]  Name    Name of the phase.
+**/
+VOID
+EndConfigPhase (
+  IN CONST CONFIG_PHASE  *Phase,
+  IN CONST CHAR8         *Name
+  )
+{
+}
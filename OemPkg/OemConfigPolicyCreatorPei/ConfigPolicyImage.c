@@ -0,0 +1,357 @@
+/** @file
+  Creates the config policy from a prebuilt default policy image.
+
+  Serializing the policy walks every knob twice, once to size the policy and once to convert each name
+  to UCS-2 and write its CONFIG_VAR_LIST entry, yet the result only differs from boot to boot in the
+  values that a profile or variable storage overrides. When the platform provides a default policy
+  image (see OemConfigPolicyImage.h), it is copied as a whole and only the entries whose value differs
+  from the knob cache are written again. The image file can hold one image per profile, so that a
+  profile selected at boot patches no more knobs than the default profile does.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigPolicyImage.h>
+#include <Guid/VariableFormat.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/ConfigVariableListLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PlatformConfigDataLib.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+/**
+  Find a raw section of a file.
+
+  PeiServicesFfsFindSectionData3 does not return the size of the section it finds, so the sections of
+  the file are walked here. Raw sections inside encapsulation sections are not searched.
+
+  @param[in]  FileHandle        The file.
+  @param[in]  SectionInstance   Raw section of the file to find, 0 for the first.
+  @param[out] Data              Receives the data of the section.
+  @param[out] DataSize          Receives the size of Data.
+
+  @retval EFI_SUCCESS     The section was found.
+  @retval EFI_NOT_FOUND   The file has no such section, or its sections are malformed.
+**/
+STATIC
+EFI_STATUS
+FindRawSection (
+  IN  EFI_PEI_FILE_HANDLE  FileHandle,
+  IN  UINTN                SectionInstance,
+  OUT CONST VOID           **Data,
+  OUT UINT32               *DataSize
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_FV_FILE_INFO                 FileInfo;
+  CONST EFI_COMMON_SECTION_HEADER  *Section;
+  UINTN                            Offset;
+  UINTN                            HeaderSize;
+  UINTN                            SectionSize;
+
+  Status = PeiServicesFfsGetFileInfo (FileHandle, &FileInfo);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  // sections start on 4 byte boundaries
+  for (Offset = 0;
+       (Offset < FileInfo.BufferSize) && (FileInfo.BufferSize - Offset >= sizeof (EFI_COMMON_SECTION_HEADER));
+       Offset = ALIGN_VALUE (Offset + SectionSize, 4))
+  {
+    Section = (CONST EFI_COMMON_SECTION_HEADER *)((CONST UINT8 *)FileInfo.Buffer + Offset);
+    if (IS_SECTION2 (Section)) {
+      if (FileInfo.BufferSize - Offset < sizeof (EFI_COMMON_SECTION_HEADER2)) {
+        break;
+      }
+
+      HeaderSize  = sizeof (EFI_COMMON_SECTION_HEADER2);
+      SectionSize = SECTION2_SIZE (Section);
+    } else {
+      HeaderSize  = sizeof (EFI_COMMON_SECTION_HEADER);
+      SectionSize = SECTION_SIZE (Section);
+    }
+
+    if ((SectionSize < HeaderSize) || (SectionSize > FileInfo.BufferSize - Offset)) {
+      break;
+    }
+
+    if (Section->Type != EFI_SECTION_RAW) {
+      continue;
+    }
+
+    if (SectionInstance == 0) {
+      *Data     = (CONST UINT8 *)Section + HeaderSize;
+      *DataSize = (UINT32)(SectionSize - HeaderSize);
+      return EFI_SUCCESS;
+    }
+
+    SectionInstance--;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Find a policy image in the firmware volumes.
+
+  @param[in]  SectionInstance   Raw section of the image file that holds the image.
+  @param[out] Image             Receives the image.
+  @param[out] ImageSize         Receives the size of the image.
+
+  @retval EFI_SUCCESS     The image was found.
+  @retval EFI_NOT_FOUND   The platform has no such image.
+**/
+STATIC
+EFI_STATUS
+FindPolicyImage (
+  IN  UINTN                                 SectionInstance,
+  OUT CONST OEM_CONFIG_POLICY_IMAGE_HEADER  **Image,
+  OUT UINT32                                *ImageSize
+  )
+{
+  EFI_STATUS           Status;
+  CONST EFI_GUID       *FileGuid;
+  EFI_PEI_FV_HANDLE    VolumeHandle;
+  EFI_PEI_FILE_HANDLE  FileHandle;
+  UINTN                Instance;
+
+  FileGuid = (CONST EFI_GUID *)PcdGetPtr (PcdOemConfigPolicyImageFile);
+  if (IsZeroGuid (FileGuid)) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Instance = 0; ; Instance++) {
+    Status = PeiServicesFfsFindNextVolume (Instance, &VolumeHandle);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Status = PeiServicesFfsFindFileByName (FileGuid, VolumeHandle, &FileHandle);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    Status = FindRawSection (FileHandle, SectionInstance, (CONST VOID **)Image, ImageSize);
+    if (!EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  DEBUG ((DEBUG_WARN, "%a - Config policy image %g section %d not found.\n", __FUNCTION__, FileGuid, SectionInstance));
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Hash the names and namespaces of the knobs as described for OEM_CONFIG_POLICY_IMAGE_HEADER.KnobHash.
+
+  @retval     The hash.
+**/
+UINT32
+HashKnobs (
+  VOID
+  )
+{
+  CONST CHAR8  *Name;
+  CONST UINT8  *Guid;
+  UINT32       Hash;
+  UINTN        Knob;
+  UINTN        Index;
+
+  Hash = OEM_CONFIG_POLICY_IMAGE_HASH_SEED;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    Name = gKnobData[Knob].Name;
+    do {
+      Hash = (Hash ^ (UINT8)*Name) * OEM_CONFIG_POLICY_IMAGE_HASH_PRIME;
+    } while (*Name++ != '\0');
+
+    Guid = (CONST UINT8 *)&gKnobData[Knob].VendorNamespace;
+    for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+      Hash = (Hash ^ Guid[Index]) * OEM_CONFIG_POLICY_IMAGE_HASH_PRIME;
+    }
+  }
+
+  return Hash;
+}
+
+/**
+  Get the end of a knob's entry in the image list.
+
+  @param[in]  Image   The image.
+  @param[in]  Knobs   The knob table of the image.
+  @param[in]  Knob    Knob index.
+
+  @retval     Offset of the end of the entry from the start of the list.
+**/
+STATIC
+UINT32
+GetEntryEnd (
+  IN CONST OEM_CONFIG_POLICY_IMAGE_HEADER  *Image,
+  IN CONST OEM_CONFIG_POLICY_IMAGE_KNOB    *Knobs,
+  IN UINTN                                 Knob
+  )
+{
+  return (Knob + 1 < Image->KnobCount) ? Knobs[Knob + 1].EntryOffset : Image->ListSize;
+}
+
+/**
+  Check that an image fits in its section and describes the knobs of this build.
+
+  @param[in]  Image       The image.
+  @param[in]  ImageSize   Size of the image section.
+
+  @retval     TRUE        The image can be used.
+  @retval     FALSE       Not.
+**/
+STATIC
+BOOLEAN
+IsPolicyImageValid (
+  IN CONST OEM_CONFIG_POLICY_IMAGE_HEADER  *Image,
+  IN UINT32                                ImageSize
+  )
+{
+  EFI_STATUS                          Status;
+  CONST OEM_CONFIG_POLICY_IMAGE_KNOB  *Knobs;
+  UINT32                              EntrySize;
+  UINT32                              EntryEnd;
+  UINTN                               Knob;
+
+  if ((ImageSize < sizeof (OEM_CONFIG_POLICY_IMAGE_HEADER)) ||
+      (Image->Signature != OEM_CONFIG_POLICY_IMAGE_SIGNATURE) ||
+      (Image->Version != OEM_CONFIG_POLICY_IMAGE_VERSION) ||
+      (Image->KnobCount != gNumKnobs) ||
+      ((UINT64)ImageSize < sizeof (OEM_CONFIG_POLICY_IMAGE_HEADER) + MultU64x32 (Image->KnobCount, sizeof (OEM_CONFIG_POLICY_IMAGE_KNOB)) + Image->ListSize))
+  {
+    return FALSE;
+  }
+
+  if (Image->KnobHash != HashKnobs ()) {
+    return FALSE;
+  }
+
+  // The entries must follow each other from the start of the list, with the sizes this build gives them.
+  Knobs = (CONST OEM_CONFIG_POLICY_IMAGE_KNOB *)(Image + 1);
+  if ((gNumKnobs != 0) && (Knobs[0].EntryOffset != 0)) {
+    return FALSE;
+  }
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    EntryEnd = GetEntryEnd (Image, Knobs, Knob);
+    Status   = GetVarListSize ((UINT32)gKnobData[Knob].NameSize * sizeof (CHAR16), gKnobData[Knob].ValueSize, &EntrySize);
+    if (EFI_ERROR (Status) ||
+        (EntryEnd < Knobs[Knob].EntryOffset) ||
+        (EntryEnd - Knobs[Knob].EntryOffset != EntrySize) ||
+        (Knobs[Knob].ValueOffset < Knobs[Knob].EntryOffset) ||
+        (Knobs[Knob].ValueOffset > EntryEnd) ||
+        (EntryEnd - Knobs[Knob].ValueOffset < gKnobData[Knob].ValueSize))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Create the config policy from the prebuilt policy image named by PcdOemConfigPolicyImageFile.
+
+  The image of the active profile is used if the file has one, otherwise the default image. The image
+  is copied and only the entries of knobs whose cache value differs from the image are serialized
+  again, so the policy is correct whichever image is used.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData of the active profile, or
+                                  GENERIC_PROFILE_INDEX for none.
+  @param[out] ConfPolicy          Receives the config policy, allocated from pool.
+  @param[out] ConfPolicySize      Receives the size of ConfPolicy.
+
+  @retval EFI_SUCCESS           The policy was created.
+  @retval EFI_NOT_FOUND         There is no image, or it does not match the knobs of this build.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                An entry could not be serialized.
+**/
+EFI_STATUS
+CreateConfPolicyFromImage (
+  IN  UINT32  ActiveProfileIndex,
+  OUT VOID    **ConfPolicy,
+  OUT UINT32  *ConfPolicySize
+  )
+{
+  EFI_STATUS                            Status;
+  CONST OEM_CONFIG_POLICY_IMAGE_HEADER  *Image;
+  CONST OEM_CONFIG_POLICY_IMAGE_KNOB    *Knobs;
+  UINT32                                ImageSize;
+  UINT8                                 *Policy;
+  CHAR16                                UnicodeName[CONF_VAR_NAME_LEN];      // get a buffer of the max name size
+  CONFIG_VAR_LIST_ENTRY                 VarListEntry;
+  UINTN                                 EntrySize;
+  UINTN                                 PatchCount;
+  UINTN                                 Knob;
+
+  // section 0 is the default image and section N + 1 the image of profile N
+  Status = EFI_NOT_FOUND;
+  if (ActiveProfileIndex != GENERIC_PROFILE_INDEX) {
+    Status = FindPolicyImage (ActiveProfileIndex + 1, &Image, &ImageSize);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Status = FindPolicyImage (0, &Image, &ImageSize);
+  }
+
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (!IsPolicyImageValid (Image, ImageSize)) {
+    DEBUG ((DEBUG_WARN, "%a - Config policy image does not match the knobs of this build.\n", __FUNCTION__));
+    return EFI_NOT_FOUND;
+  }
+
+  Knobs  = (CONST OEM_CONFIG_POLICY_IMAGE_KNOB *)(Image + 1);
+  Policy = AllocateCopyPool (Image->ListSize, Knobs + Image->KnobCount);
+  if (Policy == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PatchCount = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (CompareMem (&Policy[Knobs[Knob].ValueOffset], gKnobData[Knob].CacheValueAddress, gKnobData[Knob].ValueSize) == 0) {
+      continue;
+    }
+
+    // Rewrite the whole entry so that anything derived from the value is brought up to date as well.
+    AsciiStrToUnicodeStrS (gKnobData[Knob].Name, UnicodeName, gKnobData[Knob].NameSize);
+
+    VarListEntry.Name       = UnicodeName;
+    VarListEntry.Guid       = gKnobData[Knob].VendorNamespace;
+    VarListEntry.Attributes = VARIABLE_ATTRIBUTE_NV_BS_RT;
+    VarListEntry.Data       = gKnobData[Knob].CacheValueAddress;
+    VarListEntry.DataSize   = (UINT32)gKnobData[Knob].ValueSize;
+
+    EntrySize = GetEntryEnd (Image, Knobs, Knob) - Knobs[Knob].EntryOffset;
+    Status    = ConvertVariableEntryToVariableList (&VarListEntry, &Policy[Knobs[Knob].EntryOffset], &EntrySize);
+    if (EFI_ERROR (Status) || (EntrySize != GetEntryEnd (Image, Knobs, Knob) - Knobs[Knob].EntryOffset)) {
+      DEBUG ((DEBUG_ERROR, "%a failed to patch config knob %a! Status (%r)\n", __FUNCTION__, gKnobData[Knob].Name, Status));
+      ASSERT (FALSE);
+      FreePool (Policy);
+      return EFI_ERROR (Status) ? Status : EFI_ABORTED;
+    }
+
+    PatchCount++;
+  }
+
+  DEBUG ((DEBUG_INFO, "%a - %d of %d knobs patched into the default policy image.\n", __FUNCTION__, PatchCount, gNumKnobs));
+
+  *ConfPolicy     = Policy;
+  *ConfPolicySize = Image->ListSize;
+  return EFI_SUCCESS;
+}
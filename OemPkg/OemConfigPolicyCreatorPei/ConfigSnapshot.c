@@ -0,0 +1,174 @@
+/** @file
+  Publishes the effective config as a snapshot HOB for DXE.
+
+  DXE consumers that need a knob value would otherwise go through policy service or read the
+  override variables again, and could see a different value than PEI did. The snapshot is a table of
+  the value of every knob by its index, taken from the knob cache once the config is final, with a
+  SHA-256 digest of its content (see OemConfigSnapshot.h). The digest is also compared with the one the
+  previous boot stored, so consumers of the policy can skip work when the config has not changed.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigSnapshot.h>
+#include <Ppi/ReadOnlyVariable2.h>
+
+#include <Library/BaseCryptLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/SafeIntLib.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+/**
+  Publish the knob cache as the config snapshot.
+
+  The knob cache must hold the final value of every knob.
+
+  @param[out] Digest            Receives the OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest of the snapshot,
+                                all zero if it could not be computed.
+
+  @retval EFI_SUCCESS           The snapshot was published.
+  @retval EFI_UNSUPPORTED       The knob values are larger than 4 GB.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+**/
+EFI_STATUS
+PublishConfigSnapshot (
+  OUT UINT8  *Digest
+  )
+{
+  EFI_STATUS                  Status;
+  OEM_CONFIG_SNAPSHOT_HEADER  *Snapshot;
+  OEM_CONFIG_SNAPSHOT_KNOB    *Knobs;
+  OEM_CONFIG_SNAPSHOT_HOB     *Hob;
+  UINT8                       *Values;
+  UINT32                      ValuesSize;
+  UINT64                      SnapshotSize;
+  UINT64                      Offset;
+  UINT32                      PartSize;
+  UINTN                       Knob;
+
+  ZeroMem (Digest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE);
+
+  ValuesSize = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    Status = (EFI_STATUS)SafeUint32Add (ValuesSize, (UINT32)gKnobData[Knob].ValueSize, &ValuesSize);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a config knob values exceed max size!\n", __FUNCTION__));
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  SnapshotSize = OEM_CONFIG_SNAPSHOT_SIZE (gNumKnobs, ValuesSize);
+  if (SnapshotSize > MAX_UINT32) {
+    DEBUG ((DEBUG_ERROR, "%a config snapshot exceeds max size!\n", __FUNCTION__));
+    return EFI_UNSUPPORTED;
+  }
+
+  Snapshot = AllocatePool ((UINTN)SnapshotSize);
+  if (Snapshot == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a failed to allocate the config snapshot!\n", __FUNCTION__));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Snapshot->Signature  = OEM_CONFIG_SNAPSHOT_SIGNATURE;
+  Snapshot->Version    = OEM_CONFIG_SNAPSHOT_VERSION;
+  Snapshot->KnobCount  = (UINT32)gNumKnobs;
+  Snapshot->KnobHash   = HashKnobs ();
+  Snapshot->ValuesSize = ValuesSize;
+
+  Knobs  = (OEM_CONFIG_SNAPSHOT_KNOB *)(Snapshot + 1);
+  Values = (UINT8 *)(Knobs + gNumKnobs);
+  Offset = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    Knobs[Knob].ValueOffset = (UINT32)Offset;
+    Knobs[Knob].ValueSize   = (UINT32)gKnobData[Knob].ValueSize;
+    CopyMem (&Values[Offset], gKnobData[Knob].CacheValueAddress, gKnobData[Knob].ValueSize);
+    Offset += gKnobData[Knob].ValueSize;
+  }
+
+  if (!Sha256HashAll (
+         &Snapshot->KnobCount,
+         (UINTN)SnapshotSize - OFFSET_OF (OEM_CONFIG_SNAPSHOT_HEADER, KnobCount),
+         Snapshot->Digest
+         ))
+  {
+    DEBUG ((DEBUG_WARN, "%a failed to hash the config snapshot, publishing it without a digest\n", __FUNCTION__));
+    ZeroMem (Snapshot->Digest, sizeof (Snapshot->Digest));
+  }
+
+  CopyMem (Digest, Snapshot->Digest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE);
+
+  // split the snapshot across as many HOBs as it needs, in order
+  Status = EFI_SUCCESS;
+  for (Offset = 0; Offset < SnapshotSize; Offset += PartSize) {
+    PartSize = (UINT32)MIN (SnapshotSize - Offset, OEM_CONFIG_SNAPSHOT_HOB_DATA_MAX);
+    Hob      = BuildGuidHob (&gOemConfigSnapshotHobGuid, sizeof (OEM_CONFIG_SNAPSHOT_HOB) + PartSize);
+    if (Hob == NULL) {
+      DEBUG ((DEBUG_ERROR, "%a failed to build a config snapshot HOB!\n", __FUNCTION__));
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+
+    Hob->Offset = (UINT32)Offset;
+    Hob->Size   = PartSize;
+    CopyMem (Hob + 1, (UINT8 *)Snapshot + Offset, PartSize);
+  }
+
+  FreePool (Snapshot);
+  return Status;
+}
+
+/**
+  Check whether the config digest of this boot is the one the previous boot stored.
+
+  @param[in]  Digest    The OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest of this boot.
+
+  @retval     TRUE      The config is unchanged since the previous boot.
+  @retval     FALSE     It changed, Digest is all zero, or no valid digest was stored.
+**/
+BOOLEAN
+IsConfigUnchanged (
+  IN CONST UINT8  *Digest
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *VariablePpi;
+  UINT8                            PreviousDigest[OEM_CONFIG_SNAPSHOT_DIGEST_SIZE];
+  UINTN                            DigestSize;
+  UINT32                           Attributes;
+
+  if (IsZeroBuffer (Digest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE)) {
+    return FALSE;
+  }
+
+  Status = PeiServicesLocatePpi (&gEfiPeiReadOnlyVariable2PpiGuid, 0, NULL, (VOID **)&VariablePpi);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  DigestSize = sizeof (PreviousDigest);
+  Status     = VariablePpi->GetVariable (
+                              VariablePpi,
+                              OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_NAME,
+                              &gOemConfigSnapshotHobGuid,
+                              &Attributes,
+                              &DigestSize,
+                              PreviousDigest
+                              );
+
+  // the variable is only trusted if the OS could not have written it
+  return (BOOLEAN)(!EFI_ERROR (Status) &&
+                   (Attributes == OEM_CONFIG_SNAPSHOT_DIGEST_VARIABLE_ATTRS) &&
+                   (DigestSize == OEM_CONFIG_SNAPSHOT_DIGEST_SIZE) &&
+                   (CompareMem (PreviousDigest, Digest, OEM_CONFIG_SNAPSHOT_DIGEST_SIZE) == 0));
+}
@@ -6,7 +6,7 @@
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
-#include <Uefi.h>
+#include <PiPei.h>
 #include <ConfigStdStructDefs.h>
 
 #include <Library/DebugLib.h>
@@ -20,102 +20,41 @@
 #include <Library/ConfigKnobShimLib.h>
 #include <Library/SafeIntLib.h>
 #include <Library/PolicyLib.h>
+#include <Library/OemConfigPolicyLib.h>
 #include <Library/ActiveProfileIndexSelectorLib.h>
 #include <Library/PlatformConfigDataLib.h>
 
-/**
-  Helper function to apply profile overrides. This function is only
-  called if the active profile index has been validated to be within
-  the acceptable range.
-
-  @param[in]  ActiveProfileIndex The validated index into gProfileData
-
-  @retval     EFI_SUCCESS        Successfully applied the input profile index
-  @retval     !EFI_SUCCESS       Failed to apply the input profile index, applied generic profile instead
-**/
-STATIC
-EFI_STATUS
-ApplyProfileOverrides (
-  UINT32  ActiveProfileIndex
-  )
-{
-  PROFILE  *ActiveProfile = &gProfileData[ActiveProfileIndex];
-  UINTN    i;
-  UINTN    Knob;
-
-  for (i = 0; i < ActiveProfile->OverrideCount; i++) {
-    Knob = ActiveProfile->Overrides[i].Knob;
-    if ((Knob >= gNumKnobs) || (Knob != gKnobData[Knob].Knob)) {
-      // something bad happened in the autogeneration, knobs are
-      // not ordered. Don't muck about finding the misordered knobs
-      // fail
-      DEBUG ((
-        DEBUG_ERROR,
-        "%a knob autogeneration out of order, can't finish applying profile, defaulting to generic profile\n",
-        __FUNCTION__
-        ));
-
-      // we may have failed in the middle of applying the profile, so we need to
-      // write the default value for each knob we may have passed to its cache address so we can
-      // have a clean generic profile. We didn't apply the knob for this value of i, so decrement
-      // before we start
-      if (i == 0) {
-        return EFI_INVALID_PARAMETER;
-      }
-
-      i--;
-      for ( ; i > 0; i--) {
-        Knob = ActiveProfile->Overrides[i].Knob;
-        CopyMem (gKnobData[Knob].CacheValueAddress, gKnobData[Knob].DefaultValueAddress, gKnobData[Knob].ValueSize);
-      }
-
-      // do this once more when i == 0. To keep signed/unsigned comparisons issues in check, i is not signed
-      // otherwise we'd do >= 0 in the loop
-      Knob = ActiveProfile->Overrides[i].Knob;
-      CopyMem (gKnobData[Knob].CacheValueAddress, gKnobData[Knob].DefaultValueAddress, gKnobData[Knob].ValueSize);
-
-      ASSERT (FALSE);
-      return EFI_INVALID_PARAMETER;
-    }
-
-    CopyMem (gKnobData[Knob].CacheValueAddress, ActiveProfile->Overrides[i].Value, gKnobData[Knob].ValueSize);
-  }
-
-  return EFI_SUCCESS;
-}
+#include "OemConfigPolicyCreatorPei.h"
 
 /**
-  Helper function to create config policy.
+  Helper function to serialize every knob into a new config policy.
 
   @param[out]      ConfPolicy     Pointer to uninitialized config policy
   @param[out]      ConfPolicySize Pointer to size of created ConfPolicy
 
   @retval EFI_SUCCESS           The configuration is translated to policy successfully.
   @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
-  @retval EFI_NOT_READY         Variable Services were not found.
+  @retval EFI_UNSUPPORTED       The config is larger than 4 GB.
   @retval EFI_ABORTED           Creating variable list failed.
-  @retval Others                Other errors occurred when getting GFX policy.
 **/
-STATIC
 EFI_STATUS
-CreateConfPolicy (
+SerializeConfPolicy (
   OUT  VOID     **ConfPolicy,
-  OUT   UINT16  *ConfPolicySize
+  OUT   UINT32  *ConfPolicySize
   )
 {
-  EFI_STATUS                  Status;
-  UINT32                      i;
-  UINT32                      NeededSize = 0;
-  UINT32                      Offset     = 0;
-  CHAR16                      UnicodeName[CONF_VAR_NAME_LEN];           // get a buffer of the max name size
-  CONFIG_VAR_LIST_ENTRY       VarListEntry;
-  UINTN                       VarListSize;
-  VOID                        *ConfListPtr;
-  UINT32                      UnicodeNameSize;
-  UINT32                      TmpNeededSize;
-  UINT32                      ActiveProfileIndex;
-  OEM_CONFIG_METADATA_POLICY  ConfigMetadata;
-  CHAR8                       *ProfileName;
+  EFI_STATUS             Status;
+  UINT32                 i;
+  UINT32                 NeededSize = 0;
+  UINT32                 Offset     = 0;
+  CHAR16                 UnicodeName[CONF_VAR_NAME_LEN];                // get a buffer of the max name size
+  CONFIG_VAR_LIST_ENTRY  VarListEntry;
+  UINTN                  VarListSize;
+  VOID                   *ConfListPtr;
+  UINT32                 UnicodeNameSize;
+  UINT32                 TmpNeededSize;
+
+  *ConfPolicy = NULL;
 
   // first figure out how much space we need to allocate for the ConfPolicy
   for (i = 0; i < gNumKnobs; i++) {
@@ -125,7 +64,7 @@ CreateConfPolicy (
       DEBUG ((DEBUG_ERROR, "%a config knob has too long a name! Size: 0x%x\n", __FUNCTION__, gKnobData[i].NameSize * 2));
       ASSERT (FALSE);
       Status = EFI_UNSUPPORTED;
-      goto CreatePolicyExit;
+      goto SerializeExit;
     }
 
     // the var list will use the Unicode version of the name, gKnobData has the ASCII version
@@ -135,7 +74,7 @@ CreateConfPolicy (
       DEBUG ((DEBUG_ERROR, "%a Config var list is too large!\n", __FUNCTION__));
       ASSERT (FALSE);
       Status = EFI_UNSUPPORTED;
-      goto CreatePolicyExit;
+      goto SerializeExit;
     }
 
     Status = (EFI_STATUS)SafeUint32Add (NeededSize, TmpNeededSize, &NeededSize);
@@ -144,29 +83,97 @@ CreateConfPolicy (
       DEBUG ((DEBUG_ERROR, "%a config exceeds max size!\n", __FUNCTION__));
       ASSERT (FALSE);
       Status = EFI_UNSUPPORTED;
-      goto CreatePolicyExit;
+      goto SerializeExit;
     }
   }
 
-  Status = (EFI_STATUS)SafeUint32ToUint16 (NeededSize, ConfPolicySize);
-  // validate we won't overflow the maximum size allowed for policy service. In addition, don't
-  // overflow the DataSize (UINT32) of VarListEntry
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "%a config is greater than 64k! Too large for what policy service supports\n", __FUNCTION__));
-    ASSERT (FALSE);
-    Status = EFI_UNSUPPORTED;
-    goto CreatePolicyExit;
-  }
-
   *ConfPolicy = AllocatePool (NeededSize);
 
   if (*ConfPolicy == NULL) {
     DEBUG ((DEBUG_ERROR, "%a failed to allocate Conf Policy memory!\n", __FUNCTION__));
     ASSERT (FALSE);
     Status = EFI_OUT_OF_RESOURCES;
-    goto CreatePolicyExit;
+    goto SerializeExit;
+  }
+
+  // now go through and populate the Conf Policy
+  for (i = 0; i < gNumKnobs; i++) {
+    AsciiStrToUnicodeStrS (gKnobData[i].Name, UnicodeName, gKnobData[i].NameSize);
+
+    VarListEntry.Name = UnicodeName;
+    VarListEntry.Guid = gKnobData[i].VendorNamespace;
+    // hardcoded for now
+    VarListEntry.Attributes = VARIABLE_ATTRIBUTE_NV_BS_RT;
+    VarListEntry.Data       = gKnobData[i].CacheValueAddress;
+    // this is validated not to overflow above where we ensure the entire config
+    // NeededSize does not overflow a UINT32 and NeededSize takes each knob's
+    // ValueSize into consideration
+    VarListEntry.DataSize = (UINT32)gKnobData[i].ValueSize;
+
+    ConfListPtr = ((UINT8 *)*ConfPolicy) + Offset;
+
+    VarListSize = (UINTN)NeededSize - (UINTN)Offset;
+    Status      = ConvertVariableEntryToVariableList (&VarListEntry, ConfListPtr, &VarListSize);
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a failed to convert variable entry to var list! - %r\n", __FUNCTION__, Status));
+      ASSERT (FALSE);
+      goto SerializeExit;
+    }
+
+    Offset += (UINT32)VarListSize;
+  }
+
+  if (Offset != NeededSize) {
+    // oops we messed up the math, may have corrupted memory...
+    DEBUG ((DEBUG_ERROR, "%a expected ConfPolicy size %x does not match actual size %x!\n", __FUNCTION__, NeededSize, Offset));
+    ASSERT (Offset == NeededSize);
+    Status = EFI_ABORTED;
+    goto SerializeExit;
   }
 
+  *ConfPolicySize = NeededSize;
+
+SerializeExit:
+  if (EFI_ERROR (Status) && (*ConfPolicy != NULL)) {
+    FreePool (*ConfPolicy);
+    *ConfPolicy = NULL;
+  }
+
+  return Status;
+}
+
+/**
+  Helper function to create config policy.
+
+  @param[out]      ConfPolicy     Pointer to uninitialized config policy
+  @param[out]      ConfPolicySize Pointer to size of created ConfPolicy
+
+  @retval EFI_SUCCESS           The configuration is translated to policy successfully.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval EFI_NOT_READY         Variable Services were not found.
+  @retval EFI_ABORTED           Creating variable list failed.
+  @retval Others                Other errors occurred when getting GFX policy.
+**/
+STATIC
+EFI_STATUS
+CreateConfPolicy (
+  OUT  VOID     **ConfPolicy,
+  OUT   UINT32  *ConfPolicySize
+  )
+{
+  EFI_STATUS                  Status;
+  UINT32                      i;
+  UINT32                      ActiveProfileIndex;
+  OEM_CONFIG_METADATA_POLICY  ConfigMetadata;
+  CHAR8                       *ProfileName;
+  BOOLEAN                     *Overridden = NULL;
+  CONFIG_PHASE                Phase;
+
+  *ConfPolicy = NULL;
+
+  BeginConfigPhase (&Phase);
+
   // before we get potential overrides for the policy, we need to figure out which
   // profile will be our active one for this boot and apply any overrides from it
   // to the cache
@@ -177,17 +184,7 @@ CreateConfPolicy (
     ActiveProfileIndex = GENERIC_PROFILE_INDEX;
   }
 
-  if (ActiveProfileIndex < gNumProfiles) {
-    // if ActiveProfileIndex == GENERIC_PROFILE_INDEX, we are using the generic profile and don't
-    // look for any profile overrides. Otherwise, ensure that the active profile index
-    // is valid, otherwise use the generic profile. If it is valid, apply those overrides.
-    Status = ApplyProfileOverrides (ActiveProfileIndex);
-    if (EFI_ERROR (Status)) {
-      // if we failed to apply the profile, we defaulted to the generic profile
-      // mark that here so we report it in the config metadata policy
-      ActiveProfileIndex = GENERIC_PROFILE_INDEX;
-    }
-  } else if (ActiveProfileIndex != GENERIC_PROFILE_INDEX) {
+  if ((ActiveProfileIndex >= gNumProfiles) && (ActiveProfileIndex != GENERIC_PROFILE_INDEX)) {
     DEBUG ((
       DEBUG_ERROR,
       "%a bad value of ActiveProfileIndex returned: %d, defaulting to generic profile\n",
@@ -197,74 +194,85 @@ CreateConfPolicy (
     ActiveProfileIndex = GENERIC_PROFILE_INDEX;
   }
 
-  // now go through and populate the Conf Policy
-  for (i = 0; i < gNumKnobs; i++) {
-    AsciiStrToUnicodeStrS (gKnobData[i].Name, UnicodeName, gKnobData[i].NameSize);
+  // if ActiveProfileIndex == GENERIC_PROFILE_INDEX, we are using the generic profile and only
+  // the base profiles are applied. Otherwise the active profile is applied on top of them.
+  Status = ApplyProfileStack (ActiveProfileIndex);
+  if (EFI_ERROR (Status)) {
+    // if we failed to apply the profile, we defaulted to the generic profile
+    // mark that here so we report it in the config metadata policy
+    ActiveProfileIndex = GENERIC_PROFILE_INDEX;
+  }
 
-    VarListEntry.Name = UnicodeName;
-    VarListEntry.Guid = gKnobData[i].VendorNamespace;
-    // hardcoded for now
-    VarListEntry.Attributes = VARIABLE_ATTRIBUTE_NV_BS_RT;
-    VarListEntry.Data       = gKnobData[i].CacheValueAddress;
-    // this is validated not to overflow above where we ensure the entire config
-    // NeededSize is not greater than MAX_UINT16 and NeededSize is takes each knob's
-    // ValueSize into consideration
-    VarListEntry.DataSize = (UINT32)gKnobData[i].ValueSize;
+  EndConfigPhase (&Phase, "profiles");
+  BeginConfigPhase (&Phase);
 
-    // check if value has been overridden in variable storage
-    Status = GetConfigKnobOverride (
-               &gKnobData[i].VendorNamespace,
-               UnicodeName,
-               gKnobData[i].CacheValueAddress,
-               gKnobData[i].ValueSize
-               );
-
-    // if variable services fails other than failing to find the variable (it was not overridden)
-    // or a size mismatch (stale data from a previous definition of the knob), we should fail
-    // as we may be missing overridden knobs
-    if (EFI_ERROR (Status) && (Status != EFI_NOT_FOUND) && (Status != EFI_BAD_BUFFER_SIZE)) {
-      DEBUG ((
-        DEBUG_ERROR,
-        "%a variable services failed to find %a with status (%r)\n",
-        __FUNCTION__,
-        gKnobData[i].Name,
-        Status
-        ));
-      ASSERT (FALSE);
-      goto CreatePolicyExit;
-    }
+  Overridden = AllocatePool (gNumKnobs * sizeof (BOOLEAN));
+  if (Overridden == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a failed to allocate knob override flags!\n", __FUNCTION__));
+    ASSERT (FALSE);
+    Status = EFI_OUT_OF_RESOURCES;
+    goto CreatePolicyExit;
+  }
+
+  // apply the values that have been overridden in variable storage, reading the variable
+  // stores once for all knobs
+  Status = ReadConfigKnobOverrides (Overridden);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a failed to read config knob overrides! Status (%r)\n", __FUNCTION__, Status));
+    ASSERT (FALSE);
+    goto CreatePolicyExit;
+  }
+
+  // then the packed override store, for the knobs without a variable of their own
+  Status = ApplyConfigOverrideStore (Overridden);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a failed to apply the config override store! Status (%r)\n", __FUNCTION__, Status));
+    ASSERT (FALSE);
+    goto CreatePolicyExit;
+  }
 
+  for (i = 0; i < gNumKnobs; i++) {
     // Validate the value from flash meets the constraints of the knob
-    if ((Status == EFI_SUCCESS) && (gKnobData[i].Validator != NULL)) {
+    if (Overridden[i] && (gKnobData[i].Validator != NULL)) {
       if (!gKnobData[i].Validator (gKnobData[i].CacheValueAddress)) {
         // If it doesn't, we will set the value to the default value
         DEBUG ((DEBUG_ERROR, "Config knob %a failed validation!\n", gKnobData[i].Name));
         CopyMem (gKnobData[i].CacheValueAddress, gKnobData[i].DefaultValueAddress, gKnobData[i].ValueSize);
       }
     }
+  }
 
-    ConfListPtr = ((UINT8 *)*ConfPolicy) + Offset;
+  EndConfigPhase (&Phase, "overrides");
 
-    VarListSize = (UINTN)NeededSize - (UINTN)Offset;
-    Status      = ConvertVariableEntryToVariableList (&VarListEntry, ConfListPtr, &VarListSize);
+  // the knob cache is final, hand it to DXE. DXE consumers can still go through policy service
+  // if this fails, so it does not fail the policy.
+  BeginConfigPhase (&Phase);
+  Status = PublishConfigSnapshot (ConfigMetadata.ConfigDigest);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a failed to publish the config snapshot! Status (%r)\n", __FUNCTION__, Status));
+  }
 
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a failed to convert variable entry to var list! - %r\n", __FUNCTION__, Status));
-      ASSERT (FALSE);
-      goto CreatePolicyExit;
-    }
+  // let policy consumers reuse what they derived from the config on the previous boot
+  ConfigMetadata.ConfigUnchanged = IsConfigUnchanged (ConfigMetadata.ConfigDigest);
+  DEBUG ((DEBUG_INFO, "%a config %a since the previous boot\n", __FUNCTION__, ConfigMetadata.ConfigUnchanged ? "unchanged" : "changed"));
 
-    Offset += (UINT32)VarListSize;
+  EndConfigPhase (&Phase, "snapshot");
+  BeginConfigPhase (&Phase);
+
+  // start from the prebuilt policy image of the active profile if the platform has one,
+  // otherwise serialize every knob
+  Status = CreateConfPolicyFromImage (ActiveProfileIndex, ConfPolicy, ConfPolicySize);
+  if (Status == EFI_NOT_FOUND) {
+    Status = SerializeConfPolicy (ConfPolicy, ConfPolicySize);
   }
 
-  if (Offset != NeededSize) {
-    // oops we messed up the math, may have corrupted memory...
-    DEBUG ((DEBUG_ERROR, "%a expected ConfPolicy size %x does not match actual size %x!\n", __FUNCTION__, NeededSize, Offset));
-    ASSERT (Offset == NeededSize);
-    Status = EFI_ABORTED;
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a failed to build the config policy! Status (%r)\n", __FUNCTION__, Status));
     goto CreatePolicyExit;
   }
 
+  EndConfigPhase (&Phase, "serialize");
+
   // Publish the config metadata policy
   ConfigMetadata.ActiveProfileIndex = ActiveProfileIndex;
   if (ConfigMetadata.ActiveProfileIndex == GENERIC_PROFILE_INDEX) {
@@ -292,11 +300,16 @@ CreateConfPolicy (
   }
 
 CreatePolicyExit:
+  if (Overridden != NULL) {
+    FreePool (Overridden);
+  }
+
   if (EFI_ERROR (Status)) {
     *ConfPolicySize = 0;
 
     if (*ConfPolicy != NULL) {
       FreePool (*ConfPolicy);
+      *ConfPolicy = NULL;
     }
   }
 
@@ -318,11 +331,14 @@ OemConfigPolicyCreatorPeiEntry (
   IN CONST EFI_PEI_SERVICES  **PeiServices
   )
 {
-  EFI_STATUS  Status;
-  VOID        *ConfPolicy    = NULL;
-  UINT16      ConfPolicySize = 0;
+  EFI_STATUS    Status;
+  VOID          *ConfPolicy    = NULL;
+  UINT32        ConfPolicySize = 0;
+  CONFIG_PHASE  Total;
+  CONFIG_PHASE  Phase;
 
   DEBUG ((DEBUG_INFO, "%a - Entry.\n", __FUNCTION__));
+  BeginConfigPhase (&Total);
 
   // Oem can choose to do any Oem specific things to config here such as enforcing static only config or
   // selecting a configuration profile based on some criteria
@@ -334,10 +350,12 @@ OemConfigPolicyCreatorPeiEntry (
     goto Exit;
   }
 
-  // Publish immutable config policy
-  // Policy Service will receive gOemConfigPolicyGuid and publish it as a PPI so that the Silicon Policy Creator can
-  // have a depex on it and map it to Silicon Policies
-  Status = SetPolicy (&gOemConfigPolicyGuid, POLICY_ATTRIBUTE_FINALIZED, ConfPolicy, ConfPolicySize);
+  // Publish immutable config policy, split into chunks that each fit in a policy
+  // Policy Service will receive gOemConfigPolicyGuid, the index of the chunks, and publish it as a PPI so that the
+  // Silicon Policy Creator can have a depex on it and map it to Silicon Policies
+  BeginConfigPhase (&Phase);
+  Status = OemConfigPolicyPublish (ConfPolicy, ConfPolicySize);
+  EndConfigPhase (&Phase, "publish");
 
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a Failed to set config policy! Status (%r)\n", __FUNCTION__, Status));
@@ -351,6 +369,8 @@ Exit:
     FreePool (ConfPolicy);
   }
 
+  EndConfigPhase (&Total, "total");
+
   // return success even in failure scenarios as returning a failure from an entry point can cause the image to be
   // unloaded. In this way depend modules can come up and run their own failure scenarios for not finding the config
   // policy
@@ -0,0 +1,214 @@
+/** @file
+  Internal definitions for OemConfigPolicyCreatorPei.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef OEM_CONFIG_POLICY_CREATOR_PEI_H_
+#define OEM_CONFIG_POLICY_CREATOR_PEI_H_
+
+//
+// A phase of creating the config policy. Phases are only measured by the host test of the creator,
+// which tells them apart by address.
+//
+typedef struct {
+  UINT8    Reserved;
+} CONFIG_PHASE;
+
+//
+// Open addressing hash table of the knobs by name. A slot holds a knob index plus one, or 0 when empty.
+//
+typedef struct {
+  UINT32    *Slots;
+  UINT32    SlotMask;     // Slot count - 1. The slot count is a power of 2.
+} KNOB_NAME_TABLE;
+
+/**
+  Apply the base profiles and, on top of them, the active profile to the knob cache.
+
+  The cache must hold the knob defaults. Base profiles that fail validation are skipped.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData of the active profile, or
+                                  GENERIC_PROFILE_INDEX for none.
+
+  @retval EFI_SUCCESS             The profiles were applied.
+  @retval EFI_INVALID_PARAMETER   The active profile failed validation and was not applied. The base
+                                  profiles were.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed and no profile was applied.
+**/
+EFI_STATUS
+ApplyProfileStack (
+  IN UINT32  ActiveProfileIndex
+  );
+
+/**
+  Read the variable overrides of all config knobs into their cache values.
+
+  Knobs without an override, or whose override has a different size than the knob (stale data from
+  a previous definition of the knob), keep their current cache value.
+
+  @param[out] Overridden    Array of gNumKnobs entries. Entry N is set to TRUE if knob N was
+                            overridden from variable storage and must be validated.
+
+  @retval EFI_SUCCESS           All overrides were read.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                Variable services failed, so overridden knobs may be missing.
+**/
+EFI_STATUS
+ReadConfigKnobOverrides (
+  OUT BOOLEAN  *Overridden
+  );
+
+/**
+  Build the hash table of the knob names.
+
+  @param[out] Table     Table to build. Free Table->Slots when done.
+
+  @retval EFI_SUCCESS           The table was built.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+**/
+EFI_STATUS
+BuildKnobNameTable (
+  OUT KNOB_NAME_TABLE  *Table
+  );
+
+/**
+  Find a knob by its ASCII name and namespace.
+
+  @param[in]  Table       Table built by BuildKnobNameTable.
+  @param[in]  Name        Knob name. Need not be null-terminated.
+  @param[in]  NameSize    Size of Name in bytes, including the null terminator.
+  @param[in]  VendorGuid  Namespace of the knob.
+
+  @retval     The knob index, or gNumKnobs if there is no such knob.
+**/
+UINTN
+FindKnobByName (
+  IN CONST KNOB_NAME_TABLE  *Table,
+  IN CONST CHAR8            *Name,
+  IN UINTN                  NameSize,
+  IN CONST EFI_GUID         *VendorGuid
+  );
+
+/**
+  Apply the packed override store to the knob cache.
+
+  Knobs already overridden by their own variable are left alone.
+
+  @param[in,out]  Overridden    Array of gNumKnobs entries. Entry N is set to TRUE if knob N was
+                                overridden from the store and must be validated.
+
+  @retval EFI_SUCCESS           The store was applied, or there is no valid store.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                Variable services failed, so overridden knobs may be missing.
+**/
+EFI_STATUS
+ApplyConfigOverrideStore (
+  IN OUT BOOLEAN  *Overridden
+  );
+
+/**
+  Helper function to serialize every knob into a new config policy.
+
+  @param[out]      ConfPolicy     Pointer to uninitialized config policy
+  @param[out]      ConfPolicySize Pointer to size of created ConfPolicy
+
+  @retval EFI_SUCCESS           The configuration is translated to policy successfully.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval EFI_UNSUPPORTED       The config is larger than 4 GB.
+  @retval EFI_ABORTED           Creating variable list failed.
+**/
+EFI_STATUS
+SerializeConfPolicy (
+  OUT  VOID     **ConfPolicy,
+  OUT   UINT32  *ConfPolicySize
+  );
+
+/**
+  Create the config policy from the prebuilt policy image named by PcdOemConfigPolicyImageFile.
+
+  The image of the active profile is used if the file has one, otherwise the default image. The image
+  is copied and only the entries of knobs whose cache value differs from the image are serialized
+  again.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData of the active profile, or
+                                  GENERIC_PROFILE_INDEX for none.
+  @param[out] ConfPolicy          Receives the config policy, allocated from pool.
+  @param[out] ConfPolicySize      Receives the size of ConfPolicy.
+
+  @retval EFI_SUCCESS           The policy was created.
+  @retval EFI_NOT_FOUND         There is no image, or it does not match the knobs of this build.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                An entry could not be serialized.
+**/
+EFI_STATUS
+CreateConfPolicyFromImage (
+  IN  UINT32  ActiveProfileIndex,
+  OUT VOID    **ConfPolicy,
+  OUT UINT32  *ConfPolicySize
+  );
+
+/**
+  Hash the names and namespaces of the knobs as described for OEM_CONFIG_POLICY_IMAGE_HEADER.KnobHash.
+
+  @retval     The hash.
+**/
+UINT32
+HashKnobs (
+  VOID
+  );
+
+/**
+  Publish the knob cache as the config snapshot.
+
+  The knob cache must hold the final value of every knob.
+
+  @param[out] Digest            Receives the OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest of the snapshot,
+                                all zero if it could not be computed.
+
+  @retval EFI_SUCCESS           The snapshot was published.
+  @retval EFI_UNSUPPORTED       The knob values are larger than 4 GB.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+**/
+EFI_STATUS
+PublishConfigSnapshot (
+  OUT UINT8  *Digest
+  );
+
+/**
+  Check whether the config digest of this boot is the one the previous boot stored.
+
+  @param[in]  Digest    The OEM_CONFIG_SNAPSHOT_DIGEST_SIZE byte digest of this boot.
+
+  @retval     TRUE      The config is unchanged since the previous boot.
+  @retval     FALSE     It changed, Digest is all zero, or no valid digest was stored.
+**/
+BOOLEAN
+IsConfigUnchanged (
+  IN CONST UINT8  *Digest
+  );
+
+/**
+  Start measuring a phase.
+
+  @param[out] Phase   Receives the state at the start of the phase.
+**/
+VOID
+BeginConfigPhase (
+  OUT CONFIG_PHASE  *Phase
+  );
+
+/**
+  Stop measuring a phase and log what it took.
+
+  @param[in]  Phase   The state at the start of the phase.
+  @param[in]  Name    Name of the phase.
+**/
+VOID
+EndConfigPhase (
+  IN CONST CONFIG_PHASE  *Phase,
+  IN CONST CHAR8         *Name
+  );
+
+#endif // OEM_CONFIG_POLICY_CREATOR_PEI_H_
@@ -0,0 +1,152 @@
+/** @file
+  Applies a stack of config profiles to the knob cache.
+
+  The profiles listed in PcdOemConfigBaseProfiles are stacked in order, and the active profile goes
+  on top, so a later profile wins over an earlier one. Every profile in the stack is checked before
+  the cache is written. Each override is validated by indexing gKnobData directly, and a profile with
+  a bad override is dropped as a whole, so it never has to be rolled back. The stack is then applied
+  from the top down, with a bitmap over the knob index marking the knobs already written. Each
+  overridden knob is copied exactly once, whatever the depth of the stack.
+
+  Copyright (c) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PlatformConfigDataLib.h>
+
+#include "OemConfigPolicyCreatorPei.h"
+
+// End of the PcdOemConfigBaseProfiles list.
+#define BASE_PROFILE_LIST_END  0xFF
+
+// Most profiles in a stack: every base profile and the active profile.
+#define PROFILE_STACK_MAX  (MAX_UINT8 + 1)
+
+/**
+  Check that every override of a profile names a knob of this build.
+
+  @param[in]  ProfileIndex  Index into gProfileData.
+
+  @retval     TRUE          The profile can be applied.
+  @retval     FALSE         Not.
+**/
+STATIC
+BOOLEAN
+IsProfileValid (
+  IN UINT32  ProfileIndex
+  )
+{
+  CONST PROFILE  *Profile;
+  UINTN          Knob;
+  UINTN          i;
+
+  if (ProfileIndex >= gNumProfiles) {
+    DEBUG ((DEBUG_ERROR, "%a profile index %d is out of range!\n", __FUNCTION__, ProfileIndex));
+    return FALSE;
+  }
+
+  Profile = &gProfileData[ProfileIndex];
+  for (i = 0; i < Profile->OverrideCount; i++) {
+    Knob = Profile->Overrides[i].Knob;
+    if ((Knob >= gNumKnobs) || (Knob != gKnobData[Knob].Knob)) {
+      // something bad happened in the autogeneration, knobs are not ordered
+      DEBUG ((DEBUG_ERROR, "%a knob autogeneration out of order in profile %d!\n", __FUNCTION__, ProfileIndex));
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Apply the base profiles and, on top of them, the active profile to the knob cache.
+
+  The cache must hold the knob defaults. Base profiles that fail validation are skipped.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData of the active profile, or
+                                  GENERIC_PROFILE_INDEX for none.
+
+  @retval EFI_SUCCESS             The profiles were applied.
+  @retval EFI_INVALID_PARAMETER   The active profile failed validation and was not applied. The base
+                                  profiles were.
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed and no profile was applied.
+**/
+EFI_STATUS
+ApplyProfileStack (
+  IN UINT32  ActiveProfileIndex
+  )
+{
+  EFI_STATUS     Status;
+  CONST UINT8    *BaseProfiles;
+  UINTN          BaseProfileCount;
+  UINT32         Stack[PROFILE_STACK_MAX];
+  UINTN          StackDepth;
+  UINT64         *Written;
+  CONST PROFILE  *Profile;
+  UINTN          Knob;
+  UINTN          Index;
+  UINTN          i;
+
+  Status     = EFI_SUCCESS;
+  StackDepth = 0;
+
+  BaseProfiles     = (CONST UINT8 *)PcdGetPtr (PcdOemConfigBaseProfiles);
+  BaseProfileCount = PcdGetSize (PcdOemConfigBaseProfiles);
+  for (Index = 0; (Index < BaseProfileCount) && (BaseProfiles[Index] != BASE_PROFILE_LIST_END); Index++) {
+    if (StackDepth == PROFILE_STACK_MAX - 1) {
+      DEBUG ((DEBUG_ERROR, "%a too many base profiles, ignoring the rest\n", __FUNCTION__));
+      break;
+    }
+
+    if (IsProfileValid (BaseProfiles[Index])) {
+      Stack[StackDepth++] = BaseProfiles[Index];
+    } else {
+      DEBUG ((DEBUG_ERROR, "%a skipping base profile %d\n", __FUNCTION__, BaseProfiles[Index]));
+    }
+  }
+
+  if (ActiveProfileIndex != GENERIC_PROFILE_INDEX) {
+    if (IsProfileValid (ActiveProfileIndex)) {
+      Stack[StackDepth++] = ActiveProfileIndex;
+    } else {
+      Status = EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (StackDepth == 0) {
+    return Status;
+  }
+
+  Written = AllocateZeroPool (((gNumKnobs + 63) / 64) * sizeof (UINT64));
+  if (Written == NULL) {
+    DEBUG ((DEBUG_ERROR, "%a failed to allocate the profile bitmap!\n", __FUNCTION__));
+    ASSERT (FALSE);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // walk the stack from the top and each profile from its last override, so that the value that
+  // wins is the first one written and every other value for the knob is skipped
+  while (StackDepth > 0) {
+    Profile = &gProfileData[Stack[--StackDepth]];
+    for (i = Profile->OverrideCount; i > 0; i--) {
+      Knob = Profile->Overrides[i - 1].Knob;
+      if ((Written[Knob / 64] & LShiftU64 (1, Knob % 64)) != 0) {
+        continue;
+      }
+
+      Written[Knob / 64] |= LShiftU64 (1, Knob % 64);
+      CopyMem (gKnobData[Knob].CacheValueAddress, Profile->Overrides[i - 1].Value, gKnobData[Knob].ValueSize);
+    }
+  }
+
+  FreePool (Written);
+  return Status;
+}
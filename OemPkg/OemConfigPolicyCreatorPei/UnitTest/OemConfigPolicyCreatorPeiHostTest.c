@@ -0,0 +1,1217 @@
+/** @file OemConfigPolicyCreatorPeiHostTest.c
+
+  Host based benchmark and tests of OemConfigPolicyCreatorPei.
+
+  The creator is built against host instances of PeiServicesLib, PolicyLib and MemoryAllocationLib,
+  and against a variable PPI over an authenticated variable store in a firmware volume, the way the
+  PEI variable driver reads the NV store. The knob and profile tables are generated for each test,
+  from 10 to 20000 knobs, with knobs overridden by the base and active profiles, by their own
+  variables and by the packed override store.
+
+  Each test runs the entry point of the creator and checks every knob of the published policy against
+  the value expected for it. The policy image tests also add a policy image file, built from gKnobData
+  the way the platform build generates it, and check that the image patched with the final knob cache
+  is the policy that serializing every knob creates. The stale override store tests write the store
+  the way a build with other knobs would, with entries of removed knobs, of knobs under an old name and
+  of knobs with another size, and check that only those entries are dropped. This file takes the
+  place of ConfigPhaseProfileNull.c, so every phase the creator measures logs its wall time, the number of
+  allocations it made and its peak pool use.
+
+  OemPkgHostTest.dsc builds the test twice, with PcdOemConfigScanVariableStores FALSE and TRUE, so
+  the overrides phase of the two builds compares reading the knob variables one at a time through the
+  variable PPI with walking the variable stores once.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Guid/OemConfigMetadataPolicy.h>
+#include <Guid/OemConfigOverrideStore.h>
+#include <Guid/OemConfigPolicyImage.h>
+#include <Guid/OemConfigSnapshot.h>
+#include <Guid/SystemNvDataGuid.h>
+#include <Guid/VariableFormat.h>
+#include <Ppi/ReadOnlyVariable2.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/ConfigKnobShimLib.h>
+#include <Library/ConfigVariableListLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OemConfigPolicyLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/PolicyLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/VariableFlashInfoLib.h>
+
+#include <HostHobLibHelper.h>
+#include <HostMemoryAllocationLibHelper.h>
+#include <HostPeiServicesLibHelper.h>
+#include <HostPolicyLibHelper.h>
+
+#include "../OemConfigPolicyCreatorPei.h"
+
+#define UNIT_TEST_APP_NAME     "OemConfigPolicyCreatorPei Host Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_KNOB_MAX            20000
+#define TEST_KNOB_NAME_SIZE      24
+#define TEST_KNOB_VALUE_MAX      16
+#define TEST_PROFILE_COUNT       3
+#define TEST_FOREIGN_VARIABLES   200
+#define TEST_PHASE_DEPTH_MAX     4
+
+//
+// Value layers. Layer N + 1 is the value of profile N.
+//
+#define LAYER_DEFAULT         0
+#define LAYER_VARIABLE        10
+#define LAYER_STALE_VARIABLE  11
+#define LAYER_OVERRIDE_STORE  12
+
+//
+// Which knobs each source overrides.
+//
+#define IS_PROFILE_KNOB(Profile, Knob)  (((Knob) % mProfileStride[Profile]) == 0)
+#define IS_VARIABLE_KNOB(Knob)          (((Knob) % 11) == 0)
+#define IS_STALE_VARIABLE_KNOB(Knob)    (((Knob) % 101) == 50)
+#define IS_STORE_KNOB(Knob)             (((Knob) % 13) == 6)
+
+//
+// Which store knobs a stale override store has under another name or with another size, and how
+// often it has an entry of a knob that was removed.
+//
+#define IS_RENAMED_STORE_KNOB(Knob)  (((Knob) % 39) == 6)
+#define IS_RESIZED_STORE_KNOB(Knob)  (((Knob) % 65) == 32)
+#define IS_REMOVED_KNOB_AFTER(Knob)  (((Knob) % 91) == 45)
+
+typedef struct {
+  UINT32     KnobCount;
+  UINT32     PolicyImageCount;      // Images in the policy image file, 0 for no file.
+  BOOLEAN    StalePolicyImage;      // The images describe the knobs of another build.
+  BOOLEAN    StaleOverrideStore;    // The override store was written by a build with other knobs.
+} CREATOR_TEST_CONTEXT;
+
+//
+// A phase the creator is measuring.
+//
+typedef struct {
+  CONST CONFIG_PHASE    *Phase;
+  UINT64                StartNanoseconds;
+  UINT64                StartAllocationCount;
+  UINT64                StartSize;
+  UINT64                PeakSize;
+} OPEN_CONFIG_PHASE;
+
+//
+// The generated platform config data.
+//
+KNOB_DATA  gKnobData[TEST_KNOB_MAX];
+UINTN      gNumKnobs = 0;
+PROFILE    gProfileData[TEST_PROFILE_COUNT];
+UINTN      gNumProfiles = TEST_PROFILE_COUNT;
+CHAR8      *gProfileFlavorNames[TEST_PROFILE_COUNT] = { "P0", "P1", "P2" };
+
+STATIC CREATOR_TEST_CONTEXT  m10Knobs    = { 10 };
+STATIC CREATOR_TEST_CONTEXT  m100Knobs   = { 100 };
+STATIC CREATOR_TEST_CONTEXT  m1000Knobs  = { 1000 };
+STATIC CREATOR_TEST_CONTEXT  m5000Knobs  = { 5000 };
+STATIC CREATOR_TEST_CONTEXT  m20000Knobs = { TEST_KNOB_MAX };
+
+STATIC CREATOR_TEST_CONTEXT  m1000KnobsDefaultImage   = { 1000, 1 };
+STATIC CREATOR_TEST_CONTEXT  m1000KnobsProfileImages  = { 1000, TEST_PROFILE_COUNT + 1 };
+STATIC CREATOR_TEST_CONTEXT  m20000KnobsProfileImages = { TEST_KNOB_MAX, TEST_PROFILE_COUNT + 1 };
+STATIC CREATOR_TEST_CONTEXT  m100KnobsStaleImage      = { 100, 1, TRUE };
+STATIC CREATOR_TEST_CONTEXT  m1000KnobsStaleStore     = { 1000, 0, FALSE, TRUE };
+STATIC CREATOR_TEST_CONTEXT  m20000KnobsStaleStore    = { TEST_KNOB_MAX, 0, FALSE, TRUE };
+
+STATIC CONST UINT8   mValueSizes[]                     = { 1, 4, 1, 8, 2, 4, 1, TEST_KNOB_VALUE_MAX };
+STATIC CONST UINT32  mProfileStride[TEST_PROFILE_COUNT] = { 5, 3, 7 };
+
+STATIC EFI_GUID  mKnobNamespaces[] = {
+  { 0x6F3F61AE, 0xC913, 0x4C19, { 0x99, 0xC7, 0xE3, 0xA0, 0x2C, 0xC1, 0xF7, 0xAB }
+  },
+  { 0xAAF5DE39, 0x0D84, 0x4728, { 0xB6, 0xD6, 0x4A, 0xD0, 0x36, 0x5F, 0xDB, 0x9D }
+  }
+};
+
+STATIC CHAR8             *mKnobNames       = NULL;
+STATIC UINT8             *mKnobValues      = NULL;    // Default, cache and expected value of every knob.
+STATIC UINT8             *mProfileValues   = NULL;
+STATIC PROFILE_OVERRIDE  *mProfileOverrides = NULL;
+STATIC UINT8             *mNvStorage       = NULL;
+STATIC UINT64            mNvStorageSize    = 0;
+STATIC UINT8             *mNextVariable    = NULL;
+STATIC UINT8             *mPolicyImageFile = NULL;
+
+STATIC OPEN_CONFIG_PHASE  mOpenPhases[TEST_PHASE_DEPTH_MAX];
+STATIC UINTN              mOpenPhaseCount = 0;
+
+EFI_STATUS
+EFIAPI
+OemConfigPolicyCreatorPeiEntry (
+  IN EFI_PEI_FILE_HANDLE     FileHandle,
+  IN CONST EFI_PEI_SERVICES  **PeiServices
+  );
+
+/**
+  Get the value size of a knob.
+
+  @param[in]  Knob    Index of the knob.
+
+  @return     The size in bytes.
+**/
+STATIC
+UINTN
+KnobValueSize (
+  IN UINTN  Knob
+  )
+{
+  return mValueSizes[Knob % ARRAY_SIZE (mValueSizes)];
+}
+
+/**
+  Fill a knob value with the bytes of a layer.
+
+  @param[out] Value   Receives the value.
+  @param[in]  Size    Size of the value.
+  @param[in]  Knob    Index of the knob.
+  @param[in]  Layer   The layer the value comes from.
+**/
+STATIC
+VOID
+FillKnobValue (
+  OUT UINT8  *Value,
+  IN  UINTN  Size,
+  IN  UINTN  Knob,
+  IN  UINTN  Layer
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Size; Index++) {
+    Value[Index] = (UINT8)(Knob * 31 + Index * 7 + Layer * 101);
+  }
+}
+
+/**
+  Get the current time in nanoseconds.
+
+  @return     Nanoseconds since an arbitrary start.
+**/
+STATIC
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Fold the peak pool use since the last fold into every open phase.
+**/
+STATIC
+VOID
+FoldPeakIntoOpenPhases (
+  VOID
+  )
+{
+  HOST_MEMORY_ALLOCATION_STATS  Stats;
+  UINTN                         Index;
+
+  HostMemoryAllocationLibGetStats (&Stats);
+  for (Index = 0; Index < mOpenPhaseCount; Index++) {
+    mOpenPhases[Index].PeakSize = MAX (mOpenPhases[Index].PeakSize, Stats.PeakSize);
+  }
+
+  HostMemoryAllocationLibResetPeak ();
+}
+
+/**
+  Start measuring a phase.
+
+  @param[out] Phase   Receives the state at the start of the phase.
+**/
+VOID
+BeginConfigPhase (
+  OUT CONFIG_PHASE  *Phase
+  )
+{
+  HOST_MEMORY_ALLOCATION_STATS  Stats;
+  OPEN_CONFIG_PHASE             *Open;
+
+  ZeroMem (Phase, sizeof (*Phase));
+  ASSERT (mOpenPhaseCount < TEST_PHASE_DEPTH_MAX);
+  if (mOpenPhaseCount == TEST_PHASE_DEPTH_MAX) {
+    return;
+  }
+
+  FoldPeakIntoOpenPhases ();
+  HostMemoryAllocationLibGetStats (&Stats);
+
+  Open                       = &mOpenPhases[mOpenPhaseCount++];
+  Open->Phase                = Phase;
+  Open->StartAllocationCount = Stats.AllocationCount;
+  Open->StartSize            = Stats.CurrentSize;
+  Open->PeakSize             = Stats.CurrentSize;
+  Open->StartNanoseconds     = GetNanoseconds ();
+}
+
+/**
+  Stop measuring a phase and log what it took.
+
+  @param[in]  Phase   The state at the start of the phase.
+  @param[in]  Name    Name of the phase.
+**/
+VOID
+EndConfigPhase (
+  IN CONST CONFIG_PHASE  *Phase,
+  IN CONST CHAR8         *Name
+  )
+{
+  UINT64                        EndNanoseconds;
+  HOST_MEMORY_ALLOCATION_STATS  Stats;
+  OPEN_CONFIG_PHASE             *Open;
+  UINTN                         Index;
+
+  EndNanoseconds = GetNanoseconds ();
+
+  // phases a failed creator did not end are dropped
+  for (Index = mOpenPhaseCount; (Index > 0) && (mOpenPhases[Index - 1].Phase != Phase); Index--) {
+  }
+
+  if (Index == 0) {
+    return;
+  }
+
+  FoldPeakIntoOpenPhases ();
+  HostMemoryAllocationLibGetStats (&Stats);
+
+  mOpenPhaseCount = Index - 1;
+  Open            = &mOpenPhases[mOpenPhaseCount];
+  DEBUG ((
+    DEBUG_INFO,
+    "%6d knobs  %-9a %8ld us %8ld allocations %10ld bytes peak\n",
+    gNumKnobs,
+    Name,
+    DivU64x32 (EndNanoseconds - Open->StartNanoseconds, 1000),
+    Stats.AllocationCount - Open->StartAllocationCount,
+    Open->PeakSize - Open->StartSize
+    ));
+}
+
+/**
+  Get a variable from the NV store, walking it from the start like the PEI variable driver.
+
+  @param[in]      This          Not used.
+  @param[in]      VariableName  Name of the variable.
+  @param[in]      VariableGuid  GUID of the variable.
+  @param[out]     Attributes    Receives the attributes of the variable.
+  @param[in,out]  DataSize      Size of Data on input, size of the variable on output.
+  @param[out]     Data          Receives the data.
+
+  @retval EFI_SUCCESS           The variable was read.
+  @retval EFI_NOT_FOUND         There is no such variable.
+  @retval EFI_BUFFER_TOO_SMALL  Data is too small.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestGetVariable (
+  IN CONST  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *This,
+  IN CONST  CHAR16                           *VariableName,
+  IN CONST  EFI_GUID                         *VariableGuid,
+  OUT       UINT32                           *Attributes OPTIONAL,
+  IN OUT    UINTN                            *DataSize,
+  OUT       VOID                             *Data OPTIONAL
+  )
+{
+  CONST EFI_FIRMWARE_VOLUME_HEADER     *FvHeader;
+  CONST VARIABLE_STORE_HEADER          *Store;
+  CONST AUTHENTICATED_VARIABLE_HEADER  *Variable;
+  CONST UINT8                          *End;
+  CONST UINT8                          *Name;
+  UINTN                                NameSize;
+
+  NameSize = StrSize (VariableName);
+  FvHeader = (CONST EFI_FIRMWARE_VOLUME_HEADER *)mNvStorage;
+  Store    = (CONST VARIABLE_STORE_HEADER *)(mNvStorage + FvHeader->HeaderLength);
+  End      = (CONST UINT8 *)Store + Store->Size;
+
+  for (Variable = (CONST AUTHENTICATED_VARIABLE_HEADER *)HEADER_ALIGN (Store + 1);
+       ((CONST UINT8 *)(Variable + 1) <= End) && (Variable->StartId == VARIABLE_DATA);
+       Variable = (CONST AUTHENTICATED_VARIABLE_HEADER *)HEADER_ALIGN (Name + Variable->NameSize + GET_PAD_SIZE (Variable->NameSize) + Variable->DataSize))
+  {
+    Name = (CONST UINT8 *)(Variable + 1);
+    if ((Variable->State != VAR_ADDED) ||
+        (Variable->NameSize != NameSize) ||
+        !CompareGuid (&Variable->VendorGuid, VariableGuid) ||
+        (CompareMem (Name, VariableName, NameSize) != 0))
+    {
+      continue;
+    }
+
+    if (*DataSize < Variable->DataSize) {
+      *DataSize = Variable->DataSize;
+      return EFI_BUFFER_TOO_SMALL;
+    }
+
+    if (Attributes != NULL) {
+      *Attributes = Variable->Attributes;
+    }
+
+    *DataSize = Variable->DataSize;
+    CopyMem (Data, Name + NameSize + GET_PAD_SIZE (NameSize), Variable->DataSize);
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Variable names are not enumerated by the creator.
+
+  @retval EFI_UNSUPPORTED   Always.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TestGetNextVariableName (
+  IN CONST  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *This,
+  IN OUT    UINTN                            *VariableNameSize,
+  IN OUT    CHAR16                           *VariableName,
+  IN OUT    EFI_GUID                         *VariableGuid
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+STATIC EFI_PEI_READ_ONLY_VARIABLE2_PPI  mVariablePpi = {
+  TestGetVariable,
+  TestGetNextVariableName
+};
+
+STATIC EFI_PEI_PPI_DESCRIPTOR  mVariablePpiList = {
+  EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST,
+  &gEfiPeiReadOnlyVariable2PpiGuid,
+  &mVariablePpi
+};
+
+/**
+  Read a knob override through the variable PPI, like ConfigKnobShimPeiLib.
+
+  @param[in]  ConfigKnobGuid      The GUID of the config knob.
+  @param[in]  ConfigKnobName      The name of the config knob.
+  @param[out] ConfigKnobData      Receives the value.
+  @param[in]  ProfileDefaultSize  The size of the value of the knob.
+
+  @retval EFI_SUCCESS           The override was read.
+  @retval EFI_NOT_FOUND         The knob is not overridden.
+  @retval EFI_BAD_BUFFER_SIZE   The override has a different size than the knob.
+**/
+EFI_STATUS
+EFIAPI
+GetConfigKnobOverride (
+  IN  EFI_GUID  *ConfigKnobGuid,
+  IN  CHAR16    *ConfigKnobName,
+  OUT VOID      *ConfigKnobData,
+  IN  UINTN     ProfileDefaultSize
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_PEI_READ_ONLY_VARIABLE2_PPI  *VariablePpi;
+  UINTN                            DataSize;
+
+  Status = PeiServicesLocatePpi (&gEfiPeiReadOnlyVariable2PpiGuid, 0, NULL, (VOID **)&VariablePpi);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  DataSize = ProfileDefaultSize;
+  Status   = VariablePpi->GetVariable (VariablePpi, ConfigKnobName, ConfigKnobGuid, NULL, &DataSize, ConfigKnobData);
+  if ((Status == EFI_BUFFER_TOO_SMALL) || (!EFI_ERROR (Status) && (DataSize != ProfileDefaultSize))) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  return Status;
+}
+
+/**
+  Get the NV variable storage, which is the firmware volume the test built.
+
+  @param[out] BaseAddress   Receives the base address of the storage.
+  @param[out] Length        Receives the size of the storage.
+
+  @retval EFI_SUCCESS       Always.
+**/
+EFI_STATUS
+EFIAPI
+GetVariableFlashNvStorageInfo (
+  OUT EFI_PHYSICAL_ADDRESS  *BaseAddress,
+  OUT UINT64                *Length
+  )
+{
+  *BaseAddress = (EFI_PHYSICAL_ADDRESS)(UINTN)mNvStorage;
+  *Length      = mNvStorageSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Append a variable to the NV store being built.
+
+  @param[in]  Name          Name of the variable.
+  @param[in]  Guid          GUID of the variable.
+  @param[in]  Attributes    Attributes of the variable.
+  @param[in]  Data          Data of the variable.
+  @param[in]  DataSize      Size of Data.
+**/
+STATIC
+VOID
+AddVariable (
+  IN CONST CHAR16    *Name,
+  IN CONST EFI_GUID  *Guid,
+  IN UINT32          Attributes,
+  IN CONST VOID      *Data,
+  IN UINTN           DataSize
+  )
+{
+  AUTHENTICATED_VARIABLE_HEADER  *Variable;
+  UINT8                          *VariableName;
+
+  Variable             = (AUTHENTICATED_VARIABLE_HEADER *)HEADER_ALIGN (mNextVariable);
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = VAR_ADDED;
+  Variable->Attributes = Attributes;
+  Variable->NameSize   = (UINT32)StrSize (Name);
+  Variable->DataSize   = (UINT32)DataSize;
+  CopyGuid (&Variable->VendorGuid, Guid);
+
+  VariableName = (UINT8 *)(Variable + 1);
+  CopyMem (VariableName, Name, Variable->NameSize);
+  CopyMem (VariableName + Variable->NameSize + GET_PAD_SIZE (Variable->NameSize), Data, DataSize);
+  mNextVariable = VariableName + Variable->NameSize + GET_PAD_SIZE (Variable->NameSize) + DataSize;
+}
+
+/**
+  Append an entry to the packed override store being built.
+
+  @param[in,out]  Store       The store.
+  @param[in,out]  Entry       The next entry. Receives the entry after it.
+  @param[in]      Name        Knob name.
+  @param[in]      Namespace   Knob namespace.
+  @param[in]      ValueSize   Size of the value.
+  @param[in]      Knob        Index of the knob the value is generated for.
+**/
+STATIC
+VOID
+AddStoreEntry (
+  IN OUT OEM_CONFIG_OVERRIDE_STORE_HEADER  *Store,
+  IN OUT OEM_CONFIG_OVERRIDE_STORE_ENTRY   **Entry,
+  IN     CONST CHAR8                       *Name,
+  IN     CONST EFI_GUID                    *Namespace,
+  IN     UINTN                             ValueSize,
+  IN     UINTN                             Knob
+  )
+{
+  CopyGuid (&(*Entry)->VendorNamespace, Namespace);
+  (*Entry)->NameSize  = (UINT32)AsciiStrSize (Name);
+  (*Entry)->ValueSize = (UINT32)ValueSize;
+  CopyMem (*Entry + 1, Name, (*Entry)->NameSize);
+  FillKnobValue ((UINT8 *)(*Entry + 1) + (*Entry)->NameSize, ValueSize, Knob, LAYER_OVERRIDE_STORE);
+
+  *Entry = (OEM_CONFIG_OVERRIDE_STORE_ENTRY *)((UINT8 *)(*Entry + 1) + (*Entry)->NameSize + ValueSize);
+  Store->EntryCount++;
+}
+
+/**
+  Build the packed override store of the knobs IS_STORE_KNOB selects.
+
+  A stale store is written the way a build with other knobs would write it. It has the knobs
+  IS_RENAMED_STORE_KNOB selects under another name, the knobs IS_RESIZED_STORE_KNOB selects with
+  another size, and an entry of a removed knob after the knobs IS_REMOVED_KNOB_AFTER selects.
+
+  @param[in]  Stale       Write a stale store.
+  @param[out] StoreSize   Receives the size of the store.
+
+  @return     The store, or NULL if memory allocation failed.
+**/
+STATIC
+OEM_CONFIG_OVERRIDE_STORE_HEADER *
+BuildOverrideStore (
+  IN  BOOLEAN  Stale,
+  OUT UINTN    *StoreSize
+  )
+{
+  OEM_CONFIG_OVERRIDE_STORE_HEADER  *Store;
+  OEM_CONFIG_OVERRIDE_STORE_ENTRY   *Entry;
+  CHAR8                             Name[TEST_KNOB_NAME_SIZE];
+  UINTN                             Knob;
+
+  // room for the longest name and value of every entry
+  *StoreSize = sizeof (OEM_CONFIG_OVERRIDE_STORE_HEADER);
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (IS_STORE_KNOB (Knob)) {
+      *StoreSize += sizeof (OEM_CONFIG_OVERRIDE_STORE_ENTRY) + TEST_KNOB_NAME_SIZE + KnobValueSize (Knob) + 1;
+    }
+
+    if (IS_REMOVED_KNOB_AFTER (Knob)) {
+      *StoreSize += sizeof (OEM_CONFIG_OVERRIDE_STORE_ENTRY) + TEST_KNOB_NAME_SIZE + 1;
+    }
+  }
+
+  Store = AllocateZeroPool (*StoreSize);
+  if (Store == NULL) {
+    return NULL;
+  }
+
+  Store->Signature = OEM_CONFIG_OVERRIDE_STORE_SIGNATURE;
+  Store->Version   = OEM_CONFIG_OVERRIDE_STORE_VERSION;
+
+  Entry = (OEM_CONFIG_OVERRIDE_STORE_ENTRY *)(Store + 1);
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (IS_STORE_KNOB (Knob)) {
+      if (Stale && IS_RENAMED_STORE_KNOB (Knob)) {
+        AsciiSPrint (Name, sizeof (Name), "HostTestOldKnob%d", (UINT32)Knob);
+      } else {
+        AsciiStrCpyS (Name, sizeof (Name), gKnobData[Knob].Name);
+      }
+
+      AddStoreEntry (
+        Store,
+        &Entry,
+        Name,
+        &gKnobData[Knob].VendorNamespace,
+        KnobValueSize (Knob) + ((Stale && IS_RESIZED_STORE_KNOB (Knob)) ? 1 : 0),
+        Knob
+        );
+    }
+
+    if (Stale && IS_REMOVED_KNOB_AFTER (Knob)) {
+      AsciiSPrint (Name, sizeof (Name), "HostTestGoneKnob%d", (UINT32)Knob);
+      AddStoreEntry (Store, &Entry, Name, &gKnobData[Knob].VendorNamespace, 1, Knob);
+    }
+  }
+
+  *StoreSize   = (UINTN)((UINT8 *)Entry - (UINT8 *)Store);
+  Store->Crc32 = CalculateCrc32 (Store + 1, *StoreSize - sizeof (*Store));
+  return Store;
+}
+
+/**
+  Build the NV variable storage: an authenticated variable store in a firmware volume, with the
+  knob override variables, stale variables of the wrong size, variables of other drivers, and the
+  packed override store.
+
+  @param[in]  StaleStore  Write the override store the way a build with other knobs would.
+
+  @retval     TRUE    The storage was built.
+  @retval     FALSE   Memory allocation failed.
+**/
+STATIC
+BOOLEAN
+BuildNvStorage (
+  IN BOOLEAN  StaleStore
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER        *FvHeader;
+  VARIABLE_STORE_HEADER             *Store;
+  OEM_CONFIG_OVERRIDE_STORE_HEADER  *OverrideStore;
+  UINTN                             OverrideStoreSize;
+  CHAR16                            Name[TEST_KNOB_NAME_SIZE];
+  UINT8                             Value[TEST_KNOB_VALUE_MAX + 1];
+  UINTN                             VariableSize;
+  UINTN                             Knob;
+  UINTN                             Index;
+
+  OverrideStore = BuildOverrideStore (StaleStore, &OverrideStoreSize);
+  if (OverrideStore == NULL) {
+    return FALSE;
+  }
+
+  VariableSize   = sizeof (AUTHENTICATED_VARIABLE_HEADER) + sizeof (Name) + sizeof (Value) + HEADER_ALIGNMENT;
+  mNvStorageSize = sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY) + sizeof (VARIABLE_STORE_HEADER) +
+                   (gNumKnobs + TEST_FOREIGN_VARIABLES) * VariableSize +
+                   sizeof (AUTHENTICATED_VARIABLE_HEADER) + sizeof (OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME) + OverrideStoreSize + HEADER_ALIGNMENT;
+  mNvStorageSize = ALIGN_VALUE (mNvStorageSize, EFI_PAGE_SIZE);
+  mNvStorage     = AllocatePool ((UINTN)mNvStorageSize);
+  if (mNvStorage == NULL) {
+    FreePool (OverrideStore);
+    return FALSE;
+  }
+
+  SetMem (mNvStorage, (UINTN)mNvStorageSize, 0xFF);
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *)mNvStorage;
+  ZeroMem (FvHeader, sizeof (*FvHeader) + sizeof (EFI_FV_BLOCK_MAP_ENTRY));
+  CopyGuid (&FvHeader->FileSystemGuid, &gEfiSystemNvDataFvGuid);
+  FvHeader->FvLength              = mNvStorageSize;
+  FvHeader->Signature             = EFI_FVH_SIGNATURE;
+  FvHeader->HeaderLength          = (UINT16)(sizeof (*FvHeader) + sizeof (EFI_FV_BLOCK_MAP_ENTRY));
+  FvHeader->Revision              = EFI_FVH_REVISION;
+  FvHeader->BlockMap[0].NumBlocks = (UINT32)(mNvStorageSize / EFI_PAGE_SIZE);
+  FvHeader->BlockMap[0].Length    = EFI_PAGE_SIZE;
+
+  Store = (VARIABLE_STORE_HEADER *)(mNvStorage + FvHeader->HeaderLength);
+  ZeroMem (Store, sizeof (*Store));
+  CopyGuid (&Store->Signature, &gEfiAuthenticatedVariableGuid);
+  Store->Size   = (UINT32)(mNvStorageSize - FvHeader->HeaderLength);
+  Store->Format = VARIABLE_STORE_FORMATTED;
+  Store->State  = VARIABLE_STORE_HEALTHY;
+
+  mNextVariable = (UINT8 *)(Store + 1);
+  for (Index = 0; Index < TEST_FOREIGN_VARIABLES / 2; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Boot%04X", (UINT32)Index);
+    FillKnobValue (Value, sizeof (Value), Index, LAYER_VARIABLE);
+    AddVariable (Name, &gEfiVariableGuid, VARIABLE_ATTRIBUTE_NV_BS_RT, Value, sizeof (Value));
+  }
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    AsciiStrToUnicodeStrS (gKnobData[Knob].Name, Name, ARRAY_SIZE (Name));
+    if (IS_VARIABLE_KNOB (Knob)) {
+      FillKnobValue (Value, KnobValueSize (Knob), Knob, LAYER_VARIABLE);
+      AddVariable (Name, &gKnobData[Knob].VendorNamespace, VARIABLE_ATTRIBUTE_NV_BS_RT, Value, KnobValueSize (Knob));
+    } else if (IS_STALE_VARIABLE_KNOB (Knob)) {
+      FillKnobValue (Value, KnobValueSize (Knob) + 1, Knob, LAYER_STALE_VARIABLE);
+      AddVariable (Name, &gKnobData[Knob].VendorNamespace, VARIABLE_ATTRIBUTE_NV_BS_RT, Value, KnobValueSize (Knob) + 1);
+    }
+  }
+
+  for (Index = TEST_FOREIGN_VARIABLES / 2; Index < TEST_FOREIGN_VARIABLES; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"Driver%04X", (UINT32)Index);
+    FillKnobValue (Value, sizeof (Value), Index, LAYER_VARIABLE);
+    AddVariable (Name, &gEfiVariableGuid, VARIABLE_ATTRIBUTE_NV_BS_RT, Value, sizeof (Value));
+  }
+
+  AddVariable (
+    OEM_CONFIG_OVERRIDE_STORE_VARIABLE_NAME,
+    &gOemConfigOverrideStoreGuid,
+    OEM_CONFIG_OVERRIDE_STORE_VARIABLE_ATTRS,
+    OverrideStore,
+    OverrideStoreSize
+    );
+
+  ASSERT (mNextVariable <= mNvStorage + mNvStorageSize);
+  FreePool (OverrideStore);
+  return TRUE;
+}
+
+/**
+  Get the value of a knob in an image of the policy image file.
+
+  @param[out] Value     Receives the value.
+  @param[in]  Knob      Index of the knob.
+  @param[in]  Section   Raw section of the file that holds the image. Section 0 is the default image
+                        and section N + 1 the image of profile N.
+**/
+STATIC
+VOID
+ImageKnobValue (
+  OUT UINT8  *Value,
+  IN  UINTN  Knob,
+  IN  UINTN  Section
+  )
+{
+  CONST UINT8  *BaseProfiles;
+  UINTN        Index;
+
+  FillKnobValue (Value, KnobValueSize (Knob), Knob, LAYER_DEFAULT);
+  if (Section == 0) {
+    return;
+  }
+
+  BaseProfiles = (CONST UINT8 *)PcdGetPtr (PcdOemConfigBaseProfiles);
+  for (Index = 0; (Index < PcdGetSize (PcdOemConfigBaseProfiles)) && (BaseProfiles[Index] != 0xFF); Index++) {
+    if (IS_PROFILE_KNOB (BaseProfiles[Index], Knob)) {
+      FillKnobValue (Value, KnobValueSize (Knob), Knob, BaseProfiles[Index] + 1);
+    }
+  }
+
+  if (IS_PROFILE_KNOB (Section - 1, Knob)) {
+    FillKnobValue (Value, KnobValueSize (Knob), Knob, Section);
+  }
+}
+
+/**
+  Build the policy image file named by PcdOemConfigPolicyImageFile and add it to the firmware volume.
+
+  Each image is generated from gKnobData the way the platform build generates it: the CONFIG_VAR_LIST
+  of every knob at its image value, in gKnobData order, after the offsets of each entry and value.
+
+  @param[in]  ImageCount  Number of images in the file.
+  @param[in]  Stale       Hash the knobs of another build into the images.
+
+  @retval     TRUE    The file was added.
+  @retval     FALSE   Memory allocation failed.
+**/
+STATIC
+BOOLEAN
+BuildPolicyImageFile (
+  IN UINT32   ImageCount,
+  IN BOOLEAN  Stale
+  )
+{
+  EFI_COMMON_SECTION_HEADER       *Section;
+  OEM_CONFIG_POLICY_IMAGE_HEADER  *Image;
+  OEM_CONFIG_POLICY_IMAGE_KNOB    *Knobs;
+  UINT8                           *List;
+  CONFIG_VAR_LIST_ENTRY           VarListEntry;
+  CHAR16                          Name[TEST_KNOB_NAME_SIZE];
+  UINT8                           Value[TEST_KNOB_VALUE_MAX];
+  UINT32                          ListSize;
+  UINT32                          EntrySize;
+  UINT32                          SectionSize;
+  UINTN                           VarListSize;
+  UINTN                           Offset;
+  UINTN                           Knob;
+  UINTN                           Index;
+
+  ListSize = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    if (EFI_ERROR (GetVarListSize ((UINT32)gKnobData[Knob].NameSize * sizeof (CHAR16), (UINT32)gKnobData[Knob].ValueSize, &EntrySize))) {
+      return FALSE;
+    }
+
+    ListSize += EntrySize;
+  }
+
+  // sections start on 4 byte boundaries
+  SectionSize = sizeof (EFI_COMMON_SECTION_HEADER) + sizeof (OEM_CONFIG_POLICY_IMAGE_HEADER) +
+                (UINT32)gNumKnobs * sizeof (OEM_CONFIG_POLICY_IMAGE_KNOB) + ListSize;
+  SectionSize = ALIGN_VALUE (SectionSize, 4);
+  ASSERT (SectionSize < MAX_SECTION_SIZE);
+
+  mPolicyImageFile = AllocateZeroPool (SectionSize * ImageCount);
+  if (mPolicyImageFile == NULL) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < ImageCount; Index++) {
+    Section          = (EFI_COMMON_SECTION_HEADER *)&mPolicyImageFile[Index * SectionSize];
+    Section->Size[0] = (UINT8)SectionSize;
+    Section->Size[1] = (UINT8)(SectionSize >> 8);
+    Section->Size[2] = (UINT8)(SectionSize >> 16);
+    Section->Type    = EFI_SECTION_RAW;
+
+    Image            = (OEM_CONFIG_POLICY_IMAGE_HEADER *)(Section + 1);
+    Image->Signature = OEM_CONFIG_POLICY_IMAGE_SIGNATURE;
+    Image->Version   = OEM_CONFIG_POLICY_IMAGE_VERSION;
+    Image->KnobCount = (UINT32)gNumKnobs;
+    Image->KnobHash  = Stale ? ~HashKnobs () : HashKnobs ();
+    Image->ListSize  = ListSize;
+
+    Knobs       = (OEM_CONFIG_POLICY_IMAGE_KNOB *)(Image + 1);
+    List        = (UINT8 *)(Knobs + gNumKnobs);
+    Offset      = 0;
+    for (Knob = 0; Knob < gNumKnobs; Knob++) {
+      AsciiStrToUnicodeStrS (gKnobData[Knob].Name, Name, ARRAY_SIZE (Name));
+      ImageKnobValue (Value, Knob, Index);
+
+      // the value follows the entry header, the name, the namespace and the attributes
+      Knobs[Knob].EntryOffset = (UINT32)Offset;
+      Knobs[Knob].ValueOffset = (UINT32)(Offset + sizeof (CONFIG_VAR_LIST_HDR) + StrSize (Name) + sizeof (EFI_GUID) + sizeof (UINT32));
+
+      VarListEntry.Name       = Name;
+      VarListEntry.Guid       = gKnobData[Knob].VendorNamespace;
+      VarListEntry.Attributes = VARIABLE_ATTRIBUTE_NV_BS_RT;
+      VarListEntry.Data       = Value;
+      VarListEntry.DataSize   = (UINT32)gKnobData[Knob].ValueSize;
+
+      VarListSize = ListSize - Offset;
+      if (EFI_ERROR (ConvertVariableEntryToVariableList (&VarListEntry, &List[Offset], &VarListSize))) {
+        return FALSE;
+      }
+
+      Offset += VarListSize;
+    }
+
+    ASSERT (Offset == ListSize);
+  }
+
+  return !EFI_ERROR (HostPeiServicesLibAddFile (PcdGetPtr (PcdOemConfigPolicyImageFile), mPolicyImageFile, SectionSize * ImageCount));
+}
+
+/**
+  Get the value of a knob the creator is expected to publish.
+
+  @param[in]  Knob    Index of the knob.
+
+  @return     The value.
+**/
+STATIC
+UINT8 *
+ExpectedKnobValue (
+  IN UINTN  Knob
+  )
+{
+  // the values of the knobs are laid out as the defaults, then the cache, then the expected values
+  return (UINT8 *)gKnobData[Knob].CacheValueAddress + ((UINT8 *)gKnobData[Knob].CacheValueAddress - (UINT8 *)gKnobData[Knob].DefaultValueAddress);
+}
+
+/**
+  Generate the knob and profile tables, and the variable storage, for a test.
+
+  @param[in]  Context   The test context.
+
+  @retval UNIT_TEST_PASSED                      The tables were generated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Memory allocation failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CreatorTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST CREATOR_TEST_CONTEXT  *TestContext;
+  CONST UINT8                 *BaseProfiles;
+  UINTN                       ValuesSize;
+  UINTN                       OverrideCount;
+  UINTN                       Offset;
+  UINTN                       Knob;
+  UINTN                       Profile;
+  UINTN                       Index;
+  UINT32                      ActiveProfile;
+
+  TestContext = (CONST CREATOR_TEST_CONTEXT *)Context;
+  gNumKnobs   = TestContext->KnobCount;
+
+  HostHobLibReset ();
+  HostPeiServicesLibReset ();
+  HostPolicyLibReset ();
+
+  ValuesSize = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    ValuesSize += KnobValueSize (Knob);
+  }
+
+  mKnobNames        = AllocatePool (gNumKnobs * TEST_KNOB_NAME_SIZE);
+  mKnobValues       = AllocatePool (ValuesSize * 3);
+  mProfileValues    = AllocatePool (ValuesSize * TEST_PROFILE_COUNT);
+  mProfileOverrides = AllocatePool (gNumKnobs * TEST_PROFILE_COUNT * sizeof (PROFILE_OVERRIDE));
+  if ((mKnobNames == NULL) || (mKnobValues == NULL) || (mProfileValues == NULL) || (mProfileOverrides == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  Offset = 0;
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    AsciiSPrint (&mKnobNames[Knob * TEST_KNOB_NAME_SIZE], TEST_KNOB_NAME_SIZE, "HostTestKnob%d", (UINT32)Knob);
+
+    ZeroMem (&gKnobData[Knob], sizeof (gKnobData[Knob]));
+    gKnobData[Knob].Knob                = Knob;
+    gKnobData[Knob].DefaultValueAddress = &mKnobValues[Offset];
+    gKnobData[Knob].CacheValueAddress   = &mKnobValues[ValuesSize + Offset];
+    gKnobData[Knob].ValueSize           = KnobValueSize (Knob);
+    gKnobData[Knob].Name                = &mKnobNames[Knob * TEST_KNOB_NAME_SIZE];
+    gKnobData[Knob].NameSize            = AsciiStrSize (gKnobData[Knob].Name);
+    CopyGuid (&gKnobData[Knob].VendorNamespace, &mKnobNamespaces[Knob % ARRAY_SIZE (mKnobNamespaces)]);
+
+    FillKnobValue (&mKnobValues[Offset], KnobValueSize (Knob), Knob, LAYER_DEFAULT);
+    CopyMem (gKnobData[Knob].CacheValueAddress, gKnobData[Knob].DefaultValueAddress, KnobValueSize (Knob));
+    Offset += KnobValueSize (Knob);
+  }
+
+  OverrideCount = 0;
+  for (Profile = 0; Profile < TEST_PROFILE_COUNT; Profile++) {
+    gProfileData[Profile].Overrides     = &mProfileOverrides[OverrideCount];
+    gProfileData[Profile].OverrideCount = 0;
+
+    Offset = Profile * ValuesSize;
+    for (Knob = 0; Knob < gNumKnobs; Knob++) {
+      if (IS_PROFILE_KNOB (Profile, Knob)) {
+        FillKnobValue (&mProfileValues[Offset], KnobValueSize (Knob), Knob, Profile + 1);
+        mProfileOverrides[OverrideCount].Knob  = Knob;
+        mProfileOverrides[OverrideCount].Value = &mProfileValues[Offset];
+        gProfileData[Profile].OverrideCount++;
+        OverrideCount++;
+        Offset += KnobValueSize (Knob);
+      }
+    }
+  }
+
+  // the expected value of every knob: the default, then the base profiles in order, then the active
+  // profile, then its own variable or else the override store
+  BaseProfiles  = (CONST UINT8 *)PcdGetPtr (PcdOemConfigBaseProfiles);
+  ActiveProfile = FixedPcdGet32 (PcdActiveProfileIndex);
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    FillKnobValue (ExpectedKnobValue (Knob), KnobValueSize (Knob), Knob, LAYER_DEFAULT);
+    for (Index = 0; (Index < PcdGetSize (PcdOemConfigBaseProfiles)) && (BaseProfiles[Index] != 0xFF); Index++) {
+      if (IS_PROFILE_KNOB (BaseProfiles[Index], Knob)) {
+        FillKnobValue (ExpectedKnobValue (Knob), KnobValueSize (Knob), Knob, BaseProfiles[Index] + 1);
+      }
+    }
+
+    if ((ActiveProfile < TEST_PROFILE_COUNT) && IS_PROFILE_KNOB (ActiveProfile, Knob)) {
+      FillKnobValue (ExpectedKnobValue (Knob), KnobValueSize (Knob), Knob, ActiveProfile + 1);
+    }
+
+    if (IS_VARIABLE_KNOB (Knob)) {
+      FillKnobValue (ExpectedKnobValue (Knob), KnobValueSize (Knob), Knob, LAYER_VARIABLE);
+    } else if (IS_STORE_KNOB (Knob) &&
+               !(TestContext->StaleOverrideStore && (IS_RENAMED_STORE_KNOB (Knob) || IS_RESIZED_STORE_KNOB (Knob))))
+    {
+      FillKnobValue (ExpectedKnobValue (Knob), KnobValueSize (Knob), Knob, LAYER_OVERRIDE_STORE);
+    }
+  }
+
+  if (!BuildNvStorage (TestContext->StaleOverrideStore)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  if ((TestContext->PolicyImageCount != 0) && !BuildPolicyImageFile (TestContext->PolicyImageCount, TestContext->StalePolicyImage)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  if (EFI_ERROR (PeiServicesInstallPpi (&mVariablePpiList))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free what the test generated and drop the HOBs, PPIs and policies it left.
+
+  @param[in]  Context   Not used.
+**/
+STATIC
+VOID
+EFIAPI
+CreatorTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mKnobNames != NULL) {
+    FreePool (mKnobNames);
+    mKnobNames = NULL;
+  }
+
+  if (mKnobValues != NULL) {
+    FreePool (mKnobValues);
+    mKnobValues = NULL;
+  }
+
+  if (mProfileValues != NULL) {
+    FreePool (mProfileValues);
+    mProfileValues = NULL;
+  }
+
+  if (mProfileOverrides != NULL) {
+    FreePool (mProfileOverrides);
+    mProfileOverrides = NULL;
+  }
+
+  if (mNvStorage != NULL) {
+    FreePool (mNvStorage);
+    mNvStorage = NULL;
+  }
+
+  if (mPolicyImageFile != NULL) {
+    FreePool (mPolicyImageFile);
+    mPolicyImageFile = NULL;
+  }
+
+  gNumKnobs       = 0;
+  mOpenPhaseCount = 0;
+  HostHobLibReset ();
+  HostPeiServicesLibReset ();
+  HostPolicyLibReset ();
+}
+
+/**
+  Run the creator and check every knob of the policy it published.
+
+  @param[in]  Context   The test context.
+
+  @retval     UNIT_TEST_PASSED              Every knob has its expected value.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CreatorPublishesExpectedKnobs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                  Status;
+  OEM_CONFIG_POLICY           *Policy;
+  OEM_CONFIG_METADATA_POLICY  Metadata;
+  UINT16                      MetadataSize;
+  CHAR16                      Name[TEST_KNOB_NAME_SIZE];
+  CONST VOID                  *Data;
+  UINT32                      DataSize;
+  UINTN                       Knob;
+
+  DEBUG ((DEBUG_INFO, "\n"));
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyCreatorPeiEntry (NULL, NULL));
+
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    UT_ASSERT_MEM_EQUAL (gKnobData[Knob].CacheValueAddress, ExpectedKnobValue (Knob), gKnobData[Knob].ValueSize);
+  }
+
+  MetadataSize = sizeof (Metadata);
+  UT_ASSERT_NOT_EFI_ERROR (GetPolicy (&gOemConfigMetadataPolicyGuid, NULL, &Metadata, &MetadataSize));
+  UT_ASSERT_EQUAL (Metadata.ActiveProfileIndex, FixedPcdGet32 (PcdActiveProfileIndex));
+  UT_ASSERT_FALSE (Metadata.ConfigUnchanged);
+  UT_ASSERT_NOT_NULL (GetFirstGuidHob (&gOemConfigSnapshotHobGuid));
+
+  UT_ASSERT_NOT_EFI_ERROR (OemConfigPolicyOpen (&Policy));
+  for (Knob = 0; Knob < gNumKnobs; Knob++) {
+    AsciiStrToUnicodeStrS (gKnobData[Knob].Name, Name, ARRAY_SIZE (Name));
+    Status = OemConfigPolicyGetKnob (Policy, Name, &gKnobData[Knob].VendorNamespace, &Data, &DataSize);
+    if (EFI_ERROR (Status) || (DataSize != gKnobData[Knob].ValueSize) || (CompareMem (Data, ExpectedKnobValue (Knob), DataSize) != 0)) {
+      OemConfigPolicyClose (Policy);
+      UT_LOG_ERROR ("Knob %a is wrong in the policy. Status %r\n", gKnobData[Knob].Name, Status);
+      return UNIT_TEST_ERROR_TEST_FAILED;
+    }
+  }
+
+  OemConfigPolicyClose (Policy);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Run the creator from a policy image file and check that the image patched with the final knob cache
+  is the policy that serializing every knob creates.
+
+  @param[in]  Context   The test context.
+
+  @retval     UNIT_TEST_PASSED              The policies are the same.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CreatorPatchesPolicyImage (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID     *Patched;
+  VOID     *Serialized;
+  UINT32   PatchedSize;
+  UINT32   SerializedSize;
+  BOOLEAN  Same;
+
+  UT_ASSERT_EQUAL (CreatorPublishesExpectedKnobs (Context), UNIT_TEST_PASSED);
+
+  UT_ASSERT_NOT_EFI_ERROR (CreateConfPolicyFromImage (FixedPcdGet32 (PcdActiveProfileIndex), &Patched, &PatchedSize));
+  UT_ASSERT_NOT_EFI_ERROR (SerializeConfPolicy (&Serialized, &SerializedSize));
+
+  Same = (PatchedSize == SerializedSize) && (CompareMem (Patched, Serialized, SerializedSize) == 0);
+  FreePool (Patched);
+  FreePool (Serialized);
+
+  UT_ASSERT_TRUE (Same);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Run the creator with a policy image file of another build and check that the image is not used.
+
+  @param[in]  Context   The test context.
+
+  @retval     UNIT_TEST_PASSED              The policy was serialized.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CreatorIgnoresStalePolicyImage (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID    *Patched;
+  UINT32  PatchedSize;
+
+  UT_ASSERT_EQUAL (CreatorPublishesExpectedKnobs (Context), UNIT_TEST_PASSED);
+  UT_ASSERT_STATUS_EQUAL (CreateConfPolicyFromImage (FixedPcdGet32 (PcdActiveProfileIndex), &Patched, &PatchedSize), EFI_NOT_FOUND);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CreatorTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+  DEBUG ((
+    DEBUG_INFO,
+    "Variable overrides are read %a.\n",
+    FeaturePcdGet (PcdOemConfigScanVariableStores) ? "by walking the variable stores" : "through the variable PPI"
+    ));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&CreatorTests, Framework, "Config Policy Creator Tests", "OemPkg.OemConfigPolicyCreatorPei", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CreatorTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (CreatorTests, "Policy of 10 knobs", "10Knobs", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m10Knobs);
+  AddTestCase (CreatorTests, "Policy of 100 knobs", "100Knobs", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m100Knobs);
+  AddTestCase (CreatorTests, "Policy of 1000 knobs", "1000Knobs", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m1000Knobs);
+  AddTestCase (CreatorTests, "Policy of 5000 knobs", "5000Knobs", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m5000Knobs);
+  AddTestCase (CreatorTests, "Policy of 20000 knobs", "20000Knobs", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m20000Knobs);
+  AddTestCase (CreatorTests, "Policy of 1000 knobs from the default image", "1000KnobsDefaultImage", CreatorPatchesPolicyImage, CreatorTestSetup, CreatorTestCleanup, &m1000KnobsDefaultImage);
+  AddTestCase (CreatorTests, "Policy of 1000 knobs from the profile images", "1000KnobsProfileImages", CreatorPatchesPolicyImage, CreatorTestSetup, CreatorTestCleanup, &m1000KnobsProfileImages);
+  AddTestCase (CreatorTests, "Policy of 20000 knobs from the profile images", "20000KnobsProfileImages", CreatorPatchesPolicyImage, CreatorTestSetup, CreatorTestCleanup, &m20000KnobsProfileImages);
+  AddTestCase (CreatorTests, "Policy image of another build is ignored", "StaleImage", CreatorIgnoresStalePolicyImage, CreatorTestSetup, CreatorTestCleanup, &m100KnobsStaleImage);
+  AddTestCase (CreatorTests, "Override store of 1000 knobs from another build", "1000KnobsStaleStore", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m1000KnobsStaleStore);
+  AddTestCase (CreatorTests, "Override store of 20000 knobs from another build", "20000KnobsStaleStore", CreatorPublishesExpectedKnobs, CreatorTestSetup, CreatorTestCleanup, &m20000KnobsStaleStore);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
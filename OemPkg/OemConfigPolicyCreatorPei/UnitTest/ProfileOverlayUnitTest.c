@@ -0,0 +1,524 @@
+/** @file ProfileOverlayUnitTest.c
+
+  Host based unit tests of ApplyProfileStack against the ApplyProfileOverrides it replaced.
+
+  Random knob tables and profiles are generated for each iteration: knobs of 1 to 8 bytes, profiles
+  that override a knob more than once, profiles with an override for a knob the table does not have,
+  and tables whose knobs are out of order. The reference applies the base profiles of
+  PcdOemConfigBaseProfiles and then the active profile one after another with ApplyProfileOverrides,
+  leaving the cache as it was when a profile fails, which is what dropping the profile as a whole
+  means. ApplyProfileStack must leave the same knob cache and fail for the same active profiles.
+
+  OemPkgHostTest.dsc builds the test twice, without base profiles, where the active profile alone is
+  compared with ApplyProfileOverrides, and with a stack of base profiles that includes an index past
+  the generated profiles. A benchmark times both over 20000 knobs.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <PiPei.h>
+#include <ConfigStdStructDefs.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PlatformConfigDataLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../OemConfigPolicyCreatorPei.h"
+
+#define UNIT_TEST_APP_NAME     "ProfileOverlay Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_KNOB_MAX             20000
+#define TEST_PROFILE_MAX          8
+#define TEST_VALUE_MAX            8
+#define TEST_RANDOM_KNOB_MAX      256
+#define TEST_ITERATIONS           2000
+#define TEST_BENCHMARK_PROFILES   4
+#define TEST_BENCHMARK_OVERRIDES  (TEST_KNOB_MAX / 2)
+#define TEST_BENCHMARK_ROUNDS     20
+
+//
+// The generated platform config data.
+//
+KNOB_DATA  gKnobData[TEST_KNOB_MAX];
+UINTN      gNumKnobs = 0;
+PROFILE    gProfileData[TEST_PROFILE_MAX];
+UINTN      gNumProfiles = 0;
+
+STATIC UINT8             *mKnobValues     = NULL;   // Default and then cache value of every knob.
+STATIC PROFILE_OVERRIDE  *mOverrides      = NULL;
+STATIC UINT8             *mOverrideValues = NULL;
+STATIC UINT8             *mReference      = NULL;   // Cache values the reference left.
+STATIC UINT8             *mSaved          = NULL;   // Cache values before a reference profile.
+STATIC UINT32            mRandomState;
+
+/**
+  Get the current time in nanoseconds.
+
+  @return     Nanoseconds since an arbitrary start.
+**/
+STATIC
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Get the next pseudo random number. The sequence is the same on every run.
+
+  @retval   The number.
+**/
+STATIC
+UINT32
+NextRandom (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState << 13;
+  mRandomState ^= mRandomState >> 17;
+  mRandomState ^= mRandomState << 5;
+  return mRandomState;
+}
+
+/**
+  Get the cache values of every knob. They follow the default values.
+
+  @retval   The cache values.
+**/
+STATIC
+UINT8 *
+CacheValues (
+  VOID
+  )
+{
+  return &mKnobValues[gNumKnobs * TEST_VALUE_MAX];
+}
+
+/**
+  Put the default value of every knob in its cache.
+**/
+STATIC
+VOID
+ResetCache (
+  VOID
+  )
+{
+  CopyMem (CacheValues (), mKnobValues, gNumKnobs * TEST_VALUE_MAX);
+}
+
+/**
+  The profile apply before ApplyProfileStack, without its debug output and assert.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData.
+
+  @retval EFI_SUCCESS             The profile was applied.
+  @retval EFI_INVALID_PARAMETER   The profile names a knob out of order. The knobs it wrote were set
+                                  back to their defaults.
+**/
+STATIC
+EFI_STATUS
+ApplyProfileOverrides (
+  UINT32  ActiveProfileIndex
+  )
+{
+  PROFILE  *ActiveProfile = &gProfileData[ActiveProfileIndex];
+  UINTN    i;
+  UINTN    Knob;
+
+  for (i = 0; i < ActiveProfile->OverrideCount; i++) {
+    Knob = ActiveProfile->Overrides[i].Knob;
+    if ((Knob >= gNumKnobs) || (Knob != gKnobData[Knob].Knob)) {
+      if (i == 0) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      i--;
+      for ( ; i > 0; i--) {
+        Knob = ActiveProfile->Overrides[i].Knob;
+        CopyMem (gKnobData[Knob].CacheValueAddress, gKnobData[Knob].DefaultValueAddress, gKnobData[Knob].ValueSize);
+      }
+
+      Knob = ActiveProfile->Overrides[i].Knob;
+      CopyMem (gKnobData[Knob].CacheValueAddress, gKnobData[Knob].DefaultValueAddress, gKnobData[Knob].ValueSize);
+
+      return EFI_INVALID_PARAMETER;
+    }
+
+    CopyMem (gKnobData[Knob].CacheValueAddress, ActiveProfile->Overrides[i].Value, gKnobData[Knob].ValueSize);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Apply one profile of the reference stack. A profile that fails leaves the cache as it was.
+
+  @param[in]  ProfileIndex  Index into gProfileData, which may be out of range.
+
+  @retval     TRUE          The profile was applied.
+  @retval     FALSE         The profile was dropped.
+**/
+STATIC
+BOOLEAN
+ReferenceApplyProfile (
+  IN UINT32  ProfileIndex
+  )
+{
+  if (ProfileIndex >= gNumProfiles) {
+    return FALSE;
+  }
+
+  CopyMem (mSaved, CacheValues (), gNumKnobs * TEST_VALUE_MAX);
+  if (EFI_ERROR (ApplyProfileOverrides (ProfileIndex))) {
+    CopyMem (CacheValues (), mSaved, gNumKnobs * TEST_VALUE_MAX);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Apply the base profiles and the active profile one after another into mReference.
+
+  @param[in]  ActiveProfileIndex  Index into gProfileData, which may be out of range, or
+                                  GENERIC_PROFILE_INDEX.
+
+  @retval     The status ApplyProfileStack should return.
+**/
+STATIC
+EFI_STATUS
+ReferenceApplyStack (
+  IN UINT32  ActiveProfileIndex
+  )
+{
+  EFI_STATUS   Status;
+  CONST UINT8  *BaseProfiles;
+  UINTN        Index;
+
+  ResetCache ();
+
+  BaseProfiles = (CONST UINT8 *)PcdGetPtr (PcdOemConfigBaseProfiles);
+  for (Index = 0; (Index < PcdGetSize (PcdOemConfigBaseProfiles)) && (BaseProfiles[Index] != 0xFF); Index++) {
+    ReferenceApplyProfile (BaseProfiles[Index]);
+  }
+
+  Status = EFI_SUCCESS;
+  if ((ActiveProfileIndex != GENERIC_PROFILE_INDEX) && !ReferenceApplyProfile (ActiveProfileIndex)) {
+    Status = EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (mReference, CacheValues (), gNumKnobs * TEST_VALUE_MAX);
+  return Status;
+}
+
+/**
+  Generate a knob table and its profiles.
+
+  @param[in]  KnobCount     Number of knobs.
+  @param[in]  ProfileCount  Number of profiles.
+  @param[in]  MaxOverrides  Most overrides in a profile.
+  @param[in]  Corrupt       Sometimes generate a bad override or a knob out of order.
+
+  @retval     TRUE          The tables were generated.
+  @retval     FALSE         Memory allocation failed.
+**/
+STATIC
+BOOLEAN
+BuildTables (
+  IN UINTN    KnobCount,
+  IN UINTN    ProfileCount,
+  IN UINTN    MaxOverrides,
+  IN BOOLEAN  Corrupt
+  )
+{
+  UINTN  Knob;
+  UINTN  Profile;
+  UINTN  Index;
+  UINTN  Byte;
+  UINTN  OverrideCount;
+
+  mKnobValues     = AllocatePool (KnobCount * TEST_VALUE_MAX * 2);
+  mReference      = AllocatePool (KnobCount * TEST_VALUE_MAX);
+  mSaved          = AllocatePool (KnobCount * TEST_VALUE_MAX);
+  mOverrides      = AllocatePool (ProfileCount * MaxOverrides * sizeof (PROFILE_OVERRIDE));
+  mOverrideValues = AllocatePool (ProfileCount * MaxOverrides * TEST_VALUE_MAX);
+  if ((mKnobValues == NULL) || (mReference == NULL) || (mSaved == NULL) || (mOverrides == NULL) || (mOverrideValues == NULL)) {
+    return FALSE;
+  }
+
+  gNumKnobs    = KnobCount;
+  gNumProfiles = ProfileCount;
+
+  for (Knob = 0; Knob < KnobCount; Knob++) {
+    ZeroMem (&gKnobData[Knob], sizeof (gKnobData[Knob]));
+    gKnobData[Knob].Knob                = Knob;
+    gKnobData[Knob].DefaultValueAddress = &mKnobValues[Knob * TEST_VALUE_MAX];
+    gKnobData[Knob].CacheValueAddress   = &mKnobValues[(KnobCount + Knob) * TEST_VALUE_MAX];
+    gKnobData[Knob].ValueSize           = 1 + NextRandom () % TEST_VALUE_MAX;
+    for (Byte = 0; Byte < TEST_VALUE_MAX; Byte++) {
+      mKnobValues[Knob * TEST_VALUE_MAX + Byte] = (UINT8)NextRandom ();
+    }
+  }
+
+  for (Profile = 0; Profile < ProfileCount; Profile++) {
+    OverrideCount = (MaxOverrides == TEST_BENCHMARK_OVERRIDES) ? MaxOverrides : NextRandom () % (MaxOverrides + 1);
+
+    gProfileData[Profile].Overrides     = &mOverrides[Profile * MaxOverrides];
+    gProfileData[Profile].OverrideCount = OverrideCount;
+    for (Index = 0; Index < OverrideCount; Index++) {
+      mOverrides[Profile * MaxOverrides + Index].Knob  = NextRandom () % KnobCount;
+      mOverrides[Profile * MaxOverrides + Index].Value = &mOverrideValues[(Profile * MaxOverrides + Index) * TEST_VALUE_MAX];
+      for (Byte = 0; Byte < TEST_VALUE_MAX; Byte++) {
+        mOverrideValues[(Profile * MaxOverrides + Index) * TEST_VALUE_MAX + Byte] = (UINT8)NextRandom ();
+      }
+    }
+
+    if (Corrupt && (OverrideCount != 0) && ((NextRandom () % 6) == 0)) {
+      mOverrides[Profile * MaxOverrides + NextRandom () % OverrideCount].Knob = KnobCount + NextRandom () % 3;
+    }
+  }
+
+  if (Corrupt && ((NextRandom () % 20) == 0)) {
+    gKnobData[NextRandom () % KnobCount].Knob = KnobCount;
+  }
+
+  ResetCache ();
+  return TRUE;
+}
+
+/**
+  Free the generated tables.
+
+  @param[in]  Context   Not used.
+**/
+STATIC
+VOID
+EFIAPI
+FreeTables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mKnobValues != NULL) {
+    FreePool (mKnobValues);
+    mKnobValues = NULL;
+  }
+
+  if (mReference != NULL) {
+    FreePool (mReference);
+    mReference = NULL;
+  }
+
+  if (mSaved != NULL) {
+    FreePool (mSaved);
+    mSaved = NULL;
+  }
+
+  if (mOverrides != NULL) {
+    FreePool (mOverrides);
+    mOverrides = NULL;
+  }
+
+  if (mOverrideValues != NULL) {
+    FreePool (mOverrideValues);
+    mOverrideValues = NULL;
+  }
+
+  gNumKnobs    = 0;
+  gNumProfiles = 0;
+}
+
+/**
+  ApplyProfileStack leaves the knob cache the reference leaves, and fails for the same active
+  profiles, for every active profile, one past the last and GENERIC_PROFILE_INDEX.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+StackMatchesOverrides (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Expected;
+  EFI_STATUS  Status;
+  UINTN       Iteration;
+  UINT32      Active;
+  UINTN       Cases;
+  UINTN       FailedCases;
+
+  mRandomState = 0x6C078965;
+  Cases        = 0;
+  FailedCases  = 0;
+
+  for (Iteration = 0; Iteration < TEST_ITERATIONS; Iteration++) {
+    UT_ASSERT_TRUE (
+      BuildTables (
+        1 + NextRandom () % TEST_RANDOM_KNOB_MAX,
+        1 + NextRandom () % TEST_PROFILE_MAX,
+        TEST_RANDOM_KNOB_MAX + 8,
+        TRUE
+        )
+      );
+
+    for (Active = 0; Active <= gNumProfiles + 1; Active++) {
+      if (Active == gNumProfiles + 1) {
+        Active = GENERIC_PROFILE_INDEX;
+      }
+
+      Expected = ReferenceApplyStack (Active);
+      ResetCache ();
+      Status = ApplyProfileStack (Active);
+
+      if ((Status != Expected) || (CompareMem (CacheValues (), mReference, gNumKnobs * TEST_VALUE_MAX) != 0)) {
+        UT_LOG_ERROR ("Iteration %d, active profile 0x%x: %r, expected %r\n", Iteration, Active, Status, Expected);
+        UT_ASSERT_STATUS_EQUAL (Status, Expected);
+        UT_ASSERT_MEM_EQUAL (CacheValues (), mReference, gNumKnobs * TEST_VALUE_MAX);
+      }
+
+      Cases++;
+      if (EFI_ERROR (Expected)) {
+        FailedCases++;
+      }
+
+      if (Active == GENERIC_PROFILE_INDEX) {
+        break;
+      }
+    }
+
+    FreeTables (NULL);
+  }
+
+  UT_LOG_INFO ("%d cases, %d with an active profile that fails\n", Cases, FailedCases);
+  UT_ASSERT_NOT_EQUAL (FailedCases, 0);
+  UT_ASSERT_NOT_EQUAL (FailedCases, Cases);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Time the reference and ApplyProfileStack over 20000 knobs and profiles that each override half of
+  them.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              The test passed.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Benchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Round;
+  UINT64  Start;
+  UINT64  ReferenceNanoseconds;
+  UINT64  StackNanoseconds;
+
+  mRandomState = 0x2545F491;
+  UT_ASSERT_TRUE (BuildTables (TEST_KNOB_MAX, TEST_BENCHMARK_PROFILES, TEST_BENCHMARK_OVERRIDES, FALSE));
+
+  Start = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    UT_ASSERT_NOT_EFI_ERROR (ReferenceApplyStack (TEST_BENCHMARK_PROFILES - 1));
+  }
+
+  ReferenceNanoseconds = GetNanoseconds () - Start;
+
+  Start = GetNanoseconds ();
+  for (Round = 0; Round < TEST_BENCHMARK_ROUNDS; Round++) {
+    ResetCache ();
+    UT_ASSERT_NOT_EFI_ERROR (ApplyProfileStack (TEST_BENCHMARK_PROFILES - 1));
+  }
+
+  StackNanoseconds = GetNanoseconds () - Start;
+
+  UT_ASSERT_MEM_EQUAL (CacheValues (), mReference, gNumKnobs * TEST_VALUE_MAX);
+  UT_LOG_INFO (
+    "%d knobs: profiles one after another %ld us, stacked %ld us\n",
+    TEST_KNOB_MAX,
+    DivU64x32 (ReferenceNanoseconds, TEST_BENCHMARK_ROUNDS * 1000),
+    DivU64x32 (StackNanoseconds, TEST_BENCHMARK_ROUNDS * 1000)
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      StackTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&StackTests, Framework, "Profile Stack Tests", "OemPkg.OemConfigPolicyCreatorPei.ProfileOverlay", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for StackTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (StackTests, "The stack matches applying profiles one after another", "Random", StackMatchesOverrides, NULL, FreeTables, NULL);
+  AddTestCase (StackTests, "Applying profiles is timed", "Benchmark", Benchmark, NULL, FreeTables, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
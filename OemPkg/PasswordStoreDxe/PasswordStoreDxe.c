@@ -0,0 +1,345 @@
+/** @file PasswordStoreDxe.c
+
+  This module owns the platform ADMIN password store and produces the PasswordStore protocol that
+  PasswordStoreLib forwards to.
+
+  The store variable is read once at entry and kept in memory. Only SetPassword writes the variable, and
+  it refreshes the cached copy when it does, so checking whether a password is set or authenticating a
+  password does not read the variable again. The no-password hash is also generated once here rather
+  than in every image that links the library.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Guid/PasswordStoreVariable.h>
+
+#include <Protocol/PasswordStore.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PasswordPolicyLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+STATIC PASSWORD_HASH  mStore                = NULL;   // Cached copy of the store variable.
+STATIC UINTN          mStoreSize            = 0;
+STATIC PASSWORD_HASH  mNullPasswordHash     = NULL;
+STATIC UINTN          mNullPasswordHashSize = 0;
+
+/**
+  Compare two buffers in time that depends only on their size.
+
+  @param[in]  Buffer1   First buffer.
+  @param[in]  Buffer2   Second buffer.
+  @param[in]  Size      Number of bytes to compare.
+
+  @retval     TRUE    The buffers are equal.
+  @retval     FALSE   The buffers differ.
+
+**/
+STATIC
+BOOLEAN
+ConstantTimeCompare (
+  IN CONST UINT8  *Buffer1,
+  IN CONST UINT8  *Buffer2,
+  IN UINTN        Size
+  )
+{
+  UINTN  Index;
+  UINT8  Difference;
+
+  Difference = 0;
+  for (Index = 0; Index < Size; Index++) {
+    Difference |= Buffer1[Index] ^ Buffer2[Index];
+  }
+
+  return (BOOLEAN)(Difference == 0);
+}
+
+/**
+  Write the store variable and replace the cached copy.
+
+  @param[in]  PasswordHash        Pointer to the password hash
+  @param[in]  PasswordHashSize    Size of the password hash
+
+  @retval     EFI_SUCCESS             Password stored successfully.
+  @retval     EFI_OUT_OF_RESOURCES    There is no memory for the cached copy. Nothing was written.
+  @retval     EFI_ABORTED             The variable could not be written.
+  @retval     Others                  The hash is not valid.
+
+**/
+STATIC
+EFI_STATUS
+WriteStore (
+  IN  CONST UINT8  *PasswordHash,
+  IN        UINTN  PasswordHashSize
+  )
+{
+  EFI_STATUS     Status;
+  PASSWORD_HASH  NewStore;
+
+  Status = PasswordPolicyValidatePasswordHash ((PASSWORD_HASH)PasswordHash, PasswordHashSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  NewStore = AllocateCopyPool (PasswordHashSize, PasswordHash);
+  if (NewStore == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gRT->SetVariable (
+                  PASSWORD_STORE_ADMIN_VARIABLE_NAME,
+                  &PASSWORD_STORE_ADMIN_NAMESPACE_GUID,
+                  PASSWORD_STORE_ADMIN_VARIABLE_ATTRS,
+                  PasswordHashSize,
+                  NewStore
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to write the password store. Status = %r.\n", __FUNCTION__, Status));
+    ZeroMem (NewStore, PasswordHashSize);
+    FreePool (NewStore);
+    return EFI_ABORTED;
+  }
+
+  if (mStore != NULL) {
+    ZeroMem (mStore, mStoreSize);
+    FreePool (mStore);
+  }
+
+  mStore     = NewStore;
+  mStoreSize = PasswordHashSize;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Store a new password hash, as generated by PasswordPolicyGeneratePasswordHash.
+
+  @param[in]  This              Protocol instance.
+  @param[in]  PasswordHash      The password hash.
+  @param[in]  PasswordHashSize  Size of PasswordHash in bytes.
+
+  @retval     EFI_SUCCESS             The hash was stored.
+  @retval     EFI_INVALID_PARAMETER   PasswordHash is NULL or not a valid password hash.
+  @retval     EFI_ABORTED             The store variable could not be written.
+  @retval     EFI_OUT_OF_RESOURCES    There is no memory for the cached copy. Nothing was written.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+PasswordStoreDxeSetPassword (
+  IN  PASSWORD_STORE_PROTOCOL  *This,
+  IN  CONST UINT8              *PasswordHash,
+  IN  UINTN                    PasswordHashSize
+  )
+{
+  if (PasswordHash == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return WriteStore (PasswordHash, PasswordHashSize);
+}
+
+/**
+  Determine whether an administrator password is set.
+
+  @param[in]  This    Protocol instance.
+
+  @retval     TRUE    A password is set.
+  @retval     FALSE   No password is set, or the store could not be read.
+
+**/
+STATIC
+BOOLEAN
+EFIAPI
+PasswordStoreDxeIsPasswordSet (
+  IN  PASSWORD_STORE_PROTOCOL  *This
+  )
+{
+  if ((mStore == NULL) || (mStoreSize == 0)) {
+    return FALSE;
+  }
+
+  // Any store other than the no-password hash is a password.
+  //
+  if ((mStoreSize == mNullPasswordHashSize) && (CompareMem (mStore, mNullPasswordHash, mStoreSize) == 0)) {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Check a password against the stored password hash.
+
+  NOTE: This function does NOT perform string validation on the password
+        being authenticated. This is to accommodate changing valid character sets.
+        Will still make sure that string does not exceed max buffer size.
+
+  @param[in]  This        Protocol instance.
+  @param[in]  Password    Password to check.
+
+  @retval     TRUE    Password matches the stored password, or no password is set.
+  @retval     FALSE   Password is NULL or empty, or does not match.
+
+**/
+STATIC
+BOOLEAN
+EFIAPI
+PasswordStoreDxeAuthenticatePassword (
+  IN  PASSWORD_STORE_PROTOCOL  *This,
+  IN  CONST CHAR16             *Password
+  )
+{
+  EFI_STATUS     Status;
+  BOOLEAN        Result = FALSE;
+  UINTN          DataSize;
+  CHAR16         TempPassword[PW_MAX_LENGTH + 1];       // Maximum password length plus a NULL terminator.
+  PASSWORD_HASH  NewStore = NULL;
+  PASSWORD_HASH  UpgradedStore;
+  UINTN          UpgradedStoreSize;
+
+  // If there is no password set, all accesses should authenticate.
+  if (!PasswordStoreDxeIsPasswordSet (This)) {
+    return TRUE;
+  }
+
+  if ((Password == NULL) || (Password[0] == '\0')) {
+    return FALSE;
+  }
+
+  // Prep the password for evaluation.
+  PasswordPolicySafeCopyPassword (
+    TempPassword,
+    ARRAY_SIZE (TempPassword),
+    Password
+    );
+
+  //
+  // Step 1: Build a new store from the cached one so that the keys can be compared.
+  Status = PasswordPolicyGeneratePasswordHash (
+             mStore,                                          // Use existing Version and Salt
+             TempPassword,                                    // Password
+             &NewStore,                                       // Store
+             &DataSize
+             );
+
+  //
+  // Step 2: Compare the stores without stopping at the first difference.
+  if (!EFI_ERROR (Status) && (DataSize == mStoreSize)) {
+    Result = ConstantTimeCompare (mStore, NewStore, DataSize);
+  }
+
+  //
+  // Step 3: The password is known to be good, so rehash it if the store uses an old format or cost.
+  // A failure here, such as for a password below the class minimums a new password needs, leaves the
+  // old store in place; it still authenticates.
+  if (Result && !PasswordPolicyIsPasswordHashCurrent (mStore, mStoreSize)) {
+    Status = PasswordPolicyGeneratePasswordHash (
+               NULL,                                            // New Version and Salt
+               TempPassword,                                    // Password
+               &UpgradedStore,                                  // Store
+               &UpgradedStoreSize
+               );
+    if (!EFI_ERROR (Status)) {
+      Status = WriteStore (UpgradedStore, UpgradedStoreSize);
+      ZeroMem (UpgradedStore, UpgradedStoreSize);
+      FreePool (UpgradedStore);
+    }
+
+    DEBUG ((DEBUG_INFO, "%a - Password store upgrade. Status = %r.\n", __FUNCTION__, Status));
+  }
+
+  // Always put away your toys.
+  PasswordPolicyCleansePwBuffer (TempPassword, sizeof (TempPassword));
+
+  if (NULL != NewStore) {
+    ZeroMem (NewStore, DataSize);
+    FreePool (NewStore);
+  }
+
+  return Result;
+}
+
+STATIC PASSWORD_STORE_PROTOCOL  mPasswordStoreProtocol = {
+  PasswordStoreDxeIsPasswordSet,
+  PasswordStoreDxeAuthenticatePassword,
+  PasswordStoreDxeSetPassword
+};
+
+/**
+  Entry point for the PasswordStore driver. Loads the store, initializing it to the no-password hash
+  if it is missing or has the wrong attributes, and installs the PasswordStore protocol.
+
+  There is an assumption that the Password Variable will be locked. That will be up to the platform.
+
+  @param[in]  ImageHandle   The image handle of this driver.
+  @param[in]  SystemTable   The UEFI system table.
+
+  @retval     EFI_SUCCESS   The protocol was installed.
+  @retval     Others        The driver could not start.
+
+**/
+EFI_STATUS
+EFIAPI
+PasswordStoreDxeEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS     Status;
+  UINT32         Attributes;
+  UINTN          DataSize;
+  PASSWORD_HASH  Store = NULL;
+
+  Status = PasswordPolicyGeneratePasswordHash (NULL, NULL, &mNullPasswordHash, &mNullPasswordHashSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to generate the no-password hash. Status = %r.\n", __FUNCTION__, Status));
+    return Status;
+  }
+
+  Status = GetVariable3 (
+             PASSWORD_STORE_ADMIN_VARIABLE_NAME,
+             &PASSWORD_STORE_ADMIN_NAMESPACE_GUID,
+             (VOID **)&Store,
+             &DataSize,
+             &Attributes
+             );
+
+  // Make sure that password is found and has the correct attributes. If not, initialize it.
+  if (EFI_ERROR (Status) || (DataSize == 0) || (Attributes != PASSWORD_STORE_ADMIN_VARIABLE_ATTRS)) {
+    if (Store != NULL) {
+      FreePool (Store);
+    }
+
+    Status = WriteStore (mNullPasswordHash, mNullPasswordHashSize);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a - Failed to properly initialize password! Status = %r.\n", __FUNCTION__, Status));
+      ASSERT (FALSE);
+    }
+  } else {
+    mStore     = Store;
+    mStoreSize = DataSize;
+  }
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &ImageHandle,
+                  &gPasswordStoreProtocolGuid,
+                  &mPasswordStoreProtocol,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to install the PasswordStore protocol. Status = %r.\n", __FUNCTION__, Status));
+  }
+
+  return Status;
+}
@@ -0,0 +1,211 @@
+/** @file Pbkdf2CryptLib.c
+
+  PBKDF2-HMAC-SHA256 on the SHA-256 functions of BaseCryptLib, with progress.
+
+  Pkcs5HashPassword can neither report progress nor be cancelled, and the portable compression
+  function of Pbkdf2Sha256.c is about half as fast as BaseCryptLib. This computes the same HMAC
+  chain as Pkcs5HashPassword from SHA-256 contexts of the HMAC pads, hashed once and duplicated for
+  every HMAC the way Pkcs5HashPassword duplicates its HMAC context, so it runs at BaseCryptLib speed
+  while reporting progress. It only runs on the BSP, since BaseCryptLib may call a protocol.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "Pkcs5PasswordHashDxe.h"
+
+#define HMAC_IPAD  0x36
+#define HMAC_OPAD  0x5C
+
+/**
+  Hashes an HMAC pad into a new SHA-256 context.
+
+  @param[out] Context   SHA-256 context to start.
+  @param[in]  Key       PBKDF2_SHA256_BLOCK_SIZE bytes of HMAC key.
+  @param[in]  PadByte   HMAC_IPAD or HMAC_OPAD.
+
+  @retval     TRUE    Context holds the pad.
+  @retval     FALSE   BaseCryptLib failed.
+
+**/
+STATIC
+BOOLEAN
+HashPad (
+  OUT VOID         *Context,
+  IN  CONST UINT8  *Key,
+  IN  UINT8        PadByte
+  )
+{
+  UINT8    Pad[PBKDF2_SHA256_BLOCK_SIZE];
+  UINTN    Index;
+  BOOLEAN  Result;
+
+  for (Index = 0; Index < PBKDF2_SHA256_BLOCK_SIZE; Index++) {
+    Pad[Index] = Key[Index] ^ PadByte;
+  }
+
+  Result = Sha256Init (Context) && Sha256Update (Context, Pad, sizeof (Pad));
+  ZeroMem (Pad, sizeof (Pad));
+  return Result;
+}
+
+/**
+  Finishes an HMAC whose message has been hashed into a copy of the inner pad context.
+
+  @param[in,out]  Work    The inner pad context with the message hashed into it. It is reused.
+  @param[in]      Outer   Context of the outer pad.
+  @param[out]     Digest  PBKDF2_SHA256_DIGEST_SIZE bytes receiving the HMAC.
+
+  @retval     TRUE    Digest holds the HMAC.
+  @retval     FALSE   BaseCryptLib failed.
+
+**/
+STATIC
+BOOLEAN
+HmacFinish (
+  IN OUT VOID        *Work,
+  IN     CONST VOID  *Outer,
+  OUT    UINT8       *Digest
+  )
+{
+  return Sha256Final (Work, Digest) &&
+         Sha256Duplicate (Outer, Work) &&
+         Sha256Update (Work, Digest, PBKDF2_SHA256_DIGEST_SIZE) &&
+         Sha256Final (Work, Digest);
+}
+
+/**
+  Derives a key with PBKDF2-HMAC-SHA256 (RFC 8018) on the BSP, reporting progress every
+  PBKDF2_PROGRESS_INTERVAL iterations. The key is the one Pkcs5HashPassword derives.
+
+  @param[in]      Password        Password buffer.
+  @param[in]      PasswordSize    Size of Password in bytes.
+  @param[in]      Salt            Salt buffer.
+  @param[in]      SaltSize        Size of Salt in bytes.
+  @param[in]      IterationCount  Number of iterations. Must not be 0.
+  @param[in,out]  Progress        Progress to report. Completed and Total are set here.
+  @param[in]      OutputSize      Number of key bytes to derive.
+  @param[out]     Output          Buffer receiving OutputSize bytes.
+
+  @retval     EFI_SUCCESS           Output holds the derived key.
+  @retval     EFI_ABORTED           The progress callback cancelled the derivation, or BaseCryptLib
+                                    failed. Output is not valid.
+  @retval     EFI_OUT_OF_RESOURCES  The SHA-256 contexts could not be allocated.
+
+**/
+EFI_STATUS
+Pbkdf2Sha256CryptLib (
+  IN     CONST UINT8      *Password,
+  IN     UINTN            PasswordSize,
+  IN     CONST UINT8      *Salt,
+  IN     UINTN            SaltSize,
+  IN     UINTN            IterationCount,
+  IN OUT PBKDF2_PROGRESS  *Progress,
+  IN     UINTN            OutputSize,
+  OUT    UINT8            *Output
+  )
+{
+  UINT8    Key[PBKDF2_SHA256_BLOCK_SIZE];
+  UINT8    Digest[PBKDF2_SHA256_DIGEST_SIZE];
+  UINT8    Result[PBKDF2_SHA256_DIGEST_SIZE];
+  UINT8    BlockIndex[sizeof (UINT32)];
+  UINT8    *Contexts;
+  VOID     *Inner;
+  VOID     *Outer;
+  VOID     *Work;
+  UINTN    ContextSize;
+  UINT32   BlockCount;
+  UINT32   BlockNumber;
+  UINTN    Iteration;
+  UINTN    Offset;
+  UINTN    Index;
+  BOOLEAN  Hashed;
+
+  ContextSize = Sha256GetContextSize ();
+  Contexts    = AllocatePool (3 * ContextSize);
+  if (Contexts == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Inner = Contexts;
+  Outer = Contexts + ContextSize;
+  Work  = Contexts + 2 * ContextSize;
+
+  BlockCount          = (UINT32)((OutputSize + PBKDF2_SHA256_DIGEST_SIZE - 1) / PBKDF2_SHA256_DIGEST_SIZE);
+  Progress->Completed = 0;
+  Progress->Total     = MultU64x32 ((UINT64)IterationCount, BlockCount);
+  Progress->Cancelled = FALSE;
+
+  //
+  // HMAC keys longer than a block are hashed first. The pads are hashed once and every HMAC of the
+  // derivation starts from a copy of them.
+  ZeroMem (Key, sizeof (Key));
+  if (PasswordSize > PBKDF2_SHA256_BLOCK_SIZE) {
+    Hashed = Sha256HashAll (Password, PasswordSize, Key);
+  } else {
+    CopyMem (Key, Password, PasswordSize);
+    Hashed = TRUE;
+  }
+
+  Hashed = Hashed && HashPad (Inner, Key, HMAC_IPAD) && HashPad (Outer, Key, HMAC_OPAD);
+
+  for (BlockNumber = 1; Hashed && !Progress->Cancelled && (BlockNumber <= BlockCount); BlockNumber++) {
+    //
+    // U1 = HMAC (Password, Salt || INT (BlockNumber))
+    BlockIndex[0] = (UINT8)(BlockNumber >> 24);
+    BlockIndex[1] = (UINT8)(BlockNumber >> 16);
+    BlockIndex[2] = (UINT8)(BlockNumber >> 8);
+    BlockIndex[3] = (UINT8)BlockNumber;
+    Hashed        = Sha256Duplicate (Inner, Work) &&
+                    Sha256Update (Work, Salt, SaltSize) &&
+                    Sha256Update (Work, BlockIndex, sizeof (BlockIndex)) &&
+                    HmacFinish (Work, Outer, Digest);
+    CopyMem (Result, Digest, sizeof (Result));
+
+    //
+    // Un = HMAC (Password, Un-1)
+    for (Iteration = 1; Hashed && (Iteration < IterationCount); Iteration++) {
+      Hashed = Sha256Duplicate (Inner, Work) &&
+               Sha256Update (Work, Digest, sizeof (Digest)) &&
+               HmacFinish (Work, Outer, Digest);
+
+      for (Index = 0; Index < sizeof (Result); Index++) {
+        Result[Index] ^= Digest[Index];
+      }
+
+      if ((Iteration & (PBKDF2_PROGRESS_INTERVAL - 1)) == 0) {
+        if (!Progress->Callback (Progress->CallbackContext, Progress->Completed + Iteration, Progress->Total)) {
+          Progress->Cancelled = TRUE;
+          break;
+        }
+      }
+    }
+
+    Progress->Completed += Iteration;
+
+    Offset = (UINTN)(BlockNumber - 1) * PBKDF2_SHA256_DIGEST_SIZE;
+    CopyMem (&Output[Offset], Result, MIN (OutputSize - Offset, PBKDF2_SHA256_DIGEST_SIZE));
+  }
+
+  ZeroMem (Key, sizeof (Key));
+  ZeroMem (Digest, sizeof (Digest));
+  ZeroMem (Result, sizeof (Result));
+  ZeroMem (Contexts, 3 * ContextSize);
+  FreePool (Contexts);
+
+  if (!Hashed) {
+    DEBUG ((DEBUG_ERROR, "%a - SHA-256 failed.\n", __FUNCTION__));
+    return EFI_ABORTED;
+  }
+
+  return Progress->Cancelled ? EFI_ABORTED : EFI_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/** @file Pbkdf2Mp.c
+
+  Computes the output blocks of a PBKDF2 derivation in parallel.
+
+  Each PBKDF2 output block is an independent chain of IterationCount HMACs. A key longer than one
+  digest, such as the 40-byte V1 password key, is therefore several chains that can run at the
+  same time. Each block is a MpJobQueueLib job: blocks are handed to idle application processors
+  and the BSP computes the blocks no AP took, reporting progress as it goes. When MP services are
+  missing or no AP is idle, the BSP computes every block itself. The output is the same either way.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MpJobQueueLib.h>
+
+#include "Pkcs5PasswordHashDxe.h"
+
+// Most blocks queued at once. Longer keys are computed in several rounds.
+#define PBKDF2_MP_MAX_BLOCKS  (MP_JOB_QUEUE_MAX_APS + 1)
+
+//
+// One output block.
+//
+typedef struct {
+  CONST PBKDF2_SHA256_CONTEXT    *Context;
+  UINT32                         BlockNumber;
+  UINT8                          Digest[PBKDF2_SHA256_DIGEST_SIZE];
+} PBKDF2_MP_BLOCK;
+
+/**
+  Job procedure. Computes one output block without reporting progress.
+
+  @param[in,out]  Buffer  The PBKDF2_MP_BLOCK.
+
+**/
+STATIC
+VOID
+EFIAPI
+Pbkdf2MpProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  PBKDF2_MP_BLOCK  *Block;
+
+  Block = (PBKDF2_MP_BLOCK *)Buffer;
+  Pbkdf2Sha256Block (Block->Context, Block->BlockNumber, NULL, Block->Digest);
+}
+
+/**
+  Keeps the progress callback running while the BSP waits for an AP, so the caller's UI stays live.
+
+  @param[in]  Context   The PBKDF2_PROGRESS.
+
+**/
+STATIC
+VOID
+EFIAPI
+Pbkdf2MpWaitCallback (
+  IN VOID  *Context
+  )
+{
+  PBKDF2_PROGRESS  *Progress;
+
+  Progress = (PBKDF2_PROGRESS *)Context;
+  if (!Progress->Cancelled && !Progress->Callback (Progress->CallbackContext, Progress->Completed, Progress->Total)) {
+    Progress->Cancelled = TRUE;
+  }
+}
+
+/**
+  Copies a block into the output buffer, truncating the last block.
+
+  @param[out] Output        Start of the output buffer.
+  @param[in]  OutputSize    Size of the output buffer.
+  @param[in]  BlockNumber   1-based index of the block.
+  @param[in]  Digest        The block.
+
+**/
+STATIC
+VOID
+StoreBlock (
+  OUT UINT8        *Output,
+  IN  UINTN        OutputSize,
+  IN  UINT32       BlockNumber,
+  IN  CONST UINT8  *Digest
+  )
+{
+  UINTN  Offset;
+
+  Offset = (UINTN)(BlockNumber - 1) * PBKDF2_SHA256_DIGEST_SIZE;
+  CopyMem (&Output[Offset], Digest, MIN (OutputSize - Offset, PBKDF2_SHA256_DIGEST_SIZE));
+}
+
+/**
+  Computes the output blocks of a prepared PBKDF2 derivation. Blocks are handed to idle
+  application processors when MP services are available; the rest run on the caller.
+
+  @param[in]      Context     Context prepared by Pbkdf2Sha256Start.
+  @param[in,out]  Progress    Progress to report, or NULL. Completed and Total are set here.
+  @param[in]      OutputSize  Number of key bytes to derive.
+  @param[out]     Output      Buffer receiving OutputSize bytes.
+
+  @retval     TRUE    Output holds the derived key.
+  @retval     FALSE   The progress callback cancelled the derivation. Output is not valid.
+
+**/
+BOOLEAN
+Pbkdf2Sha256Blocks (
+  IN     CONST PBKDF2_SHA256_CONTEXT  *Context,
+  IN OUT PBKDF2_PROGRESS              *Progress OPTIONAL,
+  IN     UINTN                        OutputSize,
+  OUT    UINT8                        *Output
+  )
+{
+  PBKDF2_MP_BLOCK  Blocks[PBKDF2_MP_MAX_BLOCKS];
+  MP_JOB           Jobs[PBKDF2_MP_MAX_BLOCKS];
+  MP_JOB_QUEUE     Queue;
+  MP_JOB           *Job;
+  PBKDF2_MP_BLOCK  *Block;
+  UINT32           BlockCount;
+  UINT32           FirstBlock;
+  UINTN            JobCount;
+  UINTN            Index;
+
+  BlockCount = (UINT32)((OutputSize + PBKDF2_SHA256_DIGEST_SIZE - 1) / PBKDF2_SHA256_DIGEST_SIZE);
+
+  if (Progress != NULL) {
+    Progress->Completed = 0;
+    Progress->Total     = MultU64x32 ((UINT64)Context->IterationCount, BlockCount);
+    Progress->Cancelled = FALSE;
+  }
+
+  for (FirstBlock = 1; FirstBlock <= BlockCount; FirstBlock += (UINT32)JobCount) {
+    JobCount = MIN (BlockCount - FirstBlock + 1, PBKDF2_MP_MAX_BLOCKS);
+    for (Index = 0; Index < JobCount; Index++) {
+      Blocks[Index].Context     = Context;
+      Blocks[Index].BlockNumber = FirstBlock + (UINT32)Index;
+      Jobs[Index].Procedure     = Pbkdf2MpProcedure;
+      Jobs[Index].Buffer        = &Blocks[Index];
+    }
+
+    //
+    // The BSP takes every block no AP took, reporting progress as it goes. After a cancel no
+    // more blocks are started, but a block already running on an AP is always waited for.
+    MpJobQueueStart (&Queue, Jobs, JobCount);
+    for (Job = MpJobQueueNext (&Queue); Job != NULL; Job = MpJobQueueNext (&Queue)) {
+      Block = (PBKDF2_MP_BLOCK *)Job->Buffer;
+      Pbkdf2Sha256Block (Context, Block->BlockNumber, Progress, Block->Digest);
+      Job->Done = TRUE;
+
+      if ((Progress != NULL) && Progress->Cancelled) {
+        MpJobQueueCancel (&Queue);
+      }
+    }
+
+    MpJobQueueWait (&Queue, (Progress != NULL) ? Pbkdf2MpWaitCallback : NULL, Progress);
+
+    if ((Progress != NULL) && Progress->Cancelled) {
+      break;
+    }
+
+    for (Index = 0; Index < JobCount; Index++) {
+      StoreBlock (Output, OutputSize, Blocks[Index].BlockNumber, Blocks[Index].Digest);
+    }
+
+    if (Progress != NULL) {
+      Progress->Completed = MultU64x32 ((UINT64)Context->IterationCount, FirstBlock + (UINT32)JobCount - 1);
+    }
+  }
+
+  ZeroMem (Blocks, sizeof (Blocks));
+
+  return (BOOLEAN)((Progress == NULL) || !Progress->Cancelled);
+}
@@ -0,0 +1,459 @@
+/** @file Pbkdf2Sha256.c
+
+  PBKDF2-HMAC-SHA256 on top of a replaceable SHA-256 compression function.
+
+  An HMAC over a message that fits in one block, as every PBKDF2 iteration after the first
+  is, costs one compression from the saved inner pad state and one from the saved outer pad
+  state. The padded message blocks are built once per output block and only the digest bytes
+  change per iteration.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "Pkcs5PasswordHashDxe.h"
+
+#define HMAC_IPAD  0x36
+#define HMAC_OPAD  0x5C
+
+#define ROTR32(Value, Count)  (((Value) >> (Count)) | ((Value) << (32 - (Count))))
+
+typedef struct {
+  SHA256_COMPRESS    Compress;
+  UINT32             State[PBKDF2_SHA256_STATE_WORDS];
+  UINT8              Buffer[PBKDF2_SHA256_BLOCK_SIZE];
+  UINTN              BufferSize;
+  UINT64             TotalSize;
+} SHA256_STREAM;
+
+STATIC CONST UINT32  mSha256InitialState[PBKDF2_SHA256_STATE_WORDS] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+STATIC CONST UINT32  mSha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+  Reads a big-endian 32-bit value.
+
+  @param[in]  Buffer  Four bytes.
+
+  @retval     The value.
+
+**/
+STATIC
+UINT32
+ReadBe32 (
+  IN CONST UINT8  *Buffer
+  )
+{
+  return ((UINT32)Buffer[0] << 24) | ((UINT32)Buffer[1] << 16) | ((UINT32)Buffer[2] << 8) | (UINT32)Buffer[3];
+}
+
+/**
+  Writes a big-endian 32-bit value.
+
+  @param[out] Buffer  Four bytes.
+  @param[in]  Value   The value.
+
+**/
+STATIC
+VOID
+WriteBe32 (
+  OUT UINT8   *Buffer,
+  IN  UINT32  Value
+  )
+{
+  Buffer[0] = (UINT8)(Value >> 24);
+  Buffer[1] = (UINT8)(Value >> 16);
+  Buffer[2] = (UINT8)(Value >> 8);
+  Buffer[3] = (UINT8)Value;
+}
+
+/**
+  Writes the state words as a SHA-256 digest.
+
+  @param[out] Digest  PBKDF2_SHA256_DIGEST_SIZE bytes.
+  @param[in]  State   The eight state words.
+
+**/
+STATIC
+VOID
+StoreDigest (
+  OUT UINT8         *Digest,
+  IN  CONST UINT32  *State
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < PBKDF2_SHA256_STATE_WORDS; Index++) {
+    WriteBe32 (&Digest[Index * sizeof (UINT32)], State[Index]);
+  }
+}
+
+/**
+  Portable SHA-256 compression function.
+
+  @param[in,out]  State       The eight SHA-256 state words, in native byte order.
+  @param[in]      Blocks      BlockCount consecutive 64-byte message blocks.
+  @param[in]      BlockCount  Number of blocks to process.
+
+**/
+VOID
+EFIAPI
+Sha256CompressScalar (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Blocks,
+  IN     UINTN        BlockCount
+  )
+{
+  UINT32  W[64];
+  UINT32  A, B, C, D, E, F, G, H;
+  UINT32  T1, T2;
+  UINTN   Index;
+
+  for ( ; BlockCount > 0; BlockCount--, Blocks += PBKDF2_SHA256_BLOCK_SIZE) {
+    for (Index = 0; Index < 16; Index++) {
+      W[Index] = ReadBe32 (&Blocks[Index * sizeof (UINT32)]);
+    }
+
+    for (Index = 16; Index < 64; Index++) {
+      T1       = ROTR32 (W[Index - 2], 17) ^ ROTR32 (W[Index - 2], 19) ^ (W[Index - 2] >> 10);
+      T2       = ROTR32 (W[Index - 15], 7) ^ ROTR32 (W[Index - 15], 18) ^ (W[Index - 15] >> 3);
+      W[Index] = T1 + W[Index - 7] + T2 + W[Index - 16];
+    }
+
+    A = State[0];
+    B = State[1];
+    C = State[2];
+    D = State[3];
+    E = State[4];
+    F = State[5];
+    G = State[6];
+    H = State[7];
+
+    for (Index = 0; Index < 64; Index++) {
+      T1 = H + (ROTR32 (E, 6) ^ ROTR32 (E, 11) ^ ROTR32 (E, 25)) + ((E & F) ^ (~E & G)) + mSha256K[Index] + W[Index];
+      T2 = (ROTR32 (A, 2) ^ ROTR32 (A, 13) ^ ROTR32 (A, 22)) + ((A & B) ^ (A & C) ^ (B & C));
+      H  = G;
+      G  = F;
+      F  = E;
+      E  = D + T1;
+      D  = C;
+      C  = B;
+      B  = A;
+      A  = T1 + T2;
+    }
+
+    State[0] += A;
+    State[1] += B;
+    State[2] += C;
+    State[3] += D;
+    State[4] += E;
+    State[5] += F;
+    State[6] += G;
+    State[7] += H;
+  }
+
+  ZeroMem (W, sizeof (W));
+}
+
+/**
+  Starts a SHA-256 stream from a saved state.
+
+  @param[out] Stream      Stream to start.
+  @param[in]  Compress    Compression function.
+  @param[in]  State       Starting state, or NULL for the SHA-256 initial state.
+  @param[in]  TotalSize   Bytes already hashed into State.
+
+**/
+STATIC
+VOID
+Sha256StreamStart (
+  OUT SHA256_STREAM    *Stream,
+  IN  SHA256_COMPRESS  Compress,
+  IN  CONST UINT32     *State OPTIONAL,
+  IN  UINT64           TotalSize
+  )
+{
+  Stream->Compress   = Compress;
+  Stream->BufferSize = 0;
+  Stream->TotalSize  = TotalSize;
+  CopyMem (Stream->State, (State != NULL) ? State : mSha256InitialState, sizeof (Stream->State));
+}
+
+/**
+  Hashes more data into a SHA-256 stream.
+
+  @param[in,out]  Stream    Stream to update.
+  @param[in]      Data      Data to hash.
+  @param[in]      DataSize  Size of Data.
+
+**/
+STATIC
+VOID
+Sha256StreamUpdate (
+  IN OUT SHA256_STREAM  *Stream,
+  IN     CONST UINT8    *Data,
+  IN     UINTN          DataSize
+  )
+{
+  UINTN  Size;
+
+  Stream->TotalSize += DataSize;
+
+  if (Stream->BufferSize != 0) {
+    Size = MIN (DataSize, PBKDF2_SHA256_BLOCK_SIZE - Stream->BufferSize);
+    CopyMem (&Stream->Buffer[Stream->BufferSize], Data, Size);
+    Stream->BufferSize += Size;
+    Data               += Size;
+    DataSize           -= Size;
+    if (Stream->BufferSize < PBKDF2_SHA256_BLOCK_SIZE) {
+      return;
+    }
+
+    Stream->Compress (Stream->State, Stream->Buffer, 1);
+    Stream->BufferSize = 0;
+  }
+
+  Size = DataSize / PBKDF2_SHA256_BLOCK_SIZE;
+  if (Size != 0) {
+    Stream->Compress (Stream->State, Data, Size);
+    Data     += Size * PBKDF2_SHA256_BLOCK_SIZE;
+    DataSize -= Size * PBKDF2_SHA256_BLOCK_SIZE;
+  }
+
+  CopyMem (Stream->Buffer, Data, DataSize);
+  Stream->BufferSize = DataSize;
+}
+
+/**
+  Pads and finishes a SHA-256 stream.
+
+  @param[in,out]  Stream  Stream to finish. It is cleared.
+  @param[out]     Digest  PBKDF2_SHA256_DIGEST_SIZE bytes.
+
+**/
+STATIC
+VOID
+Sha256StreamFinish (
+  IN OUT SHA256_STREAM  *Stream,
+  OUT    UINT8          *Digest
+  )
+{
+  UINT64  BitCount;
+
+  BitCount                             = LShiftU64 (Stream->TotalSize, 3);
+  Stream->Buffer[Stream->BufferSize++] = 0x80;
+  if (Stream->BufferSize > PBKDF2_SHA256_BLOCK_SIZE - sizeof (UINT64)) {
+    ZeroMem (&Stream->Buffer[Stream->BufferSize], PBKDF2_SHA256_BLOCK_SIZE - Stream->BufferSize);
+    Stream->Compress (Stream->State, Stream->Buffer, 1);
+    Stream->BufferSize = 0;
+  }
+
+  ZeroMem (&Stream->Buffer[Stream->BufferSize], PBKDF2_SHA256_BLOCK_SIZE - sizeof (UINT64) - Stream->BufferSize);
+  WriteBe32 (&Stream->Buffer[PBKDF2_SHA256_BLOCK_SIZE - 8], (UINT32)RShiftU64 (BitCount, 32));
+  WriteBe32 (&Stream->Buffer[PBKDF2_SHA256_BLOCK_SIZE - 4], (UINT32)BitCount);
+  Stream->Compress (Stream->State, Stream->Buffer, 1);
+
+  StoreDigest (Digest, Stream->State);
+  ZeroMem (Stream, sizeof (*Stream));
+}
+
+/**
+  Builds a block holding a digest followed by the SHA-256 padding for a message of one block
+  plus one digest, as hashed by both halves of an HMAC over a digest.
+
+  @param[out] Block   PBKDF2_SHA256_BLOCK_SIZE bytes. The digest bytes are left zero.
+
+**/
+STATIC
+VOID
+BuildDigestBlock (
+  OUT UINT8  *Block
+  )
+{
+  ZeroMem (Block, PBKDF2_SHA256_BLOCK_SIZE);
+  Block[PBKDF2_SHA256_DIGEST_SIZE] = 0x80;
+  WriteBe32 (&Block[PBKDF2_SHA256_BLOCK_SIZE - 4], (PBKDF2_SHA256_BLOCK_SIZE + PBKDF2_SHA256_DIGEST_SIZE) * 8);
+}
+
+/**
+  Prepares a PBKDF2-HMAC-SHA256 (RFC 8018) derivation.
+
+  The HMAC inner and outer pad states are hashed once here, so each iteration of a block
+  costs two compression function calls.
+
+  @param[out] Context         Context to prepare.
+  @param[in]  Compress        Compression function to use.
+  @param[in]  Password        Password buffer.
+  @param[in]  PasswordSize    Size of Password in bytes.
+  @param[in]  Salt            Salt buffer. Must stay valid until Pbkdf2Sha256Finish.
+  @param[in]  SaltSize        Size of Salt in bytes.
+  @param[in]  IterationCount  Number of iterations. Must not be 0.
+
+**/
+VOID
+Pbkdf2Sha256Start (
+  OUT PBKDF2_SHA256_CONTEXT  *Context,
+  IN  SHA256_COMPRESS        Compress,
+  IN  CONST UINT8            *Password,
+  IN  UINTN                  PasswordSize,
+  IN  CONST UINT8            *Salt,
+  IN  UINTN                  SaltSize,
+  IN  UINTN                  IterationCount
+  )
+{
+  SHA256_STREAM  Stream;
+  UINT8          Key[PBKDF2_SHA256_BLOCK_SIZE];
+  UINT8          Pad[PBKDF2_SHA256_BLOCK_SIZE];
+  UINTN          Index;
+
+  Context->Compress       = Compress;
+  Context->Salt           = Salt;
+  Context->SaltSize       = SaltSize;
+  Context->IterationCount = IterationCount;
+
+  //
+  // HMAC keys longer than a block are hashed first.
+  ZeroMem (Key, sizeof (Key));
+  if (PasswordSize > PBKDF2_SHA256_BLOCK_SIZE) {
+    Sha256StreamStart (&Stream, Compress, NULL, 0);
+    Sha256StreamUpdate (&Stream, Password, PasswordSize);
+    Sha256StreamFinish (&Stream, Key);
+  } else {
+    CopyMem (Key, Password, PasswordSize);
+  }
+
+  //
+  // Hash the inner and outer pads once. Every HMAC of the derivation resumes from these states.
+  for (Index = 0; Index < PBKDF2_SHA256_BLOCK_SIZE; Index++) {
+    Pad[Index] = Key[Index] ^ HMAC_IPAD;
+  }
+
+  CopyMem (Context->InnerState, mSha256InitialState, sizeof (Context->InnerState));
+  Compress (Context->InnerState, Pad, 1);
+
+  for (Index = 0; Index < PBKDF2_SHA256_BLOCK_SIZE; Index++) {
+    Pad[Index] = Key[Index] ^ HMAC_OPAD;
+  }
+
+  CopyMem (Context->OuterState, mSha256InitialState, sizeof (Context->OuterState));
+  Compress (Context->OuterState, Pad, 1);
+
+  ZeroMem (Key, sizeof (Key));
+  ZeroMem (Pad, sizeof (Pad));
+}
+
+/**
+  Computes one PBKDF2 output block. Blocks only read the context, so different blocks of
+  the same derivation can be computed at the same time on different processors.
+
+  This function does not call any UEFI services itself.
+
+  @param[in]      Context       Context prepared by Pbkdf2Sha256Start.
+  @param[in]      BlockNumber   1-based index of the block.
+  @param[in,out]  Progress      Progress to report every PBKDF2_PROGRESS_INTERVAL iterations. If the
+                                callback cancels, Cancelled is set and Digest is not valid. Must be
+                                NULL on an AP.
+  @param[out]     Digest        PBKDF2_SHA256_DIGEST_SIZE bytes receiving the block.
+
+**/
+VOID
+Pbkdf2Sha256Block (
+  IN     CONST PBKDF2_SHA256_CONTEXT  *Context,
+  IN     UINT32                       BlockNumber,
+  IN OUT PBKDF2_PROGRESS              *Progress OPTIONAL,
+  OUT    UINT8                        *Digest
+  )
+{
+  SHA256_STREAM    Stream;
+  SHA256_COMPRESS  Compress;
+  UINT32           State[PBKDF2_SHA256_STATE_WORDS];
+  UINT32           Result[PBKDF2_SHA256_STATE_WORDS];
+  UINT8            InnerBlock[PBKDF2_SHA256_BLOCK_SIZE];
+  UINT8            OuterBlock[PBKDF2_SHA256_BLOCK_SIZE];
+  UINT8            BlockIndex[sizeof (UINT32)];
+  UINT64           ProgressBase;
+  UINTN            Iteration;
+  UINTN            Index;
+
+  Compress     = Context->Compress;
+  ProgressBase = (Progress != NULL) ? Progress->Completed : 0;
+  BuildDigestBlock (InnerBlock);
+  BuildDigestBlock (OuterBlock);
+
+  //
+  // U1 = HMAC (Password, Salt || INT (BlockNumber))
+  WriteBe32 (BlockIndex, BlockNumber);
+  Sha256StreamStart (&Stream, Compress, Context->InnerState, PBKDF2_SHA256_BLOCK_SIZE);
+  Sha256StreamUpdate (&Stream, Context->Salt, Context->SaltSize);
+  Sha256StreamUpdate (&Stream, BlockIndex, sizeof (BlockIndex));
+  Sha256StreamFinish (&Stream, OuterBlock);
+
+  CopyMem (State, Context->OuterState, sizeof (State));
+  Compress (State, OuterBlock, 1);
+  CopyMem (Result, State, sizeof (Result));
+
+  //
+  // Un = HMAC (Password, Un-1), one inner and one outer compression each.
+  for (Iteration = 1; Iteration < Context->IterationCount; Iteration++) {
+    StoreDigest (InnerBlock, State);
+    CopyMem (State, Context->InnerState, sizeof (State));
+    Compress (State, InnerBlock, 1);
+
+    StoreDigest (OuterBlock, State);
+    CopyMem (State, Context->OuterState, sizeof (State));
+    Compress (State, OuterBlock, 1);
+
+    for (Index = 0; Index < PBKDF2_SHA256_STATE_WORDS; Index++) {
+      Result[Index] ^= State[Index];
+    }
+
+    if ((Progress != NULL) && ((Iteration & (PBKDF2_PROGRESS_INTERVAL - 1)) == 0)) {
+      if (!Progress->Callback (Progress->CallbackContext, ProgressBase + Iteration, Progress->Total)) {
+        Progress->Cancelled = TRUE;
+        break;
+      }
+    }
+  }
+
+  if (Progress != NULL) {
+    Progress->Completed = ProgressBase + Iteration;
+  }
+
+  StoreDigest (Digest, Result);
+
+  ZeroMem (State, sizeof (State));
+  ZeroMem (Result, sizeof (Result));
+  ZeroMem (InnerBlock, sizeof (InnerBlock));
+  ZeroMem (OuterBlock, sizeof (OuterBlock));
+}
+
+/**
+  Clears a PBKDF2 context.
+
+  @param[in,out]  Context   Context prepared by Pbkdf2Sha256Start.
+
+**/
+VOID
+Pbkdf2Sha256Finish (
+  IN OUT PBKDF2_SHA256_CONTEXT  *Context
+  )
+{
+  ZeroMem (Context, sizeof (*Context));
+}
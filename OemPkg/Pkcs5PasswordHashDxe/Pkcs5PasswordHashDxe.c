@@ -0,0 +1,312 @@
+/** @file Pkcs5PasswordHashDxe.c
+
+  This module produces the PKCS5 password hash protocol. On processors with the SHA extensions, and
+  with PcdPasswordHashUseShaExtensions set, PBKDF2-HMAC-SHA256 requests are handled by an engine that
+  hashes the HMAC pads once per request and computes the output blocks of keys longer than one digest
+  on idle APs. Without them the portable compression function is slower than BaseCryptLib, so SHA-256
+  requests go to BaseCryptLib like other digest sizes do. The derived keys are identical either way.
+
+  It also produces the PasswordHashProgress protocol so a UI can follow and cancel SHA-256 requests.
+  Pkcs5HashPassword can neither report progress nor be cancelled, so while a callback is registered
+  SHA-256 requests that would go to it run PBKDF2 on the SHA-256 functions of BaseCryptLib instead,
+  which is as fast. The protocol also reports the iteration rate of hashes without a callback, timed
+  once per digest size, so callers can size hashes without timing them while a callback is registered.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/MuPkcs5PasswordHash.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "Pkcs5PasswordHashDxe.h"
+
+STATIC SHA256_COMPRESS                  mSha256Compress          = NULL;   // NULL without the enabled SHA extensions.
+STATIC PASSWORD_HASH_PROGRESS_CALLBACK  mProgressCallback        = NULL;
+STATIC VOID                             *mProgressCallbackContext = NULL;
+STATIC UINT64                           mSha1IterationRate       = 0;      // 0 until timed.
+STATIC UINT64                           mSha256IterationRate     = 0;
+
+// Iterations of the hash timed by GetIterationRate.
+#define PBKDF2_RATE_ITERATIONS  4096
+
+/**
+  Derives a key with PBKDF2, reporting progress to the registered callback if asked to.
+
+  @param[in]  PasswordSize    Size of Password in bytes.
+  @param[in]  Password        Password buffer.
+  @param[in]  SaltSize        Size of Salt in bytes.
+  @param[in]  Salt            Salt buffer.
+  @param[in]  IterationCount  Number of PBKDF2 iterations.
+  @param[in]  DigestSize      SHA1_DIGEST_SIZE or SHA256_DIGEST_SIZE.
+  @param[in]  OutputSize      Number of key bytes to derive.
+  @param[out] Output          Buffer receiving OutputSize bytes. Cleared on failure.
+  @param[in]  ReportProgress  Report progress to the registered callback, if there is one.
+
+  @retval     EFI_SUCCESS             The key was derived.
+  @retval     EFI_ABORTED             The progress callback cancelled the request, or BaseCryptLib
+                                      failed to derive the key.
+  @retval     EFI_OUT_OF_RESOURCES    A request with a progress callback could not allocate its
+                                      SHA-256 contexts.
+
+**/
+STATIC
+EFI_STATUS
+DeriveKey (
+  IN       UINTN    PasswordSize,
+  IN CONST CHAR8    *Password,
+  IN       UINTN    SaltSize,
+  IN CONST UINT8    *Salt,
+  IN       UINTN    IterationCount,
+  IN       UINTN    DigestSize,
+  IN       UINTN    OutputSize,
+  OUT      UINT8    *Output,
+  IN       BOOLEAN  ReportProgress
+  )
+{
+  PBKDF2_SHA256_CONTEXT  Context;
+  PBKDF2_PROGRESS        Progress;
+  EFI_STATUS             Status;
+
+  ZeroMem (&Progress, sizeof (Progress));
+  Progress.Callback        = ReportProgress ? mProgressCallback : NULL;
+  Progress.CallbackContext = mProgressCallbackContext;
+
+  if ((DigestSize == SHA256_DIGEST_SIZE) && (mSha256Compress != NULL)) {
+    Pbkdf2Sha256Start (&Context, mSha256Compress, (CONST UINT8 *)Password, PasswordSize, Salt, SaltSize, IterationCount);
+    Status = Pbkdf2Sha256Blocks (&Context, (Progress.Callback != NULL) ? &Progress : NULL, OutputSize, Output) ? EFI_SUCCESS : EFI_ABORTED;
+    Pbkdf2Sha256Finish (&Context);
+  } else if ((DigestSize == SHA256_DIGEST_SIZE) && (Progress.Callback != NULL)) {
+    Status = Pbkdf2Sha256CryptLib ((CONST UINT8 *)Password, PasswordSize, Salt, SaltSize, IterationCount, &Progress, OutputSize, Output);
+  } else if (!Pkcs5HashPassword (PasswordSize, Password, SaltSize, Salt, IterationCount, DigestSize, OutputSize, Output)) {
+    DEBUG ((DEBUG_ERROR, "%a - Pkcs5HashPassword failed.\n", __FUNCTION__));
+    Status = EFI_ABORTED;
+  } else {
+    Status = EFI_SUCCESS;
+  }
+
+  if (Progress.Cancelled) {
+    DEBUG ((DEBUG_INFO, "%a - Cancelled after %ld of %ld iterations.\n", __FUNCTION__, Progress.Completed, Progress.Total));
+  }
+
+  if (EFI_ERROR (Status)) {
+    ZeroMem (Output, OutputSize);
+  }
+
+  return Status;
+}
+
+/**
+  Derives a key from a password with PBKDF2 (PKCS #5 v2.0).
+
+  @param[in]  This            Protocol instance.
+  @param[in]  PasswordSize    Size of Password in bytes.
+  @param[in]  Password        Password buffer. It is not required to be null-terminated.
+  @param[in]  SaltSize        Size of Salt in bytes.
+  @param[in]  Salt            Salt buffer.
+  @param[in]  IterationCount  Number of PBKDF2 iterations.
+  @param[in]  DigestSize      Digest size of the HMAC hash. Selects SHA-1 or SHA-256.
+  @param[in]  OutputSize      Number of key bytes to derive.
+  @param[out] Output          Buffer receiving OutputSize bytes.
+
+  @retval     EFI_SUCCESS             The key was derived.
+  @retval     EFI_INVALID_PARAMETER   A buffer is NULL, a size is 0 or too large, or DigestSize
+                                      is not supported.
+  @retval     EFI_ABORTED             The progress callback cancelled the request, or BaseCryptLib
+                                      failed to derive the key.
+  @retval     EFI_OUT_OF_RESOURCES    A request with a progress callback could not allocate its
+                                      SHA-256 contexts.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+Pkcs5PasswordHashDxeHashPassword (
+  IN CONST MU_PKCS5_PASSWORD_HASH_PROTOCOL  *This,
+  IN       UINTN                            PasswordSize,
+  IN CONST CHAR8                            *Password,
+  IN       UINTN                            SaltSize,
+  IN CONST UINT8                            *Salt,
+  IN       UINTN                            IterationCount,
+  IN       UINTN                            DigestSize,
+  IN       UINTN                            OutputSize,
+  OUT      UINT8                            *Output
+  )
+{
+  //
+  // Same limits as BaseCryptLib, so both paths accept the same requests.
+  if ((Password == NULL) || (Salt == NULL) || (Output == NULL) ||
+      (PasswordSize == 0) || (PasswordSize > MAX_INT32) ||
+      (SaltSize == 0) || (SaltSize > MAX_INT32) ||
+      (OutputSize == 0) || (OutputSize > MAX_INT32) ||
+      (IterationCount == 0) || (IterationCount > MAX_INT32))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((DigestSize != SHA256_DIGEST_SIZE) && (DigestSize != SHA1_DIGEST_SIZE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return DeriveKey (PasswordSize, Password, SaltSize, Salt, IterationCount, DigestSize, OutputSize, Output, TRUE);
+}
+
+/**
+  Registers or unregisters the progress callback.
+
+  @param[in]  This      Protocol instance.
+  @param[in]  Callback  Callback to register, or NULL to unregister the current one.
+  @param[in]  Context   Passed to Callback.
+
+  @retval EFI_SUCCESS           The callback was registered or unregistered.
+  @retval EFI_ALREADY_STARTED   Another callback is registered.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+Pkcs5PasswordHashDxeRegisterProgress (
+  IN PASSWORD_HASH_PROGRESS_PROTOCOL  *This,
+  IN PASSWORD_HASH_PROGRESS_CALLBACK  Callback OPTIONAL,
+  IN VOID                             *Context OPTIONAL
+  )
+{
+  if ((Callback != NULL) && (mProgressCallback != NULL)) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  mProgressCallback        = Callback;
+  mProgressCallbackContext = (Callback != NULL) ? Context : NULL;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the PBKDF2 iteration rate of hashes computed without a progress callback, timing a hash the
+  first time it is asked for each digest size.
+
+  @param[in]  This                  Protocol instance.
+  @param[in]  DigestSize            Digest size of the HMAC hash, as passed to HashPassword.
+  @param[out] IterationsPerSecond   PBKDF2 iterations computed per second for a one-digest key.
+
+  @retval EFI_SUCCESS             IterationsPerSecond is set.
+  @retval EFI_INVALID_PARAMETER   IterationsPerSecond is NULL.
+  @retval EFI_UNSUPPORTED         DigestSize is not supported, or the hash could not be timed.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+Pkcs5PasswordHashDxeGetIterationRate (
+  IN  PASSWORD_HASH_PROGRESS_PROTOCOL  *This,
+  IN  UINTN                            DigestSize,
+  OUT UINT64                           *IterationsPerSecond
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      *Rate;
+  UINT8       Salt[SHA256_DIGEST_SIZE];
+  UINT8       Key[SHA256_DIGEST_SIZE];
+  UINT64      CounterStart;
+  UINT64      CounterEnd;
+  UINT64      Start;
+  UINT64      End;
+  UINT64      Ticks;
+  UINT64      ElapsedNs;
+
+  if (IterationsPerSecond == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (DigestSize == SHA256_DIGEST_SIZE) {
+    Rate = &mSha256IterationRate;
+  } else if (DigestSize == SHA1_DIGEST_SIZE) {
+    Rate = &mSha1IterationRate;
+  } else {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (*Rate == 0) {
+    ZeroMem (Salt, sizeof (Salt));
+    GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+    Start  = GetPerformanceCounter ();
+    Status = DeriveKey (11, "Calibration", sizeof (Salt), Salt, PBKDF2_RATE_ITERATIONS, DigestSize, DigestSize, Key, FALSE);
+    End    = GetPerformanceCounter ();
+    ZeroMem (Key, sizeof (Key));
+    if (EFI_ERROR (Status)) {
+      return EFI_UNSUPPORTED;
+    }
+
+    if (CounterEnd >= CounterStart) {
+      Ticks = (End >= Start) ? (End - Start) : ((CounterEnd - Start) + (End - CounterStart));
+    } else {
+      Ticks = (Start >= End) ? (Start - End) : ((CounterStart - End) + (Start - CounterEnd));
+    }
+
+    ElapsedNs = GetTimeInNanoSecond (Ticks);
+    if (ElapsedNs == 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    *Rate = DivU64x64Remainder (MultU64x32 (PBKDF2_RATE_ITERATIONS, 1000000000), ElapsedNs, NULL);
+    DEBUG ((DEBUG_INFO, "%a - %ld iterations per second with a %d-byte digest.\n", __FUNCTION__, *Rate, DigestSize));
+  }
+
+  *IterationsPerSecond = *Rate;
+  return EFI_SUCCESS;
+}
+
+STATIC MU_PKCS5_PASSWORD_HASH_PROTOCOL  mPkcs5PasswordHashProtocol = {
+  Pkcs5PasswordHashDxeHashPassword
+};
+
+STATIC PASSWORD_HASH_PROGRESS_PROTOCOL  mPasswordHashProgressProtocol = {
+  Pkcs5PasswordHashDxeRegisterProgress,
+  Pkcs5PasswordHashDxeGetIterationRate
+};
+
+/**
+  Entry point. Looks for an accelerated SHA-256 compression function, if enabled, and installs the protocols.
+
+  @param[in]  ImageHandle   The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The protocols were installed.
+  @retval Others            The protocols could not be installed.
+
+**/
+EFI_STATUS
+EFIAPI
+Pkcs5PasswordHashDxeEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+
+  mSha256Compress = FeaturePcdGet (PcdPasswordHashUseShaExtensions) ? Sha256GetArchCompress () : NULL;
+  DEBUG ((DEBUG_INFO, "%a - Using %a SHA-256.\n", __FUNCTION__, (mSha256Compress != NULL) ? "accelerated" : "BaseCryptLib"));
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &ImageHandle,
+                  &gMuPKCS5PasswordHashProtocolGuid,
+                  &mPkcs5PasswordHashProtocol,
+                  &gPasswordHashProgressProtocolGuid,
+                  &mPasswordHashProgressProtocol,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to install the password hash protocols. %r\n", __FUNCTION__, Status));
+  }
+
+  return Status;
+}
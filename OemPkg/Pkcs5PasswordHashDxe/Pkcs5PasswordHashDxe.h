@@ -0,0 +1,221 @@
+/** @file Pkcs5PasswordHashDxe.h
+
+  Internal definitions for the PBKDF2-HMAC-SHA256 engine behind the PKCS5 password hash protocol.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PKCS5_PASSWORD_HASH_DXE_H_
+#define _PKCS5_PASSWORD_HASH_DXE_H_
+
+#include <Protocol/PasswordHashProgress.h>
+
+#define PBKDF2_SHA256_BLOCK_SIZE   64
+#define PBKDF2_SHA256_DIGEST_SIZE  32
+#define PBKDF2_SHA256_STATE_WORDS  8
+
+// Iterations between progress callbacks. Must be a power of 2.
+#define PBKDF2_PROGRESS_INTERVAL  1024
+
+/**
+  Runs the SHA-256 compression function over whole blocks.
+
+  @param[in,out]  State       The eight SHA-256 state words, in native byte order.
+  @param[in]      Blocks      BlockCount consecutive 64-byte message blocks.
+  @param[in]      BlockCount  Number of blocks to process.
+
+**/
+typedef
+VOID
+(EFIAPI *SHA256_COMPRESS)(
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Blocks,
+  IN     UINTN        BlockCount
+  );
+
+/**
+  Portable SHA-256 compression function.
+
+  @param[in,out]  State       The eight SHA-256 state words, in native byte order.
+  @param[in]      Blocks      BlockCount consecutive 64-byte message blocks.
+  @param[in]      BlockCount  Number of blocks to process.
+
+**/
+VOID
+EFIAPI
+Sha256CompressScalar (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Blocks,
+  IN     UINTN        BlockCount
+  );
+
+#if defined (MDE_CPU_X64)
+
+/**
+  SHA-256 compression function using the SHA extensions. Implemented in X64/Sha256Ni.nasm. The
+  caller checks CPUID for SHA, SSSE3 and SSE4.1 first.
+
+  @param[in,out]  State       The eight SHA-256 state words, in native byte order.
+  @param[in]      Blocks      BlockCount consecutive 64-byte message blocks.
+  @param[in]      BlockCount  Number of blocks to process.
+
+**/
+VOID
+EFIAPI
+Sha256NiCompress (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Blocks,
+  IN     UINTN        BlockCount
+  );
+
+#endif
+
+/**
+  Returns an accelerated SHA-256 compression function if the processor supports one.
+
+  @retval     The accelerated compression function, or NULL to use Sha256CompressScalar.
+
+**/
+SHA256_COMPRESS
+Sha256GetArchCompress (
+  VOID
+  );
+
+//
+// Password-derived state shared by all output blocks of one PBKDF2 derivation.
+//
+typedef struct {
+  SHA256_COMPRESS    Compress;
+  UINT32             InnerState[PBKDF2_SHA256_STATE_WORDS];   // After the key XOR ipad block.
+  UINT32             OuterState[PBKDF2_SHA256_STATE_WORDS];   // After the key XOR opad block.
+  CONST UINT8        *Salt;
+  UINTN              SaltSize;
+  UINTN              IterationCount;
+} PBKDF2_SHA256_CONTEXT;
+
+//
+// Progress of one derivation, reported from the BSP. Completed and Total count iterations.
+//
+typedef struct {
+  PASSWORD_HASH_PROGRESS_CALLBACK    Callback;
+  VOID                               *CallbackContext;
+  UINT64                             Completed;
+  UINT64                             Total;
+  BOOLEAN                            Cancelled;
+} PBKDF2_PROGRESS;
+
+/**
+  Prepares a PBKDF2-HMAC-SHA256 (RFC 8018) derivation.
+
+  The HMAC inner and outer pad states are hashed once here, so each iteration of a block
+  costs two compression function calls.
+
+  @param[out] Context         Context to prepare.
+  @param[in]  Compress        Compression function to use.
+  @param[in]  Password        Password buffer.
+  @param[in]  PasswordSize    Size of Password in bytes.
+  @param[in]  Salt            Salt buffer. Must stay valid until Pbkdf2Sha256Finish.
+  @param[in]  SaltSize        Size of Salt in bytes.
+  @param[in]  IterationCount  Number of iterations. Must not be 0.
+
+**/
+VOID
+Pbkdf2Sha256Start (
+  OUT PBKDF2_SHA256_CONTEXT  *Context,
+  IN  SHA256_COMPRESS        Compress,
+  IN  CONST UINT8            *Password,
+  IN  UINTN                  PasswordSize,
+  IN  CONST UINT8            *Salt,
+  IN  UINTN                  SaltSize,
+  IN  UINTN                  IterationCount
+  );
+
+/**
+  Computes one PBKDF2 output block. Blocks only read the context, so different blocks of
+  the same derivation can be computed at the same time on different processors.
+
+  This function does not call any UEFI services itself.
+
+  @param[in]      Context       Context prepared by Pbkdf2Sha256Start.
+  @param[in]      BlockNumber   1-based index of the block.
+  @param[in,out]  Progress      Progress to report every PBKDF2_PROGRESS_INTERVAL iterations. If the
+                                callback cancels, Cancelled is set and Digest is not valid. Must be
+                                NULL on an AP.
+  @param[out]     Digest        PBKDF2_SHA256_DIGEST_SIZE bytes receiving the block.
+
+**/
+VOID
+Pbkdf2Sha256Block (
+  IN     CONST PBKDF2_SHA256_CONTEXT  *Context,
+  IN     UINT32                       BlockNumber,
+  IN OUT PBKDF2_PROGRESS              *Progress OPTIONAL,
+  OUT    UINT8                        *Digest
+  );
+
+/**
+  Clears a PBKDF2 context.
+
+  @param[in,out]  Context   Context prepared by Pbkdf2Sha256Start.
+
+**/
+VOID
+Pbkdf2Sha256Finish (
+  IN OUT PBKDF2_SHA256_CONTEXT  *Context
+  );
+
+/**
+  Computes the output blocks of a prepared PBKDF2 derivation. Blocks after the first are handed
+  to idle application processors when MP services are available; the rest run on the caller.
+
+  @param[in]      Context     Context prepared by Pbkdf2Sha256Start.
+  @param[in,out]  Progress    Progress to report, or NULL. Completed and Total are set here.
+  @param[in]      OutputSize  Number of key bytes to derive.
+  @param[out]     Output      Buffer receiving OutputSize bytes.
+
+  @retval     TRUE    Output holds the derived key.
+  @retval     FALSE   The progress callback cancelled the derivation. Output is not valid.
+
+**/
+BOOLEAN
+Pbkdf2Sha256Blocks (
+  IN     CONST PBKDF2_SHA256_CONTEXT  *Context,
+  IN OUT PBKDF2_PROGRESS              *Progress OPTIONAL,
+  IN     UINTN                        OutputSize,
+  OUT    UINT8                        *Output
+  );
+
+/**
+  Derives a key with PBKDF2-HMAC-SHA256 (RFC 8018) on the BSP, reporting progress every
+  PBKDF2_PROGRESS_INTERVAL iterations. The SHA-256 functions of BaseCryptLib are used, so it is
+  as fast as Pkcs5HashPassword, which derives the same key.
+
+  @param[in]      Password        Password buffer.
+  @param[in]      PasswordSize    Size of Password in bytes.
+  @param[in]      Salt            Salt buffer.
+  @param[in]      SaltSize        Size of Salt in bytes.
+  @param[in]      IterationCount  Number of iterations. Must not be 0.
+  @param[in,out]  Progress        Progress to report. Completed and Total are set here.
+  @param[in]      OutputSize      Number of key bytes to derive.
+  @param[out]     Output          Buffer receiving OutputSize bytes.
+
+  @retval     EFI_SUCCESS           Output holds the derived key.
+  @retval     EFI_ABORTED           The progress callback cancelled the derivation, or BaseCryptLib
+                                    failed. Output is not valid.
+  @retval     EFI_OUT_OF_RESOURCES  The SHA-256 contexts could not be allocated.
+
+**/
+EFI_STATUS
+Pbkdf2Sha256CryptLib (
+  IN     CONST UINT8      *Password,
+  IN     UINTN            PasswordSize,
+  IN     CONST UINT8      *Salt,
+  IN     UINTN            SaltSize,
+  IN     UINTN            IterationCount,
+  IN OUT PBKDF2_PROGRESS  *Progress,
+  IN     UINTN            OutputSize,
+  OUT    UINT8            *Output
+  );
+
+#endif // _PKCS5_PASSWORD_HASH_DXE_H_
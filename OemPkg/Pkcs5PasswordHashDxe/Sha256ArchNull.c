@@ -0,0 +1,26 @@
+/** @file Sha256ArchNull.c
+
+  No accelerated SHA-256 compression on this architecture.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include "Pkcs5PasswordHashDxe.h"
+
+/**
+  Returns an accelerated SHA-256 compression function if the processor supports one.
+
+  @retval     NULL    Always. Sha256CompressScalar is used.
+
+**/
+SHA256_COMPRESS
+Sha256GetArchCompress (
+  VOID
+  )
+{
+  return NULL;
+}
@@ -0,0 +1,1111 @@
+/** @file Pkcs5PasswordHashDxeUnitTest.c
+
+  Host based unit tests of Pkcs5PasswordHashDxe.
+
+  The portable PBKDF2-HMAC-SHA256 engine and every path of the PKCS5 password hash protocol are
+  checked against published PBKDF2 known answers: BaseCryptLib without the SHA extensions, the
+  engine with a compression function, and the SHA-256 functions of BaseCryptLib while a progress
+  callback is registered. The driver source is included so each test can pick the compression
+  function the entry point would have picked. The progress path is timed against Pkcs5HashPassword
+  and the portable engine, and the iteration rate reported for callers that size hashes is checked
+  to come from a hash that reports no progress.
+
+  On X64 the SHA extension tests run Sha256NiCompress itself when the host processor has the SHA
+  extensions: against the portable compression function on random input, through the protocol over
+  the known answers, and over the V1 and V2 password store parameters of PasswordPolicyLib against
+  BaseCryptLib. PcdPasswordHashUseShaExtensions should only be set once these pass.
+
+  The parallel block tests run Pbkdf2Sha256Blocks over the simulated APs of HostMpJobQueueLib, with
+  no AP, one AP, every AP a queue can use, and APs that refuse jobs with EFI_NOT_READY, and check
+  the keys against BaseCryptLib, the progress reported, and cancelling on the BSP and while waiting
+  for an AP.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include "../Pkcs5PasswordHashDxe.c"
+
+#include <Library/MpJobQueueLib.h>
+#include <Library/UnitTestLib.h>
+
+#include <HostMpJobQueueLibHelper.h>
+
+#if defined (MDE_CPU_X64)
+  #if defined (_MSC_VER)
+#include <intrin.h>
+  #else
+#include <cpuid.h>
+  #endif
+#endif
+
+#define UNIT_TEST_APP_NAME     "Pkcs5PasswordHashDxe Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_OUTPUT_MAX  64
+
+// One block more than Pbkdf2Sha256Blocks queues at once, one per AP and one for the BSP.
+#define TEST_BLOCKS_OUTPUT_MAX  ((MP_JOB_QUEUE_MAX_APS + 2) * PBKDF2_SHA256_DIGEST_SIZE)
+#define TEST_BLOCKS_ITERATIONS  4096
+
+#define TEST_STRING(String)  (String), (sizeof (String) - 1)
+
+#define TEST_COMPRESS_RUNS        2000
+#define TEST_COMPRESS_MAX_BLOCKS  8
+
+// Salt size of the V1 and V2 password stores of PasswordPolicyLib.
+#define TEST_STORE_SALT_SIZE  32
+
+typedef struct {
+  CONST CHAR8    *Password;
+  UINTN          PasswordSize;
+  CONST CHAR8    *Salt;
+  UINTN          SaltSize;
+  UINTN          IterationCount;
+  UINTN          DigestSize;
+  UINTN          OutputSize;
+  UINT8          Output[TEST_OUTPUT_MAX];
+} PBKDF2_KNOWN_ANSWER;
+
+//
+// The driver configuration a protocol test runs with.
+//
+typedef struct {
+  SHA256_COMPRESS    Compress;            // What the entry point would pick, NULL without the SHA extensions.
+  BOOLEAN            RegisterProgress;
+} PROTOCOL_TEST_CONTEXT;
+
+//
+// Parameters of a password store.
+//
+typedef struct {
+  UINTN    IterationCount;
+  UINTN    KeySize;
+} STORE_PARAMETERS;
+
+//
+// The simulated APs a parallel block test runs with.
+//
+typedef struct {
+  UINTN    ApCount;
+  UINTN    RefusedStarts;       // Starts the APs refuse with EFI_NOT_READY.
+} BLOCKS_TEST_CONTEXT;
+
+STATIC CONST PBKDF2_KNOWN_ANSWER  mKnownAnswers[] = {
+  // RFC 7914 section 11
+  {
+    TEST_STRING ("passwd"),
+    TEST_STRING ("salt"),
+    1,
+    SHA256_DIGEST_SIZE,
+    64,
+    {
+      0x55, 0xAC, 0x04, 0x6E, 0x56, 0xE3, 0x08, 0x9F, 0xEC, 0x16, 0x91, 0xC2, 0x25, 0x44, 0xB6, 0x05,
+      0xF9, 0x41, 0x85, 0x21, 0x6D, 0xDE, 0x04, 0x65, 0xE6, 0x8B, 0x9D, 0x57, 0xC2, 0x0D, 0xAC, 0xBC,
+      0x49, 0xCA, 0x9C, 0xCC, 0xF1, 0x79, 0xB6, 0x45, 0x99, 0x16, 0x64, 0xB3, 0x9D, 0x77, 0xEF, 0x31,
+      0x7C, 0x71, 0xB8, 0x45, 0xB1, 0xE3, 0x0B, 0xD5, 0x09, 0x11, 0x20, 0x41, 0xD3, 0xA1, 0x97, 0x83
+    }
+  },
+  // RFC 7914 section 11
+  {
+    TEST_STRING ("Password"),
+    TEST_STRING ("NaCl"),
+    80000,
+    SHA256_DIGEST_SIZE,
+    64,
+    {
+      0x4D, 0xDC, 0xD8, 0xF6, 0x0B, 0x98, 0xBE, 0x21, 0x83, 0x0C, 0xEE, 0x5E, 0xF2, 0x27, 0x01, 0xF9,
+      0x64, 0x1A, 0x44, 0x18, 0xD0, 0x4C, 0x04, 0x14, 0xAE, 0xFF, 0x08, 0x87, 0x6B, 0x34, 0xAB, 0x56,
+      0xA1, 0xD4, 0x25, 0xA1, 0x22, 0x58, 0x33, 0x54, 0x9A, 0xDB, 0x84, 0x1B, 0x51, 0xC9, 0xB3, 0x17,
+      0x6A, 0x27, 0x2B, 0xDE, 0xBB, 0xA1, 0xD0, 0x78, 0x47, 0x8F, 0x62, 0xB3, 0x97, 0xF3, 0x3C, 0x8D
+    }
+  },
+  // The RFC 6070 inputs with HMAC-SHA256
+  {
+    TEST_STRING ("password"),
+    TEST_STRING ("salt"),
+    1,
+    SHA256_DIGEST_SIZE,
+    32,
+    {
+      0x12, 0x0F, 0xB6, 0xCF, 0xFC, 0xF8, 0xB3, 0x2C, 0x43, 0xE7, 0x22, 0x52, 0x56, 0xC4, 0xF8, 0x37,
+      0xA8, 0x65, 0x48, 0xC9, 0x2C, 0xCC, 0x35, 0x48, 0x08, 0x05, 0x98, 0x7C, 0xB7, 0x0B, 0xE1, 0x7B
+    }
+  },
+  {
+    TEST_STRING ("password"),
+    TEST_STRING ("salt"),
+    2,
+    SHA256_DIGEST_SIZE,
+    32,
+    {
+      0xAE, 0x4D, 0x0C, 0x95, 0xAF, 0x6B, 0x46, 0xD3, 0x2D, 0x0A, 0xDF, 0xF9, 0x28, 0xF0, 0x6D, 0xD0,
+      0x2A, 0x30, 0x3F, 0x8E, 0xF3, 0xC2, 0x51, 0xDF, 0xD6, 0xE2, 0xD8, 0x5A, 0x95, 0x47, 0x4C, 0x43
+    }
+  },
+  {
+    TEST_STRING ("password"),
+    TEST_STRING ("salt"),
+    4096,
+    SHA256_DIGEST_SIZE,
+    32,
+    {
+      0xC5, 0xE4, 0x78, 0xD5, 0x92, 0x88, 0xC8, 0x41, 0xAA, 0x53, 0x0D, 0xB6, 0x84, 0x5C, 0x4C, 0x8D,
+      0x96, 0x28, 0x93, 0xA0, 0x01, 0xCE, 0x4E, 0x11, 0xA4, 0x96, 0x38, 0x73, 0xAA, 0x98, 0x13, 0x4A
+    }
+  },
+  {
+    TEST_STRING ("passwordPASSWORDpassword"),
+    TEST_STRING ("saltSALTsaltSALTsaltSALTsaltSALTsalt"),
+    4096,
+    SHA256_DIGEST_SIZE,
+    40,
+    {
+      0x34, 0x8C, 0x89, 0xDB, 0xCB, 0xD3, 0x2B, 0x2F, 0x32, 0xD8, 0x14, 0xB8, 0x11, 0x6E, 0x84, 0xCF,
+      0x2B, 0x17, 0x34, 0x7E, 0xBC, 0x18, 0x00, 0x18, 0x1C, 0x4E, 0x2A, 0x1F, 0xB8, 0xDD, 0x53, 0xE1,
+      0xC6, 0x35, 0x51, 0x8C, 0x7D, 0xAC, 0x47, 0xE9
+    }
+  },
+  {
+    TEST_STRING ("pass\0word"),
+    TEST_STRING ("sa\0lt"),
+    4096,
+    SHA256_DIGEST_SIZE,
+    16,
+    {
+      0x89, 0xB6, 0x9D, 0x05, 0x16, 0xF8, 0x29, 0x89, 0x3C, 0x69, 0x62, 0x26, 0x65, 0x0A, 0x86, 0x87
+    }
+  },
+  // Password longer than a SHA-256 block, hashed into the HMAC key
+  {
+    TEST_STRING ("0123456789" "0123456789" "0123456789" "0123456789" "0123456789"
+                 "0123456789" "0123456789" "0123456789" "0123456789" "0123456789"),
+    TEST_STRING ("salt"),
+    1000,
+    SHA256_DIGEST_SIZE,
+    32,
+    {
+      0x4F, 0xEA, 0x6C, 0x20, 0xB6, 0xB0, 0x7A, 0x16, 0x5F, 0xA6, 0x9A, 0xFE, 0xEA, 0x95, 0x48, 0x11,
+      0xE1, 0xC2, 0x83, 0x9D, 0x7F, 0xF8, 0x02, 0xC8, 0x41, 0x51, 0x4A, 0x74, 0x74, 0x98, 0xA4, 0x11
+    }
+  },
+  // RFC 6070
+  {
+    TEST_STRING ("password"),
+    TEST_STRING ("salt"),
+    4096,
+    SHA1_DIGEST_SIZE,
+    20,
+    {
+      0x4B, 0x00, 0x79, 0x01, 0xB7, 0x65, 0x48, 0x9A, 0xBE, 0xAD, 0x49, 0xD9, 0x26, 0xF7, 0x21, 0xD0,
+      0x65, 0xA4, 0x29, 0xC1
+    }
+  },
+};
+
+STATIC PROTOCOL_TEST_CONTEXT  mBaseCryptLib       = { NULL, FALSE };
+STATIC PROTOCOL_TEST_CONTEXT  mEngine             = { Sha256CompressScalar, FALSE };
+STATIC PROTOCOL_TEST_CONTEXT  mCryptLibOnProgress = { NULL, TRUE };
+
+#if defined (MDE_CPU_X64)
+STATIC PROTOCOL_TEST_CONTEXT  mShaExtensions           = { Sha256NiCompress, FALSE };
+STATIC PROTOCOL_TEST_CONTEXT  mShaExtensionsOnProgress = { Sha256NiCompress, TRUE };
+#endif
+
+//
+// PRIVATE_HASH_VER_1 of PasswordPolicyLib, then PRIVATE_HASH_VER_2 at the default minimum, a
+// calibrated and an odd iteration count.
+//
+STATIC CONST STORE_PARAMETERS  mStoreParameters[] = {
+  { 60000,  40                 },
+  { 10000,  SHA256_DIGEST_SIZE },
+  { 250000, SHA256_DIGEST_SIZE },
+  { 4097,   SHA256_DIGEST_SIZE }
+};
+
+STATIC BLOCKS_TEST_CONTEXT  mNoAps        = { 0, 0 };
+STATIC BLOCKS_TEST_CONTEXT  mOneAp        = { 1, 0 };
+STATIC BLOCKS_TEST_CONTEXT  mAllAps       = { MP_JOB_QUEUE_MAX_APS, 0 };
+STATIC BLOCKS_TEST_CONTEXT  mRefusingAps  = { MP_JOB_QUEUE_MAX_APS, 3 };
+
+STATIC CONST UINTN  mBlocksOutputSizes[] = { 1, PBKDF2_SHA256_DIGEST_SIZE, 40, 64, TEST_BLOCKS_OUTPUT_MAX - 5, TEST_BLOCKS_OUTPUT_MAX };
+
+STATIC UINTN   mProgressCalls;
+STATIC UINTN   mProgressCallsBeforeCancel;
+STATIC UINT64  mLastCompleted;
+STATIC UINT64  mLastTotal;
+STATIC UINT32  mRandomState;
+
+// The entry point is not run.
+EFI_BOOT_SERVICES  *gBS = NULL;
+
+/**
+  Get the current time in nanoseconds.
+
+  @return     Nanoseconds since an arbitrary start.
+**/
+STATIC
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Get the next pseudo random number. The sequence is the same on every run.
+
+  @retval   The number.
+**/
+STATIC
+UINT32
+NextRandom (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState << 13;
+  mRandomState ^= mRandomState >> 17;
+  mRandomState ^= mRandomState << 5;
+  return mRandomState;
+}
+
+/**
+  Progress callback that counts its calls, keeps the last progress reported and cancels after
+  mProgressCallsBeforeCancel of them.
+
+  @param[in]  Context     Not used.
+  @param[in]  Completed   Iterations done so far.
+  @param[in]  Total       Total iterations.
+
+  @retval     TRUE    Continue.
+  @retval     FALSE   Cancel.
+
+**/
+STATIC
+BOOLEAN
+EFIAPI
+TestProgressCallback (
+  IN VOID    *Context,
+  IN UINT64  Completed,
+  IN UINT64  Total
+  )
+{
+  mProgressCalls++;
+  mLastCompleted = Completed;
+  mLastTotal     = Total;
+  return (BOOLEAN)((mProgressCallsBeforeCancel == 0) || (mProgressCalls < mProgressCallsBeforeCancel));
+}
+
+/**
+  Configure the driver for a protocol test.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval UNIT_TEST_PASSED                      The driver is configured.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The progress callback could not be registered.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ProtocolTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST PROTOCOL_TEST_CONTEXT  *TestContext;
+
+  TestContext                = (CONST PROTOCOL_TEST_CONTEXT *)Context;
+  mSha256Compress            = TestContext->Compress;
+  mSha1IterationRate         = 0;
+  mSha256IterationRate       = 0;
+  mProgressCalls             = 0;
+  mProgressCallsBeforeCancel = 0;
+
+  if (TestContext->RegisterProgress &&
+      EFI_ERROR (mPasswordHashProgressProtocol.Register (&mPasswordHashProgressProtocol, TestProgressCallback, NULL)))
+  {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Unregister the progress callback.
+
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+ProtocolTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mPasswordHashProgressProtocol.Register (&mPasswordHashProgressProtocol, NULL, NULL);
+  mSha256Compress = NULL;
+}
+
+/**
+  Set up the simulated APs for a parallel block test.
+
+  @param[in]  Context   The BLOCKS_TEST_CONTEXT.
+
+  @retval UNIT_TEST_PASSED    The APs are set up.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BlocksTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST BLOCKS_TEST_CONTEXT  *TestContext;
+
+  TestContext                = (CONST BLOCKS_TEST_CONTEXT *)Context;
+  mProgressCalls             = 0;
+  mProgressCallsBeforeCancel = 0;
+
+  HostMpJobQueueLibReset ();
+  HostMpJobQueueLibSetApCount (TestContext->ApCount);
+  HostMpJobQueueLibRefuseStarts (TestContext->RefusedStarts);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Remove the simulated APs.
+
+  @param[in]  Context   Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+BlocksTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  HostMpJobQueueLibReset ();
+}
+
+/**
+  Derive a key with Pbkdf2Sha256Blocks and the portable engine, reporting progress.
+
+  @param[in]      OutputSize  Number of key bytes to derive.
+  @param[in,out]  Progress    Receives the progress of the derivation.
+  @param[out]     Output      Buffer receiving OutputSize bytes.
+
+  @retval     TRUE    Output holds the derived key.
+  @retval     FALSE   The progress callback cancelled the derivation.
+
+**/
+STATIC
+BOOLEAN
+DeriveBlocks (
+  IN     UINTN            OutputSize,
+  IN OUT PBKDF2_PROGRESS  *Progress,
+  OUT    UINT8            *Output
+  )
+{
+  PBKDF2_SHA256_CONTEXT  Pbkdf2;
+  BOOLEAN                Finished;
+
+  ZeroMem (Progress, sizeof (*Progress));
+  Progress->Callback = TestProgressCallback;
+
+  Pbkdf2Sha256Start (&Pbkdf2, Sha256CompressScalar, (CONST UINT8 *)"password", 8, (CONST UINT8 *)"salt", 4, TEST_BLOCKS_ITERATIONS);
+  Finished = Pbkdf2Sha256Blocks (&Pbkdf2, Progress, OutputSize, Output);
+  Pbkdf2Sha256Finish (&Pbkdf2);
+  return Finished;
+}
+
+/**
+  Derive keys of one block to two rounds of blocks and compare them with BaseCryptLib.
+
+  @param[in]  Context   The BLOCKS_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              Every key matches and all progress was reported.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BlocksMatchBaseCryptLib (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST BLOCKS_TEST_CONTEXT  *TestContext;
+  HOST_MP_JOB_QUEUE_STATS    Stats;
+  PBKDF2_PROGRESS            Progress;
+  UINT8                      Output[TEST_BLOCKS_OUTPUT_MAX + 1];
+  UINT8                      Expected[TEST_BLOCKS_OUTPUT_MAX];
+  UINTN                      BlockCount;
+  UINTN                      Index;
+
+  TestContext = (CONST BLOCKS_TEST_CONTEXT *)Context;
+
+  for (Index = 0; Index < ARRAY_SIZE (mBlocksOutputSizes); Index++) {
+    UT_ASSERT_TRUE (Pkcs5HashPassword (8, "password", 4, (CONST UINT8 *)"salt", TEST_BLOCKS_ITERATIONS, SHA256_DIGEST_SIZE, mBlocksOutputSizes[Index], Expected));
+
+    SetMem (Output, sizeof (Output), 0xA5);
+    UT_ASSERT_TRUE (DeriveBlocks (mBlocksOutputSizes[Index], &Progress, Output));
+    UT_ASSERT_MEM_EQUAL (Output, Expected, mBlocksOutputSizes[Index]);
+
+    // nothing is written past the key
+    UT_ASSERT_EQUAL (Output[mBlocksOutputSizes[Index]], 0xA5);
+
+    BlockCount = (mBlocksOutputSizes[Index] + PBKDF2_SHA256_DIGEST_SIZE - 1) / PBKDF2_SHA256_DIGEST_SIZE;
+    UT_ASSERT_EQUAL (Progress.Total, (UINT64)TEST_BLOCKS_ITERATIONS * BlockCount);
+    UT_ASSERT_EQUAL (Progress.Completed, Progress.Total);
+    UT_ASSERT_FALSE (Progress.Cancelled);
+  }
+
+  // the BSP always computes some blocks, so it reports progress
+  UT_ASSERT_TRUE (mProgressCalls != 0);
+
+  HostMpJobQueueLibGetStats (&Stats);
+  DEBUG ((DEBUG_INFO, "%d APs: %d blocks on APs, %d starts refused\n", TestContext->ApCount, Stats.ApJobs, Stats.RefusedStarts));
+  UT_ASSERT_EQUAL (Stats.RefusedStarts, TestContext->RefusedStarts);
+  if (TestContext->ApCount == 0) {
+    UT_ASSERT_EQUAL (Stats.ApJobs, 0);
+  } else {
+    UT_ASSERT_TRUE (Stats.ApJobs != 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Cancel a derivation from the progress callback while the BSP computes a block and an AP another.
+
+  @param[in]  Context   The BLOCKS_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The derivation was cancelled after the AP finished.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BlocksCancelOnBsp (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  HOST_MP_JOB_QUEUE_STATS  Stats;
+  PBKDF2_PROGRESS          Progress;
+  UINT8                    Output[3 * PBKDF2_SHA256_DIGEST_SIZE];
+
+  // block 1 runs on the AP and block 2 on the BSP, which reports progress every 1024 iterations
+  mProgressCallsBeforeCancel = 2;
+  UT_ASSERT_FALSE (DeriveBlocks (sizeof (Output), &Progress, Output));
+  UT_ASSERT_TRUE (Progress.Cancelled);
+  UT_ASSERT_EQUAL (mProgressCalls, 2);
+
+  // block 3 is never started
+  HostMpJobQueueLibGetStats (&Stats);
+  UT_ASSERT_EQUAL (Stats.ApJobs, 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Cancel a derivation from the progress callback while the BSP waits for an AP.
+
+  @param[in]  Context   The BLOCKS_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The derivation was cancelled after the AP finished.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BlocksCancelWhileWaiting (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  HOST_MP_JOB_QUEUE_STATS  Stats;
+  PBKDF2_PROGRESS          Progress;
+  UINT8                    Output[TEST_BLOCKS_OUTPUT_MAX];
+
+  // The APs take blocks 1 to 8 of the first round and the BSP block 9, reporting progress 3 times.
+  // The last block runs on an AP in the second round, and the BSP cancels while waiting for it.
+  mProgressCallsBeforeCancel = TEST_BLOCKS_ITERATIONS / PBKDF2_PROGRESS_INTERVAL;
+  UT_ASSERT_FALSE (DeriveBlocks (sizeof (Output), &Progress, Output));
+  UT_ASSERT_TRUE (Progress.Cancelled);
+
+  HostMpJobQueueLibGetStats (&Stats);
+  UT_ASSERT_EQUAL (Stats.WaitCallbacks, 1);
+  UT_ASSERT_EQUAL (Stats.ApJobs, MP_JOB_QUEUE_MAX_APS + 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Compute every SHA-256 known answer one output block at a time with the portable engine.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              Every block matches.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ScalarEngineKnownAnswers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PBKDF2_SHA256_CONTEXT  Pbkdf2;
+  UINT8                  Digest[PBKDF2_SHA256_DIGEST_SIZE];
+  UINTN                  Offset;
+  UINTN                  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mKnownAnswers); Index++) {
+    if (mKnownAnswers[Index].DigestSize != SHA256_DIGEST_SIZE) {
+      continue;
+    }
+
+    Pbkdf2Sha256Start (
+      &Pbkdf2,
+      Sha256CompressScalar,
+      (CONST UINT8 *)mKnownAnswers[Index].Password,
+      mKnownAnswers[Index].PasswordSize,
+      (CONST UINT8 *)mKnownAnswers[Index].Salt,
+      mKnownAnswers[Index].SaltSize,
+      mKnownAnswers[Index].IterationCount
+      );
+
+    for (Offset = 0; Offset < mKnownAnswers[Index].OutputSize; Offset += PBKDF2_SHA256_DIGEST_SIZE) {
+      Pbkdf2Sha256Block (&Pbkdf2, (UINT32)(Offset / PBKDF2_SHA256_DIGEST_SIZE) + 1, NULL, Digest);
+      UT_ASSERT_MEM_EQUAL (
+        Digest,
+        &mKnownAnswers[Index].Output[Offset],
+        MIN (mKnownAnswers[Index].OutputSize - Offset, PBKDF2_SHA256_DIGEST_SIZE)
+        );
+    }
+
+    Pbkdf2Sha256Finish (&Pbkdf2);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Derive every known answer through the protocol.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              Every key matches.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ProtocolKnownAnswers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST PROTOCOL_TEST_CONTEXT  *TestContext;
+  UINT8                        Output[TEST_OUTPUT_MAX];
+  UINTN                        Index;
+
+  TestContext = (CONST PROTOCOL_TEST_CONTEXT *)Context;
+
+  for (Index = 0; Index < ARRAY_SIZE (mKnownAnswers); Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (
+      mPkcs5PasswordHashProtocol.HashPassword (
+                                   &mPkcs5PasswordHashProtocol,
+                                   mKnownAnswers[Index].PasswordSize,
+                                   mKnownAnswers[Index].Password,
+                                   mKnownAnswers[Index].SaltSize,
+                                   (CONST UINT8 *)mKnownAnswers[Index].Salt,
+                                   mKnownAnswers[Index].IterationCount,
+                                   mKnownAnswers[Index].DigestSize,
+                                   mKnownAnswers[Index].OutputSize,
+                                   Output
+                                   )
+      );
+    UT_ASSERT_MEM_EQUAL (Output, mKnownAnswers[Index].Output, mKnownAnswers[Index].OutputSize);
+  }
+
+  // BaseCryptLib itself reports no progress
+  if (TestContext->RegisterProgress) {
+    UT_ASSERT_TRUE (mProgressCalls != 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Cancel a SHA-256 derivation from the progress callback without the SHA extensions.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The derivation was cancelled and the output cleared.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ProgressCancels (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CONST PBKDF2_KNOWN_ANSWER  *KnownAnswer;
+  UINT8                      Output[TEST_OUTPUT_MAX];
+  UINT8                      Zero[TEST_OUTPUT_MAX];
+  EFI_STATUS                 Status;
+
+  // RFC 7914, 80000 iterations of 2 blocks
+  KnownAnswer                = &mKnownAnswers[1];
+  mProgressCallsBeforeCancel = 3;
+
+  SetMem (Output, sizeof (Output), 0xA5);
+  ZeroMem (Zero, sizeof (Zero));
+  Status = mPkcs5PasswordHashProtocol.HashPassword (
+                                        &mPkcs5PasswordHashProtocol,
+                                        KnownAnswer->PasswordSize,
+                                        KnownAnswer->Password,
+                                        KnownAnswer->SaltSize,
+                                        (CONST UINT8 *)KnownAnswer->Salt,
+                                        KnownAnswer->IterationCount,
+                                        KnownAnswer->DigestSize,
+                                        KnownAnswer->OutputSize,
+                                        Output
+                                        );
+
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_ABORTED);
+  UT_ASSERT_EQUAL (mProgressCalls, 3);
+  UT_ASSERT_MEM_EQUAL (Output, Zero, KnownAnswer->OutputSize);
+  return UNIT_TEST_PASSED;
+}
+
+#if defined (MDE_CPU_X64)
+
+/**
+  Check the host processor for the SHA extensions the way Sha256GetArchCompress does. The host
+  BaseLib does not run CPUID, so the compiler's intrinsic is used.
+
+  @retval     TRUE    The processor has SHA, SSSE3 and SSE4.1.
+  @retval     FALSE   Not.
+
+**/
+STATIC
+BOOLEAN
+HostHasShaExtensions (
+  VOID
+  )
+{
+  UINT32  Registers[4];
+
+ #if defined (_MSC_VER)
+  __cpuid ((INT32 *)Registers, 0);
+  if (Registers[0] < 7) {
+    return FALSE;
+  }
+
+  __cpuidex ((INT32 *)Registers, 1, 0);
+  if (((Registers[2] & BIT9) == 0) || ((Registers[2] & BIT19) == 0)) {
+    return FALSE;
+  }
+
+  __cpuidex ((INT32 *)Registers, 7, 0);
+ #else
+  if (__get_cpuid_max (0, NULL) < 7) {
+    return FALSE;
+  }
+
+  __cpuid_count (1, 0, Registers[0], Registers[1], Registers[2], Registers[3]);
+  if (((Registers[2] & BIT9) == 0) || ((Registers[2] & BIT19) == 0)) {
+    return FALSE;
+  }
+
+  __cpuid_count (7, 0, Registers[0], Registers[1], Registers[2], Registers[3]);
+ #endif
+
+  return (BOOLEAN)((Registers[1] & BIT29) != 0);
+}
+
+/**
+  Compress random blocks from random states with the SHA extensions and the portable function.
+  Blocks start at every offset, as the stream code passes unaligned data.
+
+  @param[in]  Context   Not used.
+
+  @retval     UNIT_TEST_PASSED              Every state matches.
+  @retval     UNIT_TEST_SKIPPED             The processor does not have the SHA extensions.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ShaExtensionsMatchScalar (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8   Blocks[TEST_COMPRESS_MAX_BLOCKS * PBKDF2_SHA256_BLOCK_SIZE + 16];
+  UINT32  State[PBKDF2_SHA256_STATE_WORDS];
+  UINT32  Expected[PBKDF2_SHA256_STATE_WORDS];
+  UINTN   BlockCount;
+  UINTN   Offset;
+  UINTN   Run;
+  UINTN   Index;
+
+  if (!HostHasShaExtensions ()) {
+    UT_LOG_WARNING ("The processor does not have the SHA extensions.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  mRandomState = 0x85EBCA6B;
+
+  for (Run = 0; Run < TEST_COMPRESS_RUNS; Run++) {
+    for (Index = 0; Index < sizeof (Blocks); Index++) {
+      Blocks[Index] = (UINT8)NextRandom ();
+    }
+
+    for (Index = 0; Index < PBKDF2_SHA256_STATE_WORDS; Index++) {
+      State[Index] = NextRandom ();
+    }
+
+    // a block count of 0 leaves the state alone
+    BlockCount = Run % (TEST_COMPRESS_MAX_BLOCKS + 1);
+    Offset     = Run % 16;
+
+    CopyMem (Expected, State, sizeof (Expected));
+    Sha256CompressScalar (Expected, &Blocks[Offset], BlockCount);
+    Sha256NiCompress (State, &Blocks[Offset], BlockCount);
+    UT_ASSERT_MEM_EQUAL (State, Expected, sizeof (State));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Derive every known answer through the protocol with the SHA extensions.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              Every key matches.
+  @retval     UNIT_TEST_SKIPPED             The processor does not have the SHA extensions.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ShaExtensionsKnownAnswers (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (!HostHasShaExtensions ()) {
+    UT_LOG_WARNING ("The processor does not have the SHA extensions.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_TRUE (mSha256Compress == Sha256NiCompress);
+  return ProtocolKnownAnswers (Context);
+}
+
+/**
+  Derive password store keys from random passwords and salts through the protocol with the SHA
+  extensions, and compare them with BaseCryptLib.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              Every key matches.
+  @retval     UNIT_TEST_SKIPPED             The processor does not have the SHA extensions.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ShaExtensionsStores (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CHAR16  Password[33];
+  UINT8   Salt[TEST_STORE_SALT_SIZE];
+  UINT8   Output[TEST_OUTPUT_MAX];
+  UINT8   Expected[TEST_OUTPUT_MAX];
+  UINTN   PasswordLength;
+  UINTN   Index;
+  UINTN   Char;
+
+  if (!HostHasShaExtensions ()) {
+    UT_LOG_WARNING ("The processor does not have the SHA extensions.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_TRUE (mSha256Compress == Sha256NiCompress);
+  mRandomState = 0xC2B2AE35;
+
+  for (Index = 0; Index < ARRAY_SIZE (mStoreParameters); Index++) {
+    // printable ASCII passwords, hashed as UTF-16 like PasswordPolicyLib does
+    PasswordLength = 1 + NextRandom () % (ARRAY_SIZE (Password) - 1);
+    for (Char = 0; Char < PasswordLength; Char++) {
+      Password[Char] = (CHAR16)(L' ' + NextRandom () % (L'~' - L' ' + 1));
+    }
+
+    for (Char = 0; Char < sizeof (Salt); Char++) {
+      Salt[Char] = (UINT8)NextRandom ();
+    }
+
+    UT_ASSERT_TRUE (
+      Pkcs5HashPassword (
+        PasswordLength * sizeof (CHAR16),
+        (CONST CHAR8 *)Password,
+        sizeof (Salt),
+        Salt,
+        mStoreParameters[Index].IterationCount,
+        SHA256_DIGEST_SIZE,
+        mStoreParameters[Index].KeySize,
+        Expected
+        )
+      );
+
+    SetMem (Output, sizeof (Output), 0xA5);
+    UT_ASSERT_NOT_EFI_ERROR (
+      mPkcs5PasswordHashProtocol.HashPassword (
+                                   &mPkcs5PasswordHashProtocol,
+                                   PasswordLength * sizeof (CHAR16),
+                                   (CONST CHAR8 *)Password,
+                                   sizeof (Salt),
+                                   Salt,
+                                   mStoreParameters[Index].IterationCount,
+                                   SHA256_DIGEST_SIZE,
+                                   mStoreParameters[Index].KeySize,
+                                   Output
+                                   )
+      );
+    UT_ASSERT_MEM_EQUAL (Output, Expected, mStoreParameters[Index].KeySize);
+    UT_ASSERT_EQUAL (Output[mStoreParameters[Index].KeySize], 0xA5);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+#endif
+
+/**
+  Time a V1 password store hash with Pkcs5HashPassword, through the protocol with a progress
+  callback, and with the portable engine.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The keys match.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ProgressSpeed (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST CHAR16    Password[] = L"Password";
+  PBKDF2_SHA256_CONTEXT  Pbkdf2;
+  UINT8                  Salt[TEST_STORE_SALT_SIZE];
+  UINT8                  Output[TEST_OUTPUT_MAX];
+  UINT8                  Expected[TEST_OUTPUT_MAX];
+  UINT64                 Start;
+  UINT64                 BaseCryptLibNanoseconds;
+  UINT64                 ProgressNanoseconds;
+  UINT64                 ScalarNanoseconds;
+
+  SetMem (Salt, sizeof (Salt), 0x5A);
+
+  Start = GetNanoseconds ();
+  UT_ASSERT_TRUE (Pkcs5HashPassword (sizeof (Password) - sizeof (CHAR16), (CONST CHAR8 *)Password, sizeof (Salt), Salt, mStoreParameters[0].IterationCount, SHA256_DIGEST_SIZE, mStoreParameters[0].KeySize, Expected));
+  BaseCryptLibNanoseconds = GetNanoseconds () - Start;
+
+  Start = GetNanoseconds ();
+  UT_ASSERT_NOT_EFI_ERROR (
+    mPkcs5PasswordHashProtocol.HashPassword (
+                                 &mPkcs5PasswordHashProtocol,
+                                 sizeof (Password) - sizeof (CHAR16),
+                                 (CONST CHAR8 *)Password,
+                                 sizeof (Salt),
+                                 Salt,
+                                 mStoreParameters[0].IterationCount,
+                                 SHA256_DIGEST_SIZE,
+                                 mStoreParameters[0].KeySize,
+                                 Output
+                                 )
+    );
+  ProgressNanoseconds = GetNanoseconds () - Start;
+  UT_ASSERT_MEM_EQUAL (Output, Expected, mStoreParameters[0].KeySize);
+
+  // the last report is in the second block
+  UT_ASSERT_EQUAL (mLastTotal, 2 * mStoreParameters[0].IterationCount);
+  UT_ASSERT_TRUE (mLastCompleted > mStoreParameters[0].IterationCount);
+  UT_ASSERT_TRUE (mLastCompleted < mLastTotal);
+
+  Start = GetNanoseconds ();
+  Pbkdf2Sha256Start (&Pbkdf2, Sha256CompressScalar, (CONST UINT8 *)Password, sizeof (Password) - sizeof (CHAR16), Salt, sizeof (Salt), mStoreParameters[0].IterationCount);
+  UT_ASSERT_TRUE (Pbkdf2Sha256Blocks (&Pbkdf2, NULL, mStoreParameters[0].KeySize, Output));
+  Pbkdf2Sha256Finish (&Pbkdf2);
+  ScalarNanoseconds = GetNanoseconds () - Start;
+  UT_ASSERT_MEM_EQUAL (Output, Expected, mStoreParameters[0].KeySize);
+
+  UT_LOG_INFO (
+    "V1 store hash: Pkcs5HashPassword %ld us, with progress %ld us, portable engine %ld us\n",
+    DivU64x32 (BaseCryptLibNanoseconds, 1000),
+    DivU64x32 (ProgressNanoseconds, 1000),
+    DivU64x32 (ScalarNanoseconds, 1000)
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Get the iteration rate while a progress callback is registered.
+
+  @param[in]  Context   The PROTOCOL_TEST_CONTEXT.
+
+  @retval     UNIT_TEST_PASSED              The rate was timed once per digest size without
+                                            reporting progress.
+  @retval     UNIT_TEST_ERROR_TEST_FAILED   Not.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IterationRate (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Sha256Rate;
+  UINT64  Sha1Rate;
+  UINT64  Rate;
+
+  UT_ASSERT_STATUS_EQUAL (mPasswordHashProgressProtocol.GetIterationRate (&mPasswordHashProgressProtocol, SHA256_DIGEST_SIZE, NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (mPasswordHashProgressProtocol.GetIterationRate (&mPasswordHashProgressProtocol, 48, &Rate), EFI_UNSUPPORTED);
+
+  UT_ASSERT_NOT_EFI_ERROR (mPasswordHashProgressProtocol.GetIterationRate (&mPasswordHashProgressProtocol, SHA256_DIGEST_SIZE, &Sha256Rate));
+  UT_ASSERT_NOT_EFI_ERROR (mPasswordHashProgressProtocol.GetIterationRate (&mPasswordHashProgressProtocol, SHA1_DIGEST_SIZE, &Sha1Rate));
+  UT_ASSERT_TRUE (Sha256Rate != 0);
+  UT_ASSERT_TRUE (Sha1Rate != 0);
+
+  // the timed hashes ran without the callback
+  UT_ASSERT_EQUAL (mProgressCalls, 0);
+
+  // and only once
+  UT_ASSERT_NOT_EFI_ERROR (mPasswordHashProgressProtocol.GetIterationRate (&mPasswordHashProgressProtocol, SHA256_DIGEST_SIZE, &Rate));
+  UT_ASSERT_EQUAL (Rate, Sha256Rate);
+
+  UT_LOG_INFO ("%ld SHA-256 and %ld SHA-1 iterations per second\n", Sha256Rate, Sha1Rate);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests and run them.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      KnownAnswerTests;
+  UNIT_TEST_SUITE_HANDLE      BlocksTests;
+
+ #if defined (MDE_CPU_X64)
+  UNIT_TEST_SUITE_HANDLE  ShaExtensionsTests;
+ #endif
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&KnownAnswerTests, Framework, "PBKDF2 Known Answer Tests", "OemPkg.Pkcs5PasswordHashDxe.KnownAnswer", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for KnownAnswerTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (KnownAnswerTests, "Portable engine computes the known answers", "ScalarEngine", ScalarEngineKnownAnswers, NULL, NULL, NULL);
+  AddTestCase (KnownAnswerTests, "Protocol without the SHA extensions uses BaseCryptLib", "BaseCryptLib", ProtocolKnownAnswers, ProtocolTestSetup, ProtocolTestCleanup, &mBaseCryptLib);
+  AddTestCase (KnownAnswerTests, "Protocol with a compression function uses the engine", "Engine", ProtocolKnownAnswers, ProtocolTestSetup, ProtocolTestCleanup, &mEngine);
+  AddTestCase (KnownAnswerTests, "Protocol with a progress callback uses BaseCryptLib SHA-256", "CryptLibOnProgress", ProtocolKnownAnswers, ProtocolTestSetup, ProtocolTestCleanup, &mCryptLibOnProgress);
+  AddTestCase (KnownAnswerTests, "Progress callback cancels the hash", "ProgressCancels", ProgressCancels, ProtocolTestSetup, ProtocolTestCleanup, &mCryptLibOnProgress);
+  AddTestCase (KnownAnswerTests, "Progress callback keeps BaseCryptLib speed", "ProgressSpeed", ProgressSpeed, ProtocolTestSetup, ProtocolTestCleanup, &mCryptLibOnProgress);
+  AddTestCase (KnownAnswerTests, "Iteration rate is timed without the progress callback", "IterationRate", IterationRate, ProtocolTestSetup, ProtocolTestCleanup, &mCryptLibOnProgress);
+
+  Status = CreateUnitTestSuite (&BlocksTests, Framework, "PBKDF2 Parallel Block Tests", "OemPkg.Pkcs5PasswordHashDxe.Blocks", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BlocksTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BlocksTests, "Blocks on the BSP alone", "NoAps", BlocksMatchBaseCryptLib, BlocksTestSetup, BlocksTestCleanup, &mNoAps);
+  AddTestCase (BlocksTests, "Blocks on one AP and the BSP", "OneAp", BlocksMatchBaseCryptLib, BlocksTestSetup, BlocksTestCleanup, &mOneAp);
+  AddTestCase (BlocksTests, "Blocks on every AP and the BSP", "AllAps", BlocksMatchBaseCryptLib, BlocksTestSetup, BlocksTestCleanup, &mAllAps);
+  AddTestCase (BlocksTests, "Blocks with APs that are not ready", "RefusingAps", BlocksMatchBaseCryptLib, BlocksTestSetup, BlocksTestCleanup, &mRefusingAps);
+  AddTestCase (BlocksTests, "Cancel on the BSP while an AP computes a block", "CancelOnBsp", BlocksCancelOnBsp, BlocksTestSetup, BlocksTestCleanup, &mOneAp);
+  AddTestCase (BlocksTests, "Cancel while waiting for an AP", "CancelWhileWaiting", BlocksCancelWhileWaiting, BlocksTestSetup, BlocksTestCleanup, &mAllAps);
+
+ #if defined (MDE_CPU_X64)
+  Status = CreateUnitTestSuite (&ShaExtensionsTests, Framework, "SHA Extension Known Answer Tests", "OemPkg.Pkcs5PasswordHashDxe.ShaExtensions", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ShaExtensionsTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (ShaExtensionsTests, "SHA extensions compress like the portable function", "MatchScalar", ShaExtensionsMatchScalar, NULL, NULL, NULL);
+  AddTestCase (ShaExtensionsTests, "Protocol with the SHA extensions computes the known answers", "KnownAnswers", ShaExtensionsKnownAnswers, ProtocolTestSetup, ProtocolTestCleanup, &mShaExtensions);
+  AddTestCase (ShaExtensionsTests, "Protocol with the SHA extensions and a progress callback", "KnownAnswersOnProgress", ShaExtensionsKnownAnswers, ProtocolTestSetup, ProtocolTestCleanup, &mShaExtensionsOnProgress);
+  AddTestCase (ShaExtensionsTests, "Password store keys match BaseCryptLib", "Stores", ShaExtensionsStores, ProtocolTestSetup, ProtocolTestCleanup, &mShaExtensions);
+ #endif
+
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,52 @@
+/** @file Sha256Arch.c
+
+  Selects the SHA extensions compression function on X64 processors that support it.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+
+#include "../Pkcs5PasswordHashDxe.h"
+
+#define CPUID_EXTENDED_FEATURES  0x07
+#define CPUID_FEATURE_SSSE3      BIT9      // CPUID.01h:ECX
+#define CPUID_FEATURE_SSE4_1     BIT19     // CPUID.01h:ECX
+#define CPUID_FEATURE_SHA        BIT29     // CPUID.(07h,0):EBX
+
+/**
+  Returns an accelerated SHA-256 compression function if the processor supports one.
+
+  @retval     Sha256NiCompress if the processor has SHA, SSSE3 and SSE4.1, NULL otherwise.
+
+**/
+SHA256_COMPRESS
+Sha256GetArchCompress (
+  VOID
+  )
+{
+  UINT32  MaxLeaf;
+  UINT32  Ebx;
+  UINT32  Ecx;
+
+  AsmCpuid (0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < CPUID_EXTENDED_FEATURES) {
+    return NULL;
+  }
+
+  AsmCpuid (1, NULL, NULL, &Ecx, NULL);
+  if (((Ecx & CPUID_FEATURE_SSSE3) == 0) || ((Ecx & CPUID_FEATURE_SSE4_1) == 0)) {
+    return NULL;
+  }
+
+  AsmCpuidEx (CPUID_EXTENDED_FEATURES, 0, NULL, &Ebx, NULL, NULL);
+  if ((Ebx & CPUID_FEATURE_SHA) == 0) {
+    return NULL;
+  }
+
+  return Sha256NiCompress;
+}
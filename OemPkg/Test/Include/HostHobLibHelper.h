@@ -0,0 +1,21 @@
+/** @file HostHobLibHelper.h
+
+  Control of the HobLib instance that OemPkg host based unit tests use (Test/Library/HostHobLib).
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef HOST_HOB_LIB_HELPER_H_
+#define HOST_HOB_LIB_HELPER_H_
+
+/**
+  Empty the HOB list.
+**/
+VOID
+EFIAPI
+HostHobLibReset (
+  VOID
+  );
+
+#endif // HOST_HOB_LIB_HELPER_H_
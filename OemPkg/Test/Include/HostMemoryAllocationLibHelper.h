@@ -0,0 +1,39 @@
+/** @file HostMemoryAllocationLibHelper.h
+
+  Statistics of the MemoryAllocationLib instance that OemPkg host based unit tests use to measure
+  memory use (Test/Library/HostMemoryAllocationLib).
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef HOST_MEMORY_ALLOCATION_LIB_HELPER_H_
+#define HOST_MEMORY_ALLOCATION_LIB_HELPER_H_
+
+typedef struct {
+  UINT64    AllocationCount;    // Buffers allocated so far, freed or not.
+  UINT64    CurrentSize;        // Bytes in use.
+  UINT64    PeakSize;           // Most bytes in use since the start or the last reset of the peak.
+} HOST_MEMORY_ALLOCATION_STATS;
+
+/**
+  Get the allocation statistics.
+
+  @param[out] Stats   Receives the statistics.
+**/
+VOID
+EFIAPI
+HostMemoryAllocationLibGetStats (
+  OUT HOST_MEMORY_ALLOCATION_STATS  *Stats
+  );
+
+/**
+  Restart the peak from the bytes in use now.
+**/
+VOID
+EFIAPI
+HostMemoryAllocationLibResetPeak (
+  VOID
+  );
+
+#endif // HOST_MEMORY_ALLOCATION_LIB_HELPER_H_
@@ -0,0 +1,65 @@
+/** @file HostMpJobQueueLibHelper.h
+
+  Control of the MpJobQueueLib instance that OemPkg host based unit tests use
+  (Test/Library/HostMpJobQueueLib).
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef HOST_MP_JOB_QUEUE_LIB_HELPER_H_
+#define HOST_MP_JOB_QUEUE_LIB_HELPER_H_
+
+//
+// What the simulated APs did since the last reset.
+//
+typedef struct {
+  UINTN    ApJobs;            // Jobs run on an AP.
+  UINTN    RefusedStarts;     // Starts an AP refused with EFI_NOT_READY.
+  UINTN    WaitCallbacks;     // Calls of the MpJobQueueWait callback.
+} HOST_MP_JOB_QUEUE_STATS;
+
+/**
+  Remove every simulated AP and clear the statistics.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibReset (
+  VOID
+  );
+
+/**
+  Set the number of simulated APs.
+
+  @param[in]  ApCount   Number of APs, at most MP_JOB_QUEUE_MAX_APS.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibSetApCount (
+  IN UINTN  ApCount
+  );
+
+/**
+  Make the next starts of a job on an AP fail with EFI_NOT_READY, as they do on an AP that has set
+  Done but that MP services has not yet seen finish. The refused jobs stay waiting.
+
+  @param[in]  Count   Number of starts to refuse.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibRefuseStarts (
+  IN UINTN  Count
+  );
+
+/**
+  Get what the simulated APs did since the last reset.
+
+  @param[out] Stats   Receives the statistics.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibGetStats (
+  OUT HOST_MP_JOB_QUEUE_STATS  *Stats
+  );
+
+#endif // HOST_MP_JOB_QUEUE_LIB_HELPER_H_
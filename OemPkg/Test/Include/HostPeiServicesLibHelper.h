@@ -0,0 +1,42 @@
+/** @file HostPeiServicesLibHelper.h
+
+  Control of the PeiServicesLib instance that OemPkg host based unit tests use
+  (Test/Library/HostPeiServicesLib).
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef HOST_PEI_SERVICES_LIB_HELPER_H_
+#define HOST_PEI_SERVICES_LIB_HELPER_H_
+
+/**
+  Remove every PPI and file.
+**/
+VOID
+EFIAPI
+HostPeiServicesLibReset (
+  VOID
+  );
+
+/**
+  Add a freeform file to the firmware volume.
+
+  The sections are not copied.
+
+  @param[in]  FileName      Name of the file.
+  @param[in]  Sections      The sections of the file, each with its section header and 4 byte aligned.
+  @param[in]  SectionsSize  Size of Sections.
+
+  @retval EFI_SUCCESS           The file was added.
+  @retval EFI_OUT_OF_RESOURCES  The file table is full.
+**/
+EFI_STATUS
+EFIAPI
+HostPeiServicesLibAddFile (
+  IN CONST EFI_GUID  *FileName,
+  IN CONST VOID      *Sections,
+  IN UINT32          SectionsSize
+  );
+
+#endif // HOST_PEI_SERVICES_LIB_HELPER_H_
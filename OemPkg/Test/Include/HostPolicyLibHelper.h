@@ -0,0 +1,21 @@
+/** @file HostPolicyLibHelper.h
+
+  Control of the PolicyLib instance that OemPkg host based unit tests use (Test/Library/HostPolicyLib).
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef HOST_POLICY_LIB_HELPER_H_
+#define HOST_POLICY_LIB_HELPER_H_
+
+/**
+  Remove every policy, finalized or not.
+**/
+VOID
+EFIAPI
+HostPolicyLibReset (
+  VOID
+  );
+
+#endif // HOST_POLICY_LIB_HELPER_H_
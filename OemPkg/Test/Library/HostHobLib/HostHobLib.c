@@ -0,0 +1,235 @@
+/** @file HostHobLib.c
+
+  HobLib instance for host based unit tests.
+
+  The HOB list is kept in a static buffer. Like the PEI core, HOB lengths are rounded up to 8 bytes,
+  so the data of a GUID HOB can be longer than was asked for. Only the functions the OemPkg modules
+  under test use are implemented.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+
+#include <HostHobLibHelper.h>
+
+#define HOST_HOB_LIST_SIZE  SIZE_4MB
+
+STATIC UINT64                  mHobList[HOST_HOB_LIST_SIZE / sizeof (UINT64)];
+STATIC EFI_HOB_GENERIC_HEADER  *mEndOfHobList = NULL;
+
+/**
+  Empty the HOB list.
+**/
+VOID
+EFIAPI
+HostHobLibReset (
+  VOID
+  )
+{
+  mEndOfHobList            = (EFI_HOB_GENERIC_HEADER *)mHobList;
+  mEndOfHobList->HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  mEndOfHobList->HobLength = sizeof (EFI_HOB_GENERIC_HEADER);
+  mEndOfHobList->Reserved  = 0;
+}
+
+/**
+  Returns the pointer to the HOB list.
+
+  @return The pointer to the HOB list.
+
+**/
+VOID *
+EFIAPI
+GetHobList (
+  VOID
+  )
+{
+  if (mEndOfHobList == NULL) {
+    HostHobLibReset ();
+  }
+
+  return mHobList;
+}
+
+/**
+  Returns the next instance of a HOB type from the starting HOB.
+
+  @param  Type          The HOB type to return.
+  @param  HobStart      The starting HOB pointer to search from.
+
+  @return The next instance of a HOB type from the starting HOB, or NULL.
+
+**/
+VOID *
+EFIAPI
+GetNextHob (
+  IN UINT16      Type,
+  IN CONST VOID  *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+
+  ASSERT (HobStart != NULL);
+
+  Hob.Raw = (UINT8 *)HobStart;
+  while (!END_OF_HOB_LIST (Hob)) {
+    if (Hob.Header->HobType == Type) {
+      return Hob.Raw;
+    }
+
+    Hob.Raw = GET_NEXT_HOB (Hob);
+  }
+
+  return NULL;
+}
+
+/**
+  Returns the first instance of a HOB type among the whole HOB list.
+
+  @param  Type          The HOB type to return.
+
+  @return The first instance of the HOB type, or NULL.
+
+**/
+VOID *
+EFIAPI
+GetFirstHob (
+  IN UINT16  Type
+  )
+{
+  return GetNextHob (Type, GetHobList ());
+}
+
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB.
+
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      A pointer to a Guid.
+
+  @return The next instance of the matched GUID HOB from the starting HOB, or NULL.
+
+**/
+VOID *
+EFIAPI
+GetNextGuidHob (
+  IN CONST EFI_GUID  *Guid,
+  IN CONST VOID      *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  GuidHob;
+
+  GuidHob.Raw = (UINT8 *)HobStart;
+  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
+    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      break;
+    }
+
+    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  }
+
+  return GuidHob.Raw;
+}
+
+/**
+  Returns the first instance of the matched GUID HOB among the whole HOB list.
+
+  @param  Guid          The GUID to match with in the HOB list.
+
+  @return The first instance of the matched GUID HOB among the whole HOB list, or NULL.
+
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID  *Guid
+  )
+{
+  return GetNextGuidHob (Guid, GetHobList ());
+}
+
+/**
+  Builds a GUID HOB with a certain data length.
+
+  The HOB length is rounded up to 8 bytes, so the data of the HOB can be up to 7 bytes longer than
+  DataLength.
+
+  @param  Guid          The GUID to tag the customized HOB.
+  @param  DataLength    The size of the data payload for the GUID HOB.
+
+  @return The start address of the GUID HOB data, or NULL if the HOB list is full or DataLength
+          is too large.
+
+**/
+VOID *
+EFIAPI
+BuildGuidHob (
+  IN CONST EFI_GUID  *Guid,
+  IN UINTN           DataLength
+  )
+{
+  EFI_HOB_GUID_TYPE  *Hob;
+  UINTN              HobLength;
+
+  if (DataLength > (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE))) {
+    DEBUG ((DEBUG_ERROR, "%a - GUID HOB data of 0x%x bytes is too large.\n", __FUNCTION__, DataLength));
+    return NULL;
+  }
+
+  GetHobList ();
+
+  HobLength = ALIGN_VALUE (sizeof (EFI_HOB_GUID_TYPE) + DataLength, 8);
+  if (HobLength + sizeof (EFI_HOB_GENERIC_HEADER) > (UINTN)((UINT8 *)mHobList + sizeof (mHobList) - (UINT8 *)mEndOfHobList)) {
+    DEBUG ((DEBUG_ERROR, "%a - HOB list is full.\n", __FUNCTION__));
+    return NULL;
+  }
+
+  Hob = (EFI_HOB_GUID_TYPE *)mEndOfHobList;
+  ZeroMem (Hob, HobLength);
+  Hob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  Hob->Header.HobLength = (UINT16)HobLength;
+  CopyGuid (&Hob->Name, Guid);
+
+  mEndOfHobList            = (EFI_HOB_GENERIC_HEADER *)((UINT8 *)Hob + HobLength);
+  mEndOfHobList->HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  mEndOfHobList->HobLength = sizeof (EFI_HOB_GENERIC_HEADER);
+  mEndOfHobList->Reserved  = 0;
+
+  return Hob + 1;
+}
+
+/**
+  Builds a GUID HOB and copies the supplied data into it.
+
+  @param  Guid          The GUID to tag the customized HOB.
+  @param  Data          The data to be copied into the data field of the GUID HOB.
+  @param  DataLength    The size of the data payload for the GUID HOB.
+
+  @return The start address of the GUID HOB data, or NULL.
+
+**/
+VOID *
+EFIAPI
+BuildGuidDataHob (
+  IN CONST EFI_GUID  *Guid,
+  IN VOID            *Data,
+  IN UINTN           DataLength
+  )
+{
+  VOID  *HobData;
+
+  ASSERT (Data != NULL || DataLength == 0);
+
+  HobData = BuildGuidHob (Guid, DataLength);
+  if (HobData == NULL) {
+    return NULL;
+  }
+
+  return CopyMem (HobData, Data, DataLength);
+}
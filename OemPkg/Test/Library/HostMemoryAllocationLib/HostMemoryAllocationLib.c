@@ -0,0 +1,556 @@
+/** @file HostMemoryAllocationLib.c
+
+  MemoryAllocationLib instance for host based unit tests that measure memory use.
+
+  Every buffer is allocated from the C library with a header that records its size, so the library
+  can count the allocations made and track the bytes in use and their peak. Pool and page
+  allocations are counted alike, and the runtime and reserved variants are the same as the boot
+  services ones.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+
+#include <Uefi.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <HostMemoryAllocationLibHelper.h>
+
+#define HOST_ALLOCATION_SIGNATURE  SIGNATURE_32 ('H', 'A', 'L', 'C')
+
+//
+// Precedes every buffer handed out. Its size keeps pool buffers 8 byte aligned.
+//
+typedef struct {
+  UINT32    Signature;
+  UINT32    Reserved;
+  UINT64    Size;           // Bytes asked for.
+  UINT64    Allocation;     // What the C library returned.
+} HOST_ALLOCATION_HEAD;
+
+STATIC HOST_MEMORY_ALLOCATION_STATS  mStats;
+
+/**
+  Get the allocation statistics.
+
+  @param[out] Stats   Receives the statistics.
+**/
+VOID
+EFIAPI
+HostMemoryAllocationLibGetStats (
+  OUT HOST_MEMORY_ALLOCATION_STATS  *Stats
+  )
+{
+  CopyMem (Stats, &mStats, sizeof (*Stats));
+}
+
+/**
+  Restart the peak from the bytes in use now.
+**/
+VOID
+EFIAPI
+HostMemoryAllocationLibResetPeak (
+  VOID
+  )
+{
+  mStats.PeakSize = mStats.CurrentSize;
+}
+
+/**
+  Allocate a counted buffer.
+
+  @param[in]  Size        Bytes to allocate.
+  @param[in]  Alignment   Alignment of the buffer, a power of 2 or 0 for the pool alignment.
+
+  @return     The buffer, or NULL if it could not be allocated.
+**/
+STATIC
+VOID *
+HostAllocate (
+  IN UINTN  Size,
+  IN UINTN  Alignment
+  )
+{
+  VOID                  *Allocation;
+  HOST_ALLOCATION_HEAD  *Head;
+  UINTN                 Extra;
+
+  Extra = sizeof (HOST_ALLOCATION_HEAD) + ((Alignment > sizeof (HOST_ALLOCATION_HEAD)) ? Alignment : 0);
+  if (Size > MAX_UINTN - Extra) {
+    return NULL;
+  }
+
+  Allocation = malloc (Size + Extra);
+  if (Allocation == NULL) {
+    return NULL;
+  }
+
+  Head = (HOST_ALLOCATION_HEAD *)Allocation;
+  if (Alignment > sizeof (HOST_ALLOCATION_HEAD)) {
+    Head = (HOST_ALLOCATION_HEAD *)ALIGN_POINTER ((UINT8 *)Allocation + sizeof (HOST_ALLOCATION_HEAD), Alignment) - 1;
+  }
+
+  Head->Signature  = HOST_ALLOCATION_SIGNATURE;
+  Head->Allocation = (UINTN)Allocation;
+  Head->Size       = Size;
+
+  mStats.AllocationCount++;
+  mStats.CurrentSize += Size;
+  if (mStats.CurrentSize > mStats.PeakSize) {
+    mStats.PeakSize = mStats.CurrentSize;
+  }
+
+  return Head + 1;
+}
+
+/**
+  Free a counted buffer.
+
+  @param[in]  Buffer    Buffer from HostAllocate.
+**/
+STATIC
+VOID
+HostFree (
+  IN VOID  *Buffer
+  )
+{
+  HOST_ALLOCATION_HEAD  *Head;
+
+  Head = (HOST_ALLOCATION_HEAD *)Buffer - 1;
+  ASSERT (Head->Signature == HOST_ALLOCATION_SIGNATURE);
+  if (Head->Signature != HOST_ALLOCATION_SIGNATURE) {
+    return;
+  }
+
+  Head->Signature     = 0;
+  mStats.CurrentSize -= Head->Size;
+  free ((VOID *)(UINTN)Head->Allocation);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiBootServicesData.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocatePages (
+  IN UINTN  Pages
+  )
+{
+  return AllocateAlignedPages (Pages, EFI_PAGE_SIZE);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiRuntimeServicesData.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateRuntimePages (
+  IN UINTN  Pages
+  )
+{
+  return AllocatePages (Pages);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiReservedMemoryType.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateReservedPages (
+  IN UINTN  Pages
+  )
+{
+  return AllocatePages (Pages);
+}
+
+/**
+  Frees one or more 4KB pages that were previously allocated with one of the page allocation
+  functions in the Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer of pages to free.
+  @param  Pages                 The number of 4 KB pages to free.
+
+**/
+VOID
+EFIAPI
+FreePages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  ASSERT (((HOST_ALLOCATION_HEAD *)Buffer - 1)->Size == EFI_PAGES_TO_SIZE (Pages));
+  HostFree (Buffer);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiBootServicesData at a specified alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation. Must be a power of two.
+                                If Alignment is zero, then byte alignment is used.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateAlignedPages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  ASSERT ((Alignment & (Alignment - 1)) == 0);
+
+  if ((Pages == 0) || (Pages > EFI_SIZE_TO_PAGES (MAX_UINTN))) {
+    return NULL;
+  }
+
+  return HostAllocate (EFI_PAGES_TO_SIZE (Pages), Alignment);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiRuntimeServicesData at a specified alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation. Must be a power of two.
+                                If Alignment is zero, then byte alignment is used.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateAlignedRuntimePages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  return AllocateAlignedPages (Pages, Alignment);
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiReservedMemoryType at a specified alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation. Must be a power of two.
+                                If Alignment is zero, then byte alignment is used.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateAlignedReservedPages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  return AllocateAlignedPages (Pages, Alignment);
+}
+
+/**
+  Frees one or more 4KB pages that were previously allocated with one of the aligned page
+  allocation functions in the Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer of pages to free.
+  @param  Pages                 The number of 4 KB pages to free.
+
+**/
+VOID
+EFIAPI
+FreeAlignedPages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  FreePages (Buffer, Pages);
+}
+
+/**
+  Allocates a buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return HostAllocate (AllocationSize, 0);
+}
+
+/**
+  Allocates a buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateRuntimePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return AllocatePool (AllocationSize);
+}
+
+/**
+  Allocates a buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateReservedPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return AllocatePool (AllocationSize);
+}
+
+/**
+  Allocates and zeros a buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  VOID  *Buffer;
+
+  Buffer = AllocatePool (AllocationSize);
+  if (Buffer != NULL) {
+    ZeroMem (Buffer, AllocationSize);
+  }
+
+  return Buffer;
+}
+
+/**
+  Allocates and zeros a buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateRuntimeZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return AllocateZeroPool (AllocationSize);
+}
+
+/**
+  Allocates and zeros a buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateReservedZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return AllocateZeroPool (AllocationSize);
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  VOID  *Memory;
+
+  ASSERT (Buffer != NULL);
+
+  Memory = AllocatePool (AllocationSize);
+  if (Memory != NULL) {
+    CopyMem (Memory, Buffer, AllocationSize);
+  }
+
+  return Memory;
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateRuntimeCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  return AllocateCopyPool (AllocationSize, Buffer);
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+AllocateReservedCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  return AllocateCopyPool (AllocationSize, Buffer);
+}
+
+/**
+  Reallocates a buffer of type EfiBootServicesData.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. This is an optional
+                         parameter that may be NULL.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+ReallocatePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  VOID  *NewBuffer;
+
+  NewBuffer = AllocateZeroPool (NewSize);
+  if ((NewBuffer != NULL) && (OldBuffer != NULL)) {
+    CopyMem (NewBuffer, OldBuffer, MIN (OldSize, NewSize));
+    FreePool (OldBuffer);
+  }
+
+  return NewBuffer;
+}
+
+/**
+  Reallocates a buffer of type EfiRuntimeServicesData.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. This is an optional
+                         parameter that may be NULL.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+ReallocateRuntimePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  return ReallocatePool (OldSize, NewSize, OldBuffer);
+}
+
+/**
+  Reallocates a buffer of type EfiReservedMemoryType.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. This is an optional
+                         parameter that may be NULL.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+
+**/
+VOID *
+EFIAPI
+ReallocateReservedPool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  return ReallocatePool (OldSize, NewSize, OldBuffer);
+}
+
+/**
+  Frees a buffer that was previously allocated with one of the pool allocation functions in the
+  Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer to free.
+
+**/
+VOID
+EFIAPI
+FreePool (
+  IN VOID  *Buffer
+  )
+{
+  ASSERT (Buffer != NULL);
+  if (Buffer != NULL) {
+    HostFree (Buffer);
+  }
+}
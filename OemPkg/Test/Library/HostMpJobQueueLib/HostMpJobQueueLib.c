@@ -0,0 +1,299 @@
+/** @file HostMpJobQueueLib.c
+
+  MpJobQueueLib instance for host based unit tests.
+
+  There are no APs unless the test adds simulated ones. Jobs are started on idle simulated APs the
+  way the library starts them, and an AP runs its job alongside the caller: the jobs running on APs
+  finish whenever MpJobQueueNext hands the caller a job of its own, and the ones still running when
+  the caller runs out of jobs finish in MpJobQueueWait, after one call of the wait callback each. A
+  test can make APs refuse starts with EFI_NOT_READY, in which case the job stays waiting for the
+  next idle AP or the caller.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MpJobQueueLib.h>
+
+#include <HostMpJobQueueLibHelper.h>
+
+STATIC UINTN                    mApCount       = 0;
+STATIC UINTN                    mRefusedStarts = 0;     // Starts still to refuse.
+STATIC HOST_MP_JOB_QUEUE_STATS  mStats;
+
+/**
+  Remove every simulated AP and clear the statistics.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibReset (
+  VOID
+  )
+{
+  mApCount       = 0;
+  mRefusedStarts = 0;
+  ZeroMem (&mStats, sizeof (mStats));
+}
+
+/**
+  Set the number of simulated APs.
+
+  @param[in]  ApCount   Number of APs, at most MP_JOB_QUEUE_MAX_APS.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibSetApCount (
+  IN UINTN  ApCount
+  )
+{
+  ASSERT (ApCount <= MP_JOB_QUEUE_MAX_APS);
+  mApCount = MIN (ApCount, MP_JOB_QUEUE_MAX_APS);
+}
+
+/**
+  Make the next starts of a job on an AP fail with EFI_NOT_READY, as they do on an AP that has set
+  Done but that MP services has not yet seen finish. The refused jobs stay waiting.
+
+  @param[in]  Count   Number of starts to refuse.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibRefuseStarts (
+  IN UINTN  Count
+  )
+{
+  mRefusedStarts = Count;
+}
+
+/**
+  Get what the simulated APs did since the last reset.
+
+  @param[out] Stats   Receives the statistics.
+**/
+VOID
+EFIAPI
+HostMpJobQueueLibGetStats (
+  OUT HOST_MP_JOB_QUEUE_STATS  *Stats
+  )
+{
+  CopyMem (Stats, &mStats, sizeof (*Stats));
+}
+
+/**
+  Run the job of a simulated AP to the end.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+  @param[in]      Ap      Index of the AP.
+
+**/
+STATIC
+VOID
+FinishApJob (
+  IN OUT MP_JOB_QUEUE  *Queue,
+  IN     UINTN         Ap
+  )
+{
+  MP_JOB  *Job;
+
+  Job = Queue->ApJob[Ap];
+  if ((Job == NULL) || Job->Done) {
+    return;
+  }
+
+  Job->Procedure (Job->Buffer);
+  Job->Done = TRUE;
+  mStats.ApJobs++;
+}
+
+/**
+  Start waiting jobs on every simulated AP that is not running one of this queue's jobs.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+**/
+STATIC
+VOID
+DispatchToIdleAps (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; (Index < mApCount) && (Queue->NextJob < Queue->JobCount); Index++) {
+    if ((Queue->ApJob[Index] != NULL) && !Queue->ApJob[Index]->Done) {
+      continue;
+    }
+
+    // EFI_NOT_READY from StartupThisAP
+    if (mRefusedStarts != 0) {
+      mRefusedStarts--;
+      mStats.RefusedStarts++;
+      continue;
+    }
+
+    Queue->ApJob[Index] = &Queue->Jobs[Queue->NextJob++];
+  }
+}
+
+/**
+  Get the number of APs jobs can be started on.
+
+  @retval   The number of simulated APs.
+
+**/
+UINTN
+EFIAPI
+MpJobQueueGetApCount (
+  VOID
+  )
+{
+  return mApCount;
+}
+
+/**
+  Prepare a queue and start as many of its jobs as possible on idle APs.
+
+  @param[out] Queue     Queue to prepare.
+  @param[in]  Jobs      Jobs to run, in order. Procedure and Buffer must be set. The array must
+                        stay valid until MpJobQueueWait returns.
+  @param[in]  JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueStart (
+  OUT MP_JOB_QUEUE  *Queue,
+  IN  MP_JOB        *Jobs,
+  IN  UINTN         JobCount
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (Queue, sizeof (*Queue));
+  Queue->Jobs     = Jobs;
+  Queue->JobCount = JobCount;
+
+  for (Index = 0; Index < JobCount; Index++) {
+    ASSERT (Jobs[Index].Procedure != NULL);
+    Jobs[Index].Done = FALSE;
+  }
+
+  DispatchToIdleAps (Queue);
+}
+
+/**
+  Start waiting jobs on APs that have finished, then take the next waiting job for the caller.
+  The jobs running on APs finish while the caller runs its job.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+  @retval   The job for the caller to run, or NULL if every job has been started.
+
+**/
+MP_JOB *
+EFIAPI
+MpJobQueueNext (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  MP_JOB  *Job;
+  UINTN   Index;
+
+  DispatchToIdleAps (Queue);
+
+  if (Queue->NextJob >= Queue->JobCount) {
+    return NULL;
+  }
+
+  Job = &Queue->Jobs[Queue->NextJob++];
+  for (Index = 0; Index < mApCount; Index++) {
+    FinishApJob (Queue, Index);
+  }
+
+  return Job;
+}
+
+/**
+  Stop starting jobs. Jobs that have not been started are left with Done clear, and
+  MpJobQueueNext returns NULL from now on.
+
+  @param[in,out]  Queue   Queue prepared by MpJobQueueStart.
+
+**/
+VOID
+EFIAPI
+MpJobQueueCancel (
+  IN OUT MP_JOB_QUEUE  *Queue
+  )
+{
+  Queue->NextJob = Queue->JobCount;
+}
+
+/**
+  Wait for every job started on an AP to finish. The callback is called once for each job that is
+  still running.
+
+  @param[in,out]  Queue           Queue prepared by MpJobQueueStart. MpJobQueueNext must have
+                                  returned NULL, or MpJobQueueCancel must have been called.
+  @param[in]      Callback        Called while waiting, or NULL.
+  @param[in]      CallbackContext Passed to Callback.
+
+**/
+VOID
+EFIAPI
+MpJobQueueWait (
+  IN OUT MP_JOB_QUEUE          *Queue,
+  IN     MP_JOB_WAIT_CALLBACK  Callback OPTIONAL,
+  IN     VOID                  *CallbackContext OPTIONAL
+  )
+{
+  UINTN  Index;
+
+  ASSERT (Queue->NextJob >= Queue->JobCount);
+
+  for (Index = 0; Index < mApCount; Index++) {
+    if (Queue->ApJob[Index] == NULL) {
+      continue;
+    }
+
+    if (!Queue->ApJob[Index]->Done && (Callback != NULL)) {
+      mStats.WaitCallbacks++;
+      Callback (CallbackContext);
+    }
+
+    FinishApJob (Queue, Index);
+    Queue->ApJob[Index] = NULL;
+  }
+}
+
+/**
+  Run a set of jobs on the APs and the caller, and return once all of them have finished.
+
+  @param[in,out]  Jobs      Jobs to run. Procedure and Buffer must be set.
+  @param[in]      JobCount  Number of jobs.
+
+**/
+VOID
+EFIAPI
+MpJobQueueRun (
+  IN OUT MP_JOB  *Jobs,
+  IN     UINTN   JobCount
+  )
+{
+  MP_JOB_QUEUE  Queue;
+  MP_JOB        *Job;
+
+  MpJobQueueStart (&Queue, Jobs, JobCount);
+
+  for (Job = MpJobQueueNext (&Queue); Job != NULL; Job = MpJobQueueNext (&Queue)) {
+    Job->Procedure (Job->Buffer);
+    Job->Done = TRUE;
+  }
+
+  MpJobQueueWait (&Queue, NULL, NULL);
+}
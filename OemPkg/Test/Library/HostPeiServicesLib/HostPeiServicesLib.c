@@ -0,0 +1,312 @@
+/** @file HostPeiServicesLib.c
+
+  PeiServicesLib instance for host based unit tests.
+
+  PPIs are installed into and located from a fixed table. There is one firmware volume, holding the
+  freeform files the test added. The data a test installs or adds is not copied, so it must stay
+  valid until the library is reset. Only the functions the OemPkg modules under test use are
+  implemented.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+
+#include <HostPeiServicesLibHelper.h>
+
+#define HOST_PPI_MAX   64
+#define HOST_FILE_MAX  16
+
+//
+// A freeform file added by the test.
+//
+typedef struct {
+  EFI_GUID      FileName;
+  CONST VOID    *Sections;
+  UINT32        SectionsSize;
+} HOST_FILE;
+
+STATIC CONST EFI_PEI_PPI_DESCRIPTOR  *mPpis[HOST_PPI_MAX];
+STATIC UINTN                         mPpiCount = 0;
+STATIC HOST_FILE                     mFiles[HOST_FILE_MAX];
+STATIC UINTN                         mFileCount = 0;
+
+//
+// Handle of the one firmware volume.
+//
+STATIC UINT8  mVolume;
+
+/**
+  Remove every PPI and file.
+**/
+VOID
+EFIAPI
+HostPeiServicesLibReset (
+  VOID
+  )
+{
+  mPpiCount  = 0;
+  mFileCount = 0;
+}
+
+/**
+  Add a freeform file to the firmware volume.
+
+  @param[in]  FileName      Name of the file.
+  @param[in]  Sections      The sections of the file, each with its section header and 4 byte aligned.
+  @param[in]  SectionsSize  Size of Sections.
+
+  @retval EFI_SUCCESS           The file was added.
+  @retval EFI_OUT_OF_RESOURCES  The file table is full.
+**/
+EFI_STATUS
+EFIAPI
+HostPeiServicesLibAddFile (
+  IN CONST EFI_GUID  *FileName,
+  IN CONST VOID      *Sections,
+  IN UINT32          SectionsSize
+  )
+{
+  if (mFileCount == HOST_FILE_MAX) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyGuid (&mFiles[mFileCount].FileName, FileName);
+  mFiles[mFileCount].Sections     = Sections;
+  mFiles[mFileCount].SectionsSize = SectionsSize;
+  mFileCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  This service enables a given PEIM to register an interface into the PEI Foundation.
+
+  @param  PpiList               A pointer to the list of interfaces that the caller shall install.
+
+  @retval EFI_SUCCESS           The interface was successfully installed.
+  @retval EFI_INVALID_PARAMETER The PpiList pointer is NULL.
+  @retval EFI_OUT_OF_RESOURCES  There is no additional space in the PPI database.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesInstallPpi (
+  IN CONST EFI_PEI_PPI_DESCRIPTOR  *PpiList
+  )
+{
+  if (PpiList == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for ( ; ; PpiList++) {
+    if (mPpiCount == HOST_PPI_MAX) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mPpis[mPpiCount++] = PpiList;
+    if ((PpiList->Flags & EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST) != 0) {
+      return EFI_SUCCESS;
+    }
+  }
+}
+
+/**
+  This service enables PEIMs to discover a given instance of an interface.
+
+  @param  Guid                  A pointer to the GUID whose corresponding interface needs to be
+                                found.
+  @param  Instance              The N-th instance of the interface that is required.
+  @param  PpiDescriptor         A pointer to instance of the EFI_PEI_PPI_DESCRIPTOR.
+  @param  Ppi                   A pointer to the instance of the interface.
+
+  @retval EFI_SUCCESS           The interface was successfully returned.
+  @retval EFI_NOT_FOUND         The PPI descriptor is not found in the database.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesLocatePpi (
+  IN CONST EFI_GUID                   *Guid,
+  IN UINTN                            Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR       **PpiDescriptor  OPTIONAL,
+  IN OUT VOID                         **Ppi
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mPpiCount; Index++) {
+    if (!CompareGuid (mPpis[Index]->Guid, Guid)) {
+      continue;
+    }
+
+    if (Instance-- > 0) {
+      continue;
+    }
+
+    if (PpiDescriptor != NULL) {
+      *PpiDescriptor = (EFI_PEI_PPI_DESCRIPTOR *)mPpis[Index];
+    }
+
+    *Ppi = mPpis[Index]->Ppi;
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  This service enables PEIMs to discover additional firmware volumes.
+
+  @param  Instance              This instance of the firmware volume to find.
+  @param  VolumeHandle          Handle of the firmware volume header of the volume to return.
+
+  @retval EFI_SUCCESS           The volume was found.
+  @retval EFI_NOT_FOUND         The volume was not found.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsFindNextVolume (
+  IN UINTN                 Instance,
+  IN OUT EFI_PEI_FV_HANDLE  *VolumeHandle
+  )
+{
+  if (Instance != 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  *VolumeHandle = (EFI_PEI_FV_HANDLE)&mVolume;
+  return EFI_SUCCESS;
+}
+
+/**
+  This service is a wrapper for the PEI Service FfsFindByName(), except the pointer to the PEI
+  Services Table has been removed.
+
+  @param  FileName      A pointer to the name of the file to find within the firmware volume.
+  @param  VolumeHandle  The firmware volume to search FileHandle.
+  @param  FileHandle    Upon exit, points to the found file's handle or NULL if it could not be
+                        found.
+
+  @retval EFI_SUCCESS             File was found.
+  @retval EFI_NOT_FOUND           File was not found.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsFindFileByName (
+  IN CONST  EFI_GUID            *FileName,
+  IN CONST  EFI_PEI_FV_HANDLE   VolumeHandle,
+  OUT       EFI_PEI_FILE_HANDLE *FileHandle
+  )
+{
+  UINTN  Index;
+
+  *FileHandle = NULL;
+  if (VolumeHandle != (EFI_PEI_FV_HANDLE)&mVolume) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Index = 0; Index < mFileCount; Index++) {
+    if (CompareGuid (&mFiles[Index].FileName, FileName)) {
+      *FileHandle = (EFI_PEI_FILE_HANDLE)&mFiles[Index];
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  This service enables PEI modules to discover sections of a given instance and type within a
+  valid FFS file.
+
+  @param  SectionType           The value of the section type to search.
+  @param  SectionInstance       Pointer to the filesystem section instance to search.
+  @param  FileHandle            A pointer to the file header that contains the set of sections to
+                                be searched.
+  @param  SectionData           A pointer to the discovered section, if successful.
+  @param  AuthenticationStatus  Updated upon return to point to the authentication status for this
+                                section.
+
+  @retval EFI_SUCCESS           The section was found.
+  @retval EFI_NOT_FOUND         The section was not found.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsFindSectionData3 (
+  IN EFI_SECTION_TYPE     SectionType,
+  IN UINTN                SectionInstance,
+  IN EFI_PEI_FILE_HANDLE  FileHandle,
+  OUT VOID                **SectionData,
+  OUT UINT32              *AuthenticationStatus
+  )
+{
+  CONST HOST_FILE                  *File;
+  CONST EFI_COMMON_SECTION_HEADER  *Section;
+  UINT32                           Offset;
+  UINT32                           HeaderSize;
+  UINT32                           Size;
+
+  File   = (CONST HOST_FILE *)FileHandle;
+  Offset = 0;
+  while (Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= File->SectionsSize) {
+    Section    = (CONST EFI_COMMON_SECTION_HEADER *)((CONST UINT8 *)File->Sections + Offset);
+    HeaderSize = IS_SECTION2 (Section) ? sizeof (EFI_COMMON_SECTION_HEADER2) : sizeof (EFI_COMMON_SECTION_HEADER);
+    Size       = IS_SECTION2 (Section) ? SECTION2_SIZE (Section) : SECTION_SIZE (Section);
+    ASSERT ((Size >= HeaderSize) && (Size <= File->SectionsSize - Offset));
+    if ((Size < HeaderSize) || (Size > File->SectionsSize - Offset)) {
+      break;
+    }
+
+    if ((Section->Type == SectionType) && (SectionInstance-- == 0)) {
+      *SectionData          = (UINT8 *)Section + HeaderSize;
+      *AuthenticationStatus = 0;
+      return EFI_SUCCESS;
+    }
+
+    Offset += ALIGN_VALUE (Size, 4);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  This service is a wrapper for the PEI Service FfsGetFileInfo(), except the pointer to the PEI
+  Services Table has been removed.
+
+  @param  FileHandle              The handle of the file.
+  @param  FileInfo                Upon exit, points to the file's information.
+
+  @retval EFI_SUCCESS             File information returned.
+  @retval EFI_INVALID_PARAMETER   FileInfo is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsGetFileInfo (
+  IN CONST  EFI_PEI_FILE_HANDLE  FileHandle,
+  OUT EFI_FV_FILE_INFO           *FileInfo
+  )
+{
+  CONST HOST_FILE  *File;
+
+  if (FileInfo == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  File = (CONST HOST_FILE *)FileHandle;
+  CopyGuid (&FileInfo->FileName, &File->FileName);
+  FileInfo->FileType       = EFI_FV_FILETYPE_FREEFORM;
+  FileInfo->FileAttributes = 0;
+  FileInfo->Buffer         = (VOID *)File->Sections;
+  FileInfo->BufferSize     = File->SectionsSize;
+  return EFI_SUCCESS;
+}
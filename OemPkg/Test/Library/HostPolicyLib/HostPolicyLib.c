@@ -0,0 +1,215 @@
+/** @file HostPolicyLib.c
+
+  PolicyLib instance for host based unit tests.
+
+  Policies are copied into a fixed table and behave like the ones of the policy service: a finalized
+  policy cannot be set again or removed, and getting a policy into a buffer that is too small returns
+  its size. Notifications and verified policies are not supported.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PolicyLib.h>
+
+#include <HostPolicyLibHelper.h>
+
+#define HOST_POLICY_MAX  256
+
+typedef struct {
+  EFI_GUID    PolicyGuid;
+  UINT64      Attributes;
+  VOID        *Policy;      // NULL if the entry is free.
+  UINT16      PolicySize;
+} HOST_POLICY;
+
+STATIC HOST_POLICY  mPolicies[HOST_POLICY_MAX];
+
+/**
+  Find a policy.
+
+  @param[in]  PolicyGuid    The GUID of the policy.
+
+  @return     The policy, or NULL if it is not set.
+**/
+STATIC
+HOST_POLICY *
+FindPolicy (
+  IN CONST EFI_GUID  *PolicyGuid
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < HOST_POLICY_MAX; Index++) {
+    if ((mPolicies[Index].Policy != NULL) && CompareGuid (&mPolicies[Index].PolicyGuid, PolicyGuid)) {
+      return &mPolicies[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Remove every policy, finalized or not.
+**/
+VOID
+EFIAPI
+HostPolicyLibReset (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < HOST_POLICY_MAX; Index++) {
+    if (mPolicies[Index].Policy != NULL) {
+      FreePool (mPolicies[Index].Policy);
+      mPolicies[Index].Policy = NULL;
+    }
+  }
+}
+
+/**
+  Creates or updates a policy in the policy store. Will notify any applicable callbacks.
+
+  @param[in]  PolicyGuid          The uniquely identifying GUID for the policy.
+  @param[in]  Attributes          Attributes of the policy to be set.
+  @param[in]  Policy              The policy data buffer. This buffer will be copied into the data store.
+  @param[in]  PolicySize          The size of the provided policy data.
+
+  @retval   EFI_SUCCESS           Policy was created or updated.
+  @retval   EFI_ACCESS_DENIED     Policy was already finalized prior to this call.
+  @retval   EFI_OUT_OF_RESOURCES  Failed to allocate memory for the policy.
+  @retval   EFI_INVALID_PARAMETER An argument is invalid.
+**/
+EFI_STATUS
+EFIAPI
+SetPolicy (
+  IN CONST EFI_GUID  *PolicyGuid,
+  IN UINT64          Attributes,
+  IN VOID            *Policy,
+  IN UINT16          PolicySize
+  )
+{
+  HOST_POLICY  *Entry;
+  VOID         *Copy;
+  UINTN        Index;
+
+  if ((PolicyGuid == NULL) || (Policy == NULL) || (PolicySize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Entry = FindPolicy (PolicyGuid);
+  if ((Entry != NULL) && ((Entry->Attributes & POLICY_ATTRIBUTE_FINALIZED) != 0)) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  for (Index = 0; (Entry == NULL) && (Index < HOST_POLICY_MAX); Index++) {
+    if (mPolicies[Index].Policy == NULL) {
+      Entry = &mPolicies[Index];
+    }
+  }
+
+  if (Entry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Copy = AllocateCopyPool (PolicySize, Policy);
+  if (Copy == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Entry->Policy != NULL) {
+    FreePool (Entry->Policy);
+  }
+
+  CopyGuid (&Entry->PolicyGuid, PolicyGuid);
+  Entry->Attributes = Attributes;
+  Entry->Policy     = Copy;
+  Entry->PolicySize = PolicySize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieves the policy descriptor, buffer, and size for a given policy GUID.
+
+  @param[in]      PolicyGuid        The GUID of the policy being retrieved.
+  @param[out]     Attributes        The attributes of the stored policy.
+  @param[out]     Policy            The buffer where the policy data is copied.
+  @param[in,out]  PolicySize        The size of the stored policy data buffer.
+                                    On output, contains the size of the stored policy.
+
+  @retval   EFI_SUCCESS           The policy was retrieved.
+  @retval   EFI_BUFFER_TOO_SMALL  The provided buffer size was too small.
+  @retval   EFI_NOT_FOUND         The policy does not exist.
+**/
+EFI_STATUS
+EFIAPI
+GetPolicy (
+  IN CONST EFI_GUID  *PolicyGuid,
+  OUT UINT64         *Attributes OPTIONAL,
+  OUT VOID           *Policy,
+  IN OUT UINT16      *PolicySize
+  )
+{
+  HOST_POLICY  *Entry;
+  UINT16       BufferSize;
+
+  if ((PolicyGuid == NULL) || (PolicySize == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Entry = FindPolicy (PolicyGuid);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  BufferSize  = *PolicySize;
+  *PolicySize = Entry->PolicySize;
+  if ((BufferSize < Entry->PolicySize) || (Policy == NULL)) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  CopyMem (Policy, Entry->Policy, Entry->PolicySize);
+  if (Attributes != NULL) {
+    *Attributes = Entry->Attributes;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Removes a policy from the policy store.
+
+  @param[in]  PolicyGuid        The GUID of the policy being removed.
+
+  @retval   EFI_SUCCESS         The policy was removed.
+  @retval   EFI_NOT_FOUND       The policy does not exist.
+  @retval   EFI_ACCESS_DENIED   The policy is finalized.
+**/
+EFI_STATUS
+EFIAPI
+RemovePolicy (
+  IN CONST EFI_GUID  *PolicyGuid
+  )
+{
+  HOST_POLICY  *Entry;
+
+  Entry = FindPolicy (PolicyGuid);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if ((Entry->Attributes & POLICY_ATTRIBUTE_FINALIZED) != 0) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  FreePool (Entry->Policy);
+  Entry->Policy = NULL;
+  return EFI_SUCCESS;
+}
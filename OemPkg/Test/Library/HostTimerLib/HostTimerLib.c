@@ -0,0 +1,120 @@
+/** @file HostTimerLib.c
+
+  TimerLib instance for host based unit tests that time what they run.
+
+  The performance counter is the host clock in nanoseconds, counting up from 0 to MAX_UINT64, so a
+  tick is a nanosecond. The delays spin on the same clock.
+
+  Copyright (C) Microsoft Corporation. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <Uefi.h>
+
+#include <Library/TimerLib.h>
+
+/**
+  Retrieves the current value of the performance counter.
+
+  @return The host clock in nanoseconds.
+
+**/
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  timespec_get (&Now, TIME_UTC);
+  return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+/**
+  Retrieves the 64-bit frequency in Hz and the range of the performance counter.
+
+  @param  StartValue  The value the counter starts at, 0.
+  @param  EndValue    The value the counter ends at, MAX_UINT64.
+
+  @return The frequency in Hz, 1000000000.
+
+**/
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue  OPTIONAL,
+  OUT UINT64  *EndValue    OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+
+  return 1000000000;
+}
+
+/**
+  Converts elapsed ticks of the performance counter to elapsed time in nanoseconds.
+
+  @param  Ticks   The number of elapsed ticks.
+
+  @return The elapsed time in nanoseconds, which is Ticks.
+
+**/
+UINT64
+EFIAPI
+GetTimeInNanoSecond (
+  IN UINT64  Ticks
+  )
+{
+  return Ticks;
+}
+
+/**
+  Stalls the CPU for at least the given number of nanoseconds.
+
+  @param  NanoSeconds   The minimum number of nanoseconds to delay.
+
+  @return NanoSeconds.
+
+**/
+UINTN
+EFIAPI
+NanoSecondDelay (
+  IN UINTN  NanoSeconds
+  )
+{
+  UINT64  Start;
+
+  Start = GetPerformanceCounter ();
+  while (GetPerformanceCounter () - Start < NanoSeconds) {
+  }
+
+  return NanoSeconds;
+}
+
+/**
+  Stalls the CPU for at least the given number of microseconds.
+
+  @param  MicroSeconds  The minimum number of microseconds to delay.
+
+  @return MicroSeconds.
+
+**/
+UINTN
+EFIAPI
+MicroSecondDelay (
+  IN UINTN  MicroSeconds
+  )
+{
+  NanoSecondDelay (MicroSeconds * 1000);
+  return MicroSeconds;
+}